@@ -0,0 +1,236 @@
+/**
+ * @file arena_bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host benchmark of the SDRAM arenas against malloc: allocation
+ * throughput, heap fragmentation over many attempts and DTW scratch.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_arena_bench [--attempts N] [--seed S]
+ *
+ * Throughput: rounds of 16 allocations of 16 B to 4 KB, released together,
+ * with malloc()/free() and with Arena::allocate()/reset().
+ *
+ * Attempts: N unlock attempts as the gyroscope thread makes them. Each
+ * records up to a minute of samples by push_back() without reserving,
+ * takes a DTW matrix against the key and a few small scratch buffers, and
+ * every 20th attempt re-enrolls a long-lived key on the heap. Done once
+ * with everything on the heap and once with the transient buffers in the
+ * capture and DTW arenas (reset per attempt), the arena run first. mmap
+ * and trimming are disabled, as a microcontroller heap grows by sbrk()
+ * only, so the heap growth is the most the run ever needed; it is
+ * compared with the bytes still live at the end (glibc only).
+ *
+ * DTW: dtw() of two one-minute recordings with the matrix on the heap and
+ * in SdramArena(ARENA_DTW). The arena tests (host/test/arena_test.cpp)
+ * check that an attempt fits the arenas and that the distances agree.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "arena.h"
+#include "utilities.h"
+
+namespace {
+
+typedef std::vector<std::array<float, 3>> Gesture;
+typedef std::chrono::steady_clock Clock;
+
+const size_t kMinuteSamples = 60 * GYRO_SAMPLE_RATE_HZ / RECORDING_DECIMATION;
+
+volatile uintptr_t g_sink;  // keeps the allocations from being optimized out
+
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+double elapsed_ns(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+      .count();
+}
+
+// Heap bytes taken from the system and bytes in use
+struct Heap {
+  size_t footprint;
+  size_t in_use;
+};
+
+Heap heap() {
+#ifdef __GLIBC__
+  struct mallinfo2 info = mallinfo2();
+  return {info.arena + info.hblkhd, info.uordblks + info.hblkhd};
+#else
+  return {0, 0};
+#endif
+}
+
+void throughput(int rounds) {
+  const int kBlocks = 16;
+  std::mt19937 rng(1);
+  std::vector<size_t> sizes(rounds * kBlocks);
+  for (auto &size : sizes) size = 16 + rng() % 4081;
+
+  void *blocks[kBlocks];
+  auto start = Clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (int b = 0; b < kBlocks; b++) {
+      blocks[b] = malloc(sizes[r * kBlocks + b]);
+      g_sink = (uintptr_t)blocks[b];
+    }
+    for (int b = 0; b < kBlocks; b++) free(blocks[b]);
+  }
+  double heap_ns = elapsed_ns(start) / sizes.size();
+
+  Arena &arena = SdramArena(ARENA_DTW);
+  start = Clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (int b = 0; b < kBlocks; b++) {
+      g_sink = (uintptr_t)arena.allocate(sizes[r * kBlocks + b]);
+    }
+    arena.reset();
+  }
+  double arena_ns = elapsed_ns(start) / sizes.size();
+
+  printf("allocation: malloc/free %.1f ns, arena %.1f ns (%.1fx)\n",
+         heap_ns, arena_ns, heap_ns / arena_ns);
+}
+
+struct Attempts {
+  double ms;
+  Heap heap;
+  size_t live;  // bytes of the keys still enrolled
+  uint32_t arena_failures;
+};
+
+// One run of the attempt workload; with_arenas puts the transient buffers
+// in the SDRAM arenas
+Attempts attempts(int count, uint32_t seed, bool with_arenas) {
+  std::mt19937 rng(seed);
+  std::vector<Gesture *> keys(4, nullptr);
+  Arena &capture = SdramArena(ARENA_CAPTURE);
+  Arena &dtw_arena = SdramArena(ARENA_DTW);
+  Heap before = heap();
+
+  auto start = Clock::now();
+  for (int a = 0; a < count; a++) {
+    size_t samples = RECORDING_SAMPLES + rng() % (kMinuteSamples + 1);
+    size_t key_samples = RECORDING_SAMPLES + rng() % RECORDING_SAMPLES;
+
+    // Re-enroll one of the long-lived keys now and then
+    if (a % 20 == 0) {
+      size_t slot = rng() % keys.size();
+      delete keys[slot];
+      keys[slot] = new Gesture(key_samples);
+    }
+
+    if (with_arenas) {
+      capture.reset();
+      dtw_arena.reset();
+      ArenaSamples recording{ArenaAllocator<std::array<float, 3>>(capture)};
+      for (size_t i = 0; i < samples; i++) recording.push_back({1, 2, 3});
+      float *matrix =
+          dtw_arena.allocate_array<float>((samples + 1) * (key_samples + 1));
+      if (matrix != nullptr) matrix[0] = 0;
+      for (int s = 0; s < 6; s++) {
+        g_sink = (uintptr_t)dtw_arena.allocate(64 + rng() % 448);
+      }
+      g_sink = (uintptr_t)matrix + recording.size();
+    } else {
+      Gesture recording;
+      for (size_t i = 0; i < samples; i++) recording.push_back({1, 2, 3});
+      std::vector<float> matrix((samples + 1) * (key_samples + 1));
+      void *scratch[6];
+      for (int s = 0; s < 6; s++) scratch[s] = malloc(64 + rng() % 448);
+      g_sink = (uintptr_t)matrix.data() + recording.size();
+      for (int s = 0; s < 6; s++) free(scratch[s]);
+    }
+  }
+  double ms = elapsed_ns(start) / 1e6;
+
+  Heap after = heap();
+  size_t live = 0;
+  for (Gesture *key : keys) {
+    if (key != nullptr) live += key->size() * sizeof((*key)[0]);
+    delete key;
+  }
+  return {ms,
+          {after.footprint - before.footprint, after.in_use - before.in_use},
+          live,
+          capture.stats().failures + dtw_arena.stats().failures};
+}
+
+void print_attempts(const char *name, const Attempts &run) {
+  printf("%-8s %9.1f %12zu %12zu %10zu\n", name, run.ms,
+         run.heap.footprint, run.heap.in_use, run.live);
+}
+
+Gesture recording(std::mt19937 &rng, size_t samples) {
+  std::uniform_real_distribution<float> rate(-200.0f, 200.0f);
+  Gesture gesture(samples);
+  for (auto &sample : gesture) sample = {rate(rng), rate(rng), rate(rng)};
+  return gesture;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int count = atoi(option(argc, argv, "--attempts", "2000"));
+  uint32_t seed = strtoul(option(argc, argv, "--seed", "1"), nullptr, 0);
+  if (!SdramArenaInit()) {
+    printf("no memory for the arenas\n");
+    return 1;
+  }
+#ifdef __GLIBC__
+  mallopt(M_MMAP_THRESHOLD, 64 * 1024 * 1024);  // the board has no mmap
+  mallopt(M_TRIM_THRESHOLD, 64 * 1024 * 1024);  // nor gives memory back
+#endif
+
+  printf("%-8s %9s %12s %12s %10s\n", "attempts", "wall ms", "heap growth",
+         "heap in use", "live keys");
+  Attempts arena_run = attempts(count, seed, true);
+  Attempts heap_run = attempts(count, seed, false);
+  print_attempts("heap", heap_run);
+  print_attempts("arenas", arena_run);
+  Arena_Stats capture = SdramArena(ARENA_CAPTURE).stats();
+  Arena_Stats dtw_stats = SdramArena(ARENA_DTW).stats();
+  printf("(%d attempts of up to %zu samples; arena high water: capture %zu "
+         "KB, DTW %zu KB; %u requests did not fit)\n\n",
+         count, RECORDING_SAMPLES + kMinuteSamples, capture.high_water / 1024,
+         dtw_stats.high_water / 1024, arena_run.arena_failures);
+
+  throughput(100000);
+
+  // DTW of two one-minute recordings
+  std::mt19937 rng(seed);
+  Gesture s = recording(rng, kMinuteSamples);
+  Gesture t = recording(rng, kMinuteSamples);
+  auto start = Clock::now();
+  float on_heap = dtw(s, t);
+  double heap_ms = elapsed_ns(start) / 1e6;
+  SdramArena(ARENA_DTW).reset();
+  start = Clock::now();
+  float in_arena = dtw(s, t, &SdramArena(ARENA_DTW));
+  double arena_ms = elapsed_ns(start) / 1e6;
+  printf("\ndtw %zu x %zu: heap %.2f ms (%.1f), arena %.2f ms (%.1f)\n",
+         s.size(), t.size(), heap_ms, on_heap, arena_ms, in_arena);
+
+  return 0;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file blackbox_bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host benchmark of the black box recorder on the simulated SDRAM:
+ * append cost and the size and time of the serial dump.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_blackbox_bench [--attempts N] [--seed S] [--out FILE]
+ *
+ * The box lives in SdramArena(ARENA_BLACKBOX), which the host build
+ * carves from a plain buffer, and is fed as on the board: a synthetic
+ * source behind BlackBoxGyroSource, RecordGesture(), trim_gyro_data() and
+ * MatchGesture() against a key, with the key's gesture and another one in
+ * turn.
+ *
+ * Dump: after N attempts the box is dumped as capture sessions; bytes per
+ * sample kept and the time it takes. --out saves the dump for
+ * `sentry_capture info`.
+ *
+ * Append: cost of add_sample() per sample.
+ *
+ * The blackbox tests (host/test/blackbox_test.cpp) check what the dump
+ * holds and what survives a warm reset or a power cycle.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "arena.h"
+#include "blackbox.h"
+#include "fixtures.h"
+#include "utilities.h"
+
+namespace {
+
+typedef std::vector<std::array<float, 3>> Gesture;
+typedef std::chrono::steady_clock Clock;
+
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+size_t vector_sink(void *context, const uint8_t *data, size_t size) {
+  std::vector<uint8_t> *out = static_cast<std::vector<uint8_t> *>(context);
+  out->insert(out->end(), data, data + size);
+  return size;
+}
+
+// One attempt as the gyroscope thread makes it; true if it unlocked
+bool attempt(BlackBox &box, const Gesture &key, bool genuine, uint32_t seed,
+             uint32_t number) {
+  SyntheticGyroSource raw(fixtures::gesture(genuine),
+                          synth::typical_variation(), seed);
+  Gyroscope_Calibration calibration;
+  fixtures::calibrate(raw, calibration);
+
+  BlackBoxGyroSource source(raw, box);
+  Capture_Session session = {number, GYRO_SAMPLE_RATE_HZ, fixtures::kInit.conf4,
+                             raw.sensitivity(), calibration};
+  source.begin(session);
+  Gesture recording;
+  RecordGesture(source, calibration, RECORDING_SAMPLES, recording);
+  trim_gyro_data(recording);
+
+  Gesture key_copy = key;  // MatchGesture modifies its inputs
+  Match_Result match = MatchGesture(key_copy, recording);
+  box.finish(match);
+  return match.unlocked;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int attempts = atoi(option(argc, argv, "--attempts", "50"));
+  uint32_t seed = strtoul(option(argc, argv, "--seed", "1"), nullptr, 0);
+  if (!SdramArenaInit()) {
+    printf("no memory for the arenas\n");
+    return 1;
+  }
+  size_t size = BlackBox::region_size(BLACKBOX_ATTEMPTS);
+  void *region = SdramArena(ARENA_BLACKBOX).allocate(size);
+  memset(region, 0, size);
+
+  BlackBox box;
+  if (!box.init(region, size)) {
+    printf("black box does not fit in ARENA_BLACKBOX\n");
+    return 1;
+  }
+  printf("black box: %zu attempts of up to %d samples, %zu bytes (%zu per "
+         "attempt)\n\n",
+         box.capacity(), BLACKBOX_SAMPLES, size, sizeof(Blackbox_Slot));
+
+  // The key, recorded like any attempt
+  Gesture key;
+  {
+    SyntheticGyroSource raw(fixtures::gesture(true),
+                            synth::typical_variation(), seed);
+    Gyroscope_Calibration calibration;
+    fixtures::calibrate(raw, calibration);
+    RecordGesture(raw, calibration, RECORDING_SAMPLES, key);
+    trim_gyro_data(key);
+  }
+
+  int unlocked = 0;
+  for (int a = 0; a < attempts; a++) {
+    unlocked += attempt(box, key, a % 2 == 0, seed + 1 + a, a + 1);
+  }
+
+  std::vector<uint8_t> bytes;
+  CaptureWriter writer(vector_sink, &bytes);
+  auto start = Clock::now();
+  size_t dumped = box.dump(writer);
+  std::chrono::duration<double, std::milli> dump_ms = Clock::now() - start;
+  const char *out = option(argc, argv, "--out", nullptr);
+  if (out != nullptr) {
+    FILE *file = fopen(out, "wb");
+    if (file != nullptr) {
+      fwrite(bytes.data(), 1, bytes.size(), file);
+      fclose(file);
+    }
+  }
+
+  // Samples kept, from the dump itself
+  size_t samples = 0;
+  CaptureParser parser;
+  Capture_Sample batch[CAPTURE_BATCH_SAMPLES];
+  for (uint8_t byte : bytes) {
+    if (parser.push(byte) && parser.type() == CAPTURE_SAMPLES) {
+      samples += DecodeCaptureSamples(parser.payload(), parser.size(), batch);
+    }
+  }
+  printf("%d attempts (%d unlocked), %zu dumped\n", attempts, unlocked,
+         dumped);
+  printf("dump: %zu bytes for %zu samples (%.2f bytes per sample), %.2f ms\n",
+         bytes.size(), samples, (double)bytes.size() / samples,
+         dump_ms.count());
+
+  // Append cost: one slot filled over and over
+  {
+    const int kRounds = 2000;
+    Capture_Session session = {};
+    Gyroscope_RawData raw = {1, 2, 3};
+    double ns = 0;
+    for (int r = 0; r < kRounds; r++) {
+      box.begin(session);
+      auto t0 = Clock::now();
+      for (uint32_t i = 0; i < BLACKBOX_SAMPLES; i++) {
+        raw.x_raw = (int16_t)i;
+        box.add_sample(i * 5000, raw);
+      }
+      ns += std::chrono::duration<double, std::nano>(Clock::now() - t0)
+                .count();
+      box.finish(CAPTURE_OUTCOME_ENROLLED);
+    }
+    printf("append: %.2f ns per sample\n", ns / kRounds / BLACKBOX_SAMPLES);
+  }
+
+  return 0;
+}
@@ -0,0 +1,255 @@
+/**
+ * @file boot_bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host benchmark of the boot path (mount and key load) and its
+ * recovery from power loss, on the flash emulator.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_boot_bench [--trials N] [--seed S]
+ *
+ * Boot time: mounts and loads the key slot as main() does, for a blank
+ * chip, a store holding one key, and a store whose sectors are all in use
+ * after a long enrollment history. Reports wall time, the flash bytes read
+ * and the modeled flash busy time, and compares the worst case with
+ * BOOT_LOAD_BUDGET_MS.
+ *
+ * Power loss: each trial builds a random history, then cuts the power at a
+ * random byte of one more write or delete (including the compactions it
+ * triggers) and boots again. The key slot has to hold either the template
+ * from before or the one being written, never a damaged or older one,
+ * every other slot has to be unchanged, and the store has to accept and
+ * keep a new write afterwards.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "gesture_synth.h"
+#include "template_codec.h"
+#include "template_store.h"
+
+namespace {
+
+typedef std::vector<std::array<float, 3>> Gesture;
+
+const uint16_t kRate = GYRO_SAMPLE_RATE_HZ / RECORDING_DECIMATION;
+
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+Gesture random_key(synth::Rng &rng) {
+  Gesture key;
+  synth::generate(synth::random_spec(rng), synth::typical_variation(),
+                  rng.next(), key);
+  key.resize(std::max<size_t>(20, std::min<size_t>(key.size(),
+                                                   RECORDING_SAMPLES)));
+  return key;
+}
+
+// What read() returns for a template written with the default encoding
+Gesture stored_form(const Gesture &key) {
+  if (!TEMPLATE_COMPRESS) return key;
+  std::vector<uint8_t> encoded;
+  Gesture decoded;
+  TemplateEncode(key, TEMPLATE_QUANTUM, encoded);
+  TemplateDecode(encoded.data(), encoded.size(), decoded);
+  return decoded;
+}
+
+// Random writes and deletes; shadow tracks what each slot should hold
+void build_history(TemplateStore &store, synth::Rng &rng, int ops,
+                   std::vector<Gesture> &shadow) {
+  for (int i = 0; i < ops; i++) {
+    uint8_t slot = rng.next() % TEMPLATE_SLOTS;
+    if (rng.uniform() < 0.1f) {
+      store.remove(slot);
+      shadow[slot].clear();
+    } else {
+      Gesture key = random_key(rng);
+      if (store.write(slot, key, kRate)) shadow[slot] = stored_form(key);
+    }
+    store.maintain();
+  }
+}
+
+struct Boot {
+  double wall_ms;
+  uint64_t read_bytes;
+  uint64_t busy_us;
+  bool loaded;
+};
+
+// The boot path of main(): mount, then load the key slot
+Boot boot(Gesture &key) {
+  flash_emulator_reset_stats();
+  auto start = std::chrono::steady_clock::now();
+  TemplateStore store;
+  key.reserve(RECORDING_SAMPLES);
+  bool loaded = store.mount() && store.read(TEMPLATE_KEY_SLOT, key);
+  std::chrono::duration<double, std::milli> wall =
+      std::chrono::steady_clock::now() - start;
+  FlashIAP_Stats flash = flash_emulator_stats();
+  return {wall.count(), flash.read_bytes, flash.busy_us, loaded};
+}
+
+void report_boot(const char *name, int trials,
+                 void (*prepare)(synth::Rng &), uint64_t seed,
+                 double &worst_ms) {
+  std::vector<double> wall;
+  Boot last = {};
+  for (int t = 0; t < trials; t++) {
+    synth::Rng rng(seed + t);
+    prepare(rng);
+    Gesture key;
+    last = boot(key);
+    wall.push_back(last.wall_ms);
+  }
+  std::sort(wall.begin(), wall.end());
+  double median = wall[wall.size() / 2];
+  worst_ms = std::max(worst_ms, median + last.busy_us / 1e3);
+  printf("%-14s %9.3f %9.3f %10llu %10.1f %6s\n", name, median, wall.back(),
+         (unsigned long long)last.read_bytes, last.busy_us / 1e3,
+         last.loaded ? "yes" : "no");
+}
+
+void prepare_blank(synth::Rng &) { flash_emulator_erase_all(); }
+
+void prepare_one_key(synth::Rng &rng) {
+  flash_emulator_erase_all();
+  TemplateStore store;
+  store.mount();
+  store.write(TEMPLATE_KEY_SLOT, random_key(rng), kRate);
+}
+
+void prepare_full(synth::Rng &rng) {
+  flash_emulator_erase_all();
+  TemplateStore store;
+  std::vector<Gesture> shadow(TEMPLATE_SLOTS);
+  store.mount();
+  build_history(store, rng, 300, shadow);
+  // Fill up to the reserve without letting maintain() reclaim anything
+  Gesture key = random_key(rng);
+  while (store.stats().free_sectors > TEMPLATE_STORE_RESERVE) {
+    store.write(rng.next() % TEMPLATE_SLOTS, key, kRate);
+  }
+  store.write(TEMPLATE_KEY_SLOT, key, kRate);
+}
+
+enum Outcome { OUTCOME_OLD, OUTCOME_NEW, OUTCOME_VIOLATION };
+
+// One power-loss trial; cut_at is the byte of the final operation at which
+// the power fails
+Outcome power_loss_trial(uint64_t seed, uint64_t cut_at, bool &cut) {
+  synth::Rng rng(seed);
+  flash_emulator_erase_all();
+  std::vector<Gesture> shadow(TEMPLATE_SLOTS);
+  Outcome outcome;
+  Gesture fresh;
+  {
+    TemplateStore store;
+    store.mount();
+    build_history(store, rng, 10 + rng.next() % 200, shadow);
+
+    bool remove = rng.uniform() < 0.2f;
+    Gesture next = remove ? Gesture() : random_key(rng);
+    Gesture before = shadow[TEMPLATE_KEY_SLOT];
+    Gesture after = remove ? Gesture() : stored_form(next);
+
+    flash_emulator_cut_power(cut_at, (uint32_t)rng.next());
+    if (remove) {
+      store.remove(TEMPLATE_KEY_SLOT);
+    } else {
+      store.write(TEMPLATE_KEY_SLOT, next, kRate);
+    }
+    cut = flash_emulator_power_lost();
+    flash_emulator_restore_power();
+
+    // Reboot
+    TemplateStore rebooted;
+    if (!rebooted.mount()) return OUTCOME_VIOLATION;
+    for (uint8_t slot = 0; slot < TEMPLATE_SLOTS; slot++) {
+      if (slot == TEMPLATE_KEY_SLOT) continue;
+      Gesture loaded;
+      bool present = rebooted.read(slot, loaded);
+      if (present != !shadow[slot].empty() ||
+          (present && loaded != shadow[slot])) {
+        return OUTCOME_VIOLATION;
+      }
+    }
+    Gesture loaded;
+    if (!rebooted.read(TEMPLATE_KEY_SLOT, loaded)) loaded.clear();
+    outcome = loaded == after    ? OUTCOME_NEW
+              : loaded == before ? OUTCOME_OLD
+                                 : OUTCOME_VIOLATION;
+    if (outcome == OUTCOME_VIOLATION) return outcome;
+
+    // The store has to keep working after the recovery
+    fresh = random_key(rng);
+    if (!rebooted.write(TEMPLATE_KEY_SLOT, fresh, kRate)) {
+      return OUTCOME_VIOLATION;
+    }
+    rebooted.maintain();
+  }
+  TemplateStore again;
+  Gesture loaded;
+  if (!again.mount() || !again.read(TEMPLATE_KEY_SLOT, loaded) ||
+      loaded != stored_form(fresh)) {
+    return OUTCOME_VIOLATION;
+  }
+  return outcome;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int trials = atoi(option(argc, argv, "--trials", "2000"));
+  uint64_t seed = strtoull(option(argc, argv, "--seed", "1"), nullptr, 0);
+
+  double worst_ms = 0.0;
+  printf("%-14s %9s %9s %10s %10s %6s\n", "boot", "median ms", "max ms",
+         "read B", "flash ms", "key");
+  int boot_trials = std::max(1, std::min(trials, 50));
+  report_boot("blank chip", boot_trials, prepare_blank, seed, worst_ms);
+  report_boot("one key", boot_trials, prepare_one_key, seed, worst_ms);
+  report_boot("full store", boot_trials, prepare_full, seed, worst_ms);
+  printf("worst boot %.3f ms of host wall and modeled flash time, budget %d "
+         "ms\n\n",
+         worst_ms, BOOT_LOAD_BUDGET_MS);
+
+  // Power loss: cut points spread over the header, payload and any
+  // compaction of the last operation
+  long counts[3] = {0, 0, 0}, cuts = 0;
+  synth::Rng rng(seed);
+  for (int t = 0; t < trials; t++) {
+    bool cut = false;
+    uint64_t cut_at = rng.next() % (rng.uniform() < 0.8f ? 800 : 8192);
+    Outcome outcome = power_loss_trial(rng.next(), cut_at, cut);
+    counts[outcome]++;
+    if (cut) cuts++;
+    if (outcome == OUTCOME_VIOLATION) {
+      printf("violation: trial %d, cut at byte %llu\n", t,
+             (unsigned long long)cut_at);
+    }
+  }
+  printf("power loss: %d trials, %ld cut mid-operation\n", trials, cuts);
+  printf("  previous template kept %ld, new template %ld, violations %ld\n",
+         counts[OUTCOME_OLD], counts[OUTCOME_NEW], counts[OUTCOME_VIOLATION]);
+  return counts[OUTCOME_VIOLATION] == 0 && worst_ms <= BOOT_LOAD_BUDGET_MS
+             ? 0
+             : 1;
+}
@@ -0,0 +1,154 @@
+/**
+ * @file eeprom_bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host benchmark of the EEPROM record store on the emulated M24LR64:
+ * write-back cost and standby polling.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_eeprom_bench [--updates N] [--seed S]
+ *
+ * The emulator runs in real time: 90 us per byte on the bus and a 5 ms
+ * write cycle per page.
+ *
+ * Updates: N unlock attempts, each updating the attempt counters record
+ * (12 bytes), written three ways:
+ *
+ *   bsp:     the whole record with page writes, each followed by the BSP
+ *            standby wait (EEPROM_MAX_TRIALS back-to-back polls), as
+ *            BSP_EEPROM_WriteBuffer() does
+ *   store:   EepromStore::write() and flush() after every attempt
+ *   batched: EepromStore::flush() once every 10 attempts
+ *
+ * For each, reports the wall time, the pages written, the standby polls
+ * and the bus time they took (the CPU spins in the HAL for each poll), and
+ * the most write cycles any page saw. Recovery from power loss and the
+ * store without the module are tested in host/test/eeprom_store_test.cpp.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#include "eeprom_store.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// The record main() keeps in EEPROM_RECORD_ATTEMPTS
+typedef struct {
+  uint32_t attempts;
+  uint32_t failures;
+  uint32_t failure_streak;
+} Attempts;
+
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+Attempts next_attempt(Attempts a, std::mt19937 &rng) {
+  bool failed = rng() % 4 == 0;
+  a.attempts++;
+  a.failures += failed;
+  a.failure_streak = failed ? a.failure_streak + 1 : 0;
+  return a;
+}
+
+struct Run {
+  double wall_ms;
+  Eeprom_Emulator_Stats chip;
+};
+
+void print(const char *name, const Run &run) {
+  printf("%-8s %9.1f %7llu %7llu %10.2f %11u\n", name, run.wall_ms,
+         (unsigned long long)run.chip.page_writes,
+         (unsigned long long)run.chip.polls, run.chip.poll_us / 1e3,
+         run.chip.max_page_cycles);
+}
+
+// What BSP_EEPROM_WriteBuffer() does for a page-aligned buffer
+void bsp_write(uint16_t address, const void *data, size_t size) {
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  for (size_t offset = 0; offset < size; offset += EEPROM_PAGESIZE) {
+    uint8_t page[EEPROM_PAGESIZE];
+    memcpy(page, bytes + offset, EEPROM_PAGESIZE);
+    EEPROM_IO_WriteData(EEPROMAddress, address + offset, page,
+                        EEPROM_PAGESIZE);
+    while (EEPROM_IO_IsDeviceReady(EEPROMAddress, 1) == HAL_BUSY) {
+    }
+    BSP_EEPROM_WaitEepromStandbyState();
+  }
+}
+
+Run run_bsp(int updates, uint32_t seed) {
+  eeprom_emulator_erase_all();
+  BSP_EEPROM_Init();
+  eeprom_emulator_reset_stats();
+  std::mt19937 rng(seed);
+  Attempts attempts = {};
+  Eeprom_Record_Copy copy = {};
+  auto start = Clock::now();
+  for (int i = 0; i < updates; i++) {
+    attempts = next_attempt(attempts, rng);
+    copy.length = sizeof(attempts);
+    memcpy(copy.payload, &attempts, sizeof(attempts));
+    bsp_write(EEPROM_STORE_ADDRESS, &copy, sizeof(copy));
+  }
+  std::chrono::duration<double, std::milli> wall = Clock::now() - start;
+  return {wall.count(), eeprom_emulator_stats()};
+}
+
+Run run_store(int updates, int batch, uint32_t seed) {
+  eeprom_emulator_erase_all();
+  EepromStore store;
+  store.mount();
+  eeprom_emulator_reset_stats();
+  std::mt19937 rng(seed);
+  Attempts attempts = {};
+  auto start = Clock::now();
+  for (int i = 0; i < updates; i++) {
+    attempts = next_attempt(attempts, rng);
+    store.write(EEPROM_RECORD_ATTEMPTS, &attempts, sizeof(attempts));
+    if ((i + 1) % batch == 0) store.flush();
+  }
+  store.flush();
+  std::chrono::duration<double, std::milli> wall = Clock::now() - start;
+  return {wall.count(), eeprom_emulator_stats()};
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int updates = atoi(option(argc, argv, "--updates", "50"));
+  uint32_t seed = strtoul(option(argc, argv, "--seed", "1"), nullptr, 0);
+
+  // Mount: one sequential read of the whole store
+  {
+    EepromStore store;
+    auto start = Clock::now();
+    store.mount();
+    std::chrono::duration<double, std::milli> wall = Clock::now() - start;
+    printf("mount: %u bytes in %.2f ms\n\n", (unsigned)EEPROM_STORE_SIZE,
+           wall.count());
+  }
+
+  printf("%-8s %9s %7s %7s %10s %11s\n", "writes", "wall ms", "pages",
+         "polls", "poll ms", "max cycles");
+  print("bsp", run_bsp(updates, seed));
+  print("store", run_store(updates, 1, seed));
+  print("batched", run_store(updates, 10, seed));
+  printf("(%d attempts)\n", updates);
+  return 0;
+}
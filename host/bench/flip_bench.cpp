@@ -0,0 +1,180 @@
+/**
+ * @file flip_bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host benchmark of the double-buffered display on the framebuffer
+ * emulator: torn refreshes, pixel writes and the frame budget counters.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_flip_bench [--every N] [--seed S]
+ *
+ * Tearing: the status messages of an enrollment and an unlock are shown
+ * through a StatusLine twice, drawn straight to the screen and through
+ * FrameBuffers. A vertical blanking comes after a random 1 to N pixel
+ * writes, in the middle of drawing. A refresh that shows neither the last
+ * message nor the one being drawn, as a full redraw on a third display
+ * leaves them, is torn; a message not on screen once shown is wrong.
+ *
+ * Timing: the same messages back to back with the emulator refreshing in
+ * real time, so frames wait for flips, then one frame drawn for two and a
+ * half budgets.
+ *
+ * The frame_buffers tests (host/test/frame_buffers_test.cpp) check that
+ * double buffering tears nothing and what the counters make of both runs.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "frame_buffers.h"
+#include "status_line.h"
+
+namespace {
+
+const size_t kCount = STATUS_MESSAGE_COUNT;
+
+typedef std::vector<uint32_t> Frame;
+
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+Frame screen(const uint32_t *pixels) {
+  return Frame(pixels, pixels + 240 * 320);
+}
+
+// The screen before and after each message, drawn the old way
+std::vector<Frame> references() {
+  LCD_DISCO_F429ZI lcd;
+  lcd.Clear(LCD_COLOR_BLACK);
+  std::vector<Frame> frames = {screen(lcd.frame())};
+  for (const Status_Message &m : STATUS_MESSAGES) {
+    lcd.SetTextColor(LCD_COLOR_BLACK);
+    lcd.FillRect(0, STATUS_TEXT_Y, lcd.GetXSize(), FONT_SIZE);
+    lcd.SetTextColor(m.color);
+    lcd.DisplayStringAt(STATUS_TEXT_X, STATUS_TEXT_Y, (uint8_t *)m.text,
+                        CENTER_MODE);
+    frames.push_back(screen(lcd.frame()));
+  }
+  return frames;
+}
+
+struct Tearing {
+  uint32_t refreshes;
+  uint32_t torn;
+  uint32_t wrong;  // messages not on screen once shown
+  LCD_Emulator_Stats lcd;
+};
+
+// One run of the messages with refreshes in the middle of drawing
+Tearing tearing(bool buffered, uint32_t every, uint32_t seed,
+                const std::vector<Frame> &frames) {
+  LCD_DISCO_F429ZI lcd;
+  lcd.set_refresh_us(0);
+  lcd.Clear(LCD_COLOR_BLACK);
+  StatusLine line(lcd, STATUS_TEXT_X, STATUS_TEXT_Y);
+  FrameBuffers buffers(lcd, DISPLAY_FRONT_BUFFER, DISPLAY_BACK_BUFFER);
+  if (buffered) buffers.enable();
+  lcd.reset_stats();
+
+  Tearing result = {0, 0, 0, {}};
+  size_t shown = 0;  // frames[shown] is complete, frames[shown + 1] drawing
+  auto refresh = [&]() {
+    lcd.vblank();
+    result.refreshes++;
+    Frame now = screen(lcd.scanout());
+    if (now != frames[shown] && now != frames[shown + 1]) result.torn++;
+  };
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<uint32_t> writes(1, every);
+  lcd.set_write_hook(
+      [&]() {
+        refresh();
+        return writes(rng);
+      },
+      writes(rng));
+
+  for (size_t i = 0; i < kCount; i++) {
+    if (buffered) buffers.begin();
+    line.show(STATUS_MESSAGES[i].text, STATUS_MESSAGES[i].color);
+    if (buffered) {
+      buffers.damage(0, STATUS_TEXT_Y, lcd.GetXSize(), FONT_SIZE);
+      buffers.present();
+    }
+    refresh();
+    shown = i + 1;
+    if (screen(lcd.scanout()) != frames[shown]) result.wrong++;
+  }
+  lcd.set_write_hook(nullptr, 0);
+  result.lcd = lcd.stats();
+  return result;
+}
+
+void print_stats(const char *name, const Frame_Buffers_Stats &s,
+                 uint32_t budget_us) {
+  printf("%s: %lu frames, last %lu us, max %lu us (budget %lu us), "
+         "%lu over budget, %lu refreshes dropped, %lu waits for a flip "
+         "(%lu us), %llu pixels copied\n",
+         name, (unsigned long)s.frames, (unsigned long)s.last_us,
+         (unsigned long)s.max_us, (unsigned long)budget_us,
+         (unsigned long)s.over_budget, (unsigned long)s.dropped,
+         (unsigned long)s.waits, (unsigned long)s.wait_us,
+         (unsigned long long)s.copied_pixels);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  uint32_t every = strtoul(option(argc, argv, "--every", "400"), nullptr, 0);
+  uint32_t seed = strtoul(option(argc, argv, "--seed", "1"), nullptr, 0);
+  if (every == 0) every = 1;
+
+  std::vector<Frame> frames = references();
+  printf("%-8s %9s %6s %6s %12s %12s\n", "mode", "refreshes", "torn", "wrong",
+         "cpu px", "dma px");
+  for (int buffered = 0; buffered < 2; buffered++) {
+    Tearing t = tearing(buffered, every, seed, frames);
+    printf("%-8s %9lu %6lu %6lu %12llu %12llu\n",
+           buffered ? "double" : "direct", (unsigned long)t.refreshes,
+           (unsigned long)t.torn, (unsigned long)t.wrong,
+           (unsigned long long)t.lcd.cpu_pixels,
+           (unsigned long long)t.lcd.dma2d_pixels);
+  }
+
+  // Real time: the messages back to back, faster than the panel refreshes
+  LCD_DISCO_F429ZI lcd;
+  lcd.Clear(LCD_COLOR_BLACK);
+  StatusLine line(lcd, STATUS_TEXT_X, STATUS_TEXT_Y);
+  FrameBuffers buffers(lcd, DISPLAY_FRONT_BUFFER, DISPLAY_BACK_BUFFER);
+  buffers.enable();
+  for (int round = 0; round < 2; round++) {
+    for (const Status_Message &m : STATUS_MESSAGES) {
+      buffers.begin();
+      line.show(m.text, m.color);
+      buffers.damage(0, STATUS_TEXT_Y, lcd.GetXSize(), FONT_SIZE);
+      buffers.present();
+    }
+  }
+  Frame_Buffers_Stats fast = buffers.stats();
+  print_stats("back to back", fast, buffers.budget_us());
+
+  // One frame two and a half budgets long
+  buffers.begin();
+  wait_us(buffers.budget_us() * 5 / 2);
+  buffers.present();
+  Frame_Buffers_Stats slow = buffers.stats();
+  print_stats("slow frame", slow, buffers.budget_us());
+  return 0;
+}
@@ -0,0 +1,200 @@
+/**
+ * @file format_bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host comparison of the display drawn in ARGB8888, RGB565 and L8 on
+ * the framebuffer emulator: the pixels shown, the memory and the traffic.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_format_bench [--random N] [--seed S]
+ *
+ * The same scene is drawn in each format, put in it by DisplayFormatApply():
+ * the boot screen (buttons and welcome text, from the glyph atlas), the
+ * status messages through StatusLine and FrameBuffers as the firmware shows
+ * them, a rate plot of a few seconds of synthetic rates, then N random fills
+ * and texts in random colors (named or not, opaque or not).
+ *
+ * Prints, per format, the bytes a pixel, the frame buffer memory, the LTDC's
+ * scanout traffic, the SDRAM bytes the scene wrote and read, its CPU stores
+ * and DMA2D pixels. The display_format tests
+ * (host/test/display_format_test.cpp) check that each format shows the
+ * ARGB8888 scene, quantized.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "display_format.h"
+#include "frame_buffers.h"
+#include "glyph_atlas.h"
+#include "rate_plot.h"
+#include "status_line.h"
+
+namespace {
+
+const uint32_t kFormats[] = {LCD_PIXEL_FORMAT_ARGB8888,
+                             LCD_PIXEL_FORMAT_RGB565, LCD_PIXEL_FORMAT_L8};
+
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+// One part of the scene, drawn on every display
+typedef void (*Part)(LCD_DISCO_F429ZI &lcd, FrameBuffers &buffers,
+                     StatusLine &line, uint32_t seed);
+
+void boot_screen(LCD_DISCO_F429ZI &lcd, FrameBuffers &, StatusLine &,
+                 uint32_t) {
+  lcd.SetTextColor(LCD_COLOR_RED);
+  lcd.FillRect(20, 40, 200, 60);
+  lcd.FillRect(20, 120, 200, 60);
+  lcd.SetBackColor(LCD_COLOR_BLACK);
+  lcd.SetTextColor(LCD_COLOR_WHITE);
+  lcd.DisplayStringAt(0, 60, (uint8_t *)"Record", CENTER_MODE);
+  lcd.DisplayStringAt(0, 140, (uint8_t *)"Unlock", CENTER_MODE);
+  lcd.DisplayStringAt(0, 220, (uint8_t *)"Gesture Sentry", CENTER_MODE);
+}
+
+void status_messages(LCD_DISCO_F429ZI &lcd, FrameBuffers &buffers,
+                     StatusLine &line, uint32_t) {
+  for (const Status_Message &m : STATUS_MESSAGES) {
+    buffers.begin();
+    line.show(m.text, m.color);
+    buffers.damage(0, STATUS_TEXT_Y, lcd.GetXSize(), 16);
+    buffers.present();
+    lcd.vblank();
+  }
+}
+
+void rate_plot(LCD_DISCO_F429ZI &lcd, FrameBuffers &buffers, StatusLine &,
+               uint32_t seed) {
+  RatePlot plot(lcd, buffers, 0, RATE_PLOT_Y, lcd.GetXSize(),
+                RATE_PLOT_HEIGHT);
+  for (int i = 0; i < 3 * GYRO_SAMPLE_RATE_HZ; i++) {
+    float t = i / (float)GYRO_SAMPLE_RATE_HZ;
+    plot.add(200.0f * sinf(3.0f * t + seed), 120.0f * sinf(5.0f * t),
+             300.0f * cosf(2.0f * t));
+    if (i % RATE_PLOT_FRAME_SAMPLES == 0) {
+      plot.render(true);
+      lcd.vblank();
+    }
+  }
+  while (plot.pending() > 0) {
+    plot.render(true);
+    lcd.vblank();
+  }
+}
+
+int random_count = 0;
+
+void random_drawing(LCD_DISCO_F429ZI &lcd, FrameBuffers &buffers,
+                    StatusLine &line, uint32_t seed) {
+  const uint32_t named[] = {LCD_COLOR_GREEN,     LCD_COLOR_ORANGE,
+                            LCD_COLOR_DARKGRAY,  LCD_COLOR_LIGHTGREEN,
+                            LCD_COLOR_BROWN,     LCD_COLOR_DARKMAGENTA};
+  std::mt19937 rng(seed);
+  auto color = [&]() {
+    switch (rng() % 3) {
+      case 0:
+        return named[rng() % 6];
+      case 1:
+        return (uint32_t)(0xFF000000 | (rng() & 0xFFFFFF));
+      default:
+        return (uint32_t)rng();  // alpha too
+    }
+  };
+  buffers.begin();
+  for (int i = 0; i < random_count; i++) {
+    uint16_t x = rng() % lcd.GetXSize();
+    uint16_t y = rng() % (lcd.GetYSize() - 16);
+    lcd.SetTextColor(color());
+    if (rng() % 2 == 0) {
+      uint16_t width = 1 + rng() % (lcd.GetXSize() - x);
+      uint16_t height = 1 + rng() % (lcd.GetYSize() - y);
+      lcd.FillRect(x, y, width, height);
+    } else {
+      char text[16];
+      for (size_t c = 0; c + 1 < sizeof(text); c++) {
+        text[c] = (char)(' ' + rng() % LCD_ATLAS_GLYPHS);
+      }
+      text[1 + rng() % (sizeof(text) - 1)] = 0;
+      lcd.SetBackColor(color());
+      lcd.DisplayStringAt(x, y, (uint8_t *)text, LEFT_MODE);
+    }
+  }
+  buffers.damage(0, 0, lcd.GetXSize(), lcd.GetYSize());
+  buffers.present();
+  lcd.vblank();
+  line.invalidate();
+}
+
+const Part kParts[] = {boot_screen, status_messages, rate_plot,
+                       random_drawing};
+
+// A display in a format, with what the firmware draws through
+struct Display {
+  explicit Display(uint32_t format)
+      : line(lcd, STATUS_TEXT_X, STATUS_TEXT_Y),
+        buffers(lcd, DISPLAY_FRONT_BUFFER, DISPLAY_BACK_BUFFER) {
+    lcd.set_refresh_us(0);
+    DisplayFormatApply(lcd, format);
+    lcd.SetFont(&Font16);
+    lcd.Clear(LCD_COLOR_BLACK);
+    if (atlas.build(lcd.GetFont())) atlas.attach(lcd);
+    buffers.enable();
+    lcd.reset_stats();
+  }
+
+  LCD_DISCO_F429ZI lcd;
+  GlyphAtlas atlas;
+  StatusLine line;
+  FrameBuffers buffers;
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  random_count = atoi(option(argc, argv, "--random", "500"));
+  uint32_t seed = strtoul(option(argc, argv, "--seed", "1"), nullptr, 0);
+
+  const size_t formats = sizeof(kFormats) / sizeof(kFormats[0]);
+  std::vector<Display *> displays;
+  for (uint32_t format : kFormats) displays.push_back(new Display(format));
+
+  for (Part part : kParts) {
+    for (Display *display : displays) {
+      part(display->lcd, display->buffers, display->line, seed);
+    }
+  }
+
+  printf("%-9s %5s %10s %12s %12s %12s %10s %10s\n", "format", "bytes",
+         "buffers", "scanout B/s", "written", "read", "cpu", "dma2d");
+  for (size_t f = 0; f < formats; f++) {
+    LCD_DISCO_F429ZI &lcd = displays[f]->lcd;
+    Display_Format_Report report = DisplayFormatReport(lcd);
+    LCD_Emulator_Stats s = lcd.stats();
+    printf("%-9s %5lu %10lu %12lu %12llu %12llu %10llu %10llu\n",
+           report.name, (unsigned long)report.bytes_per_pixel,
+           (unsigned long)report.buffers_bytes,
+           (unsigned long)report.scanout_bytes_per_s,
+           (unsigned long long)s.bytes_written,
+           (unsigned long long)s.bytes_read,
+           (unsigned long long)s.cpu_pixels,
+           (unsigned long long)s.dma2d_pixels);
+  }
+  for (Display *display : displays) delete display;
+  return 0;
+}
@@ -0,0 +1,167 @@
+/**
+ * @file lcd_bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host comparison of the status line redraws on the framebuffer
+ * emulator: full strip redraw against StatusLine.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_lcd_bench [--random N] [--seed S]
+ *
+ * Two emulated displays get the same messages: one the old
+ * display_status() (fill the strip, draw the whole string), the other a
+ * StatusLine. The message sequences are the firmware's: boot, enrollment,
+ * a failed and a successful unlock, an erase and the touch buttons.
+ *
+ * Prints, per sequence, the pixels written by the CPU (glyphs) and by
+ * DMA2D fills either way. --random adds N random strings of 0 to 24
+ * characters (over-long ones included) in random colors. The status_line
+ * tests (host/test/status_line_test.cpp) check that both ways give the
+ * same frames.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fixtures.h"
+#include "status_line.h"
+
+namespace {
+
+struct Sequence {
+  const char *name;
+  std::vector<Status_Message> messages;
+};
+
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+// display_status() before StatusLine
+void full_redraw(LCD_DISCO_F429ZI &lcd, const char *text, uint32_t color) {
+  lcd.SetTextColor(LCD_COLOR_BLACK);
+  lcd.FillRect(0, STATUS_TEXT_Y, lcd.GetXSize(), FONT_SIZE);
+  lcd.SetTextColor(color);
+  lcd.DisplayStringAt(STATUS_TEXT_X, STATUS_TEXT_Y, (uint8_t *)text,
+                      CENTER_MODE);
+}
+
+// A sequence of the firmware's messages, after a recording if given
+Sequence sequence(const char *name, bool recording,
+                  std::initializer_list<Status_Message_Id> ids) {
+  Sequence made = {name, {}};
+  if (recording) made.messages = fixtures::recording_messages();
+  for (Status_Message_Id id : ids) made.messages.push_back(STATUS_MESSAGES[id]);
+  return made;
+}
+
+std::vector<Sequence> sequences() {
+  return {sequence("boot", false, {STATUS_NO_KEY}),
+          sequence("enroll", true, {STATUS_SAVING_KEY, STATUS_KEY_SAVED}),
+          sequence("unlock fail", true,
+                   {STATUS_UNLOCKING, STATUS_UNLOCK_FAILED}),
+          sequence("unlock ok", true,
+                   {STATUS_UNLOCKING, STATUS_UNLOCK_SUCCESS}),
+          sequence("erase", false,
+                   {STATUS_ERASING, STATUS_KEY_ERASED, STATUS_ALL_ERASED}),
+          sequence("touch", false,
+                   {STATUS_RECORD_INITIATED, STATUS_UNLOCK_INITIATED})};
+}
+
+struct Totals {
+  uint64_t cpu[2];
+  uint64_t dma2d[2];
+};
+
+// One message on both displays
+void show(LCD_DISCO_F429ZI &full, LCD_DISCO_F429ZI &diffed,
+          StatusLine &line, const Status_Message &m, Totals &totals) {
+  full.reset_stats();
+  diffed.reset_stats();
+  full_redraw(full, m.text, m.color);
+  line.show(m.text, m.color);
+  totals.cpu[0] += full.stats().cpu_pixels;
+  totals.dma2d[0] += full.stats().dma2d_pixels;
+  totals.cpu[1] += diffed.stats().cpu_pixels;
+  totals.dma2d[1] += diffed.stats().dma2d_pixels;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int random = atoi(option(argc, argv, "--random", "2000"));
+  uint32_t seed = strtoul(option(argc, argv, "--seed", "1"), nullptr, 0);
+
+  // As main() leaves the screen before the first message
+  LCD_DISCO_F429ZI full;
+  LCD_DISCO_F429ZI diffed;
+  full.Clear(LCD_COLOR_BLACK);
+  diffed.Clear(LCD_COLOR_BLACK);
+  StatusLine line(diffed, STATUS_TEXT_X, STATUS_TEXT_Y);
+
+  printf("%-12s %5s %12s %12s %12s %12s\n", "sequence", "msgs",
+         "full cpu px", "full dma px", "diff cpu px", "diff dma px");
+  Totals all = {{0, 0}, {0, 0}};
+  for (const Sequence &sequence : sequences()) {
+    Totals totals = {{0, 0}, {0, 0}};
+    for (const Status_Message &m : sequence.messages) {
+      show(full, diffed, line, m, totals);
+    }
+    printf("%-12s %5u %12llu %12llu %12llu %12llu\n", sequence.name,
+           (unsigned)sequence.messages.size(),
+           (unsigned long long)totals.cpu[0],
+           (unsigned long long)totals.dma2d[0],
+           (unsigned long long)totals.cpu[1],
+           (unsigned long long)totals.dma2d[1]);
+    for (int i = 0; i < 2; i++) {
+      all.cpu[i] += totals.cpu[i];
+      all.dma2d[i] += totals.dma2d[i];
+    }
+  }
+  printf("%-12s %5s %12llu %12llu %12llu %12llu\n", "total", "",
+         (unsigned long long)all.cpu[0], (unsigned long long)all.dma2d[0],
+         (unsigned long long)all.cpu[1], (unsigned long long)all.dma2d[1]);
+  printf("CPU pixel stores: %.1f %% of a full redraw\n",
+         100.0 * all.cpu[1] / all.cpu[0]);
+
+  Status_Line_Stats stats = line.stats();
+  printf("status line: %lu updates, %lu full redraws, %lu glyphs drawn, "
+         "%lu kept, %lu fills\n",
+         (unsigned long)stats.updates, (unsigned long)stats.full_redraws,
+         (unsigned long)stats.glyphs_drawn, (unsigned long)stats.glyphs_kept,
+         (unsigned long)stats.fills);
+
+  // Random texts, over-long ones included
+  std::mt19937 rng(seed);
+  const uint32_t colors[] = {LCD_COLOR_GREEN, LCD_COLOR_RED, LCD_COLOR_ORANGE,
+                             LCD_COLOR_YELLOW};
+  const char alphabet[] = "  ....0123ACEGIKLNORSUaegiknorsu:";
+  Totals fuzz = {{0, 0}, {0, 0}};
+  for (int i = 0; i < random; i++) {
+    std::string text(rng() % 25, ' ');
+    for (char &c : text) c = alphabet[rng() % (sizeof(alphabet) - 1)];
+    if (i % 97 == 0) diffed.SetBackColor(rng() % 2 ? LCD_COLOR_WHITE
+                                                   : LCD_COLOR_BLACK);
+    full.SetBackColor(diffed.GetBackColor());
+    Status_Message m = {text.c_str(), colors[rng() % 4]};
+    show(full, diffed, line, m, fuzz);
+  }
+  if (random > 0) {
+    printf("random: %d texts, CPU stores %.1f %%\n", random,
+           100.0 * fuzz.cpu[1] / fuzz.cpu[0]);
+  }
+  return 0;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file memory_bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host run of the memory report: stack high-water marks of the
+ * gyroscope and flash writer threads, heap usage per attempt.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_memory_bench [--attempts N] [--seed S]
+ *
+ * The threads are set up as main() sets them up: stacks of
+ * GYROSCOPE_STACK_SIZE and FLASH_WRITER_STACK_SIZE, painted with
+ * MemoryWatchStack() before they start. The gyroscope thread enrolls a key
+ * and makes N unlock attempts the way gyroscope_thread() does: the
+ * recording in the capture arena, trim_gyro_data(), the key persisted by
+ * the FlashWriter and its features rebuilt from flash, then MatchFeatures()
+ * against the key's gesture and another one in turn.
+ *
+ * Prints the allocations and heap growth of every attempt and
+ * MemoryPrint(). The memory_report tests (host/test/memory_report_test.cpp)
+ * check that neither stack is used to its last byte and that the unlock
+ * attempts keep no more heap than the one recording buffer they reuse.
+ *
+ * x86-64 frames are larger than Cortex-M4 ones and glibc keeps its thread
+ * block on the stack, so the host marks bound the board's from above;
+ * the board's own come from the 'm' console command.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+#include "capture.h"
+#include "fixtures.h"
+#include "flash_writer.h"
+#include "gyro_source.h"
+#include "matcher.h"
+#include "memory_report.h"
+#include "template_features.h"
+#include "template_store.h"
+#include "utilities.h"
+
+namespace {
+
+const uint16_t kRate = GYRO_SAMPLE_RATE_HZ / RECORDING_DECIMATION;
+
+MBED_ALIGN(8) unsigned char gyroscope_stack[GYROSCOPE_STACK_SIZE];
+
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+struct Session {
+  int attempts;
+  uint32_t seed;
+  TemplateStore store;
+  FlashWriter *writer;
+  TemplateFeatures features;
+  std::vector<Memory_Attempt> results;
+
+  Session() : features(&SdramArena(ARENA_TEMPLATE)) {}
+};
+
+// One recording into the capture arena, as the gyroscope thread makes it
+void record(ArenaSamples &samples, bool genuine, uint32_t seed) {
+  SyntheticGyroSource source(fixtures::gesture(genuine),
+                             synth::typical_variation(), seed);
+  Gyroscope_Calibration calibration;
+  fixtures::calibrate(source, calibration);
+  RecordGesture(source, calibration, RECORDING_SAMPLES, samples);
+  trim_gyro_data(samples);
+}
+
+void gyroscope_thread(Session *session) {
+  vector<array<float, 3>> gesture_key;
+  vector<array<float, 3>> unlocking_record;
+
+  for (int i = 0; i <= session->attempts; i++) {
+    SdramArena(ARENA_CAPTURE).reset();
+    ArenaSamples temp_key{
+        ArenaAllocator<array<float, 3>>(SdramArena(ARENA_CAPTURE))};
+    MemoryAttemptBegin();
+
+    bool genuine = i % 2 == 0;
+    record(temp_key, genuine, session->seed + i);
+    if (i == 0) {
+      // Enroll, wait for the flash and match the key as stored
+      gesture_key.assign(temp_key.begin(), temp_key.end());
+      session->writer->persist(TEMPLATE_KEY_SLOT, gesture_key, kRate);
+      session->writer->flush();
+      vector<array<float, 3>>().swap(gesture_key);
+      Template_View stored;
+      if (session->store.acquire(TEMPLATE_KEY_SLOT, stored)) {
+        session->features.build(stored);
+        session->store.release();
+      }
+    } else {
+      unlocking_record.assign(temp_key.begin(), temp_key.end());
+      MatchFeatures(session->features, unlocking_record);
+      unlocking_record.clear();
+    }
+    session->results.push_back(MemoryAttemptEnd());
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Session session;
+  session.attempts = atoi(option(argc, argv, "--attempts", "20"));
+  session.seed = strtoul(option(argc, argv, "--seed", "1"), nullptr, 0);
+  if (session.attempts < 3) session.attempts = 3;
+  session.results.reserve(session.attempts + 1);
+
+  if (!SdramArenaInit()) {
+    fprintf(stderr, "SDRAM arenas unavailable\n");
+    return 1;
+  }
+  flash_emulator_set_realtime(false);
+  flash_emulator_erase_all();
+  if (!session.store.mount()) {
+    fprintf(stderr, "mount failed\n");
+    return 1;
+  }
+
+  FlashWriter writer(session.store);
+  session.writer = &writer;
+  MemoryWatchStack("flash writer", writer.stack(), writer.stack_size());
+  writer.start();
+
+  Thread gyroscope(osPriorityNormal, sizeof(gyroscope_stack), gyroscope_stack,
+                   "gyroscope");
+  MemoryWatchStack("gyroscope", gyroscope_stack, sizeof(gyroscope_stack));
+  gyroscope.start([&session] { gyroscope_thread(&session); });
+  gyroscope.join();
+  writer.flush();
+
+  printf("%-8s %12s %12s\n", "attempt", "allocations", "bytes kept");
+  long kept = 0;
+  for (size_t i = 0; i < session.results.size(); i++) {
+    const Memory_Attempt &m = session.results[i];
+    printf("%-8s %12lu %12ld\n",
+           i == 0 ? "enroll" : std::to_string(i).c_str(),
+           (unsigned long)m.allocations, (long)m.growth);
+    if (i > 0) kept += m.growth;
+  }
+  printf("(heap kept by the unlock attempts: %ld bytes)\n\n", kept);
+
+  MemoryPrint();
+  return 0;
+}
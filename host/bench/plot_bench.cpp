@@ -0,0 +1,180 @@
+/**
+ * @file plot_bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host measure of the rate plot on the framebuffer emulator: cost
+ * per frame, scrolled against redrawn, and time taken from acquisition.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_plot_bench [--recordings N] [--seed S]
+ *
+ * Each recording is a synthetic gesture read through PlottingGyroSource by
+ * RecordGesture(), as the gyroscope thread records, onto a double-buffered
+ * emulated display. The emulator refreshes every third sample (15 ms at
+ * 200 Hz). A second plot gets the same columns and is redrawn whole every
+ * frame, the way a plot without scrolling would be drawn.
+ *
+ * Prints the pixel writes per frame both ways, the render time per frame
+ * against RATE_PLOT_BUDGET_US, and the longest time between two reads of
+ * the source. The rate_plot tests (host/test/rate_plot_test.cpp) check
+ * that the scrolled window matches the redrawn one and that the gaps stay
+ * under the sample period.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "capture.h"
+#include "fixtures.h"
+#include "profiler.h"
+#include "rate_plot.h"
+
+namespace {
+
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+// Stands in for the sensor's pacing: refreshes the display every third
+// sample and times the gaps between reads. Given a plot, it also redraws it
+// whole after each of its frames and counts what that writes.
+class PacedSource : public GyroSource {
+ public:
+  PacedSource(GyroSource &inner, LCD_DISCO_F429ZI &lcd, RatePlot *redrawn)
+      : inner_(inner),
+        lcd_(lcd),
+        redrawn_(redrawn),
+        samples_(0),
+        frames_(0),
+        returned_(0),
+        max_gap_us_(0),
+        redraw_cpu_(0),
+        redraw_dma2d_(0) {}
+
+  bool init(const Gyroscope_Init_Parameters &params) override {
+    return inner_.init(params);
+  }
+  float sensitivity() const override { return inner_.sensitivity(); }
+
+  bool read(Gyroscope_RawData &sample) override {
+    if (returned_ != 0) {
+      uint32_t gap = (ProfilerNow() - returned_) / ProfilerTicksPerUs();
+      max_gap_us_ = max(max_gap_us_, gap);
+    }
+    if (++samples_ % 3 == 0) lcd_.vblank();
+    if (redrawn_ != nullptr && redrawn_->stats().frames != frames_) {
+      if (lcd_.ReloadPending()) lcd_.vblank();
+      LCD_Emulator_Stats before = lcd_.stats();
+      redrawn_->redraw();
+      redraw_cpu_ += lcd_.stats().cpu_pixels - before.cpu_pixels;
+      redraw_dma2d_ += lcd_.stats().dma2d_pixels - before.dma2d_pixels;
+      frames_ = redrawn_->stats().frames;
+    }
+    bool ok = inner_.read(sample);
+    returned_ = ProfilerNow();
+    return ok;
+  }
+
+  uint32_t max_gap_us() const { return max_gap_us_; }
+  uint64_t redraw_cpu() const { return redraw_cpu_; }
+  uint64_t redraw_dma2d() const { return redraw_dma2d_; }
+
+ private:
+  GyroSource &inner_;
+  LCD_DISCO_F429ZI &lcd_;
+  RatePlot *redrawn_;
+  uint32_t samples_;
+  uint32_t frames_;    // of redrawn_, at the last redraw
+  uint32_t returned_;  // ProfilerNow() when the last read returned
+  uint32_t max_gap_us_;
+  uint64_t redraw_cpu_;
+  uint64_t redraw_dma2d_;
+};
+
+struct Run {
+  uint64_t cpu;    // pixel writes of the plot's frames
+  uint64_t dma2d;
+  uint32_t max_gap_us;
+  Rate_Plot_Stats stats;
+};
+
+// One recording through PlottingGyroSource, as the gyroscope thread makes
+// it; redraw: redraw the plot whole after every frame and count only that
+Run record(uint32_t seed, bool redraw) {
+  LCD_DISCO_F429ZI lcd;
+  lcd.set_refresh_us(0);
+  lcd.Clear(LCD_COLOR_BLACK);
+  FrameBuffers buffers(lcd, DISPLAY_FRONT_BUFFER, DISPLAY_BACK_BUFFER);
+  buffers.enable();
+  RatePlot plot(lcd, buffers, 0, RATE_PLOT_Y, lcd.GetXSize(),
+                RATE_PLOT_HEIGHT);
+
+  SyntheticGyroSource synthetic(fixtures::gesture(),
+                                synth::typical_variation(), seed);
+  PacedSource paced(synthetic, lcd, redraw ? &plot : nullptr);
+  PlottingGyroSource source(paced, plot);
+  Gyroscope_Calibration calibration;
+  fixtures::calibrate(source, calibration);
+
+  lcd.reset_stats();
+  source.begin(calibration);
+  std::vector<array<float, 3>> samples;
+  RecordGesture(source, calibration, RECORDING_SAMPLES, samples);
+  lcd.set_refresh_us(DISPLAY_REFRESH_US);  // end() waits for flips
+  source.end();
+
+  Run run;
+  run.cpu = redraw ? paced.redraw_cpu() : lcd.stats().cpu_pixels;
+  run.dma2d = redraw ? paced.redraw_dma2d() : lcd.stats().dma2d_pixels;
+  run.max_gap_us = paced.max_gap_us();
+  run.stats = plot.stats();
+  return run;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int recordings = atoi(option(argc, argv, "--recordings", "4"));
+  uint32_t seed = strtoul(option(argc, argv, "--seed", "1"), nullptr, 0);
+
+  printf("%-4s %6s %8s %7s %10s %10s %10s %10s %8s %8s %8s\n", "rec",
+         "frames", "deferred", "columns", "cpu/frame", "dma/frame",
+         "full cpu", "full dma", "mean us", "max us", "gap us");
+  for (int r = 0; r < recordings; r++) {
+    Run scrolled = record(seed + r, false);
+    Run full = record(seed + r, true);
+    const Rate_Plot_Stats &s = scrolled.stats;
+    uint32_t frames = max<uint32_t>(s.frames, 1);
+    printf("%-4d %6lu %8lu %7lu %10llu %10llu %10llu %10llu %8llu %8lu "
+           "%8lu\n",
+           r, (unsigned long)s.frames, (unsigned long)s.deferred,
+           (unsigned long)s.columns,
+           (unsigned long long)(scrolled.cpu / frames),
+           (unsigned long long)(scrolled.dma2d / frames),
+           (unsigned long long)(full.cpu / frames),
+           (unsigned long long)(full.dma2d / frames),
+           (unsigned long long)(s.frame_us / frames), (unsigned long)s.max_us,
+           (unsigned long)scrolled.max_gap_us);
+    if (s.over_budget > 0 || s.dropped > 0) {
+      printf("     %lu frames over the %u us budget, %lu columns dropped\n",
+             (unsigned long)s.over_budget, (unsigned)RATE_PLOT_BUDGET_US,
+             (unsigned long)s.dropped);
+    }
+  }
+  printf("frame rate: one frame per %u samples, %.1f fps at %u Hz\n",
+         (unsigned)RATE_PLOT_FRAME_SAMPLES,
+         (float)GYRO_SAMPLE_RATE_HZ / RATE_PLOT_FRAME_SAMPLES,
+         (unsigned)GYRO_SAMPLE_RATE_HZ);
+  return 0;
+}
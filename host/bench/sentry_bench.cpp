@@ -0,0 +1,491 @@
+/**
+ * @file sentry_bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host benchmark of the gesture processing kernels.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_bench [options] [LENGTH...]
+ *
+ *   --min-time SECONDS  time spent per measurement (default 0.2)
+ *   --reps N            timed repetitions per measurement (default 10)
+ *   --json FILE         write the results as JSON
+ *   --baseline FILE     compare against a JSON file written by --json
+ *   --threshold PCT     slowdown below which a change is noise (default 5)
+ *   --alpha P           significance level of the comparison (default 0.01)
+ *
+ * Every kernel of utilities.cpp runs at each gesture length (16 to 4096
+ * samples by default), and the Hampel filter of the capture path one
+ * sample at a time (its op is a sample). For each one the report gives the
+ * mean ns/op over the repetitions, its standard deviation, heap allocations
+ * per op and the bytes the algorithm touches per op (an element-level model
+ * of its memory traffic, not a hardware counter). On the board the same
+ * filter is timed in cycles by the PROFILE_FILTERING probe.
+ *
+ * With --baseline a result is a regression when it is more than --threshold
+ * slower and Welch's t-test over the repetitions rejects "same mean" at
+ * --alpha, or when it allocates more per op. The exit status is 1 if any
+ * result regressed.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "fixtures.h"
+#include "gesture_synth.h"
+#include "hampel_filter.h"
+#include "utilities.h"
+
+namespace {
+
+// Global new calls so far, as the shim's heap statistics count them
+size_t alloc_count() {
+  mbed_stats_heap_t stats;
+  mbed_stats_heap_get(&stats);
+  return stats.alloc_cnt;
+}
+
+typedef std::vector<std::array<float, 3>> Gesture;
+
+double g_min_time = 0.2;  // seconds per measurement
+int g_reps = 10;          // timed repetitions per measurement
+volatile float g_sink;    // keeps results alive
+
+struct Result {
+  std::string kernel;
+  size_t n;
+  double ns_mean;    // ns/op, mean of the repetitions
+  double ns_stddev;  // standard deviation of the repetitions
+  int reps;
+  double allocs;  // heap allocations per op
+  double bytes;   // bytes touched per op (model)
+};
+
+std::vector<Result> g_results;
+
+// A performance of n samples in dps, at the sensor rate, of one gesture
+// class: equal classes give gestures that resemble each other
+Gesture make_gesture(size_t n, uint32_t seed) {
+  synth::GestureSpec spec = fixtures::gesture();
+  spec.duration_s = (float)n / GYRO_SAMPLE_RATE_HZ;
+  synth::Variation variation = synth::typical_variation();
+  variation.idle_s = 0.0f;
+  variation.speed_jitter = 0.0f;
+  Gesture gesture;
+  synth::generate(spec, variation, seed, gesture, GYRO_SAMPLE_RATE_HZ);
+  return gesture;
+}
+
+// Seconds spent running body() `iterations` times
+template <class Body>
+double run(size_t iterations, Body &&body) {
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) body();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Iterations needed for one repetition to last about min_time / reps
+template <class Body>
+size_t calibrate(Body &&body) {
+  double target = g_min_time / g_reps;
+  size_t iterations = 1;
+  for (;;) {
+    double seconds = run(iterations, body);
+    if (seconds >= target || iterations >= (size_t(1) << 40)) return iterations;
+    iterations *= seconds > 0 ? std::max<size_t>(2, 1.2 * target / seconds) : 16;
+  }
+}
+
+void finish(Result &r, const std::vector<double> &samples) {
+  double sum = 0.0;
+  for (double s : samples) sum += s;
+  r.reps = (int)samples.size();
+  r.ns_mean = sum / r.reps;
+  double sq = 0.0;
+  for (double s : samples) sq += (s - r.ns_mean) * (s - r.ns_mean);
+  r.ns_stddev = r.reps > 1 ? std::sqrt(sq / (r.reps - 1)) : 0.0;
+}
+
+// Time body() over g_reps repetitions and count its allocations
+template <class Body>
+Result measure(Body &&body) {
+  size_t iterations = calibrate(body);
+  std::vector<double> samples;
+  samples.reserve(g_reps);
+  size_t allocs = 0;
+  for (int rep = 0; rep < g_reps; rep++) {
+    size_t before = alloc_count();
+    double seconds = run(iterations, body);
+    allocs += alloc_count() - before;
+    samples.push_back(seconds * 1e9 / iterations);
+  }
+
+  Result r = {};
+  finish(r, samples);
+  r.allocs = (double)allocs / (iterations * g_reps);
+  return r;
+}
+
+// For kernels that modify their input: time copy + kernel, then subtract the
+// copy alone, pairing the two within each repetition
+template <class Kernel>
+Result measure_in_place(const Gesture &input, Kernel &&kernel) {
+  Gesture work;
+  work.reserve(input.size());
+  auto total = [&] {
+    work.assign(input.begin(), input.end());
+    kernel(work);
+  };
+  auto copy = [&] {
+    work.assign(input.begin(), input.end());
+    g_sink = work[0][0];
+  };
+  size_t iterations = calibrate(total);
+
+  std::vector<double> samples;
+  size_t allocs = 0;
+  for (int rep = 0; rep < g_reps; rep++) {
+    size_t before = alloc_count();
+    double t = run(iterations, total);
+    allocs += alloc_count() - before;
+    double c = run(iterations, copy);
+    samples.push_back(std::max(0.0, t - c) * 1e9 / iterations);
+  }
+
+  Result r = {};
+  finish(r, samples);
+  r.allocs = (double)allocs / (iterations * g_reps);
+  return r;
+}
+
+void report(const char *kernel, size_t n, Result r, double bytes) {
+  r.kernel = kernel;
+  r.n = n;
+  r.bytes = bytes;
+  printf("%-28s n=%-5zu %13.1f ns/op ±%5.1f%% %9.2f allocs/op %12.0f B/op\n",
+         kernel, n, r.ns_mean,
+         r.ns_mean > 0 ? 100.0 * r.ns_stddev / r.ns_mean : 0.0, r.allocs,
+         bytes);
+  g_results.push_back(r);
+}
+
+void bench_length(size_t n) {
+  Gesture a = make_gesture(n, 1);
+  Gesture b = make_gesture(n, 2);
+  const double N = (double)n;
+  const double SAMPLE = sizeof(std::array<float, 3>);
+
+  std::vector<float> ax(n), bx(n);
+  for (size_t i = 0; i < n; i++) {
+    ax[i] = a[i][0];
+    bx[i] = b[i][0];
+  }
+
+  // Bytes: both inputs once
+  report("correlation", n, measure([&] { g_sink = correlation(ax, bx); }),
+         2 * N * sizeof(float));
+
+  // Bytes: per axis, gather from both inputs, write and re-read the copies
+  report("calculateCorrelationVectors", n, measure([&] {
+           g_sink = calculateCorrelationVectors(a, b)[0];
+         }),
+         3 * 3 * 2 * N * sizeof(float));
+
+  // Bytes: n calls on one pair of samples each
+  report("euclidean_distance", n, measure([&] {
+           float sum = 0.0f;
+           for (size_t i = 0; i < n; i++) sum += euclidean_distance(a[i], b[i]);
+           g_sink = sum;
+         }),
+         2 * N * SAMPLE);
+
+  // The whole x axis through a fresh window, as the old recording loop ran
+  // it. Bytes: per value, the value and the slot it replaces, read and
+  // written
+  report("movingAverageFilter", n, measure([&] {
+           array<float, WINDOW_SIZE> window = {};
+           size_t index = 0;
+           float sum = 0.0f, average = 0.0f;
+           for (size_t i = 0; i < n; i++) {
+             average = movingAverageFilter(ax[i], window, index, sum);
+           }
+           g_sink = average;
+         }),
+         3 * N * sizeof(float));
+
+  // One axis of the gesture with a spike every 50 samples, one sample per
+  // op, as the capture path calls it. Bytes: the sample, and the ring and
+  // the sorted window, each read and shifted once
+  std::vector<float> spiky(ax);
+  for (size_t i = 25; i < n; i += 50) spiky[i] += 1000.0f;
+  HampelFilter hampel;
+  size_t next = 0;
+  report("HampelFilter::filter", n, measure([&] {
+           g_sink = hampel.filter(spiky[next]);
+           next = next + 1 < n ? next + 1 : 0;
+         }),
+         sizeof(float) + 2 * 2 * HAMPEL_WINDOW_SIZE * sizeof(float));
+
+  // Bytes: read and write every sample
+  report("normalize", n, measure_in_place(a, [](Gesture &g) { normalize(g); }),
+         2 * N * SAMPLE);
+
+  // Idle padding on both ends so trimming has work to do.
+  // Bytes: scan the padding and move the motion to the front
+  Gesture padded(n / 4, {0.0f, 0.0f, 0.0f});
+  padded.insert(padded.end(), a.begin(), a.end());
+  padded.resize(padded.size() + n / 4, {0.0f, 0.0f, 0.0f});
+  report("trim_gyro_data", n,
+         measure_in_place(padded, [](Gesture &g) { trim_gyro_data(g); }),
+         2 * (n / 4) * SAMPLE + 2 * N * SAMPLE);
+
+  // Bytes: fill the (n+1)^2 matrix, then per cell three reads, one write
+  // and the two samples
+  report("dtw", n, measure([&] { g_sink = dtw(a, b); }),
+         (N + 1) * (N + 1) * sizeof(float) +
+             N * N * (4 * sizeof(float) + 2 * SAMPLE));
+
+  // Generator throughput, for sizing accuracy runs. Bytes: the output
+  synth::Rng rng(n);
+  synth::GestureSpec spec = synth::random_spec(rng);
+  synth::Variation variation = synth::typical_variation();
+  variation.idle_s = 0.0f;
+  variation.speed_jitter = 0.0f;
+  spec.duration_s = n / 20.0f;
+  synth::Gesture generated;
+  uint64_t seed = 0;
+  report("synth::generate", n, measure([&] {
+           synth::generate(spec, variation, seed++, generated);
+           g_sink = generated[0][0];
+         }),
+         N * SAMPLE);
+}
+
+/*******************************************************************************
+ *
+ * @brief JSON output, one result per line so a baseline can be read back
+ * without a JSON library
+ *
+ * ****************************************************************************/
+bool write_json(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (f == nullptr) {
+    fprintf(stderr, "cannot write %s\n", path);
+    return false;
+  }
+  fprintf(f, "{\"min_time\": %g, \"reps\": %d, \"results\": [\n", g_min_time,
+          g_reps);
+  for (size_t i = 0; i < g_results.size(); i++) {
+    const Result &r = g_results[i];
+    fprintf(f,
+            "  {\"kernel\": \"%s\", \"n\": %zu, \"ns_mean\": %.3f, "
+            "\"ns_stddev\": %.3f, \"reps\": %d, \"allocs_per_op\": %.4f, "
+            "\"bytes_per_op\": %.0f}%s\n",
+            r.kernel.c_str(), r.n, r.ns_mean, r.ns_stddev, r.reps, r.allocs,
+            r.bytes, i + 1 < g_results.size() ? "," : "");
+  }
+  fprintf(f, "]}\n");
+  fclose(f);
+  return true;
+}
+
+bool json_number(const char *line, const char *key, double &value) {
+  const char *p = strstr(line, key);
+  if (p == nullptr) return false;
+  p = strchr(p + strlen(key), ':');
+  if (p == nullptr) return false;
+  value = strtod(p + 1, nullptr);
+  return true;
+}
+
+bool read_json(const char *path, std::vector<Result> &results) {
+  FILE *f = fopen(path, "r");
+  if (f == nullptr) {
+    fprintf(stderr, "cannot read %s\n", path);
+    return false;
+  }
+  char line[512];
+  while (fgets(line, sizeof(line), f) != nullptr) {
+    const char *k = strstr(line, "\"kernel\": \"");
+    if (k == nullptr) continue;
+    k += strlen("\"kernel\": \"");
+    const char *end = strchr(k, '"');
+    if (end == nullptr) continue;
+
+    Result r = {};
+    r.kernel.assign(k, end);
+    double n = 0, reps = 0;
+    if (!json_number(line, "\"n\"", n) ||
+        !json_number(line, "\"ns_mean\"", r.ns_mean) ||
+        !json_number(line, "\"ns_stddev\"", r.ns_stddev) ||
+        !json_number(line, "\"reps\"", reps) ||
+        !json_number(line, "\"allocs_per_op\"", r.allocs)) {
+      continue;
+    }
+    json_number(line, "\"bytes_per_op\"", r.bytes);
+    r.n = (size_t)n;
+    r.reps = (int)reps;
+    results.push_back(r);
+  }
+  fclose(f);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * @brief Welch's t-test
+ *
+ * ****************************************************************************/
+
+// Continued fraction of the regularized incomplete beta function (modified
+// Lentz), valid for x < (a + 1) / (a + b + 2)
+double beta_fraction(double a, double b, double x) {
+  const double TINY = 1e-300;
+  double c = 1.0;
+  double d = 1.0 - (a + b) * x / (a + 1.0);
+  if (std::fabs(d) < TINY) d = TINY;
+  d = 1.0 / d;
+  double h = d;
+  for (int m = 1; m <= 300; m++) {
+    double m2 = 2.0 * m;
+    double num = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+    d = 1.0 + num * d;
+    c = 1.0 + num / c;
+    if (std::fabs(d) < TINY) d = TINY;
+    if (std::fabs(c) < TINY) c = TINY;
+    d = 1.0 / d;
+    h *= d * c;
+    num = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+    d = 1.0 + num * d;
+    c = 1.0 + num / c;
+    if (std::fabs(d) < TINY) d = TINY;
+    if (std::fabs(c) < TINY) c = TINY;
+    d = 1.0 / d;
+    double delta = d * c;
+    h *= delta;
+    if (std::fabs(delta - 1.0) < 1e-12) break;
+  }
+  return h;
+}
+
+// Regularized incomplete beta function I_x(a, b)
+double incomplete_beta(double a, double b, double x) {
+  if (x <= 0.0) return 0.0;
+  if (x >= 1.0) return 1.0;
+  double front = std::exp(std::lgamma(a + b) - std::lgamma(a) -
+                          std::lgamma(b) + a * std::log(x) +
+                          b * std::log(1.0 - x));
+  if (x < (a + 1.0) / (a + b + 2.0)) return front * beta_fraction(a, b, x) / a;
+  return 1.0 - front * beta_fraction(b, a, 1.0 - x) / b;
+}
+
+// Two-sided p-value for "the two means are equal"
+double welch_p_value(const Result &x, const Result &y) {
+  if (x.reps < 2 || y.reps < 2) return 1.0;
+  double vx = x.ns_stddev * x.ns_stddev / x.reps;
+  double vy = y.ns_stddev * y.ns_stddev / y.reps;
+  if (vx + vy == 0.0) return x.ns_mean == y.ns_mean ? 1.0 : 0.0;
+
+  double t = (x.ns_mean - y.ns_mean) / std::sqrt(vx + vy);
+  double df = (vx + vy) * (vx + vy) /
+              (vx * vx / (x.reps - 1) + vy * vy / (y.reps - 1));
+  return incomplete_beta(df / 2.0, 0.5, df / (df + t * t));
+}
+
+// Print the comparison table; returns the number of regressions
+int compare(const std::vector<Result> &baseline, double threshold,
+            double alpha) {
+  int regressions = 0;
+  printf("\n%-28s %-7s %13s %13s %8s %9s\n", "kernel", "n", "baseline ns",
+         "current ns", "change", "p");
+  for (const Result &r : g_results) {
+    const Result *base = nullptr;
+    for (const Result &b : baseline) {
+      if (b.kernel == r.kernel && b.n == r.n) base = &b;
+    }
+    if (base == nullptr) {
+      printf("%-28s %-7zu %13s %13.1f\n", r.kernel.c_str(), r.n, "-",
+             r.ns_mean);
+      continue;
+    }
+
+    double change = base->ns_mean > 0
+                        ? 100.0 * (r.ns_mean - base->ns_mean) / base->ns_mean
+                        : 0.0;
+    double p = welch_p_value(r, *base);
+    const char *verdict = "";
+    if (r.allocs > base->allocs + 1e-6) {
+      verdict = "REGRESSION (allocs)";
+      regressions++;
+    } else if (p < alpha && change > threshold) {
+      verdict = "REGRESSION";
+      regressions++;
+    } else if (p < alpha && change < -threshold) {
+      verdict = "faster";
+    }
+    printf("%-28s %-7zu %13.1f %13.1f %+7.1f%% %9.2g  %s\n", r.kernel.c_str(),
+           r.n, base->ns_mean, r.ns_mean, change, p, verdict);
+  }
+  return regressions;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::vector<size_t> lengths;
+  const char *json_path = nullptr;
+  const char *baseline_path = nullptr;
+  double threshold = 5.0;
+  double alpha = 0.01;
+
+  for (int i = 1; i < argc; i++) {
+    bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--min-time") == 0 && has_value) {
+      g_min_time = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--reps") == 0 && has_value) {
+      g_reps = std::max(2, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--json") == 0 && has_value) {
+      json_path = argv[++i];
+    } else if (strcmp(argv[i], "--baseline") == 0 && has_value) {
+      baseline_path = argv[++i];
+    } else if (strcmp(argv[i], "--threshold") == 0 && has_value) {
+      threshold = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--alpha") == 0 && has_value) {
+      alpha = atof(argv[++i]);
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    } else {
+      lengths.push_back(strtoul(argv[i], nullptr, 10));
+    }
+  }
+  if (lengths.empty()) lengths = {16, 64, 256, 1024, 4096};
+
+  std::vector<Result> baseline;
+  if (baseline_path != nullptr && !read_json(baseline_path, baseline)) return 2;
+
+  for (size_t n : lengths) {
+    if (n == 0) continue;
+    bench_length(n);
+  }
+
+  if (json_path != nullptr && !write_json(json_path)) return 2;
+  if (baseline_path != nullptr) {
+    int regressions = compare(baseline, threshold, alpha);
+    printf("%d regression%s\n", regressions, regressions == 1 ? "" : "s");
+    if (regressions > 0) return 1;
+  }
+  return 0;
+}
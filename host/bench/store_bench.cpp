@@ -0,0 +1,309 @@
+/**
+ * @file store_bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host benchmark of the template store on the flash emulator.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_store_bench [--ops N] [--seed S] [--image FILE]
+ *
+ * Runs a stream of enrollments (synthetic gestures in random slots) and
+ * deletions against a blank emulated flash, calling maintain() between
+ * operations as the main loop does, once per payload encoding on the same
+ * stream. Reports the modeled flash time per operation, write
+ * amplification, compactions and the spread of erase counts over the
+ * store's sectors, then times a remount. A final table compares the
+ * encodings: compression ratio, decode throughput and the flash time saved.
+ * The template_store tests (host/test/template_store_test.cpp) check every
+ * slot against a shadow copy after such a remount.
+ *
+ * Last, it times an unlock against a stored key three ways: copying the key
+ * out with read() and calling MatchGesture(), matching in place with
+ * acquire() and MatchTemplate(), and matching against TemplateFeatures
+ * built once from the key with MatchFeatures() (what main() does). With
+ * --image the emulated flash is a memory-mapped file, as the target's
+ * flash is memory mapped. The matcher tests (host/test/matcher_test.cpp)
+ * check that the in-place scores are those of the copy, and the features'
+ * the in-place ones bit for bit.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "gesture_synth.h"
+#include "matcher.h"
+#include "template_codec.h"
+#include "template_store.h"
+
+namespace {
+
+typedef std::vector<std::array<float, 3>> Gesture;
+
+struct Result {
+  const char *name;
+  uint64_t payload_bytes;  // bytes handed to write() as floats
+  uint64_t stored_bytes;   // bytes of the encoded payloads
+  double busy_us;          // modeled flash time of the workload
+};
+
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+Result run(const char *name, uint8_t encoding, long ops, uint64_t seed) {
+  synth::Rng rng(seed);
+  synth::Variation variation = synth::typical_variation();
+  const uint16_t rate = GYRO_SAMPLE_RATE_HZ / RECORDING_DECIMATION;
+  Result result = {name, 0, 0, 0.0};
+
+  printf("== %s ==\n", name);
+  flash_emulator_erase_all();
+  flash_emulator_reset_stats();
+  TemplateStore store;
+  store.set_encoding(encoding);
+  if (!store.mount()) {
+    fprintf(stderr, "mount failed\n");
+    return result;
+  }
+  FlashIAP_Stats after_format = flash_emulator_stats();
+  printf("first mount (format): %.2f s of flash time, %llu erases\n",
+         after_format.busy_us / 1e6, (unsigned long long)after_format.erases);
+  flash_emulator_reset_stats();
+
+  std::vector<uint8_t> encoded;
+  long writes = 0, removes = 0, failures = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < ops; i++) {
+    uint8_t slot = rng.next() % TEMPLATE_SLOTS;
+    if (rng.uniform() < 0.1f) {
+      if (!store.remove(slot)) failures++;
+      removes++;
+    } else {
+      Gesture key;
+      synth::generate(synth::random_spec(rng), variation, rng.next(), key);
+      key.resize(std::max<size_t>(20, std::min<size_t>(key.size(),
+                                                       RECORDING_SAMPLES)));
+      if (store.write(slot, key, rate)) {
+        result.payload_bytes += key.size() * sizeof(key[0]);
+        TemplateEncode(key, TEMPLATE_QUANTUM, encoded);
+        result.stored_bytes += encoding == TEMPLATE_ENCODING_DELTA
+                                   ? encoded.size()
+                                   : key.size() * sizeof(key[0]);
+      } else {
+        failures++;
+      }
+      writes++;
+    }
+    store.maintain();
+  }
+  std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+
+  FlashIAP_Stats flash = flash_emulator_stats();
+  Template_Store_Stats stats = store.stats();
+  result.busy_us = flash.busy_us;
+  printf("%ld writes, %ld deletes, %ld failures in %.3f s wall time\n", writes,
+         removes, failures, wall.count());
+  printf("flash time: %.2f s total, %.1f ms per operation\n",
+         flash.busy_us / 1e6, flash.busy_us / 1e3 / std::max(1L, ops));
+  printf("payload %.1f KB/s of flash time, write amplification %.2f\n",
+         flash.busy_us > 0
+             ? result.payload_bytes / 1024.0 / (flash.busy_us / 1e6)
+             : 0.0,
+         result.payload_bytes > 0
+             ? (double)flash.program_bytes / result.payload_bytes
+             : 0.0);
+  printf("compactions %u, erases %llu, live %u B, garbage %u B\n",
+         stats.compactions, (unsigned long long)flash.erases, stats.live_bytes,
+         stats.garbage_bytes);
+
+  uint32_t lo = UINT32_MAX, hi = 0;
+  printf("erase counts:");
+  for (int s = 0; s < TEMPLATE_STORE_SECTORS; s++) {
+    printf(" %u", stats.erase_count[s]);
+    lo = std::min(lo, stats.erase_count[s]);
+    hi = std::max(hi, stats.erase_count[s]);
+  }
+  printf(" (spread %u)\n", hi - lo);
+
+  // Remount from flash
+  flash_emulator_reset_stats();
+  TemplateStore remounted;
+  auto mount_start = std::chrono::steady_clock::now();
+  remounted.mount();
+  std::chrono::duration<double> mount_wall =
+      std::chrono::steady_clock::now() - mount_start;
+  printf("remount in %.3f ms, %llu bytes read\n\n", mount_wall.count() * 1e3,
+         (unsigned long long)flash_emulator_stats().read_bytes);
+  return result;
+}
+
+// Decode throughput in MB/s of decoded floats, the worst round-trip error
+// and the fraction of values beyond the int16 range (which the sensor would
+// have clipped as well)
+void codec_speed(uint64_t seed, double &mb_per_s, float &max_error,
+                 double &clipped) {
+  synth::Rng rng(seed);
+  std::vector<std::vector<uint8_t>> encoded(256);
+  const float limit = INT16_MAX * TEMPLATE_QUANTUM;
+  size_t decoded_bytes = 0, values = 0, beyond = 0;
+  max_error = 0.0f;
+  Gesture key, decoded;
+  for (auto &e : encoded) {
+    synth::generate(synth::random_spec(rng), synth::typical_variation(),
+                    rng.next(), key);
+    TemplateEncode(key, TEMPLATE_QUANTUM, e);
+    TemplateDecode(e.data(), e.size(), decoded);
+    for (size_t i = 0; i < key.size(); i++) {
+      for (int axis = 0; axis < 3; axis++, values++) {
+        if (fabsf(key[i][axis]) > limit) {
+          beyond++;
+        } else {
+          max_error =
+              std::max(max_error, fabsf(key[i][axis] - decoded[i][axis]));
+        }
+      }
+    }
+    decoded_bytes += key.size() * sizeof(key[0]);
+  }
+
+  long rounds = 0;
+  float sink = 0.0f;
+  auto start = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed{};
+  while (elapsed.count() < 0.2) {
+    for (const auto &e : encoded) {
+      TemplateDecoder decoder(e.data(), e.size());
+      std::array<float, 3> sample;
+      while (decoder.next(sample)) sink += sample[0];
+    }
+    rounds++;
+    elapsed = std::chrono::steady_clock::now() - start;
+  }
+  volatile float keep = sink;
+  (void)keep;
+  mb_per_s = decoded_bytes * rounds / elapsed.count() / 1e6;
+  clipped = values > 0 ? (double)beyond / values : 0.0;
+}
+
+// Mean ns per call of body over about 0.2 s
+template <typename Body>
+double time_ns(Body &&body) {
+  long calls = 0;
+  auto start = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed{};
+  while (elapsed.count() < 0.2) {
+    for (int i = 0; i < 100; i++) body();
+    calls += 100;
+    elapsed = std::chrono::steady_clock::now() - start;
+  }
+  return elapsed.count() * 1e9 / calls;
+}
+
+// Load and match one unlock attempt: copy path against the in-place view
+// and the precomputed features
+void load_and_match(uint8_t encoding, uint64_t seed) {
+  synth::Rng rng(seed);
+  synth::GestureSpec spec = synth::random_spec(rng);
+  Gesture key, attempt;
+  synth::generate(spec, synth::typical_variation(), rng.next(), key);
+  synth::generate(spec, synth::typical_variation(), rng.next(), attempt);
+  key.resize(RECORDING_SAMPLES);
+  attempt.resize(RECORDING_SAMPLES);
+
+  flash_emulator_erase_all();
+  TemplateStore store;
+  store.set_encoding(encoding);
+  if (!store.mount() || !store.write(TEMPLATE_KEY_SLOT, key, 20)) return;
+
+  // MatchGesture() modifies the attempt; refreshing it is timed apart
+  Gesture loaded, work;
+  Match_Result copied, in_place;
+  loaded.reserve(RECORDING_SAMPLES);
+  work.reserve(RECORDING_SAMPLES);
+  double refresh_ns = time_ns([&] { work = attempt; });
+  double copy_ns = time_ns([&] {
+                     work = attempt;
+                     store.read(TEMPLATE_KEY_SLOT, loaded);
+                     copied = MatchGesture(loaded, work);
+                   }) -
+                   refresh_ns;
+  double view_ns = time_ns([&] {
+    Template_View view;
+    if (store.acquire(TEMPLATE_KEY_SLOT, view)) {
+      in_place = MatchTemplate(view, attempt);
+      store.release();
+    }
+  });
+
+  // Built once per enrollment or boot, then reused by every attempt
+  TemplateFeatures features;
+  Match_Result featured;
+  double build_ns = time_ns([&] {
+    Template_View view;
+    if (store.acquire(TEMPLATE_KEY_SLOT, view)) {
+      features.build(view);
+      store.release();
+    }
+  });
+  double features_ns =
+      time_ns([&] { featured = MatchFeatures(features, attempt); });
+
+  printf("%-8s copy %7.0f ns (%zu B of RAM for the key), in place %7.0f ns "
+         "(0 B), %.1fx faster\n",
+         encoding == TEMPLATE_ENCODING_DELTA ? "delta" : "float32", copy_ns,
+         loaded.capacity() * sizeof(loaded[0]), view_ns, copy_ns / view_ns);
+  printf("%-8s features %7.0f ns (%zu B, built once in %.0f ns), %.1fx "
+         "faster than in place\n",
+         "", features_ns, features.count() * sizeof(Template_Feature_Sample),
+         build_ns, view_ns / features_ns);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  long ops = atol(option(argc, argv, "--ops", "2000"));
+  uint64_t seed = strtoull(option(argc, argv, "--seed", "1"), nullptr, 0);
+  const char *image = option(argc, argv, "--image", nullptr);
+  if (image != nullptr && !flash_emulator_map_file(image)) {
+    fprintf(stderr, "cannot map %s\n", image);
+    return 1;
+  }
+
+  Result results[] = {run("float32", TEMPLATE_ENCODING_FLOAT32, ops, seed),
+                      run("delta", TEMPLATE_ENCODING_DELTA, ops, seed)};
+  const Result &raw = results[0], &delta = results[1];
+
+  double mb_per_s;
+  float max_error;
+  double clipped;
+  codec_speed(seed, mb_per_s, max_error, clipped);
+  printf("delta encoding: %.2fx smaller (%.2f bytes per sample), max error "
+         "%.4f dps (%.2f%% clipped), decode %.0f MB/s\n",
+         delta.stored_bytes > 0 ? (double)raw.stored_bytes / delta.stored_bytes
+                                : 0.0,
+         raw.payload_bytes > 0
+             ? delta.stored_bytes * sizeof(std::array<float, 3>) /
+                   (double)raw.payload_bytes
+             : 0.0,
+         max_error, 100.0 * clipped, mb_per_s);
+  printf("flash time: %.2f s float32, %.2f s delta (%.1f%% saved)\n\n",
+         raw.busy_us / 1e6, delta.busy_us / 1e6,
+         raw.busy_us > 0 ? 100.0 * (1.0 - delta.busy_us / raw.busy_us) : 0.0);
+
+  printf("load and match a %d-sample key:\n", RECORDING_SAMPLES);
+  load_and_match(TEMPLATE_ENCODING_FLOAT32, seed);
+  load_and_match(TEMPLATE_ENCODING_DELTA, seed);
+  return 0;
+}
@@ -0,0 +1,160 @@
+/**
+ * @file text_bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host comparison of text drawn by the BSP, pixel by pixel, and
+ * blended from a glyph atlas, on the framebuffer emulator.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_text_bench [--random N] [--seed S]
+ *
+ * Per font, two emulated displays get the same text: one draws it as the
+ * BSP does, the other from a GlyphAtlas of the font, each glyph one DMA2D
+ * blend (done in software on the host). The texts are the firmware's
+ * status messages, every glyph in a line, and N random strings in random
+ * colors, alignments and places, strings that run off the right edge and
+ * colors that are not opaque (the atlas path falls back to the BSP for
+ * those) included. Fonts too large for GLYPH_ATLAS_BYTES get no atlas and
+ * are drawn by the BSP on both. The glyph_atlas tests
+ * (host/test/glyph_atlas_test.cpp) check that both framebuffers come out
+ * identical.
+ *
+ * Prints, per font, the pixel operations per glyph of the status messages
+ * each way: CPU stores, DMA2D transfers and DMA2D pixels. Both ways write
+ * the same 4 bytes a pixel to the SDRAM; the blend reads two bytes a pixel
+ * of atlas from internal SRAM, where the BSP has the CPU read the font
+ * bits and store every pixel. Then the texts drawn and, of their glyphs,
+ * the ones blended. Host time is not measured: the emulator's
+ * blend is a software loop where the board has the DMA2D.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "glyph_atlas.h"
+#include "status_line.h"
+
+namespace {
+
+struct Font {
+  const char *name;
+  sFONT *font;
+};
+
+const Font kFonts[] = {{"Font8", &Font8},
+                       {"Font12", &Font12},
+                       {"Font16", &Font16},
+                       {"Font20", &Font20},
+                       {"Font24", &Font24}};
+
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+struct Totals {
+  uint32_t glyphs;
+  LCD_Emulator_Stats ops[2];  // BSP, atlas
+  uint32_t texts;
+};
+
+void add(LCD_Emulator_Stats &total, const LCD_Emulator_Stats &s) {
+  total.cpu_pixels += s.cpu_pixels;
+  total.dma2d_pixels += s.dma2d_pixels;
+  total.dma2d_transfers += s.dma2d_transfers;
+  total.chars += s.chars;
+  total.atlas_chars += s.atlas_chars;
+}
+
+// One text on both displays, counted
+void draw(LCD_DISCO_F429ZI *lcds, uint16_t x, uint16_t y, const char *text,
+          uint32_t color, uint32_t back, Text_AlignModeTypdef mode,
+          Totals &totals) {
+  for (int i = 0; i < 2; i++) {
+    lcds[i].reset_stats();
+    lcds[i].SetTextColor(color);
+    lcds[i].SetBackColor(back);
+    lcds[i].DisplayStringAt(x, y, (uint8_t *)text, mode);
+    add(totals.ops[i], lcds[i].stats());
+  }
+  totals.glyphs += lcds[0].stats().chars;
+  totals.texts++;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int random = atoi(option(argc, argv, "--random", "2000"));
+  uint32_t seed = strtoul(option(argc, argv, "--seed", "1"), nullptr, 0);
+
+  const uint32_t colors[] = {LCD_COLOR_GREEN,  LCD_COLOR_RED,
+                             LCD_COLOR_ORANGE, LCD_COLOR_WHITE,
+                             LCD_COLOR_BLACK,  LCD_COLOR_DARKGRAY,
+                             0x80FF8000,       0x00000000};
+  const Text_AlignModeTypdef modes[] = {CENTER_MODE, RIGHT_MODE, LEFT_MODE};
+
+  printf("%-7s %5s %7s %8s %8s %8s %8s %8s %6s %8s\n", "font", "atlas",
+         "glyphs", "bsp cpu", "bsp dma", "atl cpu", "atl xfer", "atl dma",
+         "texts", "blended");
+  std::mt19937 rng(seed);
+  for (const Font &f : kFonts) {
+    LCD_DISCO_F429ZI lcds[2];
+    GlyphAtlas atlas;
+    bool built = atlas.build(f.font);
+    for (LCD_DISCO_F429ZI &lcd : lcds) {
+      lcd.SetFont(f.font);
+      lcd.SetBackColor(LCD_COLOR_BLACK);
+      lcd.Clear(LCD_COLOR_BLACK);
+    }
+    atlas.attach(lcds[1]);
+
+    Totals messages;
+    memset(&messages, 0, sizeof(messages));
+    for (const Status_Message &m : STATUS_MESSAGES) {
+      draw(lcds, STATUS_TEXT_X, STATUS_TEXT_Y, m.text, m.color,
+           LCD_COLOR_BLACK, CENTER_MODE, messages);
+    }
+
+    Totals totals = messages;
+    std::string all;
+    for (int c = ' '; c < ' ' + LCD_ATLAS_GLYPHS; c++) all += (char)c;
+    for (size_t at = 0; at < all.size(); at += 12) {
+      draw(lcds, 0, (uint16_t)(at / 12 * f.font->Height),
+           all.substr(at, 12).c_str(), LCD_COLOR_WHITE, LCD_COLOR_DARKBLUE,
+           LEFT_MODE, totals);
+    }
+    for (int i = 0; i < random; i++) {
+      std::string text(rng() % 30, ' ');
+      for (char &c : text) c = (char)(' ' + rng() % LCD_ATLAS_GLYPHS);
+      uint16_t x = rng() % lcds[0].GetXSize();
+      uint16_t y = rng() % (lcds[0].GetYSize() - f.font->Height);
+      draw(lcds, x, y, text.c_str(), colors[rng() % 8], colors[rng() % 8],
+           modes[rng() % 3], totals);
+    }
+
+    // Per glyph of the messages
+    double glyphs = messages.glyphs > 0 ? messages.glyphs : 1;
+    const LCD_Emulator_Stats &bsp = messages.ops[0];
+    const LCD_Emulator_Stats &blend = messages.ops[1];
+    printf("%-7s %5s %7lu %8.1f %8.1f %8.1f %8.2f %8.1f %6lu %7.1f%%\n",
+           f.name, built ? "yes" : "no", (unsigned long)messages.glyphs,
+           bsp.cpu_pixels / glyphs, bsp.dma2d_pixels / glyphs,
+           blend.cpu_pixels / glyphs, blend.dma2d_transfers / glyphs,
+           blend.dma2d_pixels / glyphs, (unsigned long)totals.texts,
+           100.0 * totals.ops[1].atlas_chars / max<uint32_t>(totals.glyphs, 1));
+  }
+  printf("atlas: %u bytes (GLYPH_ATLAS_BYTES), Font16 takes %u\n",
+         (unsigned)GLYPH_ATLAS_BYTES, (unsigned)GlyphAtlas::bytes(&Font16));
+  return 0;
+}
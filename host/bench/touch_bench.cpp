@@ -0,0 +1,219 @@
+/**
+ * @file touch_bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host measurement of touch-to-event latency on the STMPE811
+ * emulator: TouchInput against the polling loop it replaced.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_touch_bench [--taps N] [--idle S] [--seed S]
+ *
+ * The script: N taps, 1.2 s apart, each a bouncing finger (touch, lift
+ * after 1 ms, touch again) held 80 to 200 ms and lifted with another
+ * bounce, at a random place; between two taps a 2 ms brush, which is no
+ * press; then S seconds untouched, as the board mostly is. It is played
+ * twice, in real time, on a fresh emulator each:
+ *
+ *   interrupt  TouchInput::wait() on a thread, as the touch thread now;
+ *   polled     the loop it replaced: GetState() every 10 ms, and on a
+ *              touch a 1 s sleep before the flag was raised.
+ *
+ * A press counts when the event (or the flag) comes, from the first
+ * contact of its tap. Prints per mode the presses, the taps missed, the
+ * presses without a tap, the mean and longest latency, the interrupts and
+ * the I2C bytes and bus time. TouchInput reads more while a finger is down
+ * (the polling loop was asleep), nothing while none is. The touch_input
+ * tests (host/test/touch_input_test.cpp) check that every tap gives one
+ * press at its place, in time, and one release, and the brushes nothing.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "touch_input.h"
+
+namespace {
+
+const uint32_t kTapPeriodUs = 1200000;
+const uint32_t kFirstTapUs = 100000;
+const uint32_t kBrushUs = 2000;
+
+struct Tap {
+  uint32_t at_us;    // first contact
+  uint32_t lift_us;  // last lift
+  uint16_t x;
+  uint16_t y;
+};
+
+struct Seen {
+  Touch_Event_Type type;
+  uint16_t x;
+  uint16_t y;
+  uint32_t at_us;  // script time it came
+};
+
+struct Result {
+  std::vector<Seen> seen;
+  Ts_Emulator_Stats bus;
+};
+
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+std::vector<Ts_Emulator_Step> make_script(int taps, uint32_t idle_us,
+                                          uint32_t seed,
+                                          std::vector<Tap> &placed) {
+  std::mt19937 rng(seed);
+  std::vector<Ts_Emulator_Step> script;
+  for (int i = 0; i < taps; i++) {
+    Tap tap;
+    tap.at_us = kFirstTapUs + i * kTapPeriodUs;
+    tap.x = 10 + rng() % 220;
+    tap.y = 10 + rng() % 300;
+    uint32_t hold_us = 80000 + rng() % 120000;
+    uint32_t t = tap.at_us;
+    script.push_back({t, 1, tap.x, tap.y});
+    script.push_back({t + 1000, 0, 0, 0});
+    script.push_back({t + 1500, 1, tap.x, tap.y});
+    script.push_back({t + hold_us, 0, 0, 0});
+    script.push_back({t + hold_us + 2000, 1, tap.x, tap.y});
+    tap.lift_us = t + hold_us + 3000;
+    script.push_back({tap.lift_us, 0, 0, 0});
+    placed.push_back(tap);
+
+    uint32_t brush = t + kTapPeriodUs / 2;
+    script.push_back({brush, 1, (uint16_t)(rng() % 240),
+                      (uint16_t)(rng() % 320)});
+    script.push_back({brush + kBrushUs, 0, 0, 0});
+  }
+  script.push_back({kFirstTapUs + taps * kTapPeriodUs + idle_us, 0, 0, 0});
+  return script;
+}
+
+Result interrupt_driven(const std::vector<Ts_Emulator_Step> &script) {
+  TS_DISCO_F429ZI ts;
+  Mutex i2c_bus;
+  TouchInput input(ts, i2c_bus);
+  Result result;
+  if (!input.init(240, 320)) return result;
+  ts.reset_stats();
+  std::thread consumer([&]() {
+    Touch_Event event;
+    while (input.wait(event)) {
+      result.seen.push_back({event.type, event.x, event.y, ts.script_us()});
+    }
+  });
+  ts.play(script);
+  ts.finish();
+  std::this_thread::sleep_for(std::chrono::milliseconds(TOUCH_RELEASE_MS * 2));
+  input.stop();
+  consumer.join();
+  result.bus = ts.stats();
+  return result;
+}
+
+// The touch screen thread before TouchInput
+Result polled(const std::vector<Ts_Emulator_Step> &script) {
+  TS_DISCO_F429ZI ts;
+  Result result;
+  ts.Init(240, 320);
+  ts.reset_stats();
+  ts.play(script);
+  uint32_t end_us = script.back().at_us;
+  TS_StateTypeDef state;
+  while (ts.script_us() < end_us) {
+    ts.GetState(&state);
+    if (state.TouchDetected) {
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+      result.seen.push_back({TOUCH_PRESS, state.X, state.Y, ts.script_us()});
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ts.finish();
+  result.bus = ts.stats();
+  return result;
+}
+
+struct Score {
+  int presses;
+  int missed;
+  int spurious;
+  double mean_us;
+  uint32_t max_us;
+};
+
+// Each press goes to the tap it falls in (from its first contact to the
+// next tap); a tap without one is missed, a press without one spurious
+Score score(const Result &result, const std::vector<Tap> &taps) {
+  Score s = {0, 0, 0, 0.0, 0};
+  std::vector<int> hits(taps.size(), 0);
+  uint64_t total_us = 0;
+  for (const Seen &seen : result.seen) {
+    if (seen.type == TOUCH_RELEASE) continue;
+    s.presses++;
+    int tap = -1;
+    for (size_t t = 0; t < taps.size(); t++) {
+      if (seen.at_us >= taps[t].at_us &&
+          seen.at_us < taps[t].at_us + kTapPeriodUs) {
+        tap = (int)t;
+      }
+    }
+    if (tap < 0 || hits[tap]++ > 0) {
+      s.spurious++;
+      continue;
+    }
+    uint32_t latency = seen.at_us - taps[tap].at_us;
+    total_us += latency;
+    s.max_us = std::max(s.max_us, latency);
+  }
+  for (int h : hits) s.missed += h == 0 ? 1 : 0;
+  int scored = (int)taps.size() - s.missed;
+  s.mean_us = scored > 0 ? (double)total_us / scored : 0.0;
+  return s;
+}
+
+void print(const char *mode, const Score &s, const Ts_Emulator_Stats &bus) {
+  printf("%-9s %7d %6d %8d %8.1f %8.1f %10lu %9llu %8.1f\n", mode, s.presses,
+         s.missed, s.spurious, s.mean_us / 1000.0, s.max_us / 1000.0,
+         (unsigned long)bus.interrupts, (unsigned long long)bus.bytes,
+         bus.bus_us / 1000.0);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int taps = atoi(option(argc, argv, "--taps", "6"));
+  double idle_s = atof(option(argc, argv, "--idle", "2"));
+  uint32_t idle_us = (uint32_t)(idle_s * 1e6);
+  uint32_t seed = strtoul(option(argc, argv, "--seed", "1"), nullptr, 0);
+
+  std::vector<Tap> placed;
+  std::vector<Ts_Emulator_Step> script =
+      make_script(taps, idle_us, seed, placed);
+
+  Result fast = interrupt_driven(script);
+  Result slow = polled(script);
+  Score fast_score = score(fast, placed);
+  Score slow_score = score(slow, placed);
+
+  printf("%-9s %7s %6s %8s %8s %8s %10s %9s %8s\n", "mode", "presses",
+         "missed", "spurious", "mean ms", "max ms", "interrupts", "i2c bytes",
+         "bus ms");
+  print("interrupt", fast_score, fast.bus);
+  print("polled", slow_score, slow.bus);
+  return 0;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file ui_bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host stress benchmark of the UI thread: many producers on the
+ * lock-free queue, and on a UiRenderer drawing on the framebuffer emulator.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_ui_bench [--producers P] [--commands N] [--seed S]
+ *
+ * Queue: P threads push N commands each into a UiQueue, numbered in order
+ * and marked with the producer, retrying while the queue is full, while
+ * one thread pops them. Prints the pushes refused and the longest push,
+ * which stays far below a frame: it never waits for the consumer.
+ *
+ * Renderer: P threads post N / 10 status texts, LED states and progress
+ * bars each, at random, to a UiRenderer drawing through FrameBuffers with
+ * the emulator refreshing in real time, so its frames wait for flips. A
+ * command that finds the queue full goes to the latest-value slot of its
+ * kind. Prints the frames drawn, the commands coalesced and overflowed,
+ * and the longest post() against the longest frame.
+ *
+ * The ui_queue and ui_renderer tests (host/test/ui_queue_test.cpp,
+ * host/test/ui_renderer_test.cpp) check that every command comes out once
+ * and in order, and that the screen and LEDs end on the last state posted.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "frame_buffers.h"
+#include "status_line.h"
+#include "ui_renderer.h"
+
+namespace {
+
+const uint32_t kColors[] = {LCD_COLOR_GREEN, LCD_COLOR_ORANGE,
+                            LCD_COLOR_LIGHTGRAY, LCD_COLOR_RED,
+                            LCD_COLOR_YELLOW, LCD_COLOR_BLUE};
+
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+uint32_t elapsed_us(std::chrono::steady_clock::time_point start) {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// The longest of the times the threads saw
+void note_max(std::atomic<uint32_t> &max, uint32_t value) {
+  uint32_t seen = max.load();
+  while (value > seen && !max.compare_exchange_weak(seen, value)) {
+  }
+}
+
+// P producers and one consumer
+void queue_stress(int producers, int commands, uint32_t &rejected,
+                  uint32_t &max_push_us) {
+  UiQueue queue;
+  std::atomic<uint32_t> longest(0);
+  std::atomic<int> running(producers);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++) {
+    threads.emplace_back([&, p]() {
+      Ui_Command command;
+      memset(&command, 0, sizeof(command));
+      command.type = UI_COMMAND_STATUS;
+      command.leds = (uint8_t)p;
+      for (int i = 0; i < commands; i++) {
+        command.color = (uint32_t)i;
+        snprintf(command.text, sizeof(command.text), "%d:%d", p, i);
+        while (true) {
+          auto start = std::chrono::steady_clock::now();
+          bool pushed = queue.push(command);
+          note_max(longest, elapsed_us(start));
+          if (pushed) break;
+          std::this_thread::yield();
+        }
+      }
+      running--;
+    });
+  }
+
+  Ui_Command command;
+  while (true) {
+    bool done = running.load() == 0;  // before the last pop
+    if (queue.pop(command)) continue;
+    if (done) break;
+    std::this_thread::yield();
+  }
+  for (std::thread &t : threads) t.join();
+
+  rejected = queue.stats().rejected;
+  max_push_us = longest.load();
+}
+
+// A display with the firmware's status line and frame buffers
+struct Display {
+  explicit Display(uint32_t refresh_us)
+      : line(lcd, STATUS_TEXT_X, STATUS_TEXT_Y),
+        buffers(lcd, DISPLAY_FRONT_BUFFER, DISPLAY_BACK_BUFFER),
+        green(LED1),
+        red(LED2) {
+    lcd.set_refresh_us(refresh_us);
+    lcd.SetFont(&Font16);
+    lcd.Clear(LCD_COLOR_BLACK);
+    buffers.enable();
+  }
+
+  LCD_DISCO_F429ZI lcd;
+  StatusLine line;
+  FrameBuffers buffers;
+  DigitalOut green;
+  DigitalOut red;
+};
+
+// The producers' commands at random
+void produce(UiRenderer &ui, int p, int commands, uint32_t seed,
+             std::atomic<uint32_t> &longest) {
+  std::mt19937 rng(seed + p);
+  for (int i = 0; i < commands; i++) {
+    auto start = std::chrono::steady_clock::now();
+    switch (rng() % 3) {
+      case 0: {
+        char text[UI_STATUS_TEXT];
+        snprintf(text, sizeof(text), "Producer %d: %d", p, i);
+        ui.status(text, kColors[rng() % 6]);
+        break;
+      }
+      case 1:
+        ui.leds(rng() % 4);
+        break;
+      default:
+        ui.progress(rng() % 4 == 0 ? UI_PROGRESS_HIDDEN : rng() % 1001);
+        break;
+    }
+    note_max(longest, elapsed_us(start));
+    if (rng() % 64 == 0) std::this_thread::yield();
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int producers = atoi(option(argc, argv, "--producers", "4"));
+  int commands = atoi(option(argc, argv, "--commands", "100000"));
+  uint32_t seed = strtoul(option(argc, argv, "--seed", "1"), nullptr, 0);
+
+  uint32_t rejected = 0;
+  uint32_t max_push_us = 0;
+  queue_stress(producers, commands, rejected, max_push_us);
+  printf("queue:    %d producers x %d commands, %lu pushes refused, longest "
+         "push %lu us\n",
+         producers, commands, (unsigned long)rejected,
+         (unsigned long)max_push_us);
+
+  // The renderer under load
+  Display display(DISPLAY_REFRESH_US);
+  UiRenderer *ui = new UiRenderer(display.lcd, display.buffers, display.line,
+                                  display.green, display.red);
+  ui->start();
+  std::atomic<uint32_t> longest(0);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++) {
+    threads.emplace_back(produce, std::ref(*ui), p, commands / 10, seed,
+                         std::ref(longest));
+  }
+  for (std::thread &t : threads) t.join();
+  // Stopped once the queue is empty; stopping draws what is left
+  Ui_Queue_Stats queued = ui->queue_stats();
+  while (queued.popped != queued.pushed) {
+    std::this_thread::yield();
+    queued = ui->queue_stats();
+  }
+  Ui_Renderer_Stats drawn = ui->stats();
+  delete ui;
+
+  printf("renderer: %d producers x %d commands, %lu drawn, %lu overflowed, "
+         "%lu coalesced, %lu frames; longest post %lu us, longest frame %lu "
+         "us\n",
+         producers, commands / 10, (unsigned long)drawn.commands,
+         (unsigned long)drawn.overflowed, (unsigned long)drawn.coalesced,
+         (unsigned long)drawn.frames, (unsigned long)longest.load(),
+         (unsigned long)drawn.max_us);
+  return 0;
+}
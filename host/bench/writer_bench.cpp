@@ -0,0 +1,215 @@
+/**
+ * @file writer_bench.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host benchmark of UI responsiveness while a key is persisted, with
+ * and without the background flash writer.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_writer_bench [--seconds S] [--frame-ms F]
+ *
+ * The flash emulator runs in real time (a 16 KB erase sleeps 250 ms). A UI
+ * thread renders a frame every F ms and records how late each frame is.
+ * Halfway through the first second it enrolls a key into a store that is
+ * down to its reserve sector, so persisting the key also reclaims a sector:
+ *
+ *   synchronous: the UI thread calls write() and maintain() itself, as the
+ *                firmware did before the flash writer
+ *   background:  the UI thread queues the key with FlashWriter::persist()
+ *                and shows "Key saved" at once
+ *
+ * For each, reports the time until "Key saved" is on screen, the time until
+ * the key is in flash, and the frame lateness (maximum and 99th
+ * percentile, frames late by more than one period). A last run queues a
+ * burst of enrollments for one slot to show write coalescing; the tests
+ * in host/test/flash_writer_test.cpp check the writer's behavior.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "flash_writer.h"
+#include "gesture_synth.h"
+
+namespace {
+
+typedef std::vector<std::array<float, 3>> Gesture;
+typedef std::chrono::steady_clock Clock;
+
+const uint16_t kRate = GYRO_SAMPLE_RATE_HZ / RECORDING_DECIMATION;
+
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+Gesture make_key(uint64_t seed) {
+  synth::Rng rng(seed);
+  Gesture key;
+  synth::generate(synth::random_spec(rng), synth::typical_variation(),
+                  rng.next(), key);
+  key.resize(RECORDING_SAMPLES);
+  return key;
+}
+
+// A blank store filled until only the reserve sector is free, so the next
+// maintain() erases a sector
+void prepare(TemplateStore &store) {
+  flash_emulator_set_realtime(false);
+  flash_emulator_erase_all();
+  store.mount();
+  Gesture key = make_key(1);
+  for (uint8_t slot = 1; store.stats().free_sectors > TEMPLATE_STORE_RESERVE;
+       slot = slot % (TEMPLATE_SLOTS - 1) + 1) {
+    store.write(slot, key, kRate);
+  }
+  flash_emulator_set_realtime(true);
+}
+
+struct Run {
+  double saved_ms;   // enroll until "Key saved" is shown
+  double stored_ms;  // enroll until the key is in flash
+  double max_late_ms;
+  double p99_late_ms;
+  int late_frames;
+  int frames;
+};
+
+// UI loop from `start`: one frame per period; `enroll` runs inside the
+// frame at 0.5 s. stored_ns is set (relative to start) once the key is in
+// flash.
+template <typename Enroll>
+Run ui_loop(Clock::time_point start, double seconds, double frame_ms,
+            Enroll &&enroll, std::atomic<int64_t> &stored_ns) {
+  Run run = {};
+  std::vector<double> late;
+  auto period = std::chrono::duration<double, std::milli>(frame_ms);
+  auto next = start;
+  bool enrolled = false;
+  int64_t enroll_ns = 0;
+  while (Clock::now() - start < std::chrono::duration<double>(seconds)) {
+    std::this_thread::sleep_until(next);
+    auto now = Clock::now();
+    late.push_back(
+        std::chrono::duration<double, std::milli>(now - next).count());
+    next += std::chrono::duration_cast<Clock::duration>(period);
+    if (next < now) next = now;  // skip the frames that were missed
+
+    if (!enrolled && now - start >= std::chrono::milliseconds(500)) {
+      enrolled = true;
+      enroll_ns = (now - start).count();
+      enroll();
+      run.saved_ms = (Clock::now() - now).count() / 1e6;
+    }
+  }
+
+  std::sort(late.begin(), late.end());
+  run.frames = late.size();
+  run.max_late_ms = late.back();
+  run.p99_late_ms = late[late.size() * 99 / 100];
+  for (double l : late) {
+    if (l > frame_ms) run.late_frames++;
+  }
+  int64_t done = stored_ns.load();
+  run.stored_ms = done > 0 ? (done - enroll_ns) / 1e6 : -1.0;
+  return run;
+}
+
+void print(const char *name, const Run &run) {
+  printf("%-12s %9.1f %10.1f %9.1f %9.1f %6d/%d\n", name, run.saved_ms,
+         run.stored_ms, run.max_late_ms, run.p99_late_ms, run.late_frames,
+         run.frames);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  double seconds = atof(option(argc, argv, "--seconds", "2"));
+  double frame_ms = atof(option(argc, argv, "--frame-ms", "20"));
+  Gesture key = make_key(7);
+
+  printf("%-12s %9s %10s %9s %9s %s\n", "persist", "saved ms", "stored ms",
+         "late max", "late p99", "late frames");
+
+  // Synchronous: the UI thread does the flash work
+  Run sync;
+  {
+    TemplateStore store;
+    prepare(store);
+    std::atomic<int64_t> stored_ns(0);
+    auto start = Clock::now();
+    sync = ui_loop(start, seconds, frame_ms,
+                   [&] {
+                     store.write(TEMPLATE_KEY_SLOT, key, kRate);
+                     store.maintain();
+                     stored_ns = (Clock::now() - start).count();
+                   },
+                   stored_ns);
+    print("synchronous", sync);
+  }
+
+  // Background: the UI thread only queues the key
+  Run background;
+  uint32_t reclaimed = 0;
+  {
+    TemplateStore store;
+    prepare(store);
+    FlashWriter writer(store);
+    std::atomic<int64_t> stored_ns(0);
+    writer.start();
+    auto start = Clock::now();
+    background = ui_loop(
+        start, seconds, frame_ms,
+        [&] {
+          writer.persist(TEMPLATE_KEY_SLOT, key, kRate,
+                         [&](uint8_t, Flash_Job_Status status) {
+                           if (status == FLASH_JOB_DONE) {
+                             stored_ns = (Clock::now() - start).count();
+                           }
+                         });
+        },
+        stored_ns);
+    writer.flush();
+    reclaimed = store.stats().compactions;
+    print("background", background);
+  }
+  printf("(background reclaimed %u sector%s while the UI ran)\n", reclaimed,
+         reclaimed == 1 ? "" : "s");
+
+  // Coalescing: a burst of enrollments for one slot, queued back to back
+  {
+    TemplateStore store;
+    prepare(store);
+    FlashWriter writer(store);
+    writer.start();
+    int superseded = 0;
+    Mutex counts;
+    auto count = [&](uint8_t, Flash_Job_Status status) {
+      ScopedLock<Mutex> lock(counts);
+      if (status == FLASH_JOB_SUPERSEDED) superseded++;
+    };
+    for (int i = 0; i < 10; i++) {
+      writer.persist(TEMPLATE_KEY_SLOT, make_key(100 + i), kRate, count);
+    }
+    writer.flush();
+    Flash_Writer_Stats stats = writer.stats();
+    printf("burst of 10 writes to one slot: %u reached flash, %d superseded, "
+           "%u rejected\n",
+           stats.completed, superseded, stats.rejected);
+  }
+  return 0;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file heap_stats.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host heap statistics for the mbed shim.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Global new and delete are replaced to count them. They live apart from
+ * the rest of the shim so that no unit both defines them and uses them.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "mbed.h"
+
+#include <malloc.h>
+
+#include <atomic>
+#include <new>
+
+/*******************************************************************************
+ * Heap statistics: every global new and delete, by usable size
+ * ****************************************************************************/
+static std::atomic<size_t> heap_current(0);
+static std::atomic<size_t> heap_max(0);
+static std::atomic<size_t> heap_total(0);
+static std::atomic<uint32_t> heap_allocations(0);
+static std::atomic<uint32_t> heap_failures(0);
+
+void *operator new(size_t size) {
+  void *p = malloc(size != 0 ? size : 1);
+  if (p == nullptr) {
+    heap_failures++;
+    throw std::bad_alloc();
+  }
+  size_t usable = malloc_usable_size(p);
+  size_t current = heap_current += usable;
+  size_t max = heap_max.load(std::memory_order_relaxed);
+  while (current > max && !heap_max.compare_exchange_weak(max, current)) {
+  }
+  heap_total += usable;
+  heap_allocations++;
+  return p;
+}
+
+static void heap_release(void *p) {
+  if (p == nullptr) return;
+  heap_current -= malloc_usable_size(p);
+  free(p);
+}
+
+void operator delete(void *p) noexcept { heap_release(p); }
+void operator delete(void *p, size_t) noexcept { heap_release(p); }
+
+void mbed_stats_heap_get(mbed_stats_heap_t *stats) {
+  memset(stats, 0, sizeof(*stats));
+  stats->current_size = (uint32_t)heap_current;
+  stats->max_size = (uint32_t)heap_max;
+  stats->total_size = (uint32_t)heap_total;
+  stats->alloc_cnt = heap_allocations;
+  stats->alloc_fail_cnt = heap_failures;
+}
@@ -0,0 +1,482 @@
+/**
+ * @file lcd_emulator.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host framebuffer emulator of LCD_DISCO_F429ZI.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "lcd_emulator.h"
+
+#include <algorithm>
+#include <cstring>
+
+// LCD_DISCO_F429ZI's layer buffers
+#define LCD_FRAME_BUFFER_LAYER0 (LCD_FRAME_BUFFER + 0x130000)
+#define LCD_FRAME_BUFFER_LAYER1 LCD_FRAME_BUFFER
+
+// The ILI9341 timings: a 6 MHz dot clock, 279 x 327 clocks a frame
+#define LCD_REFRESH_US (279 * 327 / 6)
+
+LCD_DISCO_F429ZI::LCD_DISCO_F429ZI()
+    : width_(240),
+      height_(320),
+      sdram_(LCD_FRAME_BUFFER_LAYER0 - LCD_FRAME_BUFFER + 240 * 320 * 4, 0),
+      reload_pending_(false),
+      refresh_us_(LCD_REFRESH_US),
+      epoch_(std::chrono::steady_clock::now()),
+      refreshes_(0),
+      hook_pixels_(0),
+      text_color_(LCD_COLOR_BLACK),
+      back_color_(LCD_COLOR_WHITE),
+      font_(&Font16),
+      atlas_font_(nullptr),
+      atlas_(nullptr) {
+  memset(layers_, 0, sizeof(layers_));
+  layers_[0].format = layers_[1].format = LCD_PIXEL_FORMAT_ARGB8888;
+  // Layer 1 is cleared to white and hidden
+  SetLayerAddress(1, LCD_FRAME_BUFFER_LAYER1);
+  uint32_t *layer1 = (uint32_t *)memory(LCD_FRAME_BUFFER_LAYER1);
+  std::fill_n(layer1, width_ * height_, LCD_COLOR_WHITE);
+  SetLayerAddress(0, LCD_FRAME_BUFFER_LAYER0);
+  Clear(LCD_COLOR_WHITE);
+  reset_stats();
+}
+
+void LCD_DISCO_F429ZI::reset_stats() { memset(&stats_, 0, sizeof(stats_)); }
+
+static uint32_t pixel_bytes(uint32_t format) {
+  switch (format) {
+    case LCD_PIXEL_FORMAT_L8:
+      return 1;
+    case LCD_PIXEL_FORMAT_RGB565:
+      return 2;
+    default:
+      return 4;
+  }
+}
+
+uint32_t LCD_DISCO_F429ZI::GetBytesPerPixel(uint32_t layer) {
+  return pixel_bytes(layers_[layer].format);
+}
+
+// A whole frame buffer of layer 0's format at the address, or nullptr
+// outside the emulated SDRAM
+uint8_t *LCD_DISCO_F429ZI::memory(uint32_t address) {
+  uint32_t bytes = pixel_bytes(layers_[0].format);
+  uint32_t offset = address - LCD_FRAME_BUFFER;
+  if (address < LCD_FRAME_BUFFER || offset % bytes != 0 ||
+      offset + width_ * height_ * bytes > sdram_.size()) {
+    return nullptr;
+  }
+  return &sdram_[offset];
+}
+
+// The buffer at the address as the LTDC sends it to the panel
+const uint32_t *LCD_DISCO_F429ZI::view(uint32_t address,
+                                       std::vector<uint32_t> &pixels) {
+  const uint8_t *frame = memory(address);
+  if (frame == nullptr) return nullptr;
+  pixels.resize(width_ * height_);
+  for (uint32_t at = 0; at < width_ * height_; at++) {
+    pixels[at] = load(frame, at);
+  }
+  return pixels.data();
+}
+
+/*******************************************************************************
+ *
+ * @brief An ARGB8888 color as layer 0 stores it, as the BSP's ColorToPixel():
+ * RGB565 truncated, L8 the nearest CLUT entry, lowest index on a tie
+ *
+ * ****************************************************************************/
+uint32_t LCD_DISCO_F429ZI::to_pixel(uint32_t color) {
+  Layer &layer = layers_[0];
+  if (layer.format == LCD_PIXEL_FORMAT_RGB565) {
+    return ((color >> 8) & 0xF800) | ((color >> 5) & 0x07E0) |
+           ((color >> 3) & 0x001F);
+  }
+  if (layer.format != LCD_PIXEL_FORMAT_L8) return color;
+
+  color &= 0x00FFFFFF;
+  if (layer.cached && layer.cached_color == color) return layer.cached_index;
+  uint32_t best = 0;
+  uint32_t best_distance = UINT32_MAX;
+  for (uint32_t i = 0; layer.clut != nullptr && i < layer.clut_size; i++) {
+    uint32_t entry = layer.clut[i] & 0x00FFFFFF;
+    int32_t r = (int32_t)((entry >> 16) & 0xFF) - (int32_t)(color >> 16);
+    int32_t g = (int32_t)((entry >> 8) & 0xFF) -
+                (int32_t)((color >> 8) & 0xFF);
+    int32_t b = (int32_t)(entry & 0xFF) - (int32_t)(color & 0xFF);
+    uint32_t distance = (uint32_t)(r * r + g * g + b * b);
+    if (distance < best_distance) {
+      best = i;
+      best_distance = distance;
+      if (distance == 0) break;
+    }
+  }
+  layer.cached_color = color;
+  layer.cached_index = best;
+  layer.cached = true;
+  return best;
+}
+
+// A pixel of layer 0 as ARGB8888, as the LTDC expands it
+uint32_t LCD_DISCO_F429ZI::to_color(uint32_t pixel) const {
+  const Layer &layer = layers_[0];
+  if (layer.format == LCD_PIXEL_FORMAT_RGB565) {
+    return 0xFF000000 | ((pixel & 0xF800) << 8) | ((pixel & 0xE000) << 3) |
+           ((pixel & 0x07E0) << 5) | ((pixel & 0x0600) >> 1) |
+           ((pixel & 0x001F) << 3) | ((pixel & 0x001C) >> 2);
+  }
+  if (layer.format == LCD_PIXEL_FORMAT_L8) {
+    return pixel < layer.clut_size ? 0xFF000000 | layer.clut[pixel]
+                                   : 0xFF000000;
+  }
+  return pixel;
+}
+
+void LCD_DISCO_F429ZI::store(uint8_t *frame, uint32_t at, uint32_t color) {
+  uint32_t pixel = to_pixel(color);
+  switch (pixel_bytes(layers_[0].format)) {
+    case 1:
+      frame[at] = (uint8_t)pixel;
+      break;
+    case 2:
+      memcpy(frame + 2 * at, &pixel, 2);
+      break;
+    default:
+      memcpy(frame + 4 * at, &pixel, 4);
+      break;
+  }
+}
+
+uint32_t LCD_DISCO_F429ZI::load(const uint8_t *frame, uint32_t at) const {
+  uint32_t pixel = 0;
+  uint32_t bytes = pixel_bytes(layers_[0].format);
+  memcpy(&pixel, frame + bytes * at, bytes);
+  return to_color(pixel);
+}
+
+uint32_t LCD_DISCO_F429ZI::ReadPixel(uint16_t x, uint16_t y) {
+  const uint8_t *frame = memory(layers_[0].address);
+  uint32_t offset = (uint32_t)y * width_ + x;
+  return frame != nullptr && offset < width_ * height_ ? load(frame, offset)
+                                                       : 0;
+}
+
+// A store to the framebuffer; like the BSP, out-of-range columns wrap into
+// the next line
+void LCD_DISCO_F429ZI::DrawPixel(uint16_t x, uint16_t y, uint32_t color) {
+  uint8_t *frame = memory(layers_[0].address);
+  uint32_t offset = (uint32_t)y * width_ + x;
+  if (frame != nullptr && offset < width_ * height_) {
+    store(frame, offset, color);
+  }
+  stats_.cpu_pixels++;
+  stats_.bytes_written += pixel_bytes(layers_[0].format);
+  written(1);
+}
+
+// A DMA2D fill; in L8, the BSP's CPU fill
+void LCD_DISCO_F429ZI::fill(uint32_t offset, uint32_t width, uint32_t height,
+                            uint32_t line_offset, uint32_t color) {
+  uint8_t *frame = memory(layers_[0].address);
+  for (uint32_t row = 0; frame != nullptr && row < height; row++) {
+    for (uint32_t col = 0; col < width; col++) {
+      uint32_t at = offset + row * (width + line_offset) + col;
+      if (at < width_ * height_) store(frame, at, color);
+    }
+  }
+  uint64_t pixels = (uint64_t)width * height;
+  if (layers_[0].format == LCD_PIXEL_FORMAT_L8) {
+    stats_.cpu_pixels += pixels;
+  } else {
+    stats_.dma2d_pixels += pixels;
+    stats_.dma2d_transfers++;
+  }
+  stats_.bytes_written += pixels * pixel_bytes(layers_[0].format);
+  written(pixels);
+}
+
+/*******************************************************************************
+ *
+ * @brief DMA2D memory-to-memory copy of a rectangle between two buffers
+ *
+ * ****************************************************************************/
+void LCD_DISCO_F429ZI::CopyRect(uint32_t from, uint32_t to, uint16_t x,
+                                uint16_t y, uint16_t width, uint16_t height) {
+  const uint8_t *source = memory(from);
+  uint8_t *destination = memory(to);
+  uint32_t bytes = pixel_bytes(layers_[0].format);
+  if (width == 0 || height == 0) return;
+  for (uint32_t row = 0; source && destination && row < height; row++) {
+    uint32_t at = (uint32_t)(y + row) * width_ + x;
+    if (at + width > width_ * height_) break;
+    memmove(destination + at * bytes, source + at * bytes, width * bytes);
+  }
+  copied((uint64_t)width * height);
+}
+
+// Counts a copy: the DMA2D's, or in L8 the CPU's
+void LCD_DISCO_F429ZI::copied(uint64_t pixels) {
+  if (layers_[0].format == LCD_PIXEL_FORMAT_L8) {
+    stats_.cpu_pixels += pixels;
+  } else {
+    stats_.dma2d_pixels += pixels;
+    stats_.dma2d_transfers++;
+  }
+  stats_.bytes_written += pixels * pixel_bytes(layers_[0].format);
+  stats_.bytes_read += pixels * pixel_bytes(layers_[0].format);
+  written(pixels);
+}
+
+// A copy within one buffer, as the driver does it: lines in order, the
+// last first for a move down, and each line with memmove() (the CPU's copy
+// of a line moved right over itself; any other line never overlaps)
+void LCD_DISCO_F429ZI::MoveRect(uint32_t address, uint16_t from_x,
+                                uint16_t from_y, uint16_t to_x, uint16_t to_y,
+                                uint16_t width, uint16_t height) {
+  uint8_t *frame = memory(address);
+  uint32_t bytes = pixel_bytes(layers_[0].format);
+  if (width == 0 || height == 0) return;
+  bool up = to_y <= from_y;
+  for (uint32_t i = 0; frame != nullptr && i < height; i++) {
+    uint32_t row = up ? i : height - 1 - i;
+    uint32_t from = (uint32_t)(from_y + row) * width_ + from_x;
+    uint32_t to = (uint32_t)(to_y + row) * width_ + to_x;
+    if (std::max(from, to) + width > width_ * height_) continue;
+    memmove(frame + to * bytes, frame + from * bytes, width * bytes);
+  }
+  copied((uint64_t)width * height);
+}
+
+// HAL_LTDC_SetPixelFormat() reloads at once
+void LCD_DISCO_F429ZI::SetPixelFormat(uint32_t layer, uint32_t format) {
+  layers_[layer].format = format;
+  Reload(LCD_RELOAD_IMMEDIATE);
+}
+
+void LCD_DISCO_F429ZI::SetCLUT(uint32_t layer, uint32_t *clut, uint32_t size) {
+  layers_[layer].clut = clut;
+  layers_[layer].clut_size = size;
+  layers_[layer].cached = false;
+}
+
+void LCD_DISCO_F429ZI::SetLayerAddress(uint32_t layer, uint32_t address) {
+  layers_[layer].address = address;
+  layers_[layer].loaded = address;
+}
+
+void LCD_DISCO_F429ZI::SetLayerAddress_NoReload(uint32_t layer,
+                                                uint32_t address) {
+  layers_[layer].address = address;
+}
+
+void LCD_DISCO_F429ZI::Reload(uint32_t type) {
+  catch_up();
+  if (type == LCD_RELOAD_IMMEDIATE) {
+    for (Layer &layer : layers_) layer.loaded = layer.address;
+    reload_pending_ = false;
+    stats_.reloads++;
+  } else {
+    reload_pending_ = true;
+  }
+}
+
+uint8_t LCD_DISCO_F429ZI::ReloadPending() {
+  catch_up();
+  return reload_pending_;
+}
+
+/*******************************************************************************
+ *
+ * @brief A vertical blanking: the LTDC loads a pending reload
+ *
+ * ****************************************************************************/
+void LCD_DISCO_F429ZI::vblank() {
+  if (reload_pending_) {
+    for (Layer &layer : layers_) layer.loaded = layer.address;
+    reload_pending_ = false;
+    stats_.reloads++;
+  }
+  stats_.refreshes++;
+}
+
+void LCD_DISCO_F429ZI::set_write_hook(std::function<uint32_t()> hook,
+                                      uint32_t pixels) {
+  hook_ = hook;
+  hook_pixels_ = hook ? pixels : 0;
+}
+
+// A DMA2D transfer calls the hook once, when it is done
+void LCD_DISCO_F429ZI::written(uint64_t pixels) {
+  if (hook_pixels_ == 0) return;
+  if (pixels < hook_pixels_) {
+    hook_pixels_ -= pixels;
+    return;
+  }
+  hook_pixels_ = hook_();
+}
+
+void LCD_DISCO_F429ZI::set_refresh_us(uint32_t us) {
+  catch_up();
+  refresh_us_ = us;
+  epoch_ = std::chrono::steady_clock::now();
+  refreshes_ = 0;
+}
+
+// The vertical blankings real time has brought since the last call
+void LCD_DISCO_F429ZI::catch_up() {
+  if (refresh_us_ == 0) return;
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - epoch_);
+  uint64_t refreshes = elapsed.count() / refresh_us_;
+  if (refreshes > refreshes_) {
+    stats_.refreshes += refreshes - refreshes_ - 1;
+    refreshes_ = refreshes;
+    vblank();
+  }
+}
+
+void LCD_DISCO_F429ZI::Clear(uint32_t color) {
+  fill(0, width_, height_, 0, color);
+}
+
+void LCD_DISCO_F429ZI::FillRect(uint16_t x, uint16_t y, uint16_t width,
+                                uint16_t height) {
+  fill((uint32_t)y * width_ + x, width, height, width_ - width, text_color_);
+}
+
+void LCD_DISCO_F429ZI::SetGlyphAtlas(sFONT *font, const uint8_t *atlas) {
+  atlas_font_ = font;
+  atlas_ = atlas;
+}
+
+// One channel of a DMA2D blend, 8 bits of the color at shift
+static uint32_t blend_channel(uint32_t foreground, uint32_t background,
+                              uint32_t alpha_f, uint32_t alpha_b,
+                              uint32_t alpha_out, int shift) {
+  uint32_t f = (foreground >> shift) & 0xFF;
+  uint32_t b = (background >> shift) & 0xFF;
+  uint32_t mult = alpha_f * alpha_b / 255;
+  return ((f * alpha_f + b * alpha_b - b * mult) / alpha_out) << shift;
+}
+
+/*******************************************************************************
+ *
+ * @brief The software fallback of the DMA2D's A8 blend: the foreground
+ * color over the background color, by the alpha of mask and opaque, converted
+ * to layer 0's format with the wrap-around of the frame buffer's lines
+ *
+ * ****************************************************************************/
+void LCD_DISCO_F429ZI::blend_mask(const uint8_t *mask, const uint8_t *opaque,
+                                  uint32_t offset, uint32_t width,
+                                  uint32_t height, uint32_t foreground,
+                                  uint32_t background) {
+  uint8_t *frame = memory(layers_[0].address);
+  for (uint32_t row = 0; frame != nullptr && row < height; row++) {
+    for (uint32_t col = 0; col < width; col++) {
+      uint32_t at = offset + row * width_ + col;
+      uint32_t alpha_f = mask[row * width + col];
+      uint32_t alpha_b = opaque[row * width + col];
+      uint32_t alpha_out = alpha_f + alpha_b - alpha_f * alpha_b / 255;
+      uint32_t pixel = 0;
+      if (alpha_out != 0) {
+        pixel = alpha_out << 24;
+        for (int shift = 0; shift < 24; shift += 8) {
+          pixel |= blend_channel(foreground, background, alpha_f, alpha_b,
+                                 alpha_out, shift);
+        }
+      }
+      if (at < width_ * height_) store(frame, at, pixel);
+    }
+  }
+  stats_.dma2d_pixels += (uint64_t)width * height;
+  stats_.dma2d_transfers++;
+  stats_.bytes_written +=
+      (uint64_t)width * height * pixel_bytes(layers_[0].format);
+  written((uint64_t)width * height);
+}
+
+/*******************************************************************************
+ *
+ * @brief Draw one glyph as the BSP's DrawChar() does, every pixel of its box,
+ * or, from the glyph atlas, as LCD_DISCO_F429ZI's DMA2D blend does (not in
+ * L8, which the DMA2D cannot write)
+ *
+ * ****************************************************************************/
+void LCD_DISCO_F429ZI::DisplayChar(uint16_t x, uint16_t y, uint8_t ascii) {
+  if (atlas_ != nullptr && layers_[0].format != LCD_PIXEL_FORMAT_L8 &&
+      font_ == atlas_font_ && ascii >= ' ' &&
+      ascii < ' ' + LCD_ATLAS_GLYPHS && (text_color_ >> 24) == 0xFF &&
+      (back_color_ >> 24) == 0xFF && x < width_ &&
+      (y + font_->Height - 1u) * width_ + x + font_->Width <=
+          width_ * height_) {
+    uint32_t cell = font_->Width * font_->Height;
+    blend_mask(atlas_ + (ascii - ' ') * cell, atlas_ + LCD_ATLAS_GLYPHS * cell,
+               (uint32_t)y * width_ + x, font_->Width, font_->Height,
+               text_color_, back_color_);
+    stats_.chars++;
+    stats_.atlas_chars++;
+    return;
+  }
+
+  uint16_t width = font_->Width;
+  uint16_t height = font_->Height;
+  uint32_t bytes = (width + 7) / 8;
+  uint8_t offset = 8 * bytes - width;
+  const uint8_t *glyph = &font_->table[(ascii - ' ') * height * bytes];
+
+  for (uint32_t i = 0; i < height; i++) {
+    const uint8_t *row = glyph + bytes * i;
+    uint32_t line;
+    switch (bytes) {
+      case 1:
+        line = row[0];
+        break;
+      case 2:
+        line = (row[0] << 8) | row[1];
+        break;
+      default:
+        line = (row[0] << 16) | (row[1] << 8) | row[2];
+        break;
+    }
+    for (uint32_t j = 0; j < width; j++) {
+      bool set = line & (1 << (width - j + offset - 1));
+      DrawPixel(x + j, y + i, set ? text_color_ : back_color_);
+    }
+  }
+  stats_.chars++;
+}
+
+void LCD_DISCO_F429ZI::DisplayStringAt(uint16_t x, uint16_t y, uint8_t *text,
+                                       Text_AlignModeTypdef mode) {
+  uint32_t size = strlen((const char *)text);
+  uint32_t xsize = width_ / font_->Width;
+  uint16_t column;
+  switch (mode) {
+    case CENTER_MODE:
+      column = x + ((xsize - size) * font_->Width) / 2;
+      break;
+    case RIGHT_MODE:
+      column = x + ((xsize - size) * font_->Width);
+      break;
+    default:
+      column = x;
+      break;
+  }
+
+  for (uint32_t i = 0;
+       *text != 0 && ((width_ - i * font_->Width) & 0xFFFF) >= font_->Width;
+       i++) {
+    DisplayChar(column, y, *text++);
+    column += font_->Width;
+  }
+}
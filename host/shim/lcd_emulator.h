@@ -0,0 +1,207 @@
+/**
+ * @file lcd_emulator.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Host emulator of the LCD_DISCO_F429ZI display class: 240x320
+ * framebuffers in ARGB8888, RGB565 or L8 drawn as the BSP draws them, layer
+ * 0 of the LTDC scanning one out, and pixel write counts.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Only the calls the firmware's display code makes are provided, with the
+ * BSP's semantics: DisplayChar() writes every pixel of the glyph box, the
+ * set ones in the text color and the others in the back color, one CPU
+ * store each; FillRect() and Clear() are DMA2D register-to-memory fills.
+ * With a glyph atlas set, DisplayChar() is instead the DMA2D blend of the
+ * glyph's A8 cell, done in software with the DMA2D's arithmetic: one
+ * transfer, no CPU stores, the same pixels.
+ * The constructor leaves the state LCD_DISCO_F429ZI's leaves: white
+ * screen, black text on white, Font16, ARGB8888.
+ *
+ * SetPixelFormat() changes the format layer 0 is stored in, as the BSP
+ * does: colors are converted as they are stored, to RGB565 by truncation
+ * (the DMA2D's conversion) or to the index of the nearest color of the
+ * CLUT in L8. In L8 the blend and the copies are left to the CPU, as on
+ * the board: DisplayChar() draws pixel by pixel.
+ *
+ * The frame buffers live in an emulated SDRAM from LCD_FRAME_BUFFER up to
+ * the end of layer 0's buffer, where the constructor puts the two layers.
+ * Drawing goes to the address layer 0 was last given (frame()); the panel
+ * shows the one the LTDC has loaded (scanout()). SetLayerAddress_NoReload()
+ * only changes the first; Reload() with LCD_RELOAD_VERTICAL_BLANKING
+ * changes the second at the next vertical blanking, which comes every
+ * refresh_us() of real time or, with set_refresh_us(0), when vblank() is
+ * called. Layer 1 is hidden, as the firmware leaves it. A write hook runs
+ * after so many pixel writes, and returns how many until it runs again, so
+ * a bench can put refreshes in the middle of drawing.
+ *
+ * stats() counts the pixels written each way, and the SDRAM bytes written
+ * and read, so the host build can measure what a redraw costs. frame() and
+ * scanout() convert the buffer to ARGB8888 (what the LTDC sends the panel),
+ * into storage valid until their next call.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef SENTRY_HOST_LCD_EMULATOR_H
+#define SENTRY_HOST_LCD_EMULATOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "drivers/fonts.h"
+
+typedef enum {
+  CENTER_MODE = 0x01,
+  RIGHT_MODE = 0x02,
+  LEFT_MODE = 0x03
+} Text_AlignModeTypdef;
+
+#define LCD_COLOR_BLUE 0xFF0000FF
+#define LCD_COLOR_GREEN 0xFF00FF00
+#define LCD_COLOR_RED 0xFFFF0000
+#define LCD_COLOR_CYAN 0xFF00FFFF
+#define LCD_COLOR_MAGENTA 0xFFFF00FF
+#define LCD_COLOR_YELLOW 0xFFFFFF00
+#define LCD_COLOR_LIGHTBLUE 0xFF8080FF
+#define LCD_COLOR_LIGHTGREEN 0xFF80FF80
+#define LCD_COLOR_LIGHTRED 0xFFFF8080
+#define LCD_COLOR_LIGHTCYAN 0xFF80FFFF
+#define LCD_COLOR_LIGHTMAGENTA 0xFFFF80FF
+#define LCD_COLOR_LIGHTYELLOW 0xFFFFFF80
+#define LCD_COLOR_DARKBLUE 0xFF000080
+#define LCD_COLOR_DARKGREEN 0xFF008000
+#define LCD_COLOR_DARKRED 0xFF800000
+#define LCD_COLOR_DARKCYAN 0xFF008080
+#define LCD_COLOR_DARKMAGENTA 0xFF800080
+#define LCD_COLOR_DARKYELLOW 0xFF808000
+#define LCD_COLOR_WHITE 0xFFFFFFFF
+#define LCD_COLOR_LIGHTGRAY 0xFFD3D3D3
+#define LCD_COLOR_GRAY 0xFF808080
+#define LCD_COLOR_DARKGRAY 0xFF404040
+#define LCD_COLOR_BLACK 0xFF000000
+#define LCD_COLOR_BROWN 0xFFA52A2A
+#define LCD_COLOR_ORANGE 0xFFFFA500
+#define LCD_COLOR_TRANSPARENT 0xFF000000
+
+#define LCD_FRAME_BUFFER ((uint32_t)0xD0000000)
+#define LCD_RELOAD_IMMEDIATE ((uint32_t)0x00000001)
+#define LCD_RELOAD_VERTICAL_BLANKING ((uint32_t)0x00000002)
+#define LCD_ATLAS_GLYPHS 95
+#define LCD_PIXEL_FORMAT_ARGB8888 ((uint32_t)0x00000000)
+#define LCD_PIXEL_FORMAT_RGB565 ((uint32_t)0x00000002)
+#define LCD_PIXEL_FORMAT_L8 ((uint32_t)0x00000005)
+
+// Pixels written since the last reset_stats()
+typedef struct {
+  uint64_t cpu_pixels;       // single stores (glyphs, DrawPixel)
+  uint64_t dma2d_pixels;     // written by DMA2D fills
+  uint32_t dma2d_transfers;  // fills and copies started
+  uint32_t chars;            // glyphs drawn
+  uint32_t atlas_chars;      // of those, blended from a glyph atlas
+  uint32_t refreshes;        // vertical blankings
+  uint32_t reloads;          // layer address changes the LTDC took
+  uint64_t bytes_written;    // to the SDRAM, by the CPU and the DMA2D
+  uint64_t bytes_read;       // from the SDRAM, by the DMA2D's copies
+} LCD_Emulator_Stats;
+
+class LCD_DISCO_F429ZI {
+ public:
+  LCD_DISCO_F429ZI();
+
+  uint32_t GetXSize() { return width_; }
+  uint32_t GetYSize() { return height_; }
+
+  uint32_t GetTextColor() { return text_color_; }
+  uint32_t GetBackColor() { return back_color_; }
+  void SetTextColor(uint32_t color) { text_color_ = color; }
+  void SetBackColor(uint32_t color) { back_color_ = color; }
+  void SetFont(sFONT *font) { font_ = font; }
+  sFONT *GetFont() { return font_; }
+
+  uint32_t ReadPixel(uint16_t x, uint16_t y);
+  void DrawPixel(uint16_t x, uint16_t y, uint32_t color);
+  void Clear(uint32_t color);
+  void FillRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+  void DisplayChar(uint16_t x, uint16_t y, uint8_t ascii);
+  void SetGlyphAtlas(sFONT *font, const uint8_t *atlas);
+  void DisplayStringAt(uint16_t x, uint16_t y, uint8_t *text,
+                       Text_AlignModeTypdef mode);
+
+  void SetPixelFormat(uint32_t layer, uint32_t format);
+  void SetCLUT(uint32_t layer, uint32_t *clut, uint32_t size);
+  uint32_t GetPixelFormat(uint32_t layer) { return layers_[layer].format; }
+  uint32_t GetBytesPerPixel(uint32_t layer);
+  void SetLayerAddress(uint32_t layer, uint32_t address);
+  void SetLayerAddress_NoReload(uint32_t layer, uint32_t address);
+  void Reload(uint32_t type);
+  uint8_t ReloadPending();
+  void CopyRect(uint32_t from, uint32_t to, uint16_t x, uint16_t y,
+                uint16_t width, uint16_t height);
+  void MoveRect(uint32_t address, uint16_t from_x, uint16_t from_y,
+                uint16_t to_x, uint16_t to_y, uint16_t width, uint16_t height);
+
+  // Emulator only
+  const uint32_t *frame() { return view(layers_[0].address, frame_view_); }
+  const uint32_t *scanout() { return view(layers_[0].loaded, scanout_view_); }
+  uint32_t refresh_us() const { return refresh_us_; }
+  void set_refresh_us(uint32_t us);
+  void vblank();
+  void set_write_hook(std::function<uint32_t()> hook, uint32_t pixels);
+  LCD_Emulator_Stats stats() const { return stats_; }
+  void reset_stats();
+
+ private:
+  // An LTDC layer: the address in the handle (what the BSP draws into) and
+  // the one in the active registers, its format and CLUT
+  struct Layer {
+    uint32_t address;
+    uint32_t loaded;
+    uint32_t format;
+    const uint32_t *clut;
+    uint32_t clut_size;
+    uint32_t cached_color;  // the last color mapped to the CLUT
+    uint32_t cached_index;
+    bool cached;
+  };
+
+  uint8_t *memory(uint32_t address);
+  const uint32_t *view(uint32_t address, std::vector<uint32_t> &pixels);
+  uint32_t to_pixel(uint32_t color);
+  uint32_t to_color(uint32_t pixel) const;
+  void store(uint8_t *frame, uint32_t at, uint32_t color);
+  uint32_t load(const uint8_t *frame, uint32_t at) const;
+  void fill(uint32_t offset, uint32_t width, uint32_t height,
+            uint32_t line_offset, uint32_t color);
+  void blend_mask(const uint8_t *mask, const uint8_t *opaque, uint32_t offset,
+                  uint32_t width, uint32_t height, uint32_t foreground,
+                  uint32_t background);
+  void copied(uint64_t pixels);
+  void catch_up();
+  void written(uint64_t pixels);
+
+  uint32_t width_;
+  uint32_t height_;
+  std::vector<uint8_t> sdram_;
+  std::vector<uint32_t> frame_view_;
+  std::vector<uint32_t> scanout_view_;
+  Layer layers_[2];
+  bool reload_pending_;
+  uint32_t refresh_us_;  // 0: vblank() only
+  std::chrono::steady_clock::time_point epoch_;
+  uint64_t refreshes_;   // since epoch_
+  std::function<uint32_t()> hook_;
+  uint64_t hook_pixels_;  // pixel writes until the next hook call, 0: none
+  uint32_t text_color_;
+  uint32_t back_color_;
+  sFONT *font_;
+  sFONT *atlas_font_;
+  const uint8_t *atlas_;
+  LCD_Emulator_Stats stats_;
+};
+
+#endif  // SENTRY_HOST_LCD_EMULATOR_H
@@ -0,0 +1,441 @@
+/**
+ * @file mbed.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Host shim for the parts of the mbed API used by the processing code,
+ * so utilities.cpp, gyro.cpp and the matcher build and run on Linux.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Only what the shared sources touch is provided. Peripherals behave like an
+ * idle board: SPI reads return zero, GPIO writes go nowhere, and input pins
+ * only change when a host emulator drives them. FlashIAP is
+ * an emulator of the STM32F429 flash: a RAM image with its sector layout,
+ * erase and program times and per-sector erase counters. The BSP EEPROM
+ * functions drive an emulated M24LR64 with its page size and write cycle.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef SENTRY_HOST_MBED_H
+#define SENTRY_HOST_MBED_H
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// mbed.h brings both namespaces into scope; the sources rely on it
+using namespace std;
+using namespace std::chrono_literals;
+
+/*******************************************************************************
+ * Pins
+ * ****************************************************************************/
+typedef enum {
+  PA_0, PA_2, PA_15, PC_1, PF_7, PF_8, PF_9, PG_13, PG_14,
+  LED1 = PG_13,
+  LED2 = PG_14,
+  NC = -1
+} PinName;
+
+typedef enum { PullNone, PullUp, PullDown } PinMode;
+
+/*******************************************************************************
+ * Kernel clock
+ * ****************************************************************************/
+namespace Kernel {
+struct Clock {
+  typedef std::chrono::milliseconds duration;
+  typedef std::chrono::duration<uint32_t, std::milli> duration_u32;
+  typedef std::chrono::time_point<Clock, duration> time_point;
+  static time_point now();
+};
+}  // namespace Kernel
+
+void wait_us(int us);
+
+/*******************************************************************************
+ * Peripherals
+ * ****************************************************************************/
+class SPI {
+ public:
+  SPI(PinName mosi, PinName miso, PinName sclk) {
+    (void)mosi, (void)miso, (void)sclk;
+  }
+  void format(int bits, int mode = 0) { (void)bits, (void)mode; }
+  void frequency(int hz = 1000000) { (void)hz; }
+  int write(int value) {
+    (void)value;
+    return 0;
+  }
+};
+
+class DigitalOut {
+ public:
+  explicit DigitalOut(PinName pin, int value = 0) : value_(value) { (void)pin; }
+  void write(int value) { value_ = value; }
+  int read() const { return value_; }
+  DigitalOut &operator=(int value) {
+    value_ = value;
+    return *this;
+  }
+  operator int() const { return value_; }
+
+ private:
+  int value_;
+};
+
+/*******************************************************************************
+ * Timing and synchronization
+ * ****************************************************************************/
+class Timer {
+ public:
+  Timer() : running_(false), accumulated_(0) {}
+  void start();
+  void stop();
+  void reset();
+  std::chrono::microseconds elapsed_time() const;
+
+ private:
+  bool running_;
+  std::chrono::steady_clock::time_point started_;
+  std::chrono::microseconds accumulated_;
+};
+
+class Mutex {
+ public:
+  void lock() { mutex_.lock(); }
+  void unlock() { mutex_.unlock(); }
+  bool trylock() { return mutex_.try_lock(); }
+
+ private:
+  std::recursive_mutex mutex_;  // rtos::Mutex is recursive too
+};
+
+template <typename Lockable>
+class ScopedLock {
+ public:
+  explicit ScopedLock(Lockable &lockable) : lockable_(lockable) {
+    lockable_.lock();
+  }
+  ~ScopedLock() { lockable_.unlock(); }
+  ScopedLock(const ScopedLock &) = delete;
+  ScopedLock &operator=(const ScopedLock &) = delete;
+
+ private:
+  Lockable &lockable_;
+};
+
+// Interrupts cannot be masked on the host; one process-wide recursive lock
+// gives the same mutual exclusion between threads
+void core_util_critical_section_enter();
+void core_util_critical_section_exit();
+
+// rtos::ConditionVariable; the Mutex has to be held exactly once
+class ConditionVariable {
+ public:
+  explicit ConditionVariable(Mutex &mutex) : mutex_(mutex) {}
+  void wait() { cv_.wait(mutex_); }
+  std::cv_status wait_for(Kernel::Clock::duration_u32 rel_time) {
+    return cv_.wait_for(mutex_, rel_time);
+  }
+  void notify_one() { cv_.notify_one(); }
+  void notify_all() { cv_.notify_all(); }
+
+ private:
+  Mutex &mutex_;
+  std::condition_variable_any cv_;
+};
+
+class EventFlags {
+ public:
+  EventFlags() : flags_(0) {}
+  uint32_t set(uint32_t flags);
+  uint32_t clear(uint32_t flags = 0x7fffffff);
+  uint32_t get() const;
+  uint32_t wait_all(uint32_t flags, bool clear = true);
+  uint32_t wait_any(uint32_t flags, bool clear = true);
+  uint32_t wait_all_for(uint32_t flags, Kernel::Clock::duration_u32 rel_time,
+                        bool clear = true);
+  uint32_t wait_any_for(uint32_t flags, Kernel::Clock::duration_u32 rel_time,
+                        bool clear = true);
+
+ private:
+  uint32_t wait(uint32_t flags, bool all, bool clear,
+                const std::chrono::steady_clock::time_point *deadline);
+
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  uint32_t flags_;
+};
+
+/*******************************************************************************
+ * Threads and callbacks
+ * ****************************************************************************/
+template <typename Signature>
+class Callback;
+
+template <typename R, typename... Args>
+class Callback<R(Args...)> : public std::function<R(Args...)> {
+ public:
+  using std::function<R(Args...)>::function;
+};
+
+template <typename R, typename... Args>
+Callback<R(Args...)> callback(R (*function)(Args...)) {
+  return Callback<R(Args...)>(function);
+}
+
+template <typename T, typename R, typename... Args>
+Callback<R(Args...)> callback(T *object, R (T::*method)(Args...)) {
+  return Callback<R(Args...)>(
+      [object, method](Args... args) { return (object->*method)(args...); });
+}
+
+typedef enum {
+  osPriorityLow = 8,
+  osPriorityBelowNormal = 16,
+  osPriorityNormal = 24,
+  osPriorityAboveNormal = 32,
+  osPriorityHigh = 40,
+  osPriorityRealtime = 48
+} osPriority;
+
+typedef int32_t osStatus;
+#define osOK 0
+#define osErrorResource -4
+#define osFlagsError 0x80000000u         // set in every flags error code
+#define osFlagsErrorTimeout 0xFFFFFFFEu
+#define OS_STACK_SIZE 4096
+#define MBED_ALIGN(N) alignas(N)
+
+// Priorities are ignored. A stack handed in is used if it holds at least
+// PTHREAD_STACK_MIN bytes (glibc keeps the thread block at its top);
+// otherwise, as without one, the thread gets a default stack.
+class Thread {
+ public:
+  explicit Thread(osPriority priority = osPriorityNormal,
+                  uint32_t stack_size = OS_STACK_SIZE,
+                  unsigned char *stack_mem = nullptr,
+                  const char *name = nullptr)
+      : stack_size_(stack_size),
+        stack_mem_(stack_mem),
+        started_(false),
+        joined_(false) {
+    (void)priority, (void)name;
+  }
+  ~Thread();
+  osStatus start(Callback<void()> task);
+  osStatus join();
+
+ private:
+  Thread(const Thread &) = delete;
+  Thread &operator=(const Thread &) = delete;
+
+  uint32_t stack_size_;
+  unsigned char *stack_mem_;
+  pthread_t thread_;
+  bool started_;
+  bool joined_;
+};
+
+namespace ThisThread {
+void sleep_for(Kernel::Clock::duration_u32 rel_time);
+}  // namespace ThisThread
+
+/*******************************************************************************
+ * Interrupt inputs
+ * ****************************************************************************/
+class InterruptIn {
+ public:
+  explicit InterruptIn(PinName pin, PinMode mode = PullNone);
+  ~InterruptIn();
+  void rise(Callback<void()> handler);
+  void fall(Callback<void()> handler);
+  int read();
+  operator int() { return read(); }
+
+ private:
+  friend void pin_emulator_write(PinName pin, int level);
+
+  InterruptIn(const InterruptIn &) = delete;
+  InterruptIn &operator=(const InterruptIn &) = delete;
+
+  PinName pin_;
+  Callback<void()> rise_;
+  Callback<void()> fall_;
+};
+
+/*******************************************************************************
+ * Host only: input pin controls
+ *
+ * A pin rests at the level of its pull (high for PullUp, low otherwise)
+ * until pin_emulator_write() drives it. An edge runs the rise() or fall()
+ * handlers of the pin's InterruptIns on the calling thread, as the
+ * interrupt would on the board.
+ * ****************************************************************************/
+void pin_emulator_write(PinName pin, int level);
+
+/*******************************************************************************
+ * Heap statistics
+ * ****************************************************************************/
+// As with platform.heap-stats-enabled; the shim counts global new and
+// delete, by usable size, and has no heap region to report
+#define MBED_HEAP_STATS_ENABLED 1
+
+typedef struct {
+  uint32_t current_size;
+  uint32_t max_size;
+  uint32_t total_size;
+  uint32_t reserved_size;
+  uint32_t alloc_cnt;
+  uint32_t alloc_fail_cnt;
+  uint32_t overhead_size;
+} mbed_stats_heap_t;
+
+void mbed_stats_heap_get(mbed_stats_heap_t *stats);
+
+/*******************************************************************************
+ * Internal flash
+ * ****************************************************************************/
+class FlashIAP {
+ public:
+  int init();
+  int deinit();
+  int read(void *buffer, uint32_t addr, uint32_t size);
+  int program(const void *buffer, uint32_t addr, uint32_t size);
+  int erase(uint32_t addr, uint32_t size);
+  uint32_t get_page_size() const;
+  uint32_t get_sector_size(uint32_t addr) const;
+  uint32_t get_flash_start() const;
+  uint32_t get_flash_size() const;
+  uint8_t get_erase_value() const;
+};
+
+/*******************************************************************************
+ * Host only: FlashIAP emulator controls
+ *
+ * Erase and program times follow the STM32F429 datasheet at x32
+ * parallelism (typical): 16 us per programmed word, 250 ms / 550 ms / 1 s
+ * per 16 / 64 / 128 KB sector. The time is always accounted in busy_us;
+ * in real-time mode the calls also sleep for it.
+ *
+ * flash_emulator_memory() is the memory-mapped view of the image that the
+ * target has at 0x08000000. flash_emulator_map_file() backs the image with
+ * a file, so its contents outlive the process (a new file starts erased).
+ *
+ * flash_emulator_cut_power() models a reset in the middle of programming:
+ * after the given number of bytes the byte in flight keeps a random subset
+ * of its new zero bits, and every later program or erase fails until
+ * flash_emulator_restore_power(). Erases are atomic in this model.
+ * ****************************************************************************/
+#define FLASH_EMU_PROGRAM_WORD_US 16
+#define FLASH_EMU_ERASE_16K_US 250000
+#define FLASH_EMU_ERASE_64K_US 550000
+#define FLASH_EMU_ERASE_128K_US 1000000
+#define FLASH_EMU_SECTORS 24
+
+typedef struct {
+  uint64_t reads;
+  uint64_t read_bytes;
+  uint64_t programs;
+  uint64_t program_bytes;
+  uint64_t erases;
+  uint64_t erase_bytes;
+  uint64_t busy_us;  // modeled time spent erasing and programming
+  uint32_t erase_count[FLASH_EMU_SECTORS];  // per sector, since reset
+} FlashIAP_Stats;
+
+void flash_emulator_set_realtime(bool realtime);
+FlashIAP_Stats flash_emulator_stats();
+void flash_emulator_reset_stats();
+void flash_emulator_erase_all();
+int flash_emulator_sector_index(uint32_t addr);
+bool flash_emulator_map_file(const char *path);
+const uint8_t *flash_emulator_memory(uint32_t addr);
+void flash_emulator_cut_power(uint64_t after_bytes, uint32_t seed);
+void flash_emulator_restore_power();
+bool flash_emulator_power_lost();
+
+/*******************************************************************************
+ * I2C EEPROM: the parts of the BSP M24LR64 driver
+ * (drivers/stm32f429i_discovery_eeprom.h) that the record store uses
+ * ****************************************************************************/
+typedef enum { HAL_OK, HAL_ERROR, HAL_BUSY, HAL_TIMEOUT } HAL_StatusTypeDef;
+
+#define EEPROM_PAGESIZE 4
+#define EEPROM_MAX_SIZE 0x2000
+#define EEPROM_MAX_TRIALS 300
+#define EEPROM_OK 0
+#define EEPROM_FAIL 1
+#define EEPROM_TIMEOUT 2
+
+extern volatile uint16_t EEPROMAddress;  // I2C address found by the init
+
+uint32_t BSP_EEPROM_Init(void);
+uint32_t BSP_EEPROM_ReadBuffer(uint8_t *pBuffer, uint16_t ReadAddr,
+                               uint16_t *NumByteToRead);
+uint32_t BSP_EEPROM_WaitEepromStandbyState(void);
+HAL_StatusTypeDef EEPROM_IO_WriteData(uint16_t DevAddress,
+                                      uint16_t MemAddress, uint8_t *pBuffer,
+                                      uint32_t BufferSize);
+HAL_StatusTypeDef EEPROM_IO_IsDeviceReady(uint16_t DevAddress,
+                                          uint32_t Trials);
+
+/*******************************************************************************
+ * Host only: EEPROM emulator controls
+ *
+ * An 8 KB M24LR64 on a 100 kHz bus, in real time. Every byte on the bus
+ * takes EEPROM_EMU_BYTE_US. A write transfer returns at once (it is DMA on
+ * the target) and the bus reports HAL_BUSY until its bytes are clocked
+ * out; the chip then programs for EEPROM_EMU_WRITE_CYCLE_US and NACKs its
+ * address meanwhile. A write that runs past the end of its 4-byte page
+ * wraps to the start of the page, as on the part.
+ *
+ * eeprom_emulator_set_present(false) models a board without the
+ * ANT7-M24LR-A module: nothing answers on the bus.
+ *
+ * eeprom_emulator_cut_power() models a reset during a write: after the
+ * given number of page writes the next one programs only a random subset
+ * of its bytes, and the chip stops answering until
+ * eeprom_emulator_restore_power().
+ * ****************************************************************************/
+#define EEPROM_EMU_BYTE_US 90           // 9 clocks at 100 kHz
+#define EEPROM_EMU_WRITE_CYCLE_US 5000  // t_W of the M24LR64
+
+typedef struct {
+  uint64_t reads;
+  uint64_t read_bytes;
+  uint64_t page_writes;
+  uint64_t write_bytes;
+  uint64_t polls;          // addressing attempts, answered or not
+  uint64_t nacks;          // of those, the ones the chip did not answer
+  uint64_t poll_us;        // bus time spent addressing the chip
+  uint32_t max_page_cycles;  // most write cycles on one page since reset
+} Eeprom_Emulator_Stats;
+
+Eeprom_Emulator_Stats eeprom_emulator_stats();
+void eeprom_emulator_reset_stats();
+void eeprom_emulator_erase_all();
+void eeprom_emulator_set_present(bool present);
+void eeprom_emulator_cut_power(uint32_t after_pages, uint32_t seed);
+void eeprom_emulator_restore_power();
+bool eeprom_emulator_power_lost();
+
+#endif  // SENTRY_HOST_MBED_H
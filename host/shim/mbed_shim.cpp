@@ -0,0 +1,661 @@
+/**
+ * @file mbed_shim.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host implementation of the mbed shim.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "mbed.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <thread>
+
+/*******************************************************************************
+ * Kernel clock and busy waits
+ * ****************************************************************************/
+Kernel::Clock::time_point Kernel::Clock::now() {
+  static const auto epoch = std::chrono::steady_clock::now();
+  return time_point(std::chrono::duration_cast<duration>(
+      std::chrono::steady_clock::now() - epoch));
+}
+
+void wait_us(int us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void ThisThread::sleep_for(Kernel::Clock::duration_u32 rel_time) {
+  std::this_thread::sleep_for(rel_time);
+}
+
+/*******************************************************************************
+ * Timer
+ * ****************************************************************************/
+void Timer::start() {
+  if (running_) return;
+  started_ = std::chrono::steady_clock::now();
+  running_ = true;
+}
+
+void Timer::stop() {
+  if (!running_) return;
+  accumulated_ += std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - started_);
+  running_ = false;
+}
+
+void Timer::reset() {
+  accumulated_ = std::chrono::microseconds(0);
+  started_ = std::chrono::steady_clock::now();
+}
+
+std::chrono::microseconds Timer::elapsed_time() const {
+  if (!running_) return accumulated_;
+  return accumulated_ + std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - started_);
+}
+
+/*******************************************************************************
+ * Critical sections
+ * ****************************************************************************/
+static std::recursive_mutex &critical_section_lock() {
+  static std::recursive_mutex lock;
+  return lock;
+}
+
+void core_util_critical_section_enter() { critical_section_lock().lock(); }
+
+void core_util_critical_section_exit() { critical_section_lock().unlock(); }
+
+/*******************************************************************************
+ * EventFlags
+ * ****************************************************************************/
+uint32_t EventFlags::set(uint32_t flags) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  flags_ |= flags;
+  changed_.notify_all();
+  return flags_;
+}
+
+uint32_t EventFlags::clear(uint32_t flags) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint32_t before = flags_;
+  flags_ &= ~flags;
+  return before;
+}
+
+uint32_t EventFlags::get() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return flags_;
+}
+
+uint32_t EventFlags::wait_all(uint32_t flags, bool clear) {
+  return wait(flags, true, clear, nullptr);
+}
+
+uint32_t EventFlags::wait_any(uint32_t flags, bool clear) {
+  return wait(flags, false, clear, nullptr);
+}
+
+uint32_t EventFlags::wait_all_for(uint32_t flags,
+                                  Kernel::Clock::duration_u32 rel_time,
+                                  bool clear) {
+  auto deadline = std::chrono::steady_clock::now() + rel_time;
+  return wait(flags, true, clear, &deadline);
+}
+
+uint32_t EventFlags::wait_any_for(uint32_t flags,
+                                  Kernel::Clock::duration_u32 rel_time,
+                                  bool clear) {
+  auto deadline = std::chrono::steady_clock::now() + rel_time;
+  return wait(flags, false, clear, &deadline);
+}
+
+// Same contract as mbed: the flags at wake-up, or osFlagsErrorTimeout
+uint32_t EventFlags::wait(uint32_t flags, bool all, bool clear,
+                          const std::chrono::steady_clock::time_point *deadline) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto ready = [&] {
+    return all ? (flags_ & flags) == flags : (flags_ & flags) != 0;
+  };
+  if (deadline == nullptr) {
+    changed_.wait(lock, ready);
+  } else if (!changed_.wait_until(lock, *deadline, ready)) {
+    return osFlagsErrorTimeout;
+  }
+  uint32_t result = flags_;
+  if (clear) flags_ &= ~flags;
+  return result;
+}
+
+/*******************************************************************************
+ * Threads
+ * ****************************************************************************/
+static void *thread_entry(void *task) {
+  Callback<void()> *run = static_cast<Callback<void()> *>(task);
+  (*run)();
+  delete run;
+  return nullptr;
+}
+
+Thread::~Thread() {
+  if (started_ && !joined_) pthread_detach(thread_);
+}
+
+osStatus Thread::start(Callback<void()> task) {
+  if (started_) return osErrorResource;
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  if (stack_mem_ != nullptr && stack_size_ >= PTHREAD_STACK_MIN) {
+    pthread_attr_setstack(&attr, stack_mem_, stack_size_);
+  }
+  // The task is copied, the thread may outlive this object once detached
+  Callback<void()> *run = new Callback<void()>(task);
+  int error = pthread_create(&thread_, &attr, thread_entry, run);
+  pthread_attr_destroy(&attr);
+  if (error != 0) {
+    delete run;
+    return osErrorResource;
+  }
+  started_ = true;
+  return osOK;
+}
+
+osStatus Thread::join() {
+  if (started_ && !joined_) {
+    pthread_join(thread_, nullptr);
+    joined_ = true;
+  }
+  return osOK;
+}
+
+/*******************************************************************************
+ * Interrupt inputs: the level of every pin and the InterruptIns on it
+ * ****************************************************************************/
+namespace {
+
+struct Pins {
+  std::mutex mutex;
+  std::vector<InterruptIn *> inputs;
+  std::vector<std::pair<PinName, int>> levels;  // pins driven or pulled
+
+  int *level(PinName pin) {
+    for (auto &entry : levels) {
+      if (entry.first == pin) return &entry.second;
+    }
+    return nullptr;
+  }
+};
+
+Pins &pins() {
+  static Pins instance;
+  return instance;
+}
+
+}  // namespace
+
+InterruptIn::InterruptIn(PinName pin, PinMode mode) : pin_(pin) {
+  Pins &p = pins();
+  std::lock_guard<std::mutex> lock(p.mutex);
+  if (p.level(pin) == nullptr) {
+    p.levels.push_back(std::make_pair(pin, mode == PullUp ? 1 : 0));
+  }
+  p.inputs.push_back(this);
+}
+
+InterruptIn::~InterruptIn() {
+  Pins &p = pins();
+  std::lock_guard<std::mutex> lock(p.mutex);
+  p.inputs.erase(std::remove(p.inputs.begin(), p.inputs.end(), this),
+                 p.inputs.end());
+}
+
+void InterruptIn::rise(Callback<void()> handler) {
+  std::lock_guard<std::mutex> lock(pins().mutex);
+  rise_ = handler;
+}
+
+void InterruptIn::fall(Callback<void()> handler) {
+  std::lock_guard<std::mutex> lock(pins().mutex);
+  fall_ = handler;
+}
+
+int InterruptIn::read() {
+  Pins &p = pins();
+  std::lock_guard<std::mutex> lock(p.mutex);
+  int *level = p.level(pin_);
+  return level != nullptr ? *level : 0;
+}
+
+// The handlers run outside the lock, so they may read the pin
+void pin_emulator_write(PinName pin, int level) {
+  Pins &p = pins();
+  std::vector<Callback<void()>> handlers;
+  {
+    std::lock_guard<std::mutex> lock(p.mutex);
+    int *current = p.level(pin);
+    if (current == nullptr) {
+      p.levels.push_back(std::make_pair(pin, 0));
+      current = &p.levels.back().second;
+    }
+    level = level ? 1 : 0;
+    if (*current == level) return;
+    *current = level;
+    for (InterruptIn *input : p.inputs) {
+      Callback<void()> &handler = level ? input->rise_ : input->fall_;
+      if (input->pin_ == pin && handler) handlers.push_back(handler);
+    }
+  }
+  for (Callback<void()> &handler : handlers) handler();
+}
+
+/*******************************************************************************
+ * FlashIAP: 2 MB memory-mapped image, two banks of 4x16K, 1x64K and 7x128K
+ * sectors. The image is anonymous memory unless mapped onto a file.
+ * ****************************************************************************/
+static const uint32_t FLASH_START = 0x08000000;
+static const uint32_t FLASH_SIZE = 2 * 1024 * 1024;
+static const uint32_t FLASH_BANK_SIZE = FLASH_SIZE / 2;
+
+struct FlashEmulator {
+  FlashEmulator() {
+    void *p = mmap(nullptr, FLASH_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) abort();
+    image = static_cast<uint8_t *>(p);
+    memset(image, 0xFF, FLASH_SIZE);
+  }
+
+  std::mutex mutex;
+  uint8_t *image;
+  FlashIAP_Stats stats = {};
+  bool realtime = false;
+  bool cut_armed = false;
+  bool powered = true;
+  uint64_t cut_after = 0;  // bytes left until the cut
+  uint32_t cut_seed = 0;
+};
+
+static FlashEmulator &emulator() {
+  static FlashEmulator instance;
+  return instance;
+}
+
+static bool in_flash(uint32_t addr, uint32_t size) {
+  return addr >= FLASH_START && size <= FLASH_SIZE &&
+         addr - FLASH_START <= FLASH_SIZE - size;
+}
+
+// Account modeled busy time, sleeping for it in real-time mode
+static void busy(FlashEmulator &emu, uint64_t us) {
+  emu.stats.busy_us += us;
+  if (emu.realtime) std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+int flash_emulator_sector_index(uint32_t addr) {
+  if (!in_flash(addr, 1)) return -1;
+  uint32_t offset = addr - FLASH_START;
+  int bank = offset / FLASH_BANK_SIZE;
+  offset %= FLASH_BANK_SIZE;
+  int index;
+  if (offset < 0x10000) {
+    index = offset / 0x4000;  // sectors 0-3
+  } else if (offset < 0x20000) {
+    index = 4;
+  } else {
+    index = 5 + (offset - 0x20000) / 0x20000;  // sectors 5-11
+  }
+  return bank * 12 + index;
+}
+
+void flash_emulator_set_realtime(bool realtime) {
+  FlashEmulator &emu = emulator();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  emu.realtime = realtime;
+}
+
+FlashIAP_Stats flash_emulator_stats() {
+  FlashEmulator &emu = emulator();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  return emu.stats;
+}
+
+void flash_emulator_reset_stats() {
+  FlashEmulator &emu = emulator();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  emu.stats = FlashIAP_Stats();
+}
+
+void flash_emulator_erase_all() {
+  FlashEmulator &emu = emulator();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  memset(emu.image, 0xFF, FLASH_SIZE);
+}
+
+bool flash_emulator_map_file(const char *path) {
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return false;
+  off_t size = lseek(fd, 0, SEEK_END);
+  bool fresh = size < (off_t)FLASH_SIZE;
+  void *p = MAP_FAILED;
+  if (!fresh || ftruncate(fd, FLASH_SIZE) == 0) {
+    p = mmap(nullptr, FLASH_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (p == MAP_FAILED) return false;
+
+  // A new or short file is blank from its old end on
+  uint8_t *image = static_cast<uint8_t *>(p);
+  if (fresh) memset(image + size, 0xFF, FLASH_SIZE - size);
+
+  FlashEmulator &emu = emulator();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  munmap(emu.image, FLASH_SIZE);
+  emu.image = image;
+  return true;
+}
+
+const uint8_t *flash_emulator_memory(uint32_t addr) {
+  return in_flash(addr, 1) ? emulator().image + (addr - FLASH_START)
+                           : nullptr;
+}
+
+void flash_emulator_cut_power(uint64_t after_bytes, uint32_t seed) {
+  FlashEmulator &emu = emulator();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  emu.cut_armed = true;
+  emu.cut_after = after_bytes;
+  emu.cut_seed = seed;
+}
+
+void flash_emulator_restore_power() {
+  FlashEmulator &emu = emulator();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  emu.cut_armed = false;
+  emu.powered = true;
+}
+
+bool flash_emulator_power_lost() {
+  FlashEmulator &emu = emulator();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  return !emu.powered;
+}
+
+int FlashIAP::init() { return 0; }
+
+int FlashIAP::deinit() { return 0; }
+
+uint32_t FlashIAP::get_page_size() const { return 1; }
+
+uint32_t FlashIAP::get_flash_start() const { return FLASH_START; }
+
+uint32_t FlashIAP::get_flash_size() const { return FLASH_SIZE; }
+
+uint8_t FlashIAP::get_erase_value() const { return 0xFF; }
+
+uint32_t FlashIAP::get_sector_size(uint32_t addr) const {
+  if (!in_flash(addr, 1)) return 0;
+  uint32_t offset = (addr - FLASH_START) % FLASH_BANK_SIZE;
+  if (offset < 0x10000) return 0x4000;   // sectors 0-3
+  if (offset < 0x20000) return 0x10000;  // sector 4
+  return 0x20000;                        // sectors 5-11
+}
+
+int FlashIAP::read(void *buffer, uint32_t addr, uint32_t size) {
+  if (!in_flash(addr, size)) return -1;
+  FlashEmulator &emu = emulator();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  memcpy(buffer, &emu.image[addr - FLASH_START], size);
+  emu.stats.reads++;
+  emu.stats.read_bytes += size;
+  return 0;
+}
+
+// Programming can only clear bits, as on the real part
+int FlashIAP::program(const void *buffer, uint32_t addr, uint32_t size) {
+  if (!in_flash(addr, size)) return -1;
+  FlashEmulator &emu = emulator();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  if (!emu.powered) return -1;
+  const uint8_t *src = static_cast<const uint8_t *>(buffer);
+  uint8_t *dst = &emu.image[addr - FLASH_START];
+  if (emu.cut_armed && emu.cut_after < size) {
+    uint32_t done = (uint32_t)emu.cut_after;
+    for (uint32_t i = 0; i < done; i++) dst[i] &= src[i];
+    uint32_t noise = emu.cut_seed * 2654435761u;  // bits that made it
+    dst[done] &= src[done] | (uint8_t)(noise >> 24);
+    emu.powered = false;
+    emu.stats.programs++;
+    emu.stats.program_bytes += done;
+    return -1;
+  }
+  if (emu.cut_armed) emu.cut_after -= size;
+  for (uint32_t i = 0; i < size; i++) dst[i] &= src[i];
+
+  // Words touched, counting partial words at either end
+  uint64_t words = ((addr + size + 3) / 4) - (addr / 4);
+  emu.stats.programs++;
+  emu.stats.program_bytes += size;
+  busy(emu, words * FLASH_EMU_PROGRAM_WORD_US);
+  return 0;
+}
+
+// Both ends of the range have to be on sector boundaries
+int FlashIAP::erase(uint32_t addr, uint32_t size) {
+  if (!in_flash(addr, size)) return -1;
+  uint32_t end = addr + size;
+  uint32_t sector = FLASH_START;
+  while (sector < addr) sector += get_sector_size(sector);
+  if (sector != addr) return -1;
+  while (sector < end) sector += get_sector_size(sector);
+  if (sector != end) return -1;
+
+  FlashEmulator &emu = emulator();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  if (!emu.powered) return -1;
+  for (sector = addr; sector < end; sector += get_sector_size(sector)) {
+    uint32_t sector_size = get_sector_size(sector);
+    memset(&emu.image[sector - FLASH_START], 0xFF, sector_size);
+    emu.stats.erases++;
+    emu.stats.erase_bytes += sector_size;
+    emu.stats.erase_count[flash_emulator_sector_index(sector)]++;
+    busy(emu, sector_size == 0x4000    ? FLASH_EMU_ERASE_16K_US
+              : sector_size == 0x10000 ? FLASH_EMU_ERASE_64K_US
+                                       : FLASH_EMU_ERASE_128K_US);
+  }
+  return 0;
+}
+
+/*******************************************************************************
+ * I2C EEPROM: 8 KB M24LR64 image behind one bus, see mbed.h
+ * ****************************************************************************/
+static const uint16_t EEPROM_EMU_ADDRESS = 0xA0;  // EEPROM_I2C_ADDRESS_A01
+static const uint32_t EEPROM_EMU_PAGES = EEPROM_MAX_SIZE / EEPROM_PAGESIZE;
+
+volatile uint16_t EEPROMAddress = 0;
+
+struct EepromEmulator {
+  EepromEmulator() {
+    memset(image, 0xFF, sizeof(image));
+    memset(cycles, 0, sizeof(cycles));
+  }
+
+  std::mutex mutex;
+  uint8_t image[EEPROM_MAX_SIZE];
+  uint32_t cycles[EEPROM_EMU_PAGES];  // write cycles per page
+  Eeprom_Emulator_Stats stats = {};
+  std::chrono::steady_clock::time_point bus_free;    // end of the transfer
+  std::chrono::steady_clock::time_point chip_ready;  // end of the write cycle
+  bool present = true;
+  bool cut_armed = false;
+  bool powered = true;
+  uint32_t cut_after = 0;  // page writes left until the cut
+  uint32_t cut_seed = 0;
+};
+
+static EepromEmulator &eeprom() {
+  static EepromEmulator instance;
+  return instance;
+}
+
+static std::chrono::microseconds bus_time(uint32_t bytes) {
+  return std::chrono::microseconds(bytes * EEPROM_EMU_BYTE_US);
+}
+
+// Whether the chip acknowledges its address; call with the mutex held
+static bool eeprom_answers(EepromEmulator &emu, uint16_t dev_address) {
+  return emu.present && emu.powered && dev_address == EEPROM_EMU_ADDRESS &&
+         std::chrono::steady_clock::now() >= emu.chip_ready;
+}
+
+Eeprom_Emulator_Stats eeprom_emulator_stats() {
+  EepromEmulator &emu = eeprom();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  return emu.stats;
+}
+
+void eeprom_emulator_reset_stats() {
+  EepromEmulator &emu = eeprom();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  emu.stats = Eeprom_Emulator_Stats();
+  memset(emu.cycles, 0, sizeof(emu.cycles));
+}
+
+void eeprom_emulator_erase_all() {
+  EepromEmulator &emu = eeprom();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  memset(emu.image, 0xFF, sizeof(emu.image));
+}
+
+void eeprom_emulator_set_present(bool present) {
+  EepromEmulator &emu = eeprom();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  emu.present = present;
+}
+
+void eeprom_emulator_cut_power(uint32_t after_pages, uint32_t seed) {
+  EepromEmulator &emu = eeprom();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  emu.cut_armed = true;
+  emu.cut_after = after_pages;
+  emu.cut_seed = seed;
+}
+
+void eeprom_emulator_restore_power() {
+  EepromEmulator &emu = eeprom();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  emu.cut_armed = false;
+  emu.powered = true;
+  emu.bus_free = emu.chip_ready = std::chrono::steady_clock::now();
+}
+
+bool eeprom_emulator_power_lost() {
+  EepromEmulator &emu = eeprom();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  return !emu.powered;
+}
+
+uint32_t BSP_EEPROM_Init(void) {
+  EEPROMAddress = EEPROM_EMU_ADDRESS;
+  return EEPROM_IO_IsDeviceReady(EEPROMAddress, EEPROM_MAX_TRIALS) == HAL_OK
+             ? EEPROM_OK
+             : EEPROM_FAIL;
+}
+
+// Blocks until the transfer is done, as the BSP does
+uint32_t BSP_EEPROM_ReadBuffer(uint8_t *pBuffer, uint16_t ReadAddr,
+                               uint16_t *NumByteToRead) {
+  uint32_t size = *NumByteToRead;
+  EepromEmulator &emu = eeprom();
+  std::chrono::microseconds duration;
+  {
+    std::lock_guard<std::mutex> lock(emu.mutex);
+    if (std::chrono::steady_clock::now() < emu.bus_free ||
+        !eeprom_answers(emu, EEPROMAddress) || ReadAddr >= EEPROM_MAX_SIZE) {
+      return EEPROM_FAIL;
+    }
+    // A sequential read rolls over at the end of the memory
+    for (uint32_t i = 0; i < size; i++) {
+      pBuffer[i] = emu.image[(ReadAddr + i) % EEPROM_MAX_SIZE];
+    }
+    duration = bus_time(4 + size);  // address, memory address, restart
+    emu.bus_free = std::chrono::steady_clock::now() + duration;
+    emu.stats.reads++;
+    emu.stats.read_bytes += size;
+  }
+  std::this_thread::sleep_for(duration);
+  return EEPROM_OK;
+}
+
+uint32_t BSP_EEPROM_WaitEepromStandbyState(void) {
+  return EEPROM_IO_IsDeviceReady(EEPROMAddress, EEPROM_MAX_TRIALS) == HAL_OK
+             ? EEPROM_OK
+             : EEPROM_TIMEOUT;
+}
+
+// Returns once the transfer is started; the bus is busy until it is done
+HAL_StatusTypeDef EEPROM_IO_WriteData(uint16_t DevAddress,
+                                      uint16_t MemAddress, uint8_t *pBuffer,
+                                      uint32_t BufferSize) {
+  EepromEmulator &emu = eeprom();
+  std::lock_guard<std::mutex> lock(emu.mutex);
+  auto now = std::chrono::steady_clock::now();
+  if (now < emu.bus_free) return HAL_BUSY;
+  if (!eeprom_answers(emu, DevAddress) || MemAddress >= EEPROM_MAX_SIZE) {
+    return HAL_ERROR;
+  }
+
+  uint32_t page = MemAddress / EEPROM_PAGESIZE;
+  uint32_t base = page * EEPROM_PAGESIZE;
+  uint32_t keep = 0xFF;  // bytes that make it, one bit each
+  if (emu.cut_armed && emu.cut_after == 0) {
+    keep = (emu.cut_seed * 2654435761u) >> 24;
+    emu.powered = false;
+  } else if (emu.cut_armed) {
+    emu.cut_after--;
+  }
+  for (uint32_t i = 0; i < BufferSize; i++) {
+    if (keep & (1u << (i % 8))) {
+      emu.image[base + (MemAddress - base + i) % EEPROM_PAGESIZE] = pBuffer[i];
+    }
+  }
+
+  emu.cycles[page]++;
+  emu.stats.max_page_cycles =
+      std::max(emu.stats.max_page_cycles, emu.cycles[page]);
+  emu.stats.page_writes++;
+  emu.stats.write_bytes += BufferSize;
+  emu.bus_free = now + bus_time(3 + BufferSize);
+  emu.chip_ready =
+      emu.bus_free + std::chrono::microseconds(EEPROM_EMU_WRITE_CYCLE_US);
+  return HAL_OK;
+}
+
+// Each trial addresses the chip once and takes one byte time on the bus
+HAL_StatusTypeDef EEPROM_IO_IsDeviceReady(uint16_t DevAddress,
+                                          uint32_t Trials) {
+  EepromEmulator &emu = eeprom();
+  for (uint32_t i = 0; i < Trials; i++) {
+    {
+      std::lock_guard<std::mutex> lock(emu.mutex);
+      if (std::chrono::steady_clock::now() < emu.bus_free) return HAL_BUSY;
+    }
+    std::this_thread::sleep_for(bus_time(1));
+    std::lock_guard<std::mutex> lock(emu.mutex);
+    emu.stats.polls++;
+    emu.stats.poll_us += EEPROM_EMU_BYTE_US;
+    if (eeprom_answers(emu, DevAddress)) return HAL_OK;
+    emu.stats.nacks++;
+  }
+  return HAL_ERROR;
+}
@@ -0,0 +1,206 @@
+/**
+ * @file ts_emulator.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host emulator of the STMPE811 behind TS_DISCO_F429ZI.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "ts_emulator.h"
+
+#include <mbed.h>
+
+#include <algorithm>
+
+// What the BSP's STMPE811 driver clocks per register access: a write is the
+// device address, the register and the value; a read addresses the device
+// again before the value
+#define TS_EMU_WRITE_BYTES 3
+#define TS_EMU_READ_BYTES 4
+#define TS_EMU_INT_PIN PA_15
+
+TS_DISCO_F429ZI::TS_DISCO_F429ZI()
+    : epoch_(std::chrono::steady_clock::now()),
+      stopping_(false),
+      enabled_(false),
+      status_(0),
+      level_(1),
+      touched_(false),
+      x_(0),
+      y_(0) {
+  memset(&stats_, 0, sizeof(stats_));
+  pin_emulator_write(TS_EMU_INT_PIN, 1);  // released, pulled up
+}
+
+TS_DISCO_F429ZI::~TS_DISCO_F429ZI() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  finish();
+}
+
+void TS_DISCO_F429ZI::transfer(uint32_t bytes) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.transfers++;
+    stats_.bytes += bytes;
+    stats_.bus_us += bytes * TS_EMU_BYTE_US;
+  }
+  std::this_thread::sleep_for(
+      std::chrono::microseconds(bytes * TS_EMU_BYTE_US));
+}
+
+// Reset, the ID, then the ADC, touch screen and FIFO set up
+uint8_t TS_DISCO_F429ZI::Init(uint16_t XSize, uint16_t YSize) {
+  (void)XSize, (void)YSize;
+  transfer(TS_EMU_READ_BYTES + 1);
+  for (int i = 0; i < 9; i++) transfer(TS_EMU_WRITE_BYTES);
+  return TS_OK;
+}
+
+// INT_CTRL, the global enable and the touch screen sources, each a read,
+// modify and write
+uint8_t TS_DISCO_F429ZI::ITConfig() {
+  for (int i = 0; i < 3; i++) {
+    transfer(TS_EMU_READ_BYTES);
+    transfer(TS_EMU_WRITE_BYTES);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    enabled_ = true;
+  }
+  update_pin();
+  return TS_OK;
+}
+
+uint8_t TS_DISCO_F429ZI::ITGetStatus() {
+  transfer(TS_EMU_READ_BYTES);
+  std::lock_guard<std::mutex> lock(mutex_);
+  return status_;
+}
+
+// TSC_CTRL; in contact FIFO_SIZE and a sample too. Both ways the FIFO is
+// reset after, a write of FIFO_STA and another to restart it.
+void TS_DISCO_F429ZI::GetState(TS_StateTypeDef *TsState) {
+  transfer(TS_EMU_READ_BYTES);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    TsState->TouchDetected = touched_ ? 1 : 0;
+    TsState->X = touched_ ? x_ : 0;
+    TsState->Y = touched_ ? y_ : 0;
+    TsState->Z = 0;
+  }
+  if (TsState->TouchDetected) {
+    transfer(TS_EMU_READ_BYTES);
+    transfer(TS_EMU_READ_BYTES + 3);
+  }
+  transfer(TS_EMU_WRITE_BYTES);
+  transfer(TS_EMU_WRITE_BYTES);
+}
+
+void TS_DISCO_F429ZI::ITClear() {
+  transfer(TS_EMU_WRITE_BYTES);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_ = 0;
+  }
+  update_pin();
+}
+
+void TS_DISCO_F429ZI::play(const std::vector<Ts_Emulator_Step> &script) {
+  finish();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    epoch_ = std::chrono::steady_clock::now();
+  }
+  player_ = std::thread(&TS_DISCO_F429ZI::run, this, script);
+}
+
+void TS_DISCO_F429ZI::finish() {
+  if (player_.joinable()) player_.join();
+}
+
+uint32_t TS_DISCO_F429ZI::script_us() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - epoch_)
+      .count();
+}
+
+Ts_Emulator_Stats TS_DISCO_F429ZI::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void TS_DISCO_F429ZI::reset_stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+// mutex_ held
+void TS_DISCO_F429ZI::raise(uint8_t status) { status_ |= status; }
+
+// INT follows the enabled status bits; the pin is driven outside mutex_, so
+// the handlers of its InterruptIns may call back into the emulator
+void TS_DISCO_F429ZI::update_pin() {
+  std::lock_guard<std::mutex> pin_lock(pin_mutex_);
+  int level;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    level = enabled_ && status_ != 0 ? 0 : 1;
+    if (level == level_) return;
+    level_ = level;
+    if (level == 0) stats_.interrupts++;
+  }
+  pin_emulator_write(TS_EMU_INT_PIN, level);
+}
+
+/*******************************************************************************
+ *
+ * @brief Player thread: each step at its time, a touch interrupt when the
+ * contact changes, a FIFO interrupt every sample in contact
+ *
+ * ****************************************************************************/
+void TS_DISCO_F429ZI::run(std::vector<Ts_Emulator_Step> script) {
+  typedef std::chrono::steady_clock Clock;
+  std::unique_lock<std::mutex> lock(mutex_);
+  size_t next = 0;
+  Clock::time_point sample_at = epoch_;
+  while (next < script.size()) {
+    Clock::time_point step_at =
+        epoch_ + std::chrono::microseconds(script[next].at_us);
+    Clock::time_point wake_at = touched_ ? std::min(step_at, sample_at)
+                                         : step_at;
+    if (wake_.wait_until(lock, wake_at, [this] { return stopping_; })) {
+      return;
+    }
+    Clock::time_point now = Clock::now();
+    if (now >= step_at) {
+      const Ts_Emulator_Step &step = script[next++];
+      if ((step.touched != 0) != touched_) {
+        raise(TS_EMU_IT_TOUCH);
+        stats_.contacts++;
+      }
+      touched_ = step.touched != 0;
+      x_ = step.x;
+      y_ = step.y;
+      sample_at = now + std::chrono::microseconds(TS_EMU_SAMPLE_US);
+    } else if (touched_ && now >= sample_at) {
+      raise(TS_EMU_IT_FIFO_TH);
+      sample_at += std::chrono::microseconds(TS_EMU_SAMPLE_US);
+    } else {
+      continue;
+    }
+    lock.unlock();
+    update_pin();
+    lock.lock();
+  }
+}
@@ -0,0 +1,119 @@
+/**
+ * @file ts_emulator.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Host emulator of the TS_DISCO_F429ZI touch screen class: an
+ * STMPE811 on I2C3 playing a scripted finger, with its interrupt line on
+ * PA_15 and its bus time.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Only the calls the firmware's touch code makes are provided, with the
+ * BSP's semantics. play() starts a script of contact changes, in real time
+ * from the call, on a thread of the emulator. While the finger is down the
+ * controller converts a sample every TS_EMU_SAMPLE_US.
+ *
+ * After ITConfig() the controller raises its interrupts as the BSP enables
+ * them: touch detected (on every contact change, touch or lift) and FIFO
+ * above threshold (every sample in contact). INT is low while an enabled
+ * status bit is set, as with the BSP's level, active low configuration,
+ * and the emulator drives PA_15 with it (pin_emulator_write()): an
+ * InterruptIn on the pin sees a falling edge when a status bit is raised
+ * with none pending, and none until ITClear() clears them.
+ *
+ * Every call clocks the bytes the BSP's STMPE811 driver moves over the
+ * 100 kHz bus, TS_EMU_BYTE_US each, and sleeps for them. GetState() with a
+ * finger down also reads the sample and resets the FIFO. stats() counts
+ * the transfers, the bus time and the interrupts, so the host build can
+ * measure what a touch costs and how soon it is seen (script_us()).
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef SENTRY_HOST_TS_EMULATOR_H
+#define SENTRY_HOST_TS_EMULATOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define TS_OK 0x00
+#define TS_ERROR 0x01
+#define TS_TIMEOUT 0x02
+
+typedef struct {
+  uint16_t TouchDetected;
+  uint16_t X;
+  uint16_t Y;
+  uint16_t Z;
+} TS_StateTypeDef;
+
+// STMPE811 interrupt status bits (drivers/stmpe811.h)
+#define TS_EMU_IT_TOUCH 0x01    // touch detected or lifted
+#define TS_EMU_IT_FIFO_TH 0x02  // FIFO above threshold
+
+#define TS_EMU_BYTE_US 90       // 9 clocks at 100 kHz
+#define TS_EMU_SAMPLE_US 1000   // a conversion while in contact
+
+// One change of the finger, at a time from play()
+typedef struct {
+  uint32_t at_us;
+  uint8_t touched;
+  uint16_t x;
+  uint16_t y;
+} Ts_Emulator_Step;
+
+// Bus and interrupt activity since the last reset_stats()
+typedef struct {
+  uint64_t transfers;    // register reads and writes
+  uint64_t bytes;        // on the bus, addresses included
+  uint64_t bus_us;       // the time they took
+  uint32_t interrupts;   // falling edges of INT
+  uint32_t contacts;     // contact changes played
+} Ts_Emulator_Stats;
+
+class TS_DISCO_F429ZI {
+ public:
+  TS_DISCO_F429ZI();
+  ~TS_DISCO_F429ZI();
+
+  uint8_t Init(uint16_t XSize, uint16_t YSize);
+  uint8_t ITConfig();
+  uint8_t ITGetStatus();
+  void GetState(TS_StateTypeDef *TsState);
+  void ITClear();
+
+  // Emulator only
+  void play(const std::vector<Ts_Emulator_Step> &script);
+  void finish();  // waits for the end of the script
+  uint32_t script_us() const;
+  Ts_Emulator_Stats stats() const;
+  void reset_stats();
+
+ private:
+  void run(std::vector<Ts_Emulator_Step> script);
+  void raise(uint8_t status);
+  void update_pin();
+  void transfer(uint32_t bytes);
+
+  mutable std::mutex mutex_;  // the controller's state
+  std::mutex pin_mutex_;      // the INT line, changed in order
+  std::condition_variable wake_;  // the player, to stop
+  std::thread player_;
+  std::chrono::steady_clock::time_point epoch_;  // of the script
+  bool stopping_;
+  bool enabled_;      // ITConfig() done
+  uint8_t status_;    // INT_STA
+  int level_;         // INT, as driven
+  bool touched_;
+  uint16_t x_;
+  uint16_t y_;
+  Ts_Emulator_Stats stats_;
+};
+
+#endif  // SENTRY_HOST_TS_EMULATOR_H
@@ -0,0 +1,72 @@
+/**
+ * @file arena_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the SDRAM arenas: the largest unlock attempt fits them
+ * and DTW leaves its arena as it found it.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <random>
+#include <vector>
+
+#include "arena.h"
+#include "sentry_test.h"
+#include "utilities.h"
+
+namespace {
+
+typedef std::vector<std::array<float, 3>> Gesture;
+
+const size_t kMinuteSamples = 60 * GYRO_SAMPLE_RATE_HZ / RECORDING_DECIMATION;
+
+Gesture recording(std::mt19937 &rng, size_t samples) {
+  std::uniform_real_distribution<float> rate(-200.0f, 200.0f);
+  Gesture gesture(samples);
+  for (auto &sample : gesture) sample = {rate(rng), rate(rng), rate(rng)};
+  return gesture;
+}
+
+}  // namespace
+
+TEST(arena, longest_attempt_fits_the_sdram_arenas) {
+  CHECK(SdramArenaInit());
+  Arena &capture = SdramArena(ARENA_CAPTURE);
+  Arena &dtw_arena = SdramArena(ARENA_DTW);
+  uint32_t failures = capture.stats().failures + dtw_arena.stats().failures;
+
+  // A minute-long recording grown by push_back() against the longest key,
+  // with the scratch buffers of an attempt
+  for (int attempt = 0; attempt < 3; attempt++) {
+    capture.reset();
+    dtw_arena.reset();
+    const size_t samples = RECORDING_SAMPLES + kMinuteSamples;
+    const size_t key_samples = 2 * RECORDING_SAMPLES - 1;
+    ArenaSamples recorded{ArenaAllocator<std::array<float, 3>>(capture)};
+    for (size_t i = 0; i < samples; i++) recorded.push_back({1, 2, 3});
+    float *matrix =
+        dtw_arena.allocate_array<float>((samples + 1) * (key_samples + 1));
+    CHECK(matrix != nullptr);
+    for (int s = 0; s < 6; s++) CHECK(dtw_arena.allocate(512) != nullptr);
+    CHECK(capture.contains(recorded.data()));
+    CHECK(dtw_arena.contains(matrix));
+  }
+  CHECK_EQ(capture.stats().failures + dtw_arena.stats().failures, failures);
+}
+
+TEST(arena, dtw_rewinds_the_sdram_arena) {
+  CHECK(SdramArenaInit());
+  std::mt19937 rng(1);
+  Gesture s = recording(rng, kMinuteSamples);
+  Gesture t = recording(rng, kMinuteSamples);
+  Arena &arena = SdramArena(ARENA_DTW);
+  arena.reset();
+  CHECK_EQ(dtw(s, t, &arena), dtw(s, t));
+  CHECK_EQ(arena.stats().used, (size_t)0);
+}
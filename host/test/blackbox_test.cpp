@@ -0,0 +1,339 @@
+/**
+ * @file blackbox_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the black box recorder: the ring of the last attempts,
+ * its dump, warm resets and power cycles.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "blackbox.h"
+#include "fixtures.h"
+#include "sentry_test.h"
+#include "utilities.h"
+
+namespace {
+
+typedef std::vector<std::array<float, 3>> Gesture;
+
+// What the box should hold for one attempt
+struct Expected {
+  uint32_t attempt;
+  uint8_t outcome;
+  float correlation[3];
+  std::vector<Gyroscope_RawData> samples;
+};
+
+// A dump parsed back into sessions
+struct Dumped {
+  Capture_Session session;
+  Capture_Attempt attempt;
+  bool has_attempt;
+  std::vector<Gyroscope_RawData> samples;
+};
+
+// The box's region, as SdramArena(ARENA_BLACKBOX) would hand it out
+struct Region {
+  Region()
+      : size(BlackBox::region_size(BLACKBOX_ATTEMPTS)),
+        memory(size / sizeof(uint64_t) + 1) {}
+  void *data() { return memory.data(); }
+  size_t size;
+  std::vector<uint64_t> memory;
+};
+
+size_t vector_sink(void *context, const uint8_t *data, size_t size) {
+  std::vector<uint8_t> *out = static_cast<std::vector<uint8_t> *>(context);
+  out->insert(out->end(), data, data + size);
+  return size;
+}
+
+Gesture record_key(uint32_t seed) {
+  Gesture key;
+  SyntheticGyroSource raw(fixtures::gesture(true),
+                          synth::typical_variation(), seed);
+  Gyroscope_Calibration calibration;
+  fixtures::calibrate(raw, calibration);
+  RecordGesture(raw, calibration, RECORDING_SAMPLES, key);
+  trim_gyro_data(key);
+  return key;
+}
+
+// One attempt as the gyroscope thread makes it; returns what the box
+// should now hold for it
+Expected attempt(BlackBox &box, const Gesture &key, bool genuine,
+                 uint32_t seed, uint32_t number) {
+  Expected expected = {number, 0, {}, {}};
+  SyntheticGyroSource raw(fixtures::gesture(genuine),
+                          synth::typical_variation(), seed);
+  Gyroscope_Calibration calibration;
+  fixtures::calibrate(raw, calibration);
+
+  // Tap the samples the box sees
+  struct Tap : GyroSource {
+    GyroSource &inner;
+    std::vector<Gyroscope_RawData> &seen;
+    Tap(GyroSource &i, std::vector<Gyroscope_RawData> &s)
+        : inner(i), seen(s) {}
+    bool init(const Gyroscope_Init_Parameters &p) override {
+      return inner.init(p);
+    }
+    bool read(Gyroscope_RawData &sample) override {
+      if (!inner.read(sample)) return false;
+      seen.push_back(sample);
+      return true;
+    }
+    float sensitivity() const override { return inner.sensitivity(); }
+  } tap(raw, expected.samples);
+
+  BlackBoxGyroSource source(tap, box);
+  Capture_Session session = {number, GYRO_SAMPLE_RATE_HZ, fixtures::kInit.conf4,
+                             raw.sensitivity(), calibration};
+  source.begin(session);
+  Gesture recording;
+  RecordGesture(source, calibration, RECORDING_SAMPLES, recording);
+  trim_gyro_data(recording);
+
+  Gesture key_copy = key;  // MatchGesture modifies its inputs
+  Match_Result match = MatchGesture(key_copy, recording);
+  box.finish(match);
+
+  expected.outcome =
+      match.unlocked ? CAPTURE_OUTCOME_UNLOCKED : CAPTURE_OUTCOME_REJECTED;
+  for (int i = 0; i < 3; i++) expected.correlation[i] = match.correlation[i];
+  if (expected.samples.size() > BLACKBOX_SAMPLES) {
+    expected.samples.resize(BLACKBOX_SAMPLES);
+  }
+  return expected;
+}
+
+std::vector<Dumped> dump(BlackBox &box, uint32_t &crc_errors) {
+  std::vector<uint8_t> bytes;
+  CaptureWriter writer(vector_sink, &bytes);
+  box.dump(writer);
+
+  std::vector<Dumped> sessions;
+  CaptureParser parser;
+  Capture_Sample batch[CAPTURE_BATCH_SAMPLES];
+  for (uint8_t byte : bytes) {
+    if (!parser.push(byte)) continue;
+    if (parser.type() == CAPTURE_SESSION_START) {
+      sessions.push_back(Dumped());
+      sessions.back().has_attempt = false;
+      DecodeCaptureSession(parser.payload(), parser.size(),
+                           sessions.back().session);
+    } else if (sessions.empty()) {
+      continue;
+    } else if (parser.type() == CAPTURE_SAMPLES) {
+      size_t n = DecodeCaptureSamples(parser.payload(), parser.size(), batch);
+      for (size_t i = 0; i < n; i++) {
+        sessions.back().samples.push_back(batch[i].data);
+      }
+    } else if (parser.type() == CAPTURE_ATTEMPT) {
+      sessions.back().has_attempt = DecodeCaptureAttempt(
+          parser.payload(), parser.size(), sessions.back().attempt);
+    }
+  }
+  crc_errors = parser.crc_errors();
+  return sessions;
+}
+
+// Stands in for the gyroscope thread starting an attempt while a dump is
+// being written out: the first write claims the oldest slot and fills it
+struct Interrupting {
+  BlackBox *box;
+  bool claimed;
+  std::vector<uint8_t> bytes;
+};
+
+size_t interrupting_sink(void *context, const uint8_t *data, size_t size) {
+  Interrupting *out = static_cast<Interrupting *>(context);
+  if (!out->claimed) {
+    out->claimed = true;
+    Capture_Session session = {};
+    out->box->begin(session);
+    Gyroscope_RawData raw = {-1, -1, -1};
+    for (int i = 0; i < BLACKBOX_SAMPLES; i++) out->box->add_sample(i, raw);
+  }
+  return vector_sink(&out->bytes, data, size);
+}
+
+bool same(const Dumped &d, const Expected &e) {
+  if (!d.has_attempt || d.attempt.attempt != e.attempt ||
+      d.attempt.outcome != e.outcome || d.samples.size() != e.samples.size()) {
+    return false;
+  }
+  for (int i = 0; i < 3; i++) {
+    bool both_nan = std::isnan(d.attempt.correlation[i]) &&
+                    std::isnan(e.correlation[i]);
+    if (!both_nan && d.attempt.correlation[i] != e.correlation[i]) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < e.samples.size(); i++) {
+    if (d.samples[i].x_raw != e.samples[i].x_raw ||
+        d.samples[i].y_raw != e.samples[i].y_raw ||
+        d.samples[i].z_raw != e.samples[i].z_raw) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST(blackbox, dump_holds_the_last_attempts_in_order) {
+  Region region;
+  memset(region.data(), 0, region.size);
+  BlackBox box;
+  CHECK(box.init(region.data(), region.size));
+
+  // More attempts than the ring holds
+  Gesture key = record_key(1);
+  std::deque<Expected> expected;
+  for (uint32_t a = 0; a < BLACKBOX_ATTEMPTS + 18; a++) {
+    expected.push_back(attempt(box, key, a % 2 == 0, 2 + a, a + 1));
+    if (expected.size() > box.capacity()) expected.pop_front();
+  }
+
+  uint32_t crc_errors = 0;
+  std::vector<Dumped> sessions = dump(box, crc_errors);
+  CHECK_EQ(crc_errors, 0u);
+  CHECK_EQ(sessions.size(), expected.size());
+  for (size_t i = 0; i < expected.size() && i < sessions.size(); i++) {
+    CHECK(same(sessions[i], expected[i]));
+  }
+}
+
+TEST(blackbox, warm_reset_keeps_the_attempts) {
+  Region region;
+  memset(region.data(), 0, region.size);
+  BlackBox box;
+  CHECK(box.init(region.data(), region.size));
+  Gesture key = record_key(1);
+  for (uint32_t a = 0; a < 3; a++) attempt(box, key, true, 2 + a, a + 1);
+
+  // The reset comes in the middle of an attempt
+  Capture_Session session = {};
+  box.begin(session);
+  Gyroscope_RawData raw = {4, 5, 6};
+  box.add_sample(0, raw);
+  size_t held = box.count();
+
+  BlackBox rebooted;
+  CHECK(rebooted.init(region.data(), region.size));
+  CHECK_EQ(rebooted.count(), held);
+  uint32_t crc_errors = 0;
+  std::vector<Dumped> sessions = dump(rebooted, crc_errors);
+  CHECK_EQ(sessions.size(), held);
+  CHECK(!sessions.empty() && sessions.back().has_attempt);
+  if (!sessions.empty()) {
+    CHECK_EQ(sessions.back().attempt.outcome, CAPTURE_OUTCOME_INCOMPLETE);
+    CHECK_EQ(sessions.back().samples.size(), (size_t)1);
+  }
+}
+
+TEST(blackbox, power_cycle_starts_empty) {
+  Region region;
+  std::mt19937 rng(1);
+  uint8_t *bytes = static_cast<uint8_t *>(region.data());
+  for (size_t i = 0; i < region.size; i++) bytes[i] = rng();
+
+  BlackBox powered;
+  powered.init(region.data(), region.size);
+  CHECK_EQ(powered.count(), (size_t)0);
+  uint32_t crc_errors = 0;
+  CHECK(dump(powered, crc_errors).empty());
+}
+
+TEST(blackbox, clear_stops_the_attempt_being_recorded) {
+  Region region;
+  memset(region.data(), 0, region.size);
+  BlackBox box;
+  CHECK(box.init(region.data(), region.size));
+  Capture_Session session = {};
+  Gyroscope_RawData raw = {4, 5, 6};
+  box.begin(session);
+  box.add_sample(0, raw);
+
+  // From the console thread, then the gyroscope thread carries on
+  box.clear();
+  box.add_sample(1000, raw);
+  box.finish(CAPTURE_OUTCOME_ENROLLED);
+  CHECK_EQ(box.count(), (size_t)0);
+
+  box.begin(session);
+  box.add_sample(0, raw);
+  box.finish(CAPTURE_OUTCOME_ENROLLED);
+  uint32_t crc_errors = 0;
+  std::vector<Dumped> sessions = dump(box, crc_errors);
+  CHECK_EQ(sessions.size(), (size_t)1);
+  if (!sessions.empty()) {
+    CHECK_EQ(sessions[0].attempt.attempt, 1u);
+    CHECK_EQ(sessions[0].samples.size(), (size_t)1);
+  }
+}
+
+TEST(blackbox, attempt_claimed_during_a_dump_is_cut_short) {
+  Region region;
+  memset(region.data(), 0, region.size);
+  BlackBox box;
+  CHECK(box.init(region.data(), region.size));
+  Capture_Session session = {};
+  for (size_t a = 0; a < box.capacity(); a++) {
+    box.begin(session);
+    for (int16_t i = 0; i < 100; i++) {
+      Gyroscope_RawData raw = {i, (int16_t)a, 0};
+      box.add_sample(i * 5000, raw);
+    }
+    box.finish(CAPTURE_OUTCOME_ENROLLED);
+  }
+
+  Interrupting out = {&box, false, {}};
+  CaptureWriter writer(interrupting_sink, &out);
+  CHECK_EQ(box.dump(writer), box.capacity());
+  writer.flush();
+
+  // The first attempt keeps only samples read before its slot was claimed
+  std::vector<Dumped> sessions;
+  CaptureParser parser;
+  Capture_Sample batch[CAPTURE_BATCH_SAMPLES];
+  for (uint8_t byte : out.bytes) {
+    if (!parser.push(byte)) continue;
+    if (parser.type() == CAPTURE_SESSION_START) {
+      sessions.push_back(Dumped());
+    } else if (parser.type() == CAPTURE_SAMPLES && !sessions.empty()) {
+      size_t n = DecodeCaptureSamples(parser.payload(), parser.size(), batch);
+      for (size_t i = 0; i < n; i++) {
+        sessions.back().samples.push_back(batch[i].data);
+      }
+    } else if (parser.type() == CAPTURE_ATTEMPT && !sessions.empty()) {
+      DecodeCaptureAttempt(parser.payload(), parser.size(),
+                           sessions.back().attempt);
+    }
+  }
+  CHECK_EQ(sessions.size(), box.capacity());
+  if (sessions.empty()) return;
+  CHECK_EQ(sessions[0].attempt.outcome, CAPTURE_OUTCOME_INCOMPLETE);
+  CHECK(sessions[0].samples.size() < 100);
+  for (size_t i = 0; i < sessions[0].samples.size(); i++) {
+    CHECK_EQ(sessions[0].samples[i].x_raw, (int16_t)i);
+    CHECK_EQ(sessions[0].samples[i].y_raw, 0);
+  }
+  for (size_t a = 1; a < sessions.size(); a++) {
+    CHECK_EQ(sessions[a].attempt.outcome, CAPTURE_OUTCOME_ENROLLED);
+    CHECK_EQ(sessions[a].samples.size(), (size_t)100);
+  }
+}
@@ -0,0 +1,164 @@
+/**
+ * @file capture_format_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the capture writer and parser: whole frames per sink
+ * call, console text between them, round trips of every frame type.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "capture_format.h"
+#include "sentry_test.h"
+
+namespace {
+
+// Each sink call as it came, and the stream with console text written
+// between the calls, as other threads would
+struct Port {
+  std::vector<std::vector<uint8_t>> calls;
+  std::vector<uint8_t> stream;
+};
+
+const char kText[] = "Recording...\n";
+
+size_t port_sink(void *context, const uint8_t *data, size_t size) {
+  Port *port = static_cast<Port *>(context);
+  port->calls.push_back(std::vector<uint8_t>(data, data + size));
+  port->stream.insert(port->stream.end(), kText, kText + strlen(kText));
+  port->stream.insert(port->stream.end(), data, data + size);
+  return size;
+}
+
+Capture_Session make_session() {
+  Capture_Session session = {};
+  session.session_id = 9;
+  session.sample_rate_hz = GYRO_SAMPLE_RATE_HZ;
+  session.full_scale = 0x10;
+  session.sensitivity = SENSITIVITY_500;
+  session.calibration.x_offset = -12;
+  session.calibration.z_threshold = 40;
+  return session;
+}
+
+// A session of n samples, 5 ms apart
+void write_session(CaptureWriter &writer, size_t n) {
+  writer.begin_session(make_session());
+  for (size_t i = 0; i < n; i++) {
+    Gyroscope_RawData sample = {(int16_t)i, (int16_t)-i, (int16_t)(3 * i)};
+    writer.add_sample(5000 * i, sample);
+  }
+  writer.end_session();
+}
+
+}  // namespace
+
+TEST(capture_format, every_sink_call_is_one_whole_frame) {
+  Port port;
+  CaptureWriter writer(port_sink, &port);
+  write_session(writer, 70);
+  // Start, three SAMPLES frames (32, 32, 6) and the end
+  CHECK_EQ(port.calls.size(), (size_t)5);
+  for (const std::vector<uint8_t> &call : port.calls) {
+    CaptureParser parser;
+    int frames = 0;
+    for (size_t i = 0; i < call.size(); i++) {
+      bool complete = parser.push(call[i]);
+      frames += complete ? 1 : 0;
+      CHECK(!complete || i + 1 == call.size());
+    }
+    CHECK_EQ(frames, 1);
+    CHECK_EQ(parser.skipped_bytes(), (uint32_t)0);
+  }
+}
+
+TEST(capture_format, text_between_frames_loses_nothing) {
+  Port port;
+  CaptureWriter writer(port_sink, &port);
+  write_session(writer, 70);
+
+  CaptureParser parser;
+  size_t samples = 0;
+  bool started = false, ended = false;
+  for (uint8_t byte : port.stream) {
+    if (!parser.push(byte)) continue;
+    if (parser.type() == CAPTURE_SESSION_START) {
+      Capture_Session session;
+      started = DecodeCaptureSession(parser.payload(), parser.size(), session);
+      CHECK_EQ(session.session_id, (uint32_t)9);
+      CHECK_EQ(session.calibration.x_offset, -12);
+      CHECK_EQ(session.calibration.z_threshold, 40);
+    } else if (parser.type() == CAPTURE_SAMPLES) {
+      Capture_Sample batch[CAPTURE_BATCH_SAMPLES];
+      size_t count =
+          DecodeCaptureSamples(parser.payload(), parser.size(), batch);
+      for (size_t i = 0; i < count; i++, samples++) {
+        CHECK_EQ(batch[i].timestamp_us, (uint32_t)(5000 * samples));
+        CHECK_EQ(batch[i].data.z_raw, (int16_t)(3 * samples));
+      }
+    } else if (parser.type() == CAPTURE_SESSION_END) {
+      Capture_Summary summary;
+      ended = DecodeCaptureSummary(parser.payload(), parser.size(), summary);
+      CHECK_EQ(summary.sample_count, (uint32_t)70);
+      CHECK_EQ(summary.dropped, (uint32_t)0);
+    }
+  }
+  CHECK(started);
+  CHECK(ended);
+  CHECK_EQ(samples, (size_t)70);
+  CHECK_EQ(parser.crc_errors(), (uint32_t)0);
+  CHECK_EQ(parser.skipped_bytes(), (uint32_t)(5 * strlen(kText)));
+}
+
+// What the shared port used to allow: text inside a frame costs it
+TEST(capture_format, text_inside_a_frame_is_caught_by_the_crc) {
+  Port port;
+  CaptureWriter writer(port_sink, &port);
+  write_session(writer, 10);
+  std::vector<uint8_t> frame = port.calls[1];
+  frame.insert(frame.begin() + 20, kText, kText + strlen(kText));
+  CaptureParser parser;
+  int frames = 0;
+  for (uint8_t byte : frame) frames += parser.push(byte) ? 1 : 0;
+  CHECK_EQ(frames, 0);
+}
+
+TEST(capture_format, attempt_round_trip) {
+  Port port;
+  CaptureWriter writer(port_sink, &port);
+  Capture_Attempt attempt = {};
+  attempt.attempt = 17;
+  attempt.uptime_ms = 123456;
+  attempt.outcome = CAPTURE_OUTCOME_REJECTED;
+  attempt.axes_matched = 2;
+  attempt.correlation[1] = 0.75f;
+  attempt.stage_us[PROFILE_STAGE_COUNT - 1] = 4242;
+  writer.begin_session(make_session());
+  writer.add_attempt(attempt);
+  writer.end_session();
+
+  CHECK_EQ(port.calls.size(), (size_t)3);
+  CaptureParser parser;
+  bool decoded = false;
+  for (uint8_t byte : port.calls[1]) {
+    if (!parser.push(byte)) continue;
+    CHECK_EQ(parser.type(), CAPTURE_ATTEMPT);
+    Capture_Attempt back;
+    decoded = DecodeCaptureAttempt(parser.payload(), parser.size(), back);
+    CHECK_EQ(back.attempt, (uint32_t)17);
+    CHECK_EQ(back.uptime_ms, (uint32_t)123456);
+    CHECK_EQ(back.outcome, CAPTURE_OUTCOME_REJECTED);
+    CHECK_EQ(back.correlation[1], 0.75f);
+    CHECK_EQ(back.stage_us[PROFILE_STAGE_COUNT - 1], (uint32_t)4242);
+  }
+  CHECK(decoded);
+}
@@ -0,0 +1,191 @@
+/**
+ * @file display_format_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the pixel formats on the framebuffer emulator: a scene
+ * drawn in RGB565 or L8 shows the ARGB8888 one, quantized.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <climits>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "display_format.h"
+#include "frame_buffers.h"
+#include "glyph_atlas.h"
+#include "rate_plot.h"
+#include "sentry_test.h"
+#include "status_line.h"
+
+namespace {
+
+// An ARGB8888 color as a format stores it and the LTDC shows it
+uint32_t quantize(uint32_t color, uint32_t format) {
+  if (format == LCD_PIXEL_FORMAT_RGB565) {
+    uint32_t r = (color >> 19) & 0x1F;
+    uint32_t g = (color >> 10) & 0x3F;
+    uint32_t b = (color >> 3) & 0x1F;
+    return 0xFF000000 | ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) |
+           (b << 3 | b >> 2);
+  }
+  if (format == LCD_PIXEL_FORMAT_L8) {
+    const uint32_t *palette = DisplayPalette();
+    uint32_t best = 0;
+    int32_t best_distance = INT32_MAX;
+    for (uint32_t i = 0; i < DISPLAY_PALETTE_SIZE; i++) {
+      int32_t distance = 0;
+      for (int shift = 0; shift < 24; shift += 8) {
+        int32_t d = (int32_t)((palette[i] >> shift) & 0xFF) -
+                    (int32_t)((color >> shift) & 0xFF);
+        distance += d * d;
+      }
+      if (distance < best_distance) {
+        best = i;
+        best_distance = distance;
+      }
+    }
+    return 0xFF000000 | palette[best];
+  }
+  return color;
+}
+
+// A display in a format, with what the firmware draws through
+struct Display {
+  explicit Display(uint32_t format)
+      : line(lcd, STATUS_TEXT_X, STATUS_TEXT_Y),
+        buffers(lcd, DISPLAY_FRONT_BUFFER, DISPLAY_BACK_BUFFER) {
+    lcd.set_refresh_us(0);
+    DisplayFormatApply(lcd, format);
+    lcd.SetFont(&Font16);
+    lcd.Clear(LCD_COLOR_BLACK);
+    if (atlas.build(lcd.GetFont())) atlas.attach(lcd);
+    buffers.enable();
+  }
+
+  // The boot screen: buttons and welcome text, from the glyph atlas
+  void boot_screen() {
+    lcd.SetTextColor(LCD_COLOR_RED);
+    lcd.FillRect(20, 40, 200, 60);
+    lcd.FillRect(20, 120, 200, 60);
+    lcd.SetBackColor(LCD_COLOR_BLACK);
+    lcd.SetTextColor(LCD_COLOR_WHITE);
+    lcd.DisplayStringAt(0, 60, (uint8_t *)"Record", CENTER_MODE);
+    lcd.DisplayStringAt(0, 140, (uint8_t *)"Unlock", CENTER_MODE);
+    lcd.DisplayStringAt(0, 220, (uint8_t *)"Gesture Sentry", CENTER_MODE);
+  }
+
+  void status_messages() {
+    for (const Status_Message &m : STATUS_MESSAGES) {
+      buffers.begin();
+      line.show(m.text, m.color);
+      buffers.damage(0, STATUS_TEXT_Y, lcd.GetXSize(), 16);
+      buffers.present();
+      lcd.vblank();
+    }
+  }
+
+  void rate_plot() {
+    RatePlot plot(lcd, buffers, 0, RATE_PLOT_Y, lcd.GetXSize(),
+                  RATE_PLOT_HEIGHT);
+    for (int i = 0; i < 3 * GYRO_SAMPLE_RATE_HZ; i++) {
+      float t = i / (float)GYRO_SAMPLE_RATE_HZ;
+      plot.add(200.0f * sinf(3.0f * t + 1), 120.0f * sinf(5.0f * t),
+               300.0f * cosf(2.0f * t));
+      if (i % RATE_PLOT_FRAME_SAMPLES == 0) {
+        plot.render(true);
+        lcd.vblank();
+      }
+    }
+    while (plot.pending() > 0) {
+      plot.render(true);
+      lcd.vblank();
+    }
+  }
+
+  // Fills and texts in named, arbitrary and translucent colors
+  void random_drawing(int count) {
+    const uint32_t named[] = {LCD_COLOR_GREEN,    LCD_COLOR_ORANGE,
+                              LCD_COLOR_DARKGRAY, LCD_COLOR_LIGHTGREEN,
+                              LCD_COLOR_BROWN,    LCD_COLOR_DARKMAGENTA};
+    std::mt19937 rng(1);
+    auto color = [&]() {
+      switch (rng() % 3) {
+        case 0:
+          return named[rng() % 6];
+        case 1:
+          return (uint32_t)(0xFF000000 | (rng() & 0xFFFFFF));
+        default:
+          return (uint32_t)rng();
+      }
+    };
+    buffers.begin();
+    for (int i = 0; i < count; i++) {
+      uint16_t x = rng() % lcd.GetXSize();
+      uint16_t y = rng() % (lcd.GetYSize() - 16);
+      lcd.SetTextColor(color());
+      if (rng() % 2 == 0) {
+        uint16_t width = 1 + rng() % (lcd.GetXSize() - x);
+        uint16_t height = 1 + rng() % (lcd.GetYSize() - y);
+        lcd.FillRect(x, y, width, height);
+      } else {
+        char text[16];
+        for (size_t c = 0; c + 1 < sizeof(text); c++) {
+          text[c] = (char)(' ' + rng() % LCD_ATLAS_GLYPHS);
+        }
+        text[1 + rng() % (sizeof(text) - 1)] = 0;
+        lcd.SetBackColor(color());
+        lcd.DisplayStringAt(x, y, (uint8_t *)text, LEFT_MODE);
+      }
+    }
+    buffers.damage(0, 0, lcd.GetXSize(), lcd.GetYSize());
+    buffers.present();
+    lcd.vblank();
+    line.invalidate();
+  }
+
+  LCD_DISCO_F429ZI lcd;
+  GlyphAtlas atlas;
+  StatusLine line;
+  FrameBuffers buffers;
+};
+
+// Pixels of the display that are not the reference's, quantized
+int differ(Display &display, Display &reference, uint32_t format) {
+  const uint32_t *shown = display.lcd.scanout();
+  const uint32_t *expected = reference.lcd.scanout();
+  int pixels = 0;
+  for (size_t at = 0; at < 240 * 320; at++) {
+    pixels += shown[at] != quantize(expected[at], format);
+  }
+  return pixels;
+}
+
+}  // namespace
+
+TEST(display_format, scene_matches_argb8888_quantized) {
+  const uint32_t formats[] = {LCD_PIXEL_FORMAT_RGB565, LCD_PIXEL_FORMAT_L8};
+  for (uint32_t format : formats) {
+    Display reference(LCD_PIXEL_FORMAT_ARGB8888);
+    Display display(format);
+    reference.boot_screen();
+    display.boot_screen();
+    CHECK_EQ(differ(display, reference, format), 0);
+    reference.status_messages();
+    display.status_messages();
+    CHECK_EQ(differ(display, reference, format), 0);
+    reference.rate_plot();
+    display.rate_plot();
+    CHECK_EQ(differ(display, reference, format), 0);
+    reference.random_drawing(200);
+    display.random_drawing(200);
+    CHECK_EQ(differ(display, reference, format), 0);
+  }
+}
@@ -0,0 +1,137 @@
+/**
+ * @file eeprom_store_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the EEPROM record store on the emulated M24LR64: records
+ * across a remount, without the module, and across power cuts.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "eeprom_store.h"
+#include "sentry_test.h"
+
+namespace {
+
+// The record main() keeps in EEPROM_RECORD_ATTEMPTS
+typedef struct {
+  uint32_t attempts;
+  uint32_t failures;
+  uint32_t failure_streak;
+} Attempts;
+
+typedef std::vector<std::vector<uint8_t>> Shadow;  // empty: never written
+
+std::vector<uint8_t> random_value(std::mt19937 &rng) {
+  std::vector<uint8_t> value(1 + rng() % EEPROM_RECORD_PAYLOAD);
+  for (auto &b : value) b = rng();
+  return value;
+}
+
+bool holds(const EepromStore &store, uint8_t id,
+           const std::vector<uint8_t> &value) {
+  uint8_t loaded[EEPROM_RECORD_PAYLOAD];
+  if (value.empty()) return !store.read(id, loaded, 1);
+  return store.read(id, loaded, value.size()) &&
+         memcmp(loaded, value.data(), value.size()) == 0;
+}
+
+// Writes random records, then updates some and cuts the power at a random
+// page of the flush; the records that do not read back as their previous
+// or their new value after a remount
+int power_loss_trial(std::mt19937 &rng, bool &cut) {
+  eeprom_emulator_erase_all();
+  Shadow before(EEPROM_RECORDS), after;
+  {
+    EepromStore store;
+    store.mount();
+    for (int i = 0, n = 1 + rng() % EEPROM_RECORDS; i < n; i++) {
+      uint8_t id = rng() % EEPROM_RECORDS;
+      before[id] = random_value(rng);
+      store.write(id, before[id].data(), before[id].size());
+    }
+    store.flush();
+
+    after = before;
+    for (int i = 0, n = 1 + rng() % 4; i < n; i++) {
+      uint8_t id = rng() % EEPROM_RECORDS;
+      after[id] = random_value(rng);
+      store.write(id, after[id].data(), after[id].size());
+    }
+    eeprom_emulator_cut_power(rng() % 16, rng());
+    store.flush();
+    cut = eeprom_emulator_power_lost();
+    eeprom_emulator_restore_power();
+  }
+
+  EepromStore rebooted;
+  if (!rebooted.mount()) return EEPROM_RECORDS;
+  int violations = 0;
+  for (uint8_t id = 0; id < EEPROM_RECORDS; id++) {
+    if (!holds(rebooted, id, before[id]) && !holds(rebooted, id, after[id])) {
+      violations++;
+    }
+  }
+  return violations;
+}
+
+}  // namespace
+
+TEST(eeprom_store, last_value_survives_a_remount) {
+  const int batches[] = {1, 10};
+  for (int batch : batches) {
+    eeprom_emulator_erase_all();
+    Attempts attempts = {};
+    {
+      EepromStore store;
+      CHECK(store.mount());
+      for (int i = 0; i < 20; i++) {
+        attempts.attempts++;
+        attempts.failures += i % 3 == 0;
+        attempts.failure_streak = i % 3 == 0 ? attempts.failure_streak + 1 : 0;
+        CHECK(store.write(EEPROM_RECORD_ATTEMPTS, &attempts,
+                          sizeof(attempts)));
+        if ((i + 1) % batch == 0) CHECK(store.flush());
+      }
+      CHECK(store.flush());
+    }
+    EepromStore again;
+    Attempts loaded;
+    CHECK(again.mount());
+    CHECK(again.read(EEPROM_RECORD_ATTEMPTS, &loaded, sizeof(loaded)));
+    CHECK(memcmp(&loaded, &attempts, sizeof(attempts)) == 0);
+  }
+}
+
+TEST(eeprom_store, works_in_ram_without_the_module) {
+  eeprom_emulator_set_present(false);
+  EepromStore store;
+  Attempts attempts = {1, 0, 0}, loaded = {};
+  CHECK(!store.mount());
+  CHECK(store.write(EEPROM_RECORD_ATTEMPTS, &attempts, sizeof(attempts)));
+  CHECK(store.read(EEPROM_RECORD_ATTEMPTS, &loaded, sizeof(loaded)));
+  CHECK_EQ(loaded.attempts, 1u);
+  CHECK(!store.flush());
+  eeprom_emulator_set_present(true);
+}
+
+TEST(eeprom_store, records_survive_power_cuts) {
+  std::mt19937 rng(1);
+  int violations = 0, cuts = 0;
+  for (int t = 0; t < 20; t++) {
+    bool cut = false;
+    violations += power_loss_trial(rng, cut);
+    cuts += cut;
+  }
+  CHECK(cuts > 0);
+  CHECK_EQ(violations, 0);
+}
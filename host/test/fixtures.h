@@ -0,0 +1,85 @@
+/**
+ * @file fixtures.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Synthetic gestures and the gyroscope setup shared by the host
+ * tests and benchmarks.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * The key's gesture class is a circle of 1.5 turns over 2 s; attempts of
+ * another class are three strokes on the three axes. Sources are set up as
+ * the firmware sets up the L3GD20: 200 Hz, 50 Hz cutoff, 500 dps, then
+ * calibrated on 64 samples. The status messages are the firmware's, from
+ * STATUS_MESSAGES. key() makes plain numbered samples for the store tests.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef FIXTURES_H
+#define FIXTURES_H
+
+#include <array>
+#include <vector>
+
+#include "capture.h"
+#include "gesture_synth.h"
+#include "gyro_source.h"
+#include "status_line.h"
+
+namespace fixtures {
+
+const Gyroscope_Init_Parameters kInit = {ODR_200_CUTOFF_50, INT2_DRDY,
+                                         FULL_SCALE_500};
+
+// The key's gesture class, or another one
+inline synth::GestureSpec gesture(bool genuine = true) {
+  synth::GestureSpec spec = {};
+  spec.duration_s = 2.0f;
+  spec.amplitude_dps = 180.0f;
+  if (genuine) {
+    spec.shape = synth::Shape::Circle;
+    spec.axes[0] = {0.6f, 0.0f, 0.8f};
+    spec.turns = 1.5f;
+  } else {
+    spec.shape = synth::Shape::Stroke;
+    spec.segments = 3;
+    spec.axes[0] = {1.0f, 0.0f, 0.0f};
+    spec.axes[1] = {0.0f, -1.0f, 0.0f};
+    spec.axes[2] = {0.0f, 0.0f, 1.0f};
+  }
+  return spec;
+}
+
+// Initializes a source with kInit and calibrates it, as main() does
+inline void calibrate(GyroSource &source, Gyroscope_Calibration &calibration) {
+  source.init(kInit);
+  CalibrateSource(source, calibration, 64);
+}
+
+// A key of n samples, different for each seed, for the stores; not a
+// gesture anyone could perform
+inline std::vector<std::array<float, 3>> key(int n, float seed = 1.0f) {
+  std::vector<std::array<float, 3>> samples;
+  for (int i = 0; i < n; i++) {
+    samples.push_back({seed + i, seed - i, seed * i});
+  }
+  return samples;
+}
+
+// The status messages of one recording, as gyroscope_thread() shows them
+inline std::vector<Status_Message> recording_messages() {
+  const Status_Message_Id ids[] = {
+      STATUS_HOLD_ON,        STATUS_CALIBRATING,    STATUS_RECORDING_IN_3,
+      STATUS_RECORDING_IN_2, STATUS_RECORDING_IN_1, STATUS_RECORDING,
+      STATUS_FINISHED};
+  std::vector<Status_Message> messages;
+  for (Status_Message_Id id : ids) messages.push_back(STATUS_MESSAGES[id]);
+  return messages;
+}
+
+}  // namespace fixtures
+
+#endif  // FIXTURES_H
@@ -0,0 +1,178 @@
+/**
+ * @file flash_writer_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the background flash writer: what its completion
+ * callbacks see, write coalescing, the bounded queue and a UI thread that
+ * keeps its frames while a persist reclaims a sector in real time.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "fixtures.h"
+#include "flash_writer.h"
+#include "sentry_test.h"
+
+namespace {
+
+typedef std::vector<std::array<float, 3>> Gesture;
+
+typedef std::chrono::steady_clock Clock;
+
+const uint16_t kRate = GYRO_SAMPLE_RATE_HZ / RECORDING_DECIMATION;
+const std::chrono::milliseconds kFramePeriod(20);
+const int kFrames = 60;
+const int kEnrollFrame = 10;
+
+// What the callback saw, as main()'s key_persisted() would
+FlashWriter *writer = nullptr;
+TemplateStore *store = nullptr;
+int reports = 0;
+bool pending_in_callback = true;
+bool stored_in_callback = false;
+
+void persisted(uint8_t slot, Flash_Job_Status status) {
+  reports++;
+  pending_in_callback = writer->pending(slot);
+  stored_in_callback = status == FLASH_JOB_DONE && store->contains(slot);
+}
+
+int superseded_jobs = 0;
+
+void superseded(uint8_t, Flash_Job_Status status) {
+  if (status == FLASH_JOB_SUPERSEDED) superseded_jobs++;
+}
+
+}  // namespace
+
+TEST(flash_writer, job_is_settled_when_it_reports) {
+  flash_emulator_erase_all();
+  TemplateStore template_store;
+  CHECK(template_store.mount());
+  FlashWriter flash_writer(template_store);
+  writer = &flash_writer;
+  store = &template_store;
+  reports = 0;
+  flash_writer.start();
+
+  CHECK(flash_writer.persist(TEMPLATE_KEY_SLOT, fixtures::key(100), kRate,
+                             callback(persisted)));
+  flash_writer.flush();
+  CHECK_EQ(reports, 1);
+  CHECK(!pending_in_callback);
+  CHECK(stored_in_callback);
+
+  CHECK(flash_writer.remove(TEMPLATE_KEY_SLOT, callback(persisted)));
+  flash_writer.flush();
+  CHECK_EQ(reports, 2);
+  CHECK(!pending_in_callback);
+  CHECK(!template_store.contains(TEMPLATE_KEY_SLOT));
+}
+
+TEST(flash_writer, burst_for_one_slot_is_written_once) {
+  flash_emulator_erase_all();
+  TemplateStore template_store;
+  template_store.set_encoding(TEMPLATE_ENCODING_FLOAT32);
+  CHECK(template_store.mount());
+  FlashWriter flash_writer(template_store);
+  superseded_jobs = 0;
+
+  // Queued before the thread runs, so none of them has started
+  for (int i = 0; i < 10; i++) {
+    CHECK(flash_writer.persist(TEMPLATE_KEY_SLOT, fixtures::key(100, (float)i),
+                               kRate, callback(superseded)));
+  }
+  flash_writer.start();
+  flash_writer.flush();
+
+  Flash_Writer_Stats stats = flash_writer.stats();
+  CHECK_EQ(stats.completed, 1u);
+  CHECK_EQ(stats.coalesced, 9u);
+  CHECK_EQ(stats.rejected, 0u);
+  CHECK_EQ(superseded_jobs, 9);
+  Gesture stored;
+  CHECK(template_store.read(TEMPLATE_KEY_SLOT, stored));
+  CHECK(stored == fixtures::key(100, 9.0f));
+}
+
+TEST(flash_writer, full_queue_refuses_a_new_slot_only) {
+  flash_emulator_erase_all();
+  TemplateStore template_store;
+  CHECK(template_store.mount());
+  FlashWriter flash_writer(template_store);
+
+  for (uint8_t slot = 0; slot < FLASH_WRITER_QUEUE; slot++) {
+    CHECK(flash_writer.persist(slot, fixtures::key(50), kRate));
+  }
+  CHECK(!flash_writer.remove(FLASH_WRITER_QUEUE));
+  CHECK(flash_writer.remove(0));  // replaces the waiting write
+  CHECK(flash_writer.pending(0));
+
+  Flash_Writer_Stats stats = flash_writer.stats();
+  CHECK_EQ(stats.rejected, 1u);
+  CHECK_EQ(stats.coalesced, 1u);
+  CHECK_EQ(stats.max_depth, (uint32_t)FLASH_WRITER_QUEUE);
+  flash_writer.start();
+  flash_writer.flush();
+  CHECK(!template_store.contains(0));
+  CHECK(template_store.contains(1));
+}
+
+TEST(flash_writer, ui_keeps_its_frames_while_a_sector_is_reclaimed) {
+  // A store down to its reserve sector, so the next persist also erases one
+  flash_emulator_set_realtime(false);
+  flash_emulator_erase_all();
+  TemplateStore template_store;
+  CHECK(template_store.mount());
+  for (uint8_t slot = 1;
+       template_store.stats().free_sectors > TEMPLATE_STORE_RESERVE;
+       slot = slot % (TEMPLATE_SLOTS - 1) + 1) {
+    CHECK(template_store.write(slot, fixtures::key(RECORDING_SAMPLES), kRate));
+  }
+  uint32_t compactions = template_store.stats().compactions;
+  FlashWriter flash_writer(template_store);
+  flash_writer.start();
+  flash_emulator_set_realtime(true);  // a 16 KB erase sleeps 250 ms
+
+  // The UI thread renders a frame per period and enrolls a key in one
+  std::atomic<int64_t> stored_ns(0);
+  Clock::duration max_late(0);
+  Clock::time_point start = Clock::now(), returned;
+  std::thread ui([&]() {
+    Clock::time_point next = start;
+    for (int frame = 0; frame < kFrames; frame++) {
+      std::this_thread::sleep_until(next);
+      max_late = max(max_late, Clock::now() - next);
+      next += kFramePeriod;
+      if (frame == kEnrollFrame) {
+        Gesture key = fixtures::key(RECORDING_SAMPLES, 2.0f);
+        flash_writer.persist(TEMPLATE_KEY_SLOT, key, kRate,
+                             [&](uint8_t, Flash_Job_Status status) {
+                               if (status == FLASH_JOB_DONE) {
+                                 stored_ns = (Clock::now() - start).count();
+                               }
+                             });
+        returned = Clock::now();
+      }
+    }
+  });
+  ui.join();
+  flash_writer.flush();
+  flash_emulator_set_realtime(false);
+
+  CHECK(template_store.stats().compactions > compactions);
+  CHECK(template_store.contains(TEMPLATE_KEY_SLOT));
+  CHECK(max_late <= Clock::duration(kFramePeriod));
+  CHECK(stored_ns.load() > (returned - start).count());
+  CHECK(returned - start < kFramePeriod * (kEnrollFrame + 1));
+}
@@ -0,0 +1,141 @@
+/**
+ * @file frame_buffers_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the double-buffered display on the framebuffer emulator:
+ * no torn refreshes, the right frame after every flip, and the frame
+ * budget counters.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <random>
+#include <vector>
+
+#include "frame_buffers.h"
+#include "sentry_test.h"
+#include "status_line.h"
+
+namespace {
+
+const size_t kCount = STATUS_MESSAGE_COUNT;
+
+typedef std::vector<uint32_t> Frame;
+
+Frame screen(const uint32_t *pixels) {
+  return Frame(pixels, pixels + 240 * 320);
+}
+
+// The screen before and after each message, drawn the old way
+std::vector<Frame> references() {
+  LCD_DISCO_F429ZI lcd;
+  lcd.Clear(LCD_COLOR_BLACK);
+  std::vector<Frame> frames = {screen(lcd.frame())};
+  for (const Status_Message &m : STATUS_MESSAGES) {
+    lcd.SetTextColor(LCD_COLOR_BLACK);
+    lcd.FillRect(0, STATUS_TEXT_Y, lcd.GetXSize(), FONT_SIZE);
+    lcd.SetTextColor(m.color);
+    lcd.DisplayStringAt(STATUS_TEXT_X, STATUS_TEXT_Y, (uint8_t *)m.text,
+                        CENTER_MODE);
+    frames.push_back(screen(lcd.frame()));
+  }
+  return frames;
+}
+
+struct Tearing {
+  uint32_t refreshes;
+  uint32_t torn;   // refreshes showing neither the last frame nor the next
+  uint32_t wrong;  // messages not on screen once shown
+};
+
+// The messages with a refresh after every 1 to 400 pixel writes
+Tearing tearing(bool buffered) {
+  std::vector<Frame> frames = references();
+  LCD_DISCO_F429ZI lcd;
+  lcd.set_refresh_us(0);
+  lcd.Clear(LCD_COLOR_BLACK);
+  StatusLine line(lcd, STATUS_TEXT_X, STATUS_TEXT_Y);
+  FrameBuffers buffers(lcd, DISPLAY_FRONT_BUFFER, DISPLAY_BACK_BUFFER);
+  if (buffered) buffers.enable();
+
+  Tearing result = {0, 0, 0};
+  size_t shown = 0;  // frames[shown] is complete, frames[shown + 1] drawing
+  auto refresh = [&]() {
+    lcd.vblank();
+    result.refreshes++;
+    Frame now = screen(lcd.scanout());
+    if (now != frames[shown] && now != frames[shown + 1]) result.torn++;
+  };
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<uint32_t> writes(1, 400);
+  lcd.set_write_hook(
+      [&]() {
+        refresh();
+        return writes(rng);
+      },
+      writes(rng));
+
+  for (size_t i = 0; i < kCount; i++) {
+    if (buffered) buffers.begin();
+    line.show(STATUS_MESSAGES[i].text, STATUS_MESSAGES[i].color);
+    if (buffered) {
+      buffers.damage(0, STATUS_TEXT_Y, lcd.GetXSize(), FONT_SIZE);
+      buffers.present();
+    }
+    refresh();
+    shown = i + 1;
+    if (screen(lcd.scanout()) != frames[shown]) result.wrong++;
+  }
+  lcd.set_write_hook(nullptr, 0);
+  return result;
+}
+
+}  // namespace
+
+TEST(frame_buffers, refreshes_show_whole_frames) {
+  Tearing direct = tearing(false);
+  CHECK(direct.torn > 0);  // or the refreshes missed the drawing
+  CHECK_EQ(direct.wrong, 0u);
+
+  Tearing buffered = tearing(true);
+  CHECK(buffered.refreshes > kCount);
+  CHECK_EQ(buffered.torn, 0u);
+  CHECK_EQ(buffered.wrong, 0u);
+}
+
+TEST(frame_buffers, frame_budget_counters) {
+  // Real time: messages back to back, faster than the panel refreshes
+  LCD_DISCO_F429ZI lcd;
+  lcd.Clear(LCD_COLOR_BLACK);
+  StatusLine line(lcd, STATUS_TEXT_X, STATUS_TEXT_Y);
+  FrameBuffers buffers(lcd, DISPLAY_FRONT_BUFFER, DISPLAY_BACK_BUFFER);
+  buffers.enable();
+  for (const Status_Message &m : STATUS_MESSAGES) {
+    buffers.begin();
+    line.show(m.text, m.color);
+    buffers.damage(0, STATUS_TEXT_Y, lcd.GetXSize(), FONT_SIZE);
+    buffers.present();
+  }
+  Frame_Buffers_Stats fast = buffers.stats();
+  CHECK_EQ(fast.frames, (uint32_t)kCount);
+  CHECK(fast.waits > 0);
+  CHECK_EQ(fast.over_budget, 0u);
+
+  // One frame two and a half budgets long drops two refreshes
+  buffers.begin();
+  wait_us(buffers.budget_us() * 5 / 2);
+  buffers.present();
+  Frame_Buffers_Stats slow = buffers.stats();
+  CHECK_EQ(slow.over_budget, 1u);
+  CHECK_EQ(slow.dropped, 2u);
+
+  while (lcd.ReloadPending()) {
+    ThisThread::sleep_for(std::chrono::milliseconds(1));
+  }
+  CHECK(screen(lcd.scanout()) == references()[kCount]);
+}
@@ -0,0 +1,95 @@
+/**
+ * @file glyph_atlas_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the glyph atlas on the framebuffer emulator: blended text
+ * has the BSP's pixels in every font.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "glyph_atlas.h"
+#include "sentry_test.h"
+
+namespace {
+
+sFONT *const kFonts[] = {&Font8, &Font12, &Font16, &Font20, &Font24};
+
+// Two displays in one font, the second drawing from an atlas if it fits
+struct Displays {
+  explicit Displays(sFONT *font) : built(atlas.build(font)) {
+    for (LCD_DISCO_F429ZI &lcd : lcds) {
+      lcd.SetFont(font);
+      lcd.SetBackColor(LCD_COLOR_BLACK);
+      lcd.Clear(LCD_COLOR_BLACK);
+    }
+    atlas.attach(lcds[1]);
+  }
+
+  // One text on both; false if the frames differ
+  bool draw(uint16_t x, uint16_t y, const char *text, uint32_t color,
+            uint32_t back, Text_AlignModeTypdef mode) {
+    for (LCD_DISCO_F429ZI &lcd : lcds) {
+      lcd.SetTextColor(color);
+      lcd.SetBackColor(back);
+      lcd.DisplayStringAt(x, y, (uint8_t *)text, mode);
+    }
+    size_t bytes = lcds[0].GetXSize() * lcds[0].GetYSize() * sizeof(uint32_t);
+    return memcmp(lcds[0].frame(), lcds[1].frame(), bytes) == 0;
+  }
+
+  LCD_DISCO_F429ZI lcds[2];
+  GlyphAtlas atlas;
+  bool built;
+};
+
+}  // namespace
+
+TEST(glyph_atlas, every_glyph_matches_the_bsp) {
+  for (sFONT *font : kFonts) {
+    Displays displays(font);
+    std::string all;
+    for (int c = ' '; c < ' ' + LCD_ATLAS_GLYPHS; c++) all += (char)c;
+    for (size_t at = 0; at < all.size(); at += 12) {
+      CHECK(displays.draw(0, (uint16_t)(at / 12 * font->Height),
+                          all.substr(at, 12).c_str(), LCD_COLOR_WHITE,
+                          LCD_COLOR_DARKBLUE, LEFT_MODE));
+    }
+    // Fonts too large for GLYPH_ATLAS_BYTES stay with the BSP
+    uint32_t blended = displays.lcds[1].stats().atlas_chars;
+    CHECK(displays.built ? blended > 0 : blended == 0);
+  }
+  CHECK(GlyphAtlas::bytes(&Font16) <= GLYPH_ATLAS_BYTES);
+}
+
+TEST(glyph_atlas, random_texts_match_the_bsp) {
+  const uint32_t colors[] = {LCD_COLOR_GREEN,  LCD_COLOR_RED,
+                             LCD_COLOR_ORANGE, LCD_COLOR_WHITE,
+                             LCD_COLOR_BLACK,  LCD_COLOR_DARKGRAY,
+                             0x80FF8000,       0x00000000};
+  const Text_AlignModeTypdef modes[] = {CENTER_MODE, RIGHT_MODE, LEFT_MODE};
+  std::mt19937 rng(1);
+  // Off the right edge and translucent colors included
+  for (sFONT *font : kFonts) {
+    Displays displays(font);
+    int mismatches = 0;
+    for (int i = 0; i < 200; i++) {
+      std::string text(rng() % 30, ' ');
+      for (char &c : text) c = (char)(' ' + rng() % LCD_ATLAS_GLYPHS);
+      uint16_t x = rng() % displays.lcds[0].GetXSize();
+      uint16_t y = rng() % (displays.lcds[0].GetYSize() - font->Height);
+      mismatches += !displays.draw(x, y, text.c_str(), colors[rng() % 8],
+                                   colors[rng() % 8], modes[rng() % 3]);
+    }
+    CHECK_EQ(mismatches, 0);
+  }
+}
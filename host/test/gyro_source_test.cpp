@@ -0,0 +1,71 @@
+/**
+ * @file gyro_source_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the synthetic gyroscope source against the gesture
+ * generator it plays.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cmath>
+
+#include "fixtures.h"
+#include "gyro_source.h"
+#include "sentry_test.h"
+
+namespace {
+
+synth::GestureSpec flick() {
+  synth::GestureSpec spec = {};
+  spec.shape = synth::Shape::Flick;
+  spec.duration_s = 0.5f;
+  spec.amplitude_dps = 450.0f;
+  spec.axes[0] = {0.0f, 0.0f, 1.0f};
+  return spec;
+}
+
+}  // namespace
+
+TEST(gyro_source, synthetic_source_plays_the_generated_gesture) {
+  synth::Variation variation = synth::typical_variation();
+  synth::Gesture expected;
+  synth::generate(flick(), variation, 42, expected, GYRO_SAMPLE_RATE_HZ);
+
+  SyntheticGyroSource source(flick(), variation, 42);
+  CHECK(source.init(fixtures::kInit));
+  float sensitivity = source.sensitivity();
+  CHECK_EQ(sensitivity, SENSITIVITY_500);
+  size_t count = 0;
+  Gyroscope_RawData raw;
+  while (source.read(raw)) {
+    if (count < expected.size()) {
+      CHECK_NEAR(raw.x_raw * sensitivity, expected[count][0], sensitivity);
+      CHECK_NEAR(raw.y_raw * sensitivity, expected[count][1], sensitivity);
+      CHECK_NEAR(raw.z_raw * sensitivity, expected[count][2], sensitivity);
+    }
+    count++;
+  }
+  CHECK_EQ(count, expected.size());
+}
+
+TEST(gyro_source, synthetic_source_rewinds_to_the_same_stream) {
+  SyntheticGyroSource source(flick(), synth::typical_variation(), 7);
+  CHECK(source.init(fixtures::kInit));
+  std::vector<int16_t> first;
+  Gyroscope_RawData raw;
+  while (source.read(raw)) first.push_back(raw.z_raw);
+  source.rewind();
+  size_t i = 0;
+  while (source.read(raw)) {
+    CHECK(i < first.size() && raw.z_raw == first[i]);
+    i++;
+  }
+  CHECK_EQ(i, first.size());
+  CHECK_EQ(first.size(), source.rates().size());
+}
@@ -0,0 +1,141 @@
+/**
+ * @file hampel_filter_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the Hampel filter: injected spikes, real motion and the
+ * deviation floor of a flat window.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "hampel_filter.h"
+#include "sentry_test.h"
+
+namespace {
+
+const size_t kDelay = HAMPEL_WINDOW_SIZE / 2;
+
+// The filter's output for each input, realigned by its delay: out[i] is
+// what came out for in[i] (the last kDelay inputs are flushed with their
+// last value)
+std::vector<float> run(HampelFilter &filter, const std::vector<float> &in) {
+  std::vector<float> out;
+  for (size_t i = 0; i < in.size() + kDelay; i++) {
+    float value = filter.filter(in[std::min(i, in.size() - 1)]);
+    if (i >= kDelay) out.push_back(value);
+  }
+  return out;
+}
+
+// Slow noisy rotation around 100 dps
+std::vector<float> noisy(size_t n) {
+  std::vector<float> samples;
+  for (size_t i = 0; i < n; i++) {
+    samples.push_back(100.0f + 20.0f * sinf(i * 0.05f) +
+                      8.0f * sinf(i * 2.3f));
+  }
+  return samples;
+}
+
+float window_median(const std::vector<float> &in, size_t middle) {
+  std::vector<float> window(in.begin() + middle - kDelay,
+                            in.begin() + middle + kDelay + 1);
+  std::sort(window.begin(), window.end());
+  return window[kDelay];
+}
+
+}  // namespace
+
+TEST(hampel_filter, single_spike_becomes_the_window_median) {
+  std::vector<float> in = noisy(80);
+  const size_t spike = 40;
+  in[spike] = 2000.0f;
+  HampelFilter filter;
+  std::vector<float> out = run(filter, in);
+  CHECK_EQ(out[spike], window_median(in, spike));
+  CHECK(out[spike] < 200.0f);
+  for (size_t i = 0; i < in.size(); i++) {
+    if (i != spike) CHECK_EQ(out[i], in[i]);
+  }
+  CHECK_EQ(filter.outlier_count(), (size_t)1);
+}
+
+TEST(hampel_filter, spikes_of_either_sign) {
+  std::vector<float> in = noisy(120);
+  in[30] = -1500.0f;
+  in[70] = 900.0f;
+  HampelFilter filter;
+  std::vector<float> out = run(filter, in);
+  CHECK_EQ(out[30], window_median(in, 30));
+  CHECK_EQ(out[70], window_median(in, 70));
+  CHECK_EQ(filter.outlier_count(), (size_t)2);
+}
+
+TEST(hampel_filter, step_passes_unchanged) {
+  std::vector<float> in(30, 0.0f);
+  in.resize(60, 400.0f);
+  in.resize(90, -250.0f);
+  HampelFilter filter;
+  std::vector<float> out = run(filter, in);
+  CHECK(out == in);
+  CHECK_EQ(filter.outlier_count(), (size_t)0);
+}
+
+TEST(hampel_filter, ramp_and_peak_pass_unchanged) {
+  // At rest, up at 150 dps a sample to a sharp peak, back down, at rest
+  std::vector<float> in(20, 0.0f);
+  for (int i = 1; i <= 8; i++) in.push_back(150.0f * i);
+  for (int i = 7; i >= 0; i--) in.push_back(150.0f * i);
+  in.resize(in.size() + 20, 0.0f);
+  HampelFilter filter;
+  std::vector<float> out = run(filter, in);
+  CHECK(out == in);
+  CHECK_EQ(filter.outlier_count(), (size_t)0);
+}
+
+TEST(hampel_filter, output_is_delayed_half_a_window) {
+  HampelFilter filter;
+  for (size_t i = 0; i < kDelay; i++) {
+    CHECK_EQ(filter.filter(10.0f + i), 10.0f);
+  }
+  CHECK_EQ(filter.filter(99.0f), 10.0f);
+  CHECK_EQ(filter.filter(99.0f), 11.0f);
+}
+
+TEST(hampel_filter, flat_window_keeps_the_deviation_floor) {
+  // A dead-banded window is all zeros: MAD == 0, so without the floor any
+  // motion at all would be a spike
+  std::vector<float> in(40, 0.0f);
+  in[20] = HAMPEL_MIN_DEVIATION * 0.8f;
+  HampelFilter filter;
+  CHECK(run(filter, in) == in);
+  CHECK_EQ(filter.outlier_count(), (size_t)0);
+
+  HampelFilter unfloored(HAMPEL_N_SIGMAS, 0.0f);
+  CHECK_EQ(run(unfloored, in)[20], 0.0f);
+  CHECK_EQ(unfloored.outlier_count(), (size_t)1);
+
+  in[20] = HAMPEL_MIN_DEVIATION * 1.5f;
+  HampelFilter floored;
+  CHECK_EQ(run(floored, in)[20], 0.0f);
+  CHECK_EQ(floored.outlier_count(), (size_t)1);
+}
+
+TEST(hampel_filter, reset_forgets_the_window) {
+  HampelFilter filter;
+  for (int i = 0; i < 20; i++) filter.filter(500.0f);
+  filter.filter(5000.0f);
+  filter.reset();
+  CHECK_EQ(filter.outlier_count(), (size_t)0);
+  CHECK_EQ(filter.filter(1.0f), 1.0f);
+  CHECK(!filter.last_was_outlier());
+}
@@ -0,0 +1,82 @@
+/**
+ * @file lcd_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the display class on the framebuffer emulator: moving
+ * a rectangle over itself in every direction.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <vector>
+
+#include "sentry_test.h"
+#include "system_config.h"
+
+namespace {
+
+const uint16_t kX = 60;
+const uint16_t kY = 80;
+const uint16_t kSize = 40;
+
+// Every pixel of the area around the rectangle in its own color
+void pattern(LCD_DISCO_F429ZI &lcd) {
+  for (uint16_t y = kY - 10; y < kY + kSize + 10; y++) {
+    for (uint16_t x = kX - 10; x < kX + kSize + 10; x++) {
+      lcd.DrawPixel(x, y, 0xFF000000u | (uint32_t)x << 12 | y);
+    }
+  }
+}
+
+// The screen after a move that reads the source before writing anything
+std::vector<uint32_t> moved(LCD_DISCO_F429ZI &lcd, int dx, int dy) {
+  const uint32_t *frame = lcd.frame();
+  std::vector<uint32_t> pixels(frame, frame + 240 * 320);
+  std::vector<uint32_t> expected = pixels;
+  for (uint16_t y = 0; y < kSize; y++) {
+    for (uint16_t x = 0; x < kSize; x++) {
+      expected[(kY + dy + y) * 240 + kX + dx + x] =
+          pixels[(kY + y) * 240 + kX + x];
+    }
+  }
+  return expected;
+}
+
+}  // namespace
+
+TEST(lcd, overlapping_moves_in_every_direction) {
+  const int steps[][2] = {{-3, 0}, {3, 0},  {0, -3}, {0, 3},
+                          {-3, -3}, {3, 3}, {3, -3}, {-3, 3}};
+  for (const auto &step : steps) {
+    LCD_DISCO_F429ZI lcd;
+    pattern(lcd);
+    std::vector<uint32_t> expected = moved(lcd, step[0], step[1]);
+    lcd.MoveRect(DISPLAY_FRONT_BUFFER, kX, kY, kX + step[0], kY + step[1],
+                 kSize, kSize);
+    const uint32_t *frame = lcd.frame();
+    CHECK(std::vector<uint32_t>(frame, frame + 240 * 320) == expected);
+  }
+}
+
+TEST(lcd, copy_between_buffers) {
+  LCD_DISCO_F429ZI lcd;
+  pattern(lcd);
+  const uint32_t *frame = lcd.frame();
+  std::vector<uint32_t> front(frame, frame + 240 * 320);
+  lcd.CopyRect(DISPLAY_FRONT_BUFFER, DISPLAY_BACK_BUFFER, kX, kY, kSize,
+               kSize);
+  lcd.SetLayerAddress(0, DISPLAY_BACK_BUFFER);
+  const uint32_t *back = lcd.frame();
+  int differ = 0;
+  for (uint16_t y = kY; y < kY + kSize; y++) {
+    for (uint16_t x = kX; x < kX + kSize; x++) {
+      differ += back[y * 240 + x] != front[y * 240 + x];
+    }
+  }
+  CHECK_EQ(differ, 0);
+}
@@ -0,0 +1,100 @@
+/**
+ * @file matcher_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of matching a key in place in the template store: the scores
+ * are those of a copy read out of it, and its precomputed features give
+ * them bit for bit, for both encodings.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "gesture_synth.h"
+#include "matcher.h"
+#include "sentry_test.h"
+#include "template_features.h"
+#include "template_store.h"
+
+namespace {
+
+typedef std::vector<std::array<float, 3>> Gesture;
+
+const uint8_t kEncodings[] = {TEMPLATE_ENCODING_FLOAT32,
+                              TEMPLATE_ENCODING_DELTA};
+
+// A key and an attempt of one random gesture, the key stored in a blank
+// store with an encoding
+struct Stored {
+  Stored(uint8_t encoding, uint64_t seed) {
+    synth::Rng rng(seed);
+    synth::GestureSpec spec = synth::random_spec(rng);
+    synth::generate(spec, synth::typical_variation(), rng.next(), key);
+    synth::generate(spec, synth::typical_variation(), rng.next(), attempt);
+    key.resize(RECORDING_SAMPLES);
+    attempt.resize(RECORDING_SAMPLES);
+    flash_emulator_erase_all();
+    store.set_encoding(encoding);
+    ok = store.mount() && store.write(TEMPLATE_KEY_SLOT, key, 20);
+  }
+
+  Gesture key;
+  Gesture attempt;
+  TemplateStore store;
+  bool ok;
+};
+
+bool same_score(float a, float b) {
+  return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+}  // namespace
+
+TEST(matcher, in_place_matches_a_copy) {
+  for (uint8_t encoding : kEncodings) {
+    for (uint64_t seed = 1; seed <= 5; seed++) {
+      Stored stored(encoding, seed);
+      CHECK(stored.ok);
+
+      // MatchGesture() modifies the attempt it is given
+      Gesture loaded, work = stored.attempt;
+      CHECK(stored.store.read(TEMPLATE_KEY_SLOT, loaded));
+      Match_Result copied = MatchGesture(loaded, work);
+
+      Template_View view;
+      CHECK(stored.store.acquire(TEMPLATE_KEY_SLOT, view));
+      Match_Result in_place = MatchTemplate(view, stored.attempt);
+      stored.store.release();
+      for (int axis = 0; axis < 3; axis++) {
+        CHECK(same_score(copied.correlation[axis], in_place.correlation[axis]));
+      }
+    }
+  }
+}
+
+TEST(matcher, features_match_bit_for_bit) {
+  for (uint8_t encoding : kEncodings) {
+    for (uint64_t seed = 1; seed <= 5; seed++) {
+      Stored stored(encoding, seed);
+      CHECK(stored.ok);
+
+      Template_View view;
+      CHECK(stored.store.acquire(TEMPLATE_KEY_SLOT, view));
+      Match_Result in_place = MatchTemplate(view, stored.attempt);
+      TemplateFeatures features;
+      CHECK(features.build(view));
+      stored.store.release();
+      Match_Result featured = MatchFeatures(features, stored.attempt);
+      CHECK(memcmp(in_place.correlation.data(), featured.correlation.data(),
+                   sizeof(in_place.correlation)) == 0);
+    }
+  }
+}
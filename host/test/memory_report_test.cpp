@@ -0,0 +1,121 @@
+/**
+ * @file memory_report_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the memory report on the gyroscope and flash writer
+ * threads: stacks with headroom and unlock attempts that keep no heap.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <vector>
+
+#include "arena.h"
+#include "capture.h"
+#include "fixtures.h"
+#include "flash_writer.h"
+#include "gyro_source.h"
+#include "matcher.h"
+#include "memory_report.h"
+#include "sentry_test.h"
+#include "template_features.h"
+#include "template_store.h"
+#include "utilities.h"
+
+namespace {
+
+const uint16_t kRate = GYRO_SAMPLE_RATE_HZ / RECORDING_DECIMATION;
+const int kAttempts = 6;
+
+MBED_ALIGN(8) unsigned char gyroscope_stack[GYROSCOPE_STACK_SIZE];
+
+struct Session {
+  TemplateStore store;
+  FlashWriter *writer;
+  TemplateFeatures features;
+  std::vector<Memory_Attempt> results;
+
+  Session() : features(&SdramArena(ARENA_TEMPLATE)) {}
+};
+
+// One recording into the capture arena; the source is gone before the
+// attempt ends, as in gyroscope_thread()
+void record(ArenaSamples &samples, bool genuine, uint32_t seed) {
+  SyntheticGyroSource source(fixtures::gesture(genuine),
+                             synth::typical_variation(), seed);
+  Gyroscope_Calibration calibration;
+  fixtures::calibrate(source, calibration);
+  RecordGesture(source, calibration, RECORDING_SAMPLES, samples);
+  trim_gyro_data(samples);
+}
+
+// Enrolls a key, then unlock attempts as gyroscope_thread() makes them
+void gyroscope_thread(Session *session) {
+  vector<array<float, 3>> gesture_key;
+  vector<array<float, 3>> unlocking_record;
+
+  for (int i = 0; i <= kAttempts; i++) {
+    SdramArena(ARENA_CAPTURE).reset();
+    ArenaSamples temp_key{
+        ArenaAllocator<array<float, 3>>(SdramArena(ARENA_CAPTURE))};
+    MemoryAttemptBegin();
+
+    record(temp_key, i % 2 == 0, 1 + i);
+    if (i == 0) {
+      gesture_key.assign(temp_key.begin(), temp_key.end());
+      session->writer->persist(TEMPLATE_KEY_SLOT, gesture_key, kRate);
+      session->writer->flush();
+      vector<array<float, 3>>().swap(gesture_key);
+      Template_View stored;
+      if (session->store.acquire(TEMPLATE_KEY_SLOT, stored)) {
+        session->features.build(stored);
+        session->store.release();
+      }
+    } else {
+      unlocking_record.assign(temp_key.begin(), temp_key.end());
+      MatchFeatures(session->features, unlocking_record);
+      unlocking_record.clear();
+    }
+    session->results.push_back(MemoryAttemptEnd());
+  }
+}
+
+}  // namespace
+
+TEST(memory_report, attempts_fit_their_stacks_and_keep_no_heap) {
+  CHECK(SdramArenaInit());
+  flash_emulator_erase_all();
+  Session session;
+  session.results.reserve(kAttempts + 1);
+  CHECK(session.store.mount());
+
+  FlashWriter writer(session.store);
+  session.writer = &writer;
+  MemoryWatchStack("flash writer", writer.stack(), writer.stack_size());
+  writer.start();
+  Thread gyroscope(osPriorityNormal, sizeof(gyroscope_stack), gyroscope_stack,
+                   "gyroscope");
+  MemoryWatchStack("gyroscope", gyroscope_stack, sizeof(gyroscope_stack));
+  gyroscope.start([&session] { gyroscope_thread(&session); });
+  gyroscope.join();
+  writer.flush();
+
+  // A stack used to its last byte may have overflowed
+  CHECK(MemoryStackUsed(gyroscope_stack, sizeof(gyroscope_stack)) <
+        sizeof(gyroscope_stack));
+  CHECK(MemoryStackUsed(writer.stack(), writer.stack_size()) <
+        writer.stack_size());
+
+  // unlocking_record keeps its capacity, at most one full recording
+  long kept = 0;
+  for (size_t i = 1; i < session.results.size(); i++) {
+    kept += session.results[i].growth;
+  }
+  CHECK_EQ(session.results.size(), (size_t)kAttempts + 1);
+  CHECK(kept <= (long)(RECORDING_SAMPLES * sizeof(array<float, 3>) + 64));
+}
@@ -0,0 +1,135 @@
+/**
+ * @file rate_plot_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the rate plot on the framebuffer emulator: the scrolled
+ * plot matches one redrawn whole, and it never costs a sample.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <vector>
+
+#include "capture.h"
+#include "fixtures.h"
+#include "profiler.h"
+#include "rate_plot.h"
+#include "sentry_test.h"
+
+namespace {
+
+const uint32_t kSamplePeriodUs = 1000000 / GYRO_SAMPLE_RATE_HZ;
+
+// Stands in for the sensor's pacing: refreshes the display every third
+// sample and times the gaps between reads. Given a plot, it also redraws it
+// whole after each of its frames.
+class PacedSource : public GyroSource {
+ public:
+  PacedSource(GyroSource &inner, LCD_DISCO_F429ZI &lcd, RatePlot *redrawn)
+      : inner_(inner),
+        lcd_(lcd),
+        redrawn_(redrawn),
+        samples_(0),
+        frames_(0),
+        returned_(0),
+        max_gap_us_(0) {}
+
+  bool init(const Gyroscope_Init_Parameters &params) override {
+    return inner_.init(params);
+  }
+  float sensitivity() const override { return inner_.sensitivity(); }
+
+  bool read(Gyroscope_RawData &sample) override {
+    if (returned_ != 0) {
+      uint32_t gap = (ProfilerNow() - returned_) / ProfilerTicksPerUs();
+      max_gap_us_ = max(max_gap_us_, gap);
+    }
+    if (++samples_ % 3 == 0) lcd_.vblank();
+    if (redrawn_ != nullptr && redrawn_->stats().frames != frames_) {
+      if (lcd_.ReloadPending()) lcd_.vblank();
+      redrawn_->redraw();
+      frames_ = redrawn_->stats().frames;
+    }
+    bool ok = inner_.read(sample);
+    returned_ = ProfilerNow();
+    return ok;
+  }
+
+  uint32_t max_gap_us() const { return max_gap_us_; }
+
+ private:
+  GyroSource &inner_;
+  LCD_DISCO_F429ZI &lcd_;
+  RatePlot *redrawn_;
+  uint32_t samples_;
+  uint32_t frames_;    // of redrawn_, at the last redraw
+  uint32_t returned_;  // ProfilerNow() when the last read returned
+  uint32_t max_gap_us_;
+};
+
+struct Run {
+  uint32_t max_gap_us;
+  Rate_Plot_Stats stats;
+  std::vector<uint32_t> window;  // the plot on screen at the end
+};
+
+// One recording through PlottingGyroSource, as the gyroscope thread makes
+// it; redraw: redraw the plot whole after every frame
+Run record(uint32_t seed, bool redraw) {
+  LCD_DISCO_F429ZI lcd;
+  lcd.set_refresh_us(0);
+  lcd.Clear(LCD_COLOR_BLACK);
+  FrameBuffers buffers(lcd, DISPLAY_FRONT_BUFFER, DISPLAY_BACK_BUFFER);
+  buffers.enable();
+  RatePlot plot(lcd, buffers, 0, RATE_PLOT_Y, lcd.GetXSize(),
+                RATE_PLOT_HEIGHT);
+
+  SyntheticGyroSource synthetic(fixtures::gesture(),
+                                synth::typical_variation(), seed);
+  PacedSource paced(synthetic, lcd, redraw ? &plot : nullptr);
+  PlottingGyroSource source(paced, plot);
+  Gyroscope_Calibration calibration;
+  fixtures::calibrate(source, calibration);
+
+  source.begin(calibration);
+  std::vector<array<float, 3>> samples;
+  RecordGesture(source, calibration, RECORDING_SAMPLES, samples);
+  lcd.set_refresh_us(DISPLAY_REFRESH_US);  // end() waits for flips
+  source.end();
+
+  Run run;
+  run.max_gap_us = paced.max_gap_us();
+  run.stats = plot.stats();
+  while (lcd.ReloadPending()) {
+    ThisThread::sleep_for(std::chrono::milliseconds(1));
+  }
+  const uint32_t *frame = lcd.scanout();
+  for (uint32_t y = RATE_PLOT_Y; y < RATE_PLOT_Y + RATE_PLOT_HEIGHT; y++) {
+    run.window.insert(run.window.end(), frame + y * lcd.GetXSize(),
+                      frame + (y + 1) * lcd.GetXSize());
+  }
+  return run;
+}
+
+}  // namespace
+
+TEST(rate_plot, scrolled_plot_matches_a_redrawn_one) {
+  for (uint32_t seed = 1; seed <= 2; seed++) {
+    Run scrolled = record(seed, false);
+    Run full = record(seed, true);
+    CHECK(scrolled.stats.frames > 0);
+    CHECK_EQ(scrolled.stats.dropped, 0u);
+    CHECK(scrolled.window == full.window);
+  }
+}
+
+TEST(rate_plot, frames_fit_between_two_reads) {
+  Run run = record(1, false);
+  CHECK(run.stats.columns > 0);
+  CHECK(run.max_gap_us < kSamplePeriodUs);
+}
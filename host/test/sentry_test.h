@@ -0,0 +1,70 @@
+/**
+ * @file sentry_test.h
+ * @author Xhovani Mali (xxm202)
+ * @brief A minimal test harness for the host build: test cases registered
+ * per suite, checks that record a failure and carry on.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * A test is a function declared with TEST(suite, name) in any file linked
+ * into sentry_tests. `sentry_tests SUITE` runs the suite's tests, with no
+ * argument every test; the exit status is 1 if any check failed. CMake
+ * registers one ctest entry per suite.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef SENTRY_TEST_H
+#define SENTRY_TEST_H
+
+#include <cmath>
+#include <cstdio>
+
+namespace sentry_test {
+
+typedef void (*Test_Function)();
+
+// Adds a test to the registry; returns a dummy for a static initializer
+int add(const char *suite, const char *name, Test_Function function);
+
+// Records a failed check of the running test
+void fail(const char *file, int line, const char *message);
+
+}  // namespace sentry_test
+
+#define TEST(suite, name)                                               \
+  static void suite##_##name();                                         \
+  static int suite##_##name##_registered =                              \
+      sentry_test::add(#suite, #name, suite##_##name);                  \
+  static void suite##_##name()
+
+#define CHECK(condition)                                                \
+  do {                                                                  \
+    if (!(condition)) {                                                 \
+      sentry_test::fail(__FILE__, __LINE__, #condition);                \
+    }                                                                   \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                      \
+  do {                                                                  \
+    if (!((actual) == (expected))) {                                    \
+      sentry_test::fail(__FILE__, __LINE__, #actual " == " #expected);  \
+    }                                                                   \
+  } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                         \
+  do {                                                                  \
+    if (!(std::fabs((double)(actual) - (double)(expected)) <=           \
+          (double)(tolerance))) {                                       \
+      char message[160];                                                \
+      snprintf(message, sizeof(message), "%s == %s (%g vs %g)",         \
+               #actual, #expected, (double)(actual),                    \
+               (double)(expected));                                     \
+      sentry_test::fail(__FILE__, __LINE__, message);                   \
+    }                                                                   \
+  } while (0)
+
+#endif  // SENTRY_TEST_H
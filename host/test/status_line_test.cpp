@@ -0,0 +1,101 @@
+/**
+ * @file status_line_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the status line on the framebuffer emulator: the frame
+ * after every message matches a full redraw of the strip.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "fixtures.h"
+#include "sentry_test.h"
+#include "status_line.h"
+
+namespace {
+
+// Two displays as main() leaves them before the first message: one
+// redrawn whole as display_status() did before StatusLine, one diffed
+struct Displays {
+  Displays() : line(diffed, STATUS_TEXT_X, STATUS_TEXT_Y) {
+    full.Clear(LCD_COLOR_BLACK);
+    diffed.Clear(LCD_COLOR_BLACK);
+  }
+
+  // One message on both; false if the frames differ
+  bool show(const char *text, uint32_t color) {
+    full.SetTextColor(LCD_COLOR_BLACK);
+    full.FillRect(0, STATUS_TEXT_Y, full.GetXSize(), FONT_SIZE);
+    full.SetTextColor(color);
+    full.DisplayStringAt(STATUS_TEXT_X, STATUS_TEXT_Y, (uint8_t *)text,
+                         CENTER_MODE);
+    line.show(text, color);
+    size_t bytes = full.GetXSize() * full.GetYSize() * sizeof(uint32_t);
+    return memcmp(full.frame(), diffed.frame(), bytes) == 0;
+  }
+
+  LCD_DISCO_F429ZI full;
+  LCD_DISCO_F429ZI diffed;
+  StatusLine line;
+};
+
+}  // namespace
+
+TEST(status_line, firmware_messages_match_a_full_redraw) {
+  // An enrollment, a failed and a successful unlock, an erase, the prompts
+  std::vector<Status_Message> messages = {STATUS_MESSAGES[STATUS_NO_KEY]};
+  for (int attempt = 0; attempt < 3; attempt++) {
+    std::vector<Status_Message> recording = fixtures::recording_messages();
+    messages.insert(messages.end(), recording.begin(), recording.end());
+    Status_Message_Id outcome[] = {STATUS_SAVING_KEY, STATUS_KEY_SAVED};
+    if (attempt > 0) {
+      outcome[0] = STATUS_UNLOCKING;
+      outcome[1] = attempt == 1 ? STATUS_UNLOCK_FAILED : STATUS_UNLOCK_SUCCESS;
+    }
+    for (Status_Message_Id id : outcome) {
+      messages.push_back(STATUS_MESSAGES[id]);
+    }
+  }
+  for (Status_Message_Id id :
+       {STATUS_ERASING, STATUS_KEY_ERASED, STATUS_ALL_ERASED,
+        STATUS_RECORD_INITIATED, STATUS_UNLOCK_INITIATED}) {
+    messages.push_back(STATUS_MESSAGES[id]);
+  }
+
+  Displays displays;
+  for (const Status_Message &m : messages) {
+    CHECK(displays.show(m.text, m.color));
+  }
+  CHECK(displays.line.stats().glyphs_kept > 0);
+}
+
+TEST(status_line, random_texts_match_a_full_redraw) {
+  Displays displays;
+  std::mt19937 rng(1);
+  const uint32_t colors[] = {LCD_COLOR_GREEN, LCD_COLOR_RED, LCD_COLOR_ORANGE,
+                             LCD_COLOR_YELLOW};
+  const char alphabet[] = "  ....0123ACEGIKLNORSUaegiknorsu:";
+  int mismatches = 0;
+  // Over-long texts included, and now and then another background
+  for (int i = 0; i < 500; i++) {
+    std::string text(rng() % 25, ' ');
+    for (char &c : text) c = alphabet[rng() % (sizeof(alphabet) - 1)];
+    if (i % 97 == 0) {
+      displays.diffed.SetBackColor(rng() % 2 ? LCD_COLOR_WHITE
+                                             : LCD_COLOR_BLACK);
+    }
+    displays.full.SetBackColor(displays.diffed.GetBackColor());
+    mismatches += !displays.show(text.c_str(), colors[rng() % 4]);
+  }
+  CHECK_EQ(mismatches, 0);
+}
@@ -0,0 +1,192 @@
+/**
+ * @file template_store_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the template store on the flash emulator: a remount after
+ * many writes and deletes, and sector sequences torn by a reset.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <vector>
+
+#include "fixtures.h"
+#include "gesture_synth.h"
+#include "sentry_test.h"
+#include "template_codec.h"
+#include "template_store.h"
+
+namespace {
+
+typedef std::vector<std::array<float, 3>> Gesture;
+
+const uint32_t kSequenceOffset = offsetof(Template_Sector_Header, sequence);
+
+uint32_t sector_address(int s) {
+  FlashIAP flash;
+  uint32_t address = TEMPLATE_STORE_ADDRESS;
+  for (int i = 0; i < s; i++) address += flash.get_sector_size(address);
+  return address;
+}
+
+uint32_t sector_sequence(int s) {
+  uint32_t sequence;
+  memcpy(&sequence, flash_emulator_memory(sector_address(s) + kSequenceOffset),
+         sizeof(sequence));
+  return sequence;
+}
+
+// What a reset while open_sector() programs the word leaves behind
+void program_sequence(int s, uint32_t sequence) {
+  FlashIAP flash;
+  flash.init();
+  flash.program(&sequence, sector_address(s) + kSequenceOffset,
+                sizeof(sequence));
+}
+
+int free_sector() {
+  for (int s = 0; s < TEMPLATE_STORE_SECTORS; s++) {
+    if (sector_sequence(s) == TEMPLATE_UNUSED) return s;
+  }
+  return -1;
+}
+
+// A sector that reads as free must not hold records, or the next mount
+// loses them
+bool free_sectors_are_empty() {
+  for (int s = 0; s < TEMPLATE_STORE_SECTORS; s++) {
+    uint32_t word;
+    memcpy(&word,
+           flash_emulator_memory(sector_address(s) +
+                                 sizeof(Template_Sector_Header)),
+           sizeof(word));
+    if (sector_sequence(s) == TEMPLATE_UNUSED && word != TEMPLATE_UNUSED) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// What read() returns for a template written with an encoding
+Gesture stored_form(const Gesture &samples, uint8_t encoding) {
+  if (encoding != TEMPLATE_ENCODING_DELTA) return samples;
+  std::vector<uint8_t> encoded;
+  Gesture decoded;
+  TemplateEncode(samples, TEMPLATE_QUANTUM, encoded);
+  TemplateDecode(encoded.data(), encoded.size(), decoded);
+  return decoded;
+}
+
+}  // namespace
+
+TEST(template_store, every_slot_survives_a_remount) {
+  const uint8_t encodings[] = {TEMPLATE_ENCODING_FLOAT32,
+                               TEMPLATE_ENCODING_DELTA};
+  for (uint8_t encoding : encodings) {
+    flash_emulator_erase_all();
+    synth::Rng rng(1);
+    std::vector<Gesture> shadow(TEMPLATE_SLOTS);
+    {
+      TemplateStore store;
+      store.set_encoding(encoding);
+      CHECK(store.mount());
+      // Enrollments in random slots and deletions, maintain() between
+      // them as the main loop calls it; enough to compact every sector
+      for (int i = 0; i < 200; i++) {
+        uint8_t slot = rng.next() % TEMPLATE_SLOTS;
+        if (rng.uniform() < 0.1f) {
+          CHECK(store.remove(slot));
+          shadow[slot].clear();
+        } else {
+          Gesture samples;
+          synth::generate(synth::random_spec(rng), synth::typical_variation(),
+                          rng.next(), samples);
+          samples.resize(std::max<size_t>(
+              20, std::min<size_t>(samples.size(), RECORDING_SAMPLES)));
+          CHECK(store.write(slot, samples, 20));
+          shadow[slot] = stored_form(samples, encoding);
+        }
+        store.maintain();
+      }
+      CHECK(store.stats().compactions > 0);
+    }
+
+    TemplateStore remounted;
+    CHECK(remounted.mount());
+    for (uint8_t slot = 0; slot < TEMPLATE_SLOTS; slot++) {
+      Gesture loaded;
+      bool present = remounted.read(slot, loaded);
+      CHECK_EQ(present, !shadow[slot].empty());
+      CHECK(!present || loaded == shadow[slot]);
+    }
+  }
+}
+
+TEST(template_store, torn_sequence_is_reclaimed) {
+  flash_emulator_erase_all();
+  {
+    TemplateStore store;
+    store.set_encoding(TEMPLATE_ENCODING_FLOAT32);
+    CHECK(store.mount());
+    CHECK(store.write(0, fixtures::key(50, 1.0f), 100));
+    CHECK(store.write(1, fixtures::key(50, 2.0f), 100));
+  }
+  // The next sector's sequence (2) lost its top byte's zero bits
+  int torn = free_sector();
+  CHECK(torn >= 0);
+  program_sequence(torn, 0xFF000002u);
+
+  TemplateStore store;
+  store.set_encoding(TEMPLATE_ENCODING_FLOAT32);
+  CHECK(store.mount());
+  CHECK_EQ(sector_sequence(torn), TEMPLATE_UNUSED);
+  Gesture samples;
+  CHECK(store.read(1, samples));
+  CHECK(samples == fixtures::key(50, 2.0f));
+
+  // The log carries on from the sequences that are really in use
+  for (int i = 0; i < 30; i++) {
+    CHECK(store.write(i % TEMPLATE_SLOTS, fixtures::key(300, (float)i), 100));
+    store.maintain();
+  }
+  for (int s = 0; s < TEMPLATE_STORE_SECTORS; s++) {
+    uint32_t sequence = sector_sequence(s);
+    CHECK(sequence == TEMPLATE_UNUSED || sequence < 0x1000);
+  }
+}
+
+TEST(template_store, sequence_never_reaches_the_erased_value) {
+  flash_emulator_erase_all();
+  {
+    TemplateStore store;
+    CHECK(store.mount());
+  }
+  // The only sector in use, one short of the erased value: opening the
+  // next sector would program TEMPLATE_UNUSED and leave it looking free
+  program_sequence(0, TEMPLATE_UNUSED - 1);
+
+  {
+    TemplateStore store;
+    store.set_encoding(TEMPLATE_ENCODING_FLOAT32);
+    CHECK(store.mount());
+    for (int i = 0; i < 30; i++) {
+      CHECK(store.write(i % TEMPLATE_SLOTS, fixtures::key(300, (float)i), 100));
+      store.maintain();
+      CHECK(free_sectors_are_empty());
+    }
+  }
+
+  TemplateStore store;
+  CHECK(store.mount());
+  for (int slot = 0; slot < TEMPLATE_SLOTS; slot++) {
+    int last = slot + (29 - slot) / 4 * 4;  // the slot's last write
+    Gesture samples;
+    CHECK(store.read(slot, samples));
+    CHECK(samples == fixtures::key(300, (float)last));
+  }
+}
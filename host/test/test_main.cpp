@@ -0,0 +1,74 @@
+/**
+ * @file test_main.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Test registry and runner of sentry_tests.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage: sentry_tests [SUITE]
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cstring>
+#include <vector>
+
+#include "sentry_test.h"
+
+namespace sentry_test {
+
+namespace {
+
+struct Test_Case {
+  const char *suite;
+  const char *name;
+  Test_Function function;
+};
+
+// Filled by static initializers, hence a function-local registry
+std::vector<Test_Case> &registry() {
+  static std::vector<Test_Case> tests;
+  return tests;
+}
+
+int g_failures;  // failed checks of the running test
+
+}  // namespace
+
+int add(const char *suite, const char *name, Test_Function function) {
+  registry().push_back({suite, name, function});
+  return 0;
+}
+
+void fail(const char *file, int line, const char *message) {
+  printf("  %s:%d: check failed: %s\n", file, line, message);
+  g_failures++;
+}
+
+}  // namespace sentry_test
+
+int main(int argc, char **argv) {
+  using namespace sentry_test;
+  const char *suite = argc > 1 ? argv[1] : nullptr;
+  int run = 0;
+  int failed = 0;
+  for (const Test_Case &test : registry()) {
+    if (suite != nullptr && strcmp(test.suite, suite) != 0) continue;
+    g_failures = 0;
+    test.function();
+    printf("%-4s %s.%s\n", g_failures == 0 ? "ok" : "FAIL", test.suite,
+           test.name);
+    fflush(stdout);
+    run++;
+    failed += g_failures != 0 ? 1 : 0;
+  }
+  if (run == 0) {
+    printf("no tests in suite %s\n", suite != nullptr ? suite : "(all)");
+    return 1;
+  }
+  printf("%d tests, %d failed\n", run, failed);
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file touch_input_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the interrupt-driven touch input on the STMPE811
+ * emulator: one press and one release per bouncing tap, in time and in
+ * place, nothing for brushes or an idle screen.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "sentry_test.h"
+#include "touch_input.h"
+
+namespace {
+
+const uint32_t kTapPeriodUs = 1200000;
+const uint32_t kFirstTapUs = 100000;
+const uint32_t kLatencyLimitUs = (TOUCH_PRESS_MS + 25) * 1000;
+
+struct Tap {
+  uint32_t at_us;  // first contact
+  uint16_t x;
+  uint16_t y;
+};
+
+struct Seen {
+  Touch_Event_Type type;
+  uint16_t x;
+  uint16_t y;
+  uint32_t at_us;  // script time it came
+};
+
+struct Result {
+  std::vector<Seen> seen;
+  Ts_Emulator_Stats bus;
+};
+
+// Taps 1.2 s apart, each a finger that bounces as it lands and lifts,
+// with a 2 ms brush between two taps
+std::vector<Ts_Emulator_Step> make_script(int taps, std::vector<Tap> &placed) {
+  std::mt19937 rng(1);
+  std::vector<Ts_Emulator_Step> script;
+  for (int i = 0; i < taps; i++) {
+    Tap tap;
+    tap.at_us = kFirstTapUs + i * kTapPeriodUs;
+    tap.x = 10 + rng() % 220;
+    tap.y = 10 + rng() % 300;
+    uint32_t hold_us = 80000 + rng() % 120000;
+    uint32_t t = tap.at_us;
+    script.push_back({t, 1, tap.x, tap.y});
+    script.push_back({t + 1000, 0, 0, 0});
+    script.push_back({t + 1500, 1, tap.x, tap.y});
+    script.push_back({t + hold_us, 0, 0, 0});
+    script.push_back({t + hold_us + 2000, 1, tap.x, tap.y});
+    script.push_back({t + hold_us + 3000, 0, 0, 0});
+    placed.push_back(tap);
+
+    uint32_t brush = t + kTapPeriodUs / 2;
+    script.push_back({brush, 1, (uint16_t)(rng() % 240),
+                      (uint16_t)(rng() % 320)});
+    script.push_back({brush + 2000, 0, 0, 0});
+  }
+  script.push_back({kFirstTapUs + taps * kTapPeriodUs, 0, 0, 0});
+  return script;
+}
+
+// The script played in real time to TouchInput on a thread, as the touch
+// thread waits on it
+Result play(const std::vector<Ts_Emulator_Step> &script) {
+  TS_DISCO_F429ZI ts;
+  Mutex i2c_bus;
+  TouchInput input(ts, i2c_bus);
+  Result result;
+  if (!input.init(240, 320)) return result;
+  ts.reset_stats();
+  std::thread consumer([&]() {
+    Touch_Event event;
+    while (input.wait(event)) {
+      result.seen.push_back({event.type, event.x, event.y, ts.script_us()});
+    }
+  });
+  ts.play(script);
+  ts.finish();
+  std::this_thread::sleep_for(std::chrono::milliseconds(TOUCH_RELEASE_MS * 2));
+  input.stop();
+  consumer.join();
+  result.bus = ts.stats();
+  return result;
+}
+
+}  // namespace
+
+TEST(touch_input, one_press_and_release_per_tap) {
+  const int taps = 3;
+  std::vector<Tap> placed;
+  Result result = play(make_script(taps, placed));
+
+  // Presses go to the tap they fall in, from its first contact to the next
+  std::vector<int> hits(taps, 0);
+  int releases = 0;
+  for (const Seen &seen : result.seen) {
+    if (seen.type == TOUCH_RELEASE) {
+      releases++;
+      continue;
+    }
+    int tap = -1;
+    for (int t = 0; t < taps; t++) {
+      if (seen.at_us >= placed[t].at_us &&
+          seen.at_us < placed[t].at_us + kTapPeriodUs) {
+        tap = t;
+      }
+    }
+    CHECK(tap >= 0);
+    if (tap < 0) continue;
+    hits[tap]++;
+    CHECK_EQ(seen.x, placed[tap].x);
+    CHECK_EQ(seen.y, placed[tap].y);
+    CHECK(seen.at_us - placed[tap].at_us < kLatencyLimitUs);
+  }
+  for (int t = 0; t < taps; t++) CHECK_EQ(hits[t], 1);
+  CHECK_EQ(releases, taps);
+  CHECK(result.bus.interrupts > 0);
+}
+
+TEST(touch_input, idle_screen_reads_nothing) {
+  std::vector<Ts_Emulator_Step> script = {{300000, 0, 0, 0}};
+  Result result = play(script);
+  CHECK(result.seen.empty());
+  CHECK_EQ(result.bus.bytes, (uint64_t)0);
+}
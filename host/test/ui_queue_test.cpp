@@ -0,0 +1,112 @@
+/**
+ * @file ui_queue_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the lock-free UI queue: every command of concurrent
+ * producers comes out once, each producer's in order.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "sentry_test.h"
+#include "ui_queue.h"
+
+namespace {
+
+const int kProducers = 4;
+const int kCommands = 20000;
+
+// Numbered in order and marked with the producer, retried while full
+void produce(UiQueue &queue, int p, std::atomic<int> &running) {
+  Ui_Command command;
+  memset(&command, 0, sizeof(command));
+  command.type = UI_COMMAND_STATUS;
+  command.leds = (uint8_t)p;
+  for (int i = 0; i < kCommands; i++) {
+    command.color = (uint32_t)i;
+    snprintf(command.text, sizeof(command.text), "%d:%d", p, i);
+    while (!queue.push(command)) std::this_thread::yield();
+  }
+  running--;
+}
+
+}  // namespace
+
+TEST(ui_queue, single_push_and_pop) {
+  UiQueue queue;
+  Ui_Command command, popped;
+  memset(&command, 0, sizeof(command));
+  command.type = UI_COMMAND_PROGRESS;
+  command.progress = 42;
+  CHECK(!queue.pop(popped));
+  CHECK(queue.push(command));
+  CHECK(queue.pop(popped));
+  CHECK_EQ(popped.type, (uint8_t)UI_COMMAND_PROGRESS);
+  CHECK_EQ(popped.progress, 42);
+  CHECK(!queue.pop(popped));
+}
+
+TEST(ui_queue, full_queue_refuses_a_push) {
+  UiQueue queue;
+  Ui_Command command;
+  memset(&command, 0, sizeof(command));
+  for (int i = 0; i < UI_QUEUE_DEPTH; i++) CHECK(queue.push(command));
+  CHECK(!queue.push(command));
+  CHECK(queue.pop(command));
+  CHECK(queue.push(command));
+  CHECK_EQ(queue.stats().rejected, 1u);
+}
+
+TEST(ui_queue, producers_in_order_and_nothing_lost) {
+  UiQueue queue;
+  std::atomic<int> running(kProducers);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < kProducers; p++) {
+    threads.emplace_back(produce, std::ref(queue), p, std::ref(running));
+  }
+
+  std::vector<uint32_t> next(kProducers, 0);
+  uint32_t popped = 0;
+  int wrong = 0;
+  Ui_Command command;
+  while (true) {
+    bool done = running.load() == 0;  // before the last pop
+    if (queue.pop(command)) {
+      char text[UI_STATUS_TEXT];
+      snprintf(text, sizeof(text), "%d:%lu", command.leds,
+               (unsigned long)command.color);
+      if (command.leds >= kProducers || command.color != next[command.leds] ||
+          strcmp(text, command.text) != 0) {
+        wrong++;
+      } else {
+        next[command.leds]++;
+      }
+      popped++;
+    } else if (done) {
+      break;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  for (std::thread &t : threads) t.join();
+
+  CHECK_EQ(wrong, 0);
+  for (int p = 0; p < kProducers; p++) {
+    CHECK_EQ(next[p], (uint32_t)kCommands);
+  }
+  Ui_Queue_Stats stats = queue.stats();
+  CHECK_EQ(popped, (uint32_t)(kProducers * kCommands));
+  CHECK_EQ(stats.pushed, popped);
+  CHECK_EQ(stats.popped, popped);
+}
@@ -0,0 +1,168 @@
+/**
+ * @file ui_renderer_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the UI renderer on the framebuffer emulator: the latest
+ * state of each kind survives a full queue, and concurrent producers end
+ * on the last state posted.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "frame_buffers.h"
+#include "sentry_test.h"
+#include "status_line.h"
+#include "ui_renderer.h"
+
+namespace {
+
+// A display with the firmware's status line and frame buffers
+struct Display {
+  Display()
+      : line(lcd, STATUS_TEXT_X, STATUS_TEXT_Y),
+        buffers(lcd, DISPLAY_FRONT_BUFFER, DISPLAY_BACK_BUFFER),
+        green(LED1),
+        red(LED2),
+        ui(lcd, buffers, line, green, red) {
+    lcd.set_refresh_us(0);
+    lcd.SetFont(&Font16);
+    lcd.Clear(LCD_COLOR_BLACK);
+    buffers.enable();
+  }
+
+  std::vector<uint32_t> screen() {
+    lcd.vblank();
+    const uint32_t *pixels = lcd.scanout();
+    return std::vector<uint32_t>(pixels, pixels + 240 * 320);
+  }
+
+  LCD_DISCO_F429ZI lcd;
+  StatusLine line;
+  FrameBuffers buffers;
+  DigitalOut green;
+  DigitalOut red;
+  UiRenderer ui;
+};
+
+const uint32_t kColors[] = {LCD_COLOR_GREEN, LCD_COLOR_ORANGE, LCD_COLOR_RED,
+                            LCD_COLOR_BLUE};
+
+// A producer's commands at random
+void produce(UiRenderer &ui, int p, int commands) {
+  std::mt19937 rng(1 + p);
+  for (int i = 0; i < commands; i++) {
+    switch (rng() % 3) {
+      case 0: {
+        char text[UI_STATUS_TEXT];
+        snprintf(text, sizeof(text), "Producer %d: %d", p, i);
+        ui.status(text, kColors[rng() % 4]);
+        break;
+      }
+      case 1:
+        ui.leds(rng() % 4);
+        break;
+      default:
+        ui.progress(rng() % 4 == 0 ? UI_PROGRESS_HIDDEN : rng() % 1001);
+        break;
+    }
+    if (rng() % 64 == 0) std::this_thread::yield();
+  }
+}
+
+void post_last(UiRenderer &ui) {
+  const Status_Message &last = STATUS_MESSAGES[STATUS_UNLOCK_SUCCESS];
+  ui.status(last.text, last.color);
+  ui.leds(UI_LED_GREEN);
+  ui.progress(600);
+}
+
+}  // namespace
+
+TEST(ui_renderer, latest_state_survives_a_full_queue) {
+  Display display;
+  // Nothing is taken until render(): the queue fills after UI_QUEUE_DEPTH
+  const int posts = 4 * UI_QUEUE_DEPTH;
+  for (int i = 0; i < posts; i++) {
+    char text[UI_STATUS_TEXT];
+    snprintf(text, sizeof(text), "Status %d", i);
+    CHECK(display.ui.status(text, LCD_COLOR_ORANGE));
+    CHECK(display.ui.leds(i % 2 == 0 ? UI_LED_RED : UI_LED_GREEN));
+    CHECK(display.ui.progress((uint16_t)(i * 10)));
+  }
+  CHECK(display.ui.stats().overflowed > 0);
+  CHECK(display.ui.render() > 0);
+
+  Display reference;
+  char last[UI_STATUS_TEXT];
+  snprintf(last, sizeof(last), "Status %d", posts - 1);
+  reference.ui.status(last, LCD_COLOR_ORANGE);
+  reference.ui.progress((uint16_t)((posts - 1) * 10));
+  reference.ui.render();
+  CHECK(display.screen() == reference.screen());
+  CHECK_EQ(display.green.read(), 1);
+  CHECK_EQ(display.red.read(), 0);
+}
+
+TEST(ui_renderer, queued_commands_after_a_slot_is_taken) {
+  Display display;
+  for (int i = 0; i < 2 * UI_QUEUE_DEPTH; i++) {
+    CHECK(display.ui.status("Old", LCD_COLOR_RED));
+  }
+  display.ui.render();
+  display.lcd.vblank();
+  // The slot is empty again, so the next status is queued and drawn
+  CHECK(display.ui.status("New", LCD_COLOR_GREEN));
+  display.ui.render();
+
+  Display reference;
+  reference.ui.status("New", LCD_COLOR_GREEN);
+  reference.ui.render();
+  CHECK(display.screen() == reference.screen());
+  Ui_Queue_Stats queued = display.ui.queue_stats();
+  CHECK_EQ(queued.pushed, (uint32_t)UI_QUEUE_DEPTH + 1);
+}
+
+TEST(ui_renderer, producers_end_on_the_last_state) {
+  // The UI thread's frames wait for flips of a display refreshing in real
+  // time while four threads post
+  LCD_DISCO_F429ZI lcd;
+  StatusLine line(lcd, STATUS_TEXT_X, STATUS_TEXT_Y);
+  FrameBuffers buffers(lcd, DISPLAY_FRONT_BUFFER, DISPLAY_BACK_BUFFER);
+  DigitalOut green(LED1);
+  DigitalOut red(LED2);
+  lcd.set_refresh_us(DISPLAY_REFRESH_US);
+  lcd.SetFont(&Font16);
+  lcd.Clear(LCD_COLOR_BLACK);
+  buffers.enable();
+  UiRenderer *ui = new UiRenderer(lcd, buffers, line, green, red);
+  ui->start();
+  std::vector<std::thread> threads;
+  for (int p = 0; p < 4; p++) {
+    threads.emplace_back(produce, std::ref(*ui), p, 2000);
+  }
+  for (std::thread &t : threads) t.join();
+  post_last(*ui);
+  delete ui;  // draws what is left
+  while (lcd.ReloadPending()) {
+    std::this_thread::sleep_for(std::chrono::microseconds(lcd.refresh_us()));
+  }
+  std::vector<uint32_t> shown(lcd.scanout(), lcd.scanout() + 240 * 320);
+
+  Display reference;
+  post_last(reference.ui);
+  reference.ui.render();
+  CHECK(shown == reference.screen());
+  CHECK_EQ(green.read(), 1);
+  CHECK_EQ(red.read(), 0);
+}
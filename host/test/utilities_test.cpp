@@ -0,0 +1,235 @@
+/**
+ * @file utilities_test.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Tests of the utilities.cpp kernels: dtw, the correlation
+ * accumulator, trim_gyro_data, normalize and the moving average.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <cmath>
+#include <vector>
+
+#include "sentry_test.h"
+#include "utilities.h"
+
+namespace {
+
+typedef vector<array<float, 3>> Samples;
+
+Samples ramp(size_t n, float scale) {
+  Samples samples;
+  for (size_t i = 0; i < n; i++) {
+    float t = (float)i;
+    samples.push_back({scale * sinf(t * 0.3f), scale * cosf(t * 0.2f),
+                       scale * (t - n / 2.0f)});
+  }
+  return samples;
+}
+
+// The correlation as written before CorrelationAccumulator, for reference
+float reference_correlation(const vector<float> &a, const vector<float> &b) {
+  float sum_a = 0, sum_b = 0, sum_ab = 0, sq_sum_a = 0, sq_sum_b = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    float delta_a = a[i] - sum_a;
+    float delta_b = b[i] - sum_b;
+    sum_a += delta_a;
+    sum_b += delta_b;
+    sum_ab += delta_a * delta_b;
+    sq_sum_a += a[i] * a[i];
+    sq_sum_b += b[i] * b[i];
+  }
+  size_t n = a.size();
+  return (sum_ab - sum_a * sum_b / n) /
+         sqrtf((sq_sum_a - sum_a * sum_a / n) * (sq_sum_b - sum_b * sum_b / n));
+}
+
+}  // namespace
+
+TEST(utilities, dtw_of_identical_sequences_is_zero) {
+  Samples s = ramp(40, 100.0f);
+  CHECK_EQ(dtw(s, s), 0.0f);
+}
+
+TEST(utilities, dtw_of_small_sequences) {
+  Samples s = {{0, 0, 0}, {1, 0, 0}};
+  Samples t = {{0, 0, 0}, {2, 0, 0}};
+  // Cost matrix [[0, 2], [1, 1]]: the diagonal path costs 0 + 1
+  CHECK_NEAR(dtw(s, t), 1.0f, 1e-6f);
+  CHECK_NEAR(dtw(t, s), 1.0f, 1e-6f);
+  Samples u = {{3, 4, 0}};
+  CHECK_NEAR(dtw(u, {{0, 0, 0}}), 5.0f, 1e-6f);
+}
+
+TEST(utilities, dtw_absorbs_repeated_samples) {
+  Samples s = ramp(30, 50.0f);
+  Samples slow;
+  for (const auto &sample : s) {
+    slow.push_back(sample);
+    slow.push_back(sample);
+  }
+  CHECK_EQ(dtw(s, slow), 0.0f);
+  CHECK(dtw(s, ramp(30, 60.0f)) > 0.0f);
+}
+
+TEST(utilities, dtw_in_an_arena_matches_the_heap) {
+  Samples s = ramp(50, 80.0f);
+  Samples t = ramp(45, 90.0f);
+  vector<char> memory(64 * 1024);
+  Arena arena(memory.data(), memory.size());
+  CHECK_EQ(dtw(s, t, &arena), dtw(s, t));
+  CHECK_EQ(arena.mark(), (size_t)0);
+  // Too small for the matrix: the heap is used instead
+  Arena tiny(memory.data(), 64);
+  CHECK_EQ(dtw(s, t, &tiny), dtw(s, t));
+}
+
+TEST(utilities, dtw_stream_reports_a_short_sequence) {
+  Samples t = ramp(10, 1.0f);
+  int left = 3;
+  float distance = dtw_stream(
+      [&](array<float, 3> &sample) {
+        sample = {0, 0, 0};
+        return left-- > 0;
+      },
+      5, t.data(), t.size());
+  CHECK(std::isnan(distance));
+}
+
+TEST(utilities, correlation_rejects_bad_input) {
+  CHECK(std::isnan(correlation({1, 2, 3}, {1, 2})));
+  CHECK(std::isnan(correlation({0, 0, 0}, {0, 0, 0})));
+  CHECK(std::isnan(correlation({}, {})));
+}
+
+TEST(utilities, correlation_matches_its_reference) {
+  Samples s = ramp(64, 10.0f);
+  Samples t = ramp(64, 7.0f);
+  vector<float> a, b;
+  for (size_t i = 0; i < s.size(); i++) {
+    a.push_back(s[i][0]);
+    b.push_back(t[i][1]);
+  }
+  float expected = reference_correlation(a, b);
+  CHECK_NEAR(correlation(a, b), expected, 1e-6f);
+  CHECK_NEAR(correlation(b, a), reference_correlation(b, a), 1e-6f);
+}
+
+TEST(utilities, accumulator_add_b_matches_add) {
+  Samples s = ramp(48, 3.0f);
+  Samples t = ramp(48, 5.0f);
+  CorrelationAccumulator whole;
+  CorrelationAccumulator split;
+  // The a side's steps and sums as TemplateFeatures precomputes them
+  float sum_a = 0.0f, sq_sum_a = 0.0f;
+  bool a_varies = false;
+  for (size_t i = 0; i < s.size(); i++) {
+    float a = s[i][2];
+    float b = t[i][0];
+    whole.add(a, b);
+    float delta_a = a - sum_a;
+    sum_a += delta_a;
+    sq_sum_a += a * a;
+    a_varies = a_varies || a != 0.0f;
+    split.add_b(delta_a, b);
+  }
+  split.set_a(sum_a, sq_sum_a, a_varies);
+  CHECK(!std::isnan(whole.result()));
+  CHECK_EQ(split.result(), whole.result());
+}
+
+TEST(utilities, correlation_vectors_trim_to_the_shorter) {
+  Samples a = ramp(30, 2.0f);
+  Samples b = ramp(20, 3.0f);
+  array<float, 3> result = calculateCorrelationVectors(a, b);
+  CHECK_EQ(a.size(), (size_t)20);
+  CHECK_EQ(b.size(), (size_t)20);
+  for (int axis = 0; axis < 3; axis++) {
+    vector<float> x, y;
+    for (size_t i = 0; i < a.size(); i++) {
+      x.push_back(a[i][axis]);
+      y.push_back(b[i][axis]);
+    }
+    CHECK_EQ(result[axis], correlation(x, y));
+  }
+}
+
+TEST(utilities, trim_drops_leading_and_trailing_rest) {
+  Samples data = {{0, 0, 0}, {0, 0, 0}, {1, 0, 0}, {0, 0, 0},
+                  {0, 2, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+  trim_gyro_data(data);
+  Samples expected = {{1, 0, 0}, {0, 0, 0}, {0, 2, 0}};
+  CHECK(data == expected);
+}
+
+TEST(utilities, trim_keeps_data_without_rest) {
+  Samples data = ramp(16, 1.0f);
+  data[0][2] = 1.0f;  // ramp() is zero on no axis here
+  Samples expected = data;
+  trim_gyro_data(data);
+  CHECK(data == expected);
+}
+
+TEST(utilities, trim_of_a_single_moving_sample) {
+  Samples data = {{0, 0, 0}, {0, 0, -3}, {0, 0, 0}};
+  trim_gyro_data(data);
+  CHECK_EQ(data.size(), (size_t)1);
+  CHECK_EQ(data[0][2], -3.0f);
+}
+
+// The forward scan used to run past the end when every sample was at rest
+TEST(utilities, trim_of_all_rest_stops_at_the_end) {
+  Samples data(64, {0.0f, 0.0f, 0.0f});
+  data[10][1] = 0.000001f;  // below the threshold
+  trim_gyro_data(data);
+  CHECK_EQ(data.size(), (size_t)64);
+  Samples empty;
+  trim_gyro_data(empty);
+  CHECK(empty.empty());
+}
+
+TEST(utilities, trim_works_on_arena_samples) {
+  vector<char> memory(4096);
+  Arena arena(memory.data(), memory.size());
+  ArenaSamples data{ArenaAllocator<array<float, 3>>(arena)};
+  data.push_back({0, 0, 0});
+  data.push_back({4, 0, 0});
+  data.push_back({0, 0, 0});
+  trim_gyro_data(data);
+  CHECK_EQ(data.size(), (size_t)1);
+  CHECK_EQ(data[0][0], 4.0f);
+  CHECK(arena.contains(data.data()));
+}
+
+TEST(utilities, normalize_scales_to_unit_length) {
+  Samples data = {{3, 4, 0}, {0, 0, 0}, {-2, 2, 1}};
+  normalize(data);
+  CHECK_NEAR(data[0][0], 0.6f, 1e-6f);
+  CHECK_NEAR(data[0][1], 0.8f, 1e-6f);
+  CHECK_EQ(data[1][0], 0.0f);
+  CHECK_EQ(data[1][1], 0.0f);
+  CHECK_EQ(data[1][2], 0.0f);
+  CHECK_NEAR(data[2][0], -2.0f / 3.0f, 1e-6f);
+  CHECK_NEAR(data[2][2], 1.0f / 3.0f, 1e-6f);
+}
+
+TEST(utilities, moving_average_over_the_window) {
+  array<float, WINDOW_SIZE> buffer = {};
+  size_t index = 0;
+  float sum = 0.0f;
+  float average = 0.0f;
+  for (int i = 1; i <= WINDOW_SIZE; i++) {
+    average = movingAverageFilter((float)i, buffer, index, sum);
+  }
+  CHECK_NEAR(average, (WINDOW_SIZE + 1) / 2.0f, 1e-6f);
+  CHECK_EQ(index, (size_t)0);
+  // The oldest value (1) leaves the window
+  average = movingAverageFilter(1.0f + WINDOW_SIZE, buffer, index, sum);
+  CHECK_NEAR(average, (WINDOW_SIZE + 3) / 2.0f, 1e-6f);
+}
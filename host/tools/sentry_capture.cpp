@@ -0,0 +1,342 @@
+/**
+ * @file sentry_capture.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host tool to record binary gyro captures from the board and replay
+ * them into the matching pipeline.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage:
+ *   sentry_capture record DEVICE OUT [--baud N] [--sessions N]
+ *   sentry_capture info FILE
+ *   sentry_capture replay FILE [--speed X] [--key N]
+ *                  (prints the stage profile when built with
+ *                  -DSENTRY_HOST_PROFILE=ON)
+ *   sentry_capture synth OUT [--sessions N] [--seed S]
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "capture_format.h"
+#include "matcher.h"
+#include "profiler.h"
+#include "utilities.h"
+
+namespace {
+
+typedef std::vector<std::array<float, 3>> Gesture;
+
+volatile sig_atomic_t g_stop = 0;
+
+void on_signal(int) { g_stop = 1; }
+
+int usage() {
+  fprintf(stderr,
+          "usage:\n"
+          "  sentry_capture record DEVICE OUT [--baud N] [--sessions N]\n"
+          "  sentry_capture info FILE\n"
+          "  sentry_capture replay FILE [--speed X] [--key N]\n"
+          "  sentry_capture synth OUT [--sessions N] [--seed S]\n");
+  return 2;
+}
+
+// Value of "--name VALUE" in argv, or fallback
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+size_t file_sink(void *context, const uint8_t *data, size_t size) {
+  return fwrite(data, 1, size, static_cast<FILE *>(context));
+}
+
+speed_t baud_constant(long baud) {
+  switch (baud) {
+    case 9600: return B9600;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default: return 0;
+  }
+}
+
+int open_serial(const char *device, long baud) {
+  int fd = open(device, O_RDONLY | O_NOCTTY);
+  if (fd < 0) {
+    perror(device);
+    return -1;
+  }
+  termios tty;
+  if (tcgetattr(fd, &tty) != 0) {
+    perror("tcgetattr");
+    close(fd);
+    return -1;
+  }
+  cfmakeraw(&tty);
+  speed_t speed = baud_constant(baud);
+  if (speed == 0) {
+    fprintf(stderr, "unsupported baud rate %ld\n", baud);
+    close(fd);
+    return -1;
+  }
+  cfsetispeed(&tty, speed);
+  cfsetospeed(&tty, speed);
+  tty.c_cc[VMIN] = 0;
+  tty.c_cc[VTIME] = 2;  // 200 ms read timeout so Ctrl-C is noticed
+  tcsetattr(fd, TCSANOW, &tty);
+  return fd;
+}
+
+// Write one parsed frame back out in wire format
+void write_frame(FILE *out, const CaptureParser &parser) {
+  uint8_t header[CAPTURE_HEADER_SIZE] = {
+      CAPTURE_SYNC_0, CAPTURE_SYNC_1, parser.type(), (uint8_t)parser.size(),
+      (uint8_t)(parser.size() >> 8)};
+  uint16_t crc = crc16_ccitt(header + 2, 3);
+  crc = crc16_ccitt(parser.payload(), parser.size(), crc);
+  uint8_t trailer[2] = {(uint8_t)crc, (uint8_t)(crc >> 8)};
+  fwrite(header, 1, sizeof(header), out);
+  fwrite(parser.payload(), 1, parser.size(), out);
+  fwrite(trailer, 1, sizeof(trailer), out);
+}
+
+/*******************************************************************************
+ * record: keep every valid frame from the serial port, drop console text
+ * ****************************************************************************/
+int cmd_record(int argc, char **argv) {
+  if (argc < 4) return usage();
+  long baud = atol(option(argc, argv, "--baud", "115200"));
+  long sessions_wanted = atol(option(argc, argv, "--sessions", "0"));
+
+  int fd = open_serial(argv[2], baud);
+  if (fd < 0) return 1;
+  FILE *out = fopen(argv[3], "wb");
+  if (out == nullptr) {
+    perror(argv[3]);
+    close(fd);
+    return 1;
+  }
+
+  signal(SIGINT, on_signal);
+  CaptureParser parser;
+  long sessions = 0;
+  unsigned long samples = 0;
+  uint8_t buffer[512];
+
+  fprintf(stderr, "recording from %s at %ld baud, Ctrl-C to stop\n", argv[2],
+          baud);
+  while (!g_stop && (sessions_wanted == 0 || sessions < sessions_wanted)) {
+    ssize_t n = read(fd, buffer, sizeof(buffer));
+    if (n < 0) {
+      perror("read");
+      break;
+    }
+    for (ssize_t i = 0; i < n; i++) {
+      if (!parser.push(buffer[i])) continue;
+      write_frame(out, parser);
+      if (parser.type() == CAPTURE_SAMPLES) {
+        samples += parser.size() > 4 ? parser.payload()[4] : 0;
+      } else if (parser.type() == CAPTURE_SESSION_END) {
+        sessions++;
+        fprintf(stderr, "session %ld complete, %lu samples so far\n",
+                sessions, samples);
+        fflush(out);
+      }
+    }
+  }
+
+  fprintf(stderr, "%ld sessions, %lu samples, %u CRC errors\n", sessions,
+          samples, (unsigned)parser.crc_errors());
+  fclose(out);
+  close(fd);
+  return 0;
+}
+
+/*******************************************************************************
+ * info: one line per session, plus the outcome of black box attempts
+ * ****************************************************************************/
+int cmd_info(int argc, char **argv) {
+  if (argc < 3) return usage();
+  SessionReplaySource source(argv[2]);
+  Gyroscope_Init_Parameters init = {ODR_200_CUTOFF_50, INT2_DRDY,
+                                    FULL_SCALE_500};
+  if (!source.init(init)) {
+    fprintf(stderr, "%s: no session found\n", argv[2]);
+    return 1;
+  }
+
+  do {
+    const Capture_Session &s = source.session();
+    size_t count = 0;
+    Gyroscope_RawData raw;
+    while (source.read(raw)) count++;
+    printf(
+        "session %u: %u Hz, %.5f dps/digit, offsets %d/%d/%d, dead-band "
+        "%d/%d/%d, %zu samples, %.3f s\n",
+        (unsigned)s.session_id, s.sample_rate_hz, s.sensitivity,
+        s.calibration.x_offset, s.calibration.y_offset, s.calibration.z_offset,
+        s.calibration.x_threshold, s.calibration.y_threshold,
+        s.calibration.z_threshold, count, source.timestamp_us() / 1e6);
+
+    // Sessions dumped from the black box carry their outcome
+    Capture_Attempt attempt;
+    if (source.attempt(attempt)) {
+      static const char *const outcomes[] = {"incomplete", "enrolled",
+                                             "unlocked", "rejected", "no key"};
+      printf("  attempt %u at %u ms: %s, x = %.3f, y = %.3f, z = %.3f, "
+             "%u axes\n",
+             (unsigned)attempt.attempt, (unsigned)attempt.uptime_ms,
+             attempt.outcome < 5 ? outcomes[attempt.outcome] : "unknown",
+             attempt.correlation[0], attempt.correlation[1],
+             attempt.correlation[2], attempt.axes_matched);
+      printf("  stages (us):");
+      for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+        if (attempt.stage_us[i] == 0) continue;
+        printf(" %s %u", ProfilerStageName((Profile_Stage)i),
+               (unsigned)attempt.stage_us[i]);
+      }
+      printf("\n");
+    }
+  } while (source.next_session());
+
+  if (source.crc_errors() > 0) {
+    printf("%u frames failed the CRC\n", (unsigned)source.crc_errors());
+  }
+  return 0;
+}
+
+/*******************************************************************************
+ * replay: run every session through record/trim and match it against a key
+ * ****************************************************************************/
+int cmd_replay(int argc, char **argv) {
+  if (argc < 3) return usage();
+  float speed = (float)atof(option(argc, argv, "--speed", "1000"));
+  long key_index = atol(option(argc, argv, "--key", "0"));
+
+  SessionReplaySource source(argv[2], speed);
+  Gyroscope_Init_Parameters init = {ODR_200_CUTOFF_50, INT2_DRDY,
+                                    FULL_SCALE_500};
+  if (!source.init(init)) {
+    fprintf(stderr, "%s: no session found\n", argv[2]);
+    return 1;
+  }
+
+  std::vector<Gesture> gestures;
+  std::vector<uint32_t> ids;
+  double captured_seconds = 0.0;
+  size_t raw_samples = 0;
+  auto start = std::chrono::steady_clock::now();
+  do {
+    Gesture gesture;
+    Capture_Stats stats;
+    RecordGesture(source, source.session().calibration, RECORDING_SAMPLES,
+                  gesture, &stats);
+    {
+      PROFILE_SCOPE(PROFILE_TRIM);
+      trim_gyro_data(gesture);
+    }
+    captured_seconds += source.timestamp_us() / 1e6;
+    raw_samples += stats.raw_samples;
+    gestures.push_back(gesture);
+    ids.push_back(source.session().session_id);
+  } while (source.next_session());
+  std::chrono::duration<double> replay_time =
+      std::chrono::steady_clock::now() - start;
+
+  printf("replayed %zu sessions (%zu raw samples, %.2f s captured) in %.4f s"
+         ", %.0fx real time\n",
+         gestures.size(), raw_samples, captured_seconds, replay_time.count(),
+         replay_time.count() > 0 ? captured_seconds / replay_time.count() : 0);
+
+  if (key_index < 0 || (size_t)key_index >= gestures.size()) {
+    fprintf(stderr, "key session %ld out of range\n", key_index);
+    return 1;
+  }
+  for (size_t i = 0; i < gestures.size(); i++) {
+    if ((long)i == key_index) continue;
+    Gesture key = gestures[key_index];  // MatchGesture modifies its inputs
+    Gesture attempt = gestures[i];
+    Match_Result match = MatchGesture(key, attempt);
+    printf("session %u vs key %u: x = %.3f, y = %.3f, z = %.3f -> %s\n",
+           (unsigned)ids[i], (unsigned)ids[key_index], match.correlation[0],
+           match.correlation[1], match.correlation[2],
+           match.unlocked ? "UNLOCK" : "FAILED");
+  }
+  if (PROFILE_ENABLED) ProfilerPrint();
+  return 0;
+}
+
+/*******************************************************************************
+ * synth: a capture file from the synthetic source, for trying the tools
+ * ****************************************************************************/
+int cmd_synth(int argc, char **argv) {
+  if (argc < 3) return usage();
+  long sessions = atol(option(argc, argv, "--sessions", "4"));
+  uint32_t seed = (uint32_t)strtoul(option(argc, argv, "--seed", "1"), 0, 0);
+
+  FILE *out = fopen(argv[2], "wb");
+  if (out == nullptr) {
+    perror(argv[2]);
+    return 1;
+  }
+  CaptureWriter writer(file_sink, out);
+  Gyroscope_Init_Parameters init = {ODR_200_CUTOFF_50, INT2_DRDY,
+                                    FULL_SCALE_500};
+  uint32_t period_us = 1000000 / GYRO_SAMPLE_RATE_HZ;
+
+  // Every session performs one gesture class
+  synth::Rng rng(seed);
+  synth::GestureSpec spec = synth::random_spec(rng);
+  synth::Variation variation = synth::typical_variation();
+
+  for (long s = 0; s < sessions; s++) {
+    SyntheticGyroSource gyro(spec, variation, (uint64_t)seed << 32 | s);
+    gyro.init(init);
+
+    Gyroscope_Calibration calibration;
+    CalibrateSource(gyro, calibration, 64);  // consumes idle samples
+    Capture_Session session = {(uint32_t)s, GYRO_SAMPLE_RATE_HZ, init.conf4,
+                               gyro.sensitivity(), calibration};
+    writer.begin_session(session);
+    Gyroscope_RawData raw;
+    for (uint32_t t = 0; gyro.read(raw); t += period_us) {
+      writer.add_sample(t, raw);
+    }
+    writer.end_session();
+  }
+  fclose(out);
+  printf("wrote %ld sessions to %s\n", sessions, argv[2]);
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) return usage();
+  std::string command = argv[1];
+  if (command == "record") return cmd_record(argc, argv);
+  if (command == "info") return cmd_info(argc, argv);
+  if (command == "replay") return cmd_replay(argc, argv);
+  if (command == "synth") return cmd_synth(argc, argv);
+  return usage();
+}
@@ -0,0 +1,341 @@
+/**
+ * @file sentry_eval.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Host tool to measure unlock accuracy (FAR/FRR/EER) over a labeled
+ * gesture corpus.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Usage:
+ *   sentry_eval MANIFEST [options]
+ *   sentry_eval --synth CLASSES PER_CLASS [options]
+ *
+ *   --threads N      workers (default: one per hardware thread)
+ *   --from T         first threshold of the sweep (default 0)
+ *   --to T           last threshold of the sweep (default 1)
+ *   --step T         threshold step (default 0.01)
+ *   --seed S         seed of the synthetic corpus (default 1)
+ *   --variation V    synthetic variation: clean or typical (default typical)
+ *   --csv FILE       write the sweep as CSV
+ *
+ * A manifest lists one capture file per line with its label:
+ *
+ *   # label  capture file
+ *   alice    captures/alice.sgc
+ *   bob      captures/bob.sgc
+ *
+ * Every session of a file is one attempt by that label and goes through
+ * RecordGesture() and trim_gyro_data() as on the board. Every unordered pair
+ * of attempts is then scored with MatchGesture(), the unlock path of
+ * main.cpp: pairs with the same label are genuine, the others impostor. At
+ * each threshold, FAR is the fraction of impostor pairs that unlock and FRR
+ * the fraction of genuine pairs that do not.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "capture_format.h"
+#include "gesture_synth.h"
+#include "matcher.h"
+#include "utilities.h"
+#include "work_pool.h"
+
+namespace {
+
+typedef std::vector<std::array<float, 3>> Gesture;
+
+struct Corpus {
+  std::vector<Gesture> gestures;
+  std::vector<int> labels;
+  std::vector<std::string> names;  // label names, indexed by label
+};
+
+struct Sweep {
+  float from, step;
+  size_t count;  // number of thresholds
+
+  float threshold(size_t j) const { return from + j * step; }
+
+  // First threshold index j with threshold(j) >= value (count if none)
+  size_t first_at_least(float value) const {
+    if (std::isnan(value) || value == -INFINITY) return 0;
+    if (value == INFINITY) return count;
+    double k = std::ceil((value - from) / step);
+    size_t j = k <= 0 ? 0 : (size_t)std::min<double>(k, count);
+    while (j > 0 && threshold(j - 1) >= value) j--;
+    while (j < count && threshold(j) < value) j++;
+    return j;
+  }
+};
+
+// Accepted-pair counts per threshold, as a difference array
+struct Tally {
+  std::vector<int64_t> genuine;
+  std::vector<int64_t> impostor;
+  size_t genuine_pairs = 0;
+  size_t impostor_pairs = 0;
+};
+
+int usage() {
+  fprintf(stderr,
+          "usage:\n"
+          "  sentry_eval MANIFEST [options]\n"
+          "  sentry_eval --synth CLASSES PER_CLASS [options]\n"
+          "options: --threads N --from T --to T --step T --seed S\n"
+          "         --variation clean|typical --csv FILE\n");
+  return 2;
+}
+
+// Value of "--name VALUE" in argv, or fallback
+const char *option(int argc, char **argv, const char *name,
+                   const char *fallback) {
+  for (int i = 0; i + 1 < argc; i++) {
+    if (strcmp(argv[i], name) == 0) return argv[i + 1];
+  }
+  return fallback;
+}
+
+int label_of(Corpus &corpus, const std::string &name) {
+  for (size_t i = 0; i < corpus.names.size(); i++) {
+    if (corpus.names[i] == name) return (int)i;
+  }
+  corpus.names.push_back(name);
+  return (int)corpus.names.size() - 1;
+}
+
+/*******************************************************************************
+ *
+ * @brief Load every session of the capture files listed in a manifest
+ *
+ * ****************************************************************************/
+bool load_manifest(const char *path, Corpus &corpus) {
+  FILE *manifest = fopen(path, "r");
+  if (manifest == nullptr) {
+    perror(path);
+    return false;
+  }
+
+  char line[1024];
+  Gyroscope_Init_Parameters init = {ODR_200_CUTOFF_50, INT2_DRDY,
+                                    FULL_SCALE_500};
+  while (fgets(line, sizeof(line), manifest) != nullptr) {
+    char name[256], file[768];
+    if (line[0] == '#' || sscanf(line, "%255s %767s", name, file) != 2) {
+      continue;
+    }
+    int label = label_of(corpus, name);
+
+    SessionReplaySource source(file);
+    if (!source.init(init)) {
+      fprintf(stderr, "%s: no session found\n", file);
+      continue;
+    }
+    do {
+      Gesture gesture;
+      RecordGesture(source, source.session().calibration, RECORDING_SAMPLES,
+                    gesture);
+      trim_gyro_data(gesture);
+      corpus.gestures.push_back(gesture);
+      corpus.labels.push_back(label);
+    } while (source.next_session());
+  }
+  fclose(manifest);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * @brief Build a corpus from the synthetic generator: `classes` random
+ * gesture classes, `per_class` performances of each
+ *
+ * ****************************************************************************/
+void load_synthetic(size_t classes, size_t per_class, uint64_t seed,
+                    const synth::Variation &variation, Corpus &corpus) {
+  synth::Rng rng(seed);
+  for (size_t c = 0; c < classes; c++) {
+    synth::GestureSpec spec = synth::random_spec(rng);
+    int label = label_of(corpus, "class" + std::to_string(c));
+    for (size_t k = 0; k < per_class; k++) {
+      Gesture gesture;
+      synth::generate(spec, variation, rng.next() | (uint64_t)rng.next() << 32,
+                      gesture, (float)GYRO_SAMPLE_RATE_HZ /
+                                   RECORDING_DECIMATION);
+      if (gesture.size() > RECORDING_SAMPLES) gesture.resize(RECORDING_SAMPLES);
+      trim_gyro_data(gesture);
+      corpus.gestures.push_back(gesture);
+      corpus.labels.push_back(label);
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * @brief Score one pair and add its accepting threshold range to a tally
+ *
+ * MatchGesture() unlocks when exactly UNLOCK_AXES_REQUIRED axes exceed the
+ * threshold. With the scores sorted c[0] >= c[1] >= c[2], that holds for
+ * thresholds in [c[R], c[R - 1]), so each pair adds +1/-1 at two indices.
+ *
+ * ****************************************************************************/
+void score_pair(const Gesture &a, const Gesture &b, const Sweep &sweep,
+                bool genuine, Tally &tally) {
+  Gesture key = a, attempt = b;  // MatchGesture modifies its inputs
+  Match_Result match = MatchGesture(key, attempt);
+
+  float c[3];
+  for (int i = 0; i < 3; i++) {
+    c[i] = std::isnan(match.correlation[i]) ? -INFINITY : match.correlation[i];
+  }
+  std::sort(c, c + 3, [](float x, float y) { return x > y; });
+
+  const int R = UNLOCK_AXES_REQUIRED;
+  float upper = R == 0 ? INFINITY : c[R - 1];
+  float lower = R >= 3 ? -INFINITY : c[R];
+  size_t lo = sweep.first_at_least(lower);
+  size_t hi = sweep.first_at_least(upper);
+
+  std::vector<int64_t> &counts = genuine ? tally.genuine : tally.impostor;
+  if (lo < hi) {
+    counts[lo]++;
+    counts[hi]--;
+  }
+  (genuine ? tally.genuine_pairs : tally.impostor_pairs)++;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) return usage();
+
+  Sweep sweep;
+  sweep.from = (float)atof(option(argc, argv, "--from", "0"));
+  float to = (float)atof(option(argc, argv, "--to", "1"));
+  sweep.step = (float)atof(option(argc, argv, "--step", "0.01"));
+  if (sweep.step <= 0 || to < sweep.from) return usage();
+  sweep.count = (size_t)std::floor((to - sweep.from) / sweep.step + 1e-4) + 1;
+  unsigned threads = (unsigned)atoi(option(argc, argv, "--threads", "0"));
+  const char *csv_path = option(argc, argv, "--csv", nullptr);
+
+  Corpus corpus;
+  auto load_start = std::chrono::steady_clock::now();
+  if (strcmp(argv[1], "--synth") == 0) {
+    if (argc < 4) return usage();
+    std::string kind = option(argc, argv, "--variation", "typical");
+    synth::Variation variation = kind == "clean" ? synth::clean_variation()
+                                                 : synth::typical_variation();
+    load_synthetic(strtoul(argv[2], nullptr, 10), strtoul(argv[3], nullptr, 10),
+                   strtoull(option(argc, argv, "--seed", "1"), nullptr, 0),
+                   variation, corpus);
+  } else if (!load_manifest(argv[1], corpus)) {
+    return 1;
+  }
+  std::chrono::duration<double> load_time =
+      std::chrono::steady_clock::now() - load_start;
+
+  size_t m = corpus.gestures.size();
+  if (m < 2) {
+    fprintf(stderr, "need at least two attempts, have %zu\n", m);
+    return 1;
+  }
+
+  // Row i pairs attempt i with every later attempt; rows shrink towards the
+  // end, which the work-stealing pool evens out
+  WorkStealingPool pool(threads);
+  std::vector<Tally> tallies(pool.threads());
+  for (Tally &t : tallies) {
+    t.genuine.assign(sweep.count + 1, 0);
+    t.impostor.assign(sweep.count + 1, 0);
+  }
+  auto start = std::chrono::steady_clock::now();
+  pool.parallel_for(m - 1, 1, [&](size_t begin, size_t end, unsigned worker) {
+    Tally &tally = tallies[worker];
+    for (size_t i = begin; i < end; i++) {
+      for (size_t j = i + 1; j < m; j++) {
+        score_pair(corpus.gestures[i], corpus.gestures[j], sweep,
+                   corpus.labels[i] == corpus.labels[j], tally);
+      }
+    }
+  });
+  std::chrono::duration<double> eval_time =
+      std::chrono::steady_clock::now() - start;
+
+  Tally total = tallies[0];
+  for (size_t w = 1; w < tallies.size(); w++) {
+    for (size_t j = 0; j <= sweep.count; j++) {
+      total.genuine[j] += tallies[w].genuine[j];
+      total.impostor[j] += tallies[w].impostor[j];
+    }
+    total.genuine_pairs += tallies[w].genuine_pairs;
+    total.impostor_pairs += tallies[w].impostor_pairs;
+  }
+
+  size_t pairs = total.genuine_pairs + total.impostor_pairs;
+  printf("%zu attempts, %zu labels, %zu pairs (%zu genuine, %zu impostor)\n",
+         m, corpus.names.size(), pairs, total.genuine_pairs,
+         total.impostor_pairs);
+  printf("loaded in %.3f s, scored in %.3f s on %u threads "
+         "(%.0f pairs/s, %zu steals)\n\n",
+         load_time.count(), eval_time.count(), pool.threads(),
+         eval_time.count() > 0 ? pairs / eval_time.count() : 0.0,
+         pool.steals());
+
+  FILE *csv = csv_path != nullptr ? fopen(csv_path, "w") : nullptr;
+  if (csv_path != nullptr && csv == nullptr) perror(csv_path);
+  if (csv != nullptr) fprintf(csv, "threshold,far,frr\n");
+
+  // Integrate the difference arrays into rates and find the crossing
+  std::vector<double> far(sweep.count), frr(sweep.count);
+  int64_t genuine_accepted = 0, impostor_accepted = 0;
+  size_t current = sweep.first_at_least(CORRELATION_THRESHOLD - sweep.step / 2);
+  printf("%9s %9s %9s\n", "threshold", "FAR", "FRR");
+  for (size_t j = 0; j < sweep.count; j++) {
+    genuine_accepted += total.genuine[j];
+    impostor_accepted += total.impostor[j];
+    far[j] = total.impostor_pairs > 0
+                 ? (double)impostor_accepted / total.impostor_pairs
+                 : 0.0;
+    frr[j] = total.genuine_pairs > 0
+                 ? 1.0 - (double)genuine_accepted / total.genuine_pairs
+                 : 0.0;
+    printf("%9.3f %9.4f %9.4f%s\n", sweep.threshold(j), far[j], frr[j],
+           j == current ? "  <- CORRELATION_THRESHOLD" : "");
+    if (csv != nullptr) {
+      fprintf(csv, "%.4f,%.6f,%.6f\n", sweep.threshold(j), far[j], frr[j]);
+    }
+  }
+  if (csv != nullptr) fclose(csv);
+
+  // EER: where FAR - FRR changes sign, interpolated linearly; FAR and FRR
+  // need not be monotonic with an exact-count vote, so take the closest
+  // crossing to the best |FAR - FRR| point
+  size_t best = 0;
+  for (size_t j = 1; j < sweep.count; j++) {
+    if (std::fabs(far[j] - frr[j]) < std::fabs(far[best] - frr[best])) best = j;
+  }
+  double eer = (far[best] + frr[best]) / 2;
+  double eer_threshold = sweep.threshold(best);
+  for (size_t j = best > 0 ? best - 1 : 0; j + 1 < sweep.count && j <= best;
+       j++) {
+    double d0 = far[j] - frr[j], d1 = far[j + 1] - frr[j + 1];
+    if ((d0 <= 0 && d1 >= 0) || (d0 >= 0 && d1 <= 0)) {
+      double t = d0 != d1 ? d0 / (d0 - d1) : 0.0;
+      eer = far[j] + t * (far[j + 1] - far[j]);
+      eer_threshold = sweep.threshold(j) + t * sweep.step;
+      break;
+    }
+  }
+  printf("\nEER %.4f at threshold %.3f\n", eer, eer_threshold);
+  return 0;
+}
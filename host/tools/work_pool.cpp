@@ -0,0 +1,146 @@
+/**
+ * @file work_pool.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Work-stealing thread pool implementation.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "work_pool.h"
+
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(unsigned threads)
+    : generation_(0),
+      running_(0),
+      exit_(false),
+      body_(nullptr),
+      grain_(1),
+      remaining_(0),
+      steals_(0) {
+  if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned i = 0; i < threads; i++) {
+    queues_.emplace_back(new Queue());
+  }
+  // Worker 0 is the calling thread
+  for (unsigned i = 1; i < threads; i++) {
+    workers_.emplace_back(&WorkStealingPool::worker_main, this, i);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    exit_ = true;
+  }
+  start_.notify_all();
+  for (std::thread &t : workers_) t.join();
+}
+
+void WorkStealingPool::parallel_for(size_t count, size_t grain,
+                                    const Body &body) {
+  if (count == 0) return;
+  body_ = &body;
+  grain_ = std::max<size_t>(1, grain);
+  remaining_ = count;
+  steals_ = 0;
+
+  // Seed every worker with an equal share
+  unsigned n = threads();
+  for (unsigned i = 0; i < n; i++) {
+    size_t begin = count * i / n, end = count * (i + 1) / n;
+    if (begin < end) queues_[i]->ranges.emplace_back(begin, end);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+    running_ = n - 1;
+  }
+  start_.notify_all();
+
+  run(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return running_ == 0; });
+  body_ = nullptr;
+}
+
+void WorkStealingPool::worker_main(unsigned worker) {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [&] { return exit_ || generation_ != seen; });
+      if (exit_) return;
+      seen = generation_;
+    }
+    run(worker);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_--;
+    }
+    done_.notify_all();
+  }
+}
+
+/*******************************************************************************
+ *
+ * @brief Work until every index of the current parallel_for() is processed
+ * @param worker: this worker
+ *
+ * ****************************************************************************/
+void WorkStealingPool::run(unsigned worker) {
+  while (remaining_.load(std::memory_order_acquire) > 0) {
+    Range range;
+    if (!pop_local(worker, range) && !steal(worker, range)) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    // Keep halving: the upper half goes back to the deque for thieves
+    while (range.second - range.first > grain_) {
+      size_t mid = range.first + (range.second - range.first) / 2;
+      {
+        Queue &q = *queues_[worker];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.ranges.emplace_back(mid, range.second);
+      }
+      range.second = mid;
+    }
+
+    (*body_)(range.first, range.second, worker);
+    remaining_.fetch_sub(range.second - range.first, std::memory_order_release);
+  }
+}
+
+// Own work is taken from the back (most recently split, cache-warm)
+bool WorkStealingPool::pop_local(unsigned worker, Range &range) {
+  Queue &q = *queues_[worker];
+  std::lock_guard<std::mutex> lock(q.mutex);
+  if (q.ranges.empty()) return false;
+  range = q.ranges.back();
+  q.ranges.pop_back();
+  return true;
+}
+
+// Stolen work is taken from the front (the largest, oldest ranges)
+bool WorkStealingPool::steal(unsigned worker, Range &range) {
+  unsigned n = threads();
+  for (unsigned k = 1; k < n; k++) {
+    Queue &q = *queues_[(worker + k) % n];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.ranges.empty()) continue;
+    range = q.ranges.front();
+    q.ranges.pop_front();
+    steals_++;
+    return true;
+  }
+  return false;
+}
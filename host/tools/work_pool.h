@@ -0,0 +1,90 @@
+/**
+ * @file work_pool.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Work-stealing thread pool for the host tools.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * parallel_for() splits an index range lazily: every worker owns a deque of
+ * ranges, halves its current range while it is larger than the grain and
+ * pushes the other half where idle workers can steal it. Uneven work (rows
+ * of a triangular pair matrix, gestures of different lengths) ends up
+ * balanced without tuning the chunk size.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class WorkStealingPool {
+ public:
+  // Processes [begin, end) on the given worker (0 .. threads() - 1)
+  typedef std::function<void(size_t begin, size_t end, unsigned worker)> Body;
+
+  /**
+   * @param threads: number of workers, 0 for one per hardware thread
+   */
+  explicit WorkStealingPool(unsigned threads = 0);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  unsigned threads() const { return (unsigned)queues_.size(); }
+
+  /**
+   * @brief Run body over [0, count) and wait for it to finish
+   * @param count: size of the index range
+   * @param grain: ranges up to this size are not split further
+   * @param body: the work; called concurrently from all workers
+   */
+  void parallel_for(size_t count, size_t grain, const Body &body);
+
+  // Ranges taken from another worker's deque during the last parallel_for()
+  size_t steals() const { return steals_; }
+
+ private:
+  typedef std::pair<size_t, size_t> Range;
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Range> ranges;
+  };
+
+  void worker_main(unsigned worker);
+  void run(unsigned worker);
+  bool pop_local(unsigned worker, Range &range);
+  bool steal(unsigned worker, Range &range);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  uint64_t generation_;
+  unsigned running_;
+  bool exit_;
+
+  const Body *body_;
+  size_t grain_;
+  std::atomic<size_t> remaining_;  // indices not processed yet
+  std::atomic<size_t> steals_;
+};
+
+#endif  // WORK_POOL_H
@@ -0,0 +1,101 @@
+/**
+ * @file arena.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Region allocators over the unused SDRAM: bump allocation, typed
+ * sub-arenas and O(1) reset.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "arena.h"
+
+static const size_t arena_sizes[ARENA_KINDS] = {
+    ARENA_CAPTURE_SIZE, ARENA_DTW_SIZE, ARENA_TEMPLATE_SIZE,
+    ARENA_BLACKBOX_SIZE};
+static const size_t SDRAM_ARENA_SIZE = ARENA_CAPTURE_SIZE + ARENA_DTW_SIZE +
+                                       ARENA_TEMPLATE_SIZE +
+                                       ARENA_BLACKBOX_SIZE;
+
+static_assert(SDRAM_ARENA_ADDRESS >= 0xD0000000u &&
+                  SDRAM_ARENA_ADDRESS + SDRAM_ARENA_SIZE <= 0xD0800000u,
+              "the arenas have to fit in the 8 MB SDRAM");
+
+static Arena sdram_arenas[ARENA_KINDS];
+
+void Arena::init(void *base, size_t size) {
+  base_ = static_cast<uint8_t *>(base);
+  size_ = base != nullptr ? size : 0;
+  used_ = 0;
+  memset(&stats_, 0, sizeof(stats_));
+  stats_.size = size_;
+}
+
+void *Arena::allocate(size_t size, size_t alignment) {
+  uintptr_t start = (uintptr_t)base_ + used_;
+  size_t padding = (alignment - start % alignment) % alignment;
+  if (size_ - used_ < padding || size_ - used_ - padding < size) {
+    stats_.failures++;
+    return nullptr;
+  }
+  used_ += padding + size;
+  stats_.allocations++;
+  if (used_ > stats_.high_water) stats_.high_water = used_;
+  return (void *)(start + padding);
+}
+
+void Arena::release(void *pointer, size_t size) {
+  if (contains(pointer) && (uint8_t *)pointer + size == base_ + used_) {
+    used_ = (uint8_t *)pointer - base_;
+  }
+}
+
+void Arena::rewind(size_t mark) {
+  if (mark < used_) used_ = mark;
+}
+
+void Arena::reset() {
+  used_ = 0;
+  stats_.resets++;
+}
+
+bool Arena::contains(const void *pointer) const {
+  const uint8_t *p = static_cast<const uint8_t *>(pointer);
+  return base_ != nullptr && p >= base_ && p < base_ + size_;
+}
+
+Arena_Stats Arena::stats() const {
+  Arena_Stats stats = stats_;
+  stats.used = used_;
+  return stats;
+}
+
+/*******************************************************************************
+ *
+ * @brief Split the SDRAM into the sub-arenas
+ *
+ * On the board the region is the SDRAM past the LCD frame buffers; the host
+ * build allocates a buffer of the same size once.
+ *
+ * ****************************************************************************/
+bool SdramArenaInit() {
+#ifdef SENTRY_HOST_BUILD
+  static uint8_t *sdram = static_cast<uint8_t *>(malloc(SDRAM_ARENA_SIZE));
+#else
+  uint8_t *sdram = (uint8_t *)SDRAM_ARENA_ADDRESS;
+#endif
+  if (sdram == nullptr) return false;
+  uint8_t *base = sdram;
+  for (int kind = 0; kind < ARENA_KINDS; kind++) {
+    sdram_arenas[kind].init(base, arena_sizes[kind]);
+    base += arena_sizes[kind];
+  }
+  return true;
+}
+
+Arena &SdramArena(Arena_Kind kind) { return sdram_arenas[kind]; }
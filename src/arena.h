@@ -0,0 +1,207 @@
+/**
+ * @file arena.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Region allocators over the unused SDRAM: bump allocation, typed
+ * sub-arenas and O(1) reset.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * The LCD driver brings up the 8 MB SDRAM (BSP_LCD_Init() calls
+ * BSP_SDRAM_Init()) but only uses its first 3 MB for frame buffers. The
+ * recordings and scratch buffers of the gesture code, on the other hand,
+ * all come from the internal heap.
+ *
+ * An Arena hands out memory by moving an offset forward. Nothing is freed
+ * on its own: reset(), or rewind() to an earlier mark(), releases
+ * everything allocated since at once. Buffers that live for one attempt
+ * thus cost two adds and a compare, and cannot fragment anything.
+ *
+ * SdramArenaInit() splits the SDRAM from SDRAM_ARENA_ADDRESS into one
+ * arena per Arena_Kind. An arena is not thread-safe: each one belongs to
+ * a single thread (on the board, the gyroscope thread). On the host the
+ * arenas are carved from a plain buffer of the same size.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <type_traits>
+
+#include "system_config.h"
+
+// What each SDRAM sub-arena holds
+typedef enum {
+  ARENA_CAPTURE,   // samples of the attempt being recorded
+  ARENA_DTW,       // DTW matrices
+  ARENA_TEMPLATE,  // templates and data derived from them
+  ARENA_BLACKBOX,  // the black box of recent attempts, never reset
+  ARENA_KINDS
+} Arena_Kind;
+
+// Usage, for diagnostics and the host benchmark
+typedef struct {
+  size_t size;          // bytes the arena owns
+  size_t used;          // bytes handed out since the last reset
+  size_t high_water;    // most bytes in use at once
+  uint32_t allocations;
+  uint32_t failures;    // requests that did not fit
+  uint32_t resets;
+} Arena_Stats;
+
+class Arena {
+ public:
+  Arena() { init(nullptr, 0); }
+  Arena(void *base, size_t size) { init(base, size); }
+
+  /**
+   * @brief Take over a region (everything in it is forgotten)
+   */
+  void init(void *base, size_t size);
+
+  /**
+   * @brief Allocate from the arena
+   * @param size: bytes wanted
+   * @param alignment: a power of two
+   * @return the memory, nullptr if it does not fit
+   */
+  void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  /**
+   * @brief Allocate an array; no destructors run on reset, hence only
+   * trivially destructible types
+   * @return the array (uninitialized), nullptr if it does not fit
+   */
+  template <typename T>
+  T *allocate_array(size_t count) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "arena memory is released without running destructors");
+    if (count > SIZE_MAX / sizeof(T)) return nullptr;
+    return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+  }
+
+  /**
+   * @brief Give back the most recent allocation; anything else stays
+   * until the next reset
+   */
+  void release(void *pointer, size_t size);
+
+  /**
+   * @brief Position to rewind() to later
+   */
+  size_t mark() const { return used_; }
+
+  /**
+   * @brief Release everything allocated after a mark()
+   */
+  void rewind(size_t mark);
+
+  /**
+   * @brief Release everything
+   */
+  void reset();
+
+  bool contains(const void *pointer) const;
+  size_t available() const { return size_ - used_; }
+  Arena_Stats stats() const;
+
+ private:
+  uint8_t *base_;
+  size_t size_;
+  size_t used_;
+  Arena_Stats stats_;
+};
+
+/**
+ * @brief Rewinds an arena to where it was when the scope was entered
+ *
+ * A null arena is allowed and does nothing, so scratch space can be
+ * optional.
+ */
+class ArenaScope {
+ public:
+  explicit ArenaScope(Arena *arena)
+      : arena_(arena), mark_(arena != nullptr ? arena->mark() : 0) {}
+  ~ArenaScope() {
+    if (arena_ != nullptr) arena_->rewind(mark_);
+  }
+  ArenaScope(const ArenaScope &) = delete;
+  ArenaScope &operator=(const ArenaScope &) = delete;
+
+ private:
+  Arena *arena_;
+  size_t mark_;
+};
+
+/**
+ * @brief Standard allocator over an arena, for containers
+ *
+ * When the arena is full it falls back to the heap, so a container never
+ * sees a failed allocation; the arena counts the failure.
+ */
+template <typename T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+
+  explicit ArenaAllocator(Arena &arena) : arena_(&arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : arena_(other.arena()) {}
+
+  T *allocate(size_t count) {
+    void *pointer = nullptr;
+    if (count <= SIZE_MAX / sizeof(T)) {
+      pointer = arena_->allocate(count * sizeof(T), alignof(T));
+      if (pointer == nullptr) pointer = malloc(count * sizeof(T));
+    }
+    return static_cast<T *>(pointer);
+  }
+
+  void deallocate(T *pointer, size_t count) {
+    if (arena_->contains(pointer)) {
+      arena_->release(pointer, count * sizeof(T));
+    } else {
+      free(pointer);
+    }
+  }
+
+  Arena *arena() const { return arena_; }
+
+ private:
+  Arena *arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+  return !(a == b);
+}
+
+// Gyro samples in an arena
+typedef vector<array<float, 3>, ArenaAllocator<array<float, 3>>> ArenaSamples;
+
+/**
+ * @brief Split the SDRAM into the sub-arenas
+ *
+ * Call after the LCD is initialized (it initializes the SDRAM). Until then
+ * every sub-arena is empty, so allocations fall back to the heap.
+ *
+ * @return false if the memory is not available
+ */
+bool SdramArenaInit();
+
+/**
+ * @brief The sub-arena of a kind
+ */
+Arena &SdramArena(Arena_Kind kind);
+
+#endif  // ARENA_H
@@ -0,0 +1,235 @@
+/**
+ * @file blackbox.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Black box recorder of the last unlock attempts.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "blackbox.h"
+
+#include <cstring>
+
+#define BLACKBOX_MAGIC 0x42423031  // "BB01"
+
+/*******************************************************************************
+ * BlackBox
+ * ****************************************************************************/
+BlackBox::BlackBox()
+    : header_(nullptr),
+      slots_(nullptr),
+      slots_count_(0),
+      open_(nullptr),
+      claims_(0) {
+  memset(stage_start_, 0, sizeof(stage_start_));
+}
+
+/*******************************************************************************
+ *
+ * @brief Take over a region, keeping the attempts already in it
+ *
+ * The attempts are kept only if the header describes this very layout.
+ * Slots left open by a reset become incomplete attempts.
+ *
+ * ****************************************************************************/
+bool BlackBox::init(void *memory, size_t size) {
+  ScopedLock<Mutex> lock(mutex_);
+  open_.store(nullptr, std::memory_order_release);
+  if (memory == nullptr || size < region_size(1)) {
+    header_ = nullptr;
+    slots_ = nullptr;
+    slots_count_ = 0;
+    return false;
+  }
+
+  header_ = static_cast<Blackbox_Header *>(memory);
+  slots_ = reinterpret_cast<Blackbox_Slot *>(header_ + 1);
+  slots_count_ = (size - sizeof(Blackbox_Header)) / sizeof(Blackbox_Slot);
+
+  if (header_->magic != BLACKBOX_MAGIC ||
+      header_->slot_size != sizeof(Blackbox_Slot) ||
+      header_->slots != slots_count_ || header_->next_attempt == 0) {
+    header_->magic = BLACKBOX_MAGIC;
+    header_->slot_size = sizeof(Blackbox_Slot);
+    header_->slots = slots_count_;
+    clear();
+  }
+  for (size_t i = 0; i < slots_count_; i++) slots_[i].open = false;
+  return true;
+}
+
+void BlackBox::clear() {
+  ScopedLock<Mutex> lock(mutex_);
+  if (header_ == nullptr) return;
+  for (size_t i = 0; i < slots_count_; i++) {
+    slots_[i].attempt = 0;
+    slots_[i].open = false;
+  }
+  header_->next_attempt = 1;
+  open_.store(nullptr, std::memory_order_release);
+  claims_.fetch_add(slots_count_);
+}
+
+size_t BlackBox::count() const {
+  if (header_ == nullptr) return 0;
+  size_t recorded = header_->next_attempt - 1;
+  return recorded < slots_count_ ? recorded : slots_count_;
+}
+
+Blackbox_Slot *BlackBox::slot_of(uint32_t attempt) const {
+  return &slots_[(attempt - 1) % slots_count_];
+}
+
+void BlackBox::begin(const Capture_Session &session) {
+  ScopedLock<Mutex> lock(mutex_);
+  if (header_ == nullptr) return;
+
+  uint32_t attempt = header_->next_attempt++;
+  Blackbox_Slot *slot = slot_of(attempt);
+  claims_.fetch_add(1);
+  slot->attempt = attempt;
+  slot->open = true;
+  slot->count = 0;
+  slot->dropped = 0;
+  slot->last_us = 0;
+  slot->session = session;
+  memset(&slot->result, 0, sizeof(slot->result));
+  slot->result.attempt = attempt;
+  slot->result.uptime_ms =
+      (uint32_t)Kernel::Clock::now().time_since_epoch().count();
+  slot->result.outcome = CAPTURE_OUTCOME_INCOMPLETE;
+  for (int i = 0; i < 3; i++) slot->result.correlation[i] = NAN;
+
+  for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    stage_start_[i] = ProfilerTotal((Profile_Stage)i);
+  }
+  open_.store(slot, std::memory_order_release);
+}
+
+void BlackBox::finish(uint8_t outcome) { close(outcome, nullptr); }
+
+void BlackBox::finish(const Match_Result &match) {
+  close(match.unlocked ? CAPTURE_OUTCOME_UNLOCKED : CAPTURE_OUTCOME_REJECTED,
+        &match);
+}
+
+void BlackBox::close(uint8_t outcome, const Match_Result *match) {
+  ScopedLock<Mutex> lock(mutex_);
+  Blackbox_Slot *slot = open_.load(std::memory_order_relaxed);
+  if (slot == nullptr) return;
+
+  Capture_Attempt &result = slot->result;
+  result.outcome = outcome;
+  if (match != nullptr) {
+    result.axes_matched = (uint8_t)match->axes_matched;
+    for (int i = 0; i < 3; i++) result.correlation[i] = match->correlation[i];
+  }
+  float per_us = ProfilerTicksPerUs();
+  for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    uint64_t total = ProfilerTotal((Profile_Stage)i);
+    uint64_t ticks = total > stage_start_[i] ? total - stage_start_[i] : 0;
+    result.stage_us[i] = (uint32_t)(ticks / per_us);
+  }
+  slot->open = false;
+  open_.store(nullptr, std::memory_order_release);
+}
+
+/*******************************************************************************
+ *
+ * @brief Whether the slot of an attempt has been claimed again
+ *
+ * Of the attempts before `last`, the one in the oldest slot is overwritten
+ * by the first attempt begun after `claims` was read, the next one by the
+ * second, and so on.
+ *
+ * ****************************************************************************/
+bool BlackBox::reclaimed(uint32_t attempt, uint32_t last,
+                         uint32_t claims) const {
+  uint32_t begun = claims_.load() - claims;
+  return begun > attempt + slots_count_ - last;
+}
+
+/*******************************************************************************
+ *
+ * @brief Write the attempts held, oldest first, as capture sessions
+ *
+ * Only an attempt's session and result are copied under the lock; its
+ * samples are streamed to the console without it, so begin() and finish()
+ * never wait on the serial port. Each sample is checked after it is read:
+ * once the slot has been claimed again the attempt ends there, incomplete.
+ *
+ * ****************************************************************************/
+size_t BlackBox::dump(CaptureWriter &writer) {
+  size_t written = 0;
+  uint32_t last, claims;
+  {
+    ScopedLock<Mutex> lock(mutex_);
+    if (header_ == nullptr) return 0;
+    last = header_->next_attempt;
+    claims = claims_.load();
+  }
+  uint32_t first = last > slots_count_ ? last - slots_count_ : 1;
+
+  for (uint32_t attempt = first; attempt < last; attempt++) {
+    const Blackbox_Slot *slot = slot_of(attempt);
+    Capture_Session session;
+    Capture_Attempt result;
+    uint16_t count;
+    {
+      ScopedLock<Mutex> lock(mutex_);
+      if (reclaimed(attempt, last, claims) || slot->attempt != attempt ||
+          slot == open_.load(std::memory_order_relaxed) ||
+          slot->count > BLACKBOX_SAMPLES) {
+        continue;
+      }
+      session = slot->session;
+      result = slot->result;
+      count = slot->count;
+    }
+
+    writer.begin_session(session);
+    uint32_t timestamp = 0;
+    for (size_t i = 0; i < count; i++) {
+      Blackbox_Sample s = slot->samples[i];
+      if (reclaimed(attempt, last, claims)) {
+        result.outcome = CAPTURE_OUTCOME_INCOMPLETE;
+        break;
+      }
+      timestamp += s.delta_us;
+      Gyroscope_RawData raw = {s.x_raw, s.y_raw, s.z_raw};
+      writer.add_sample(timestamp, raw);
+    }
+    writer.add_attempt(result);
+    writer.end_session();
+    written++;
+  }
+  return written;
+}
+
+/*******************************************************************************
+ * BlackBoxGyroSource
+ * ****************************************************************************/
+BlackBoxGyroSource::BlackBoxGyroSource(GyroSource &inner, BlackBox &box)
+    : inner_(inner), box_(box) {}
+
+bool BlackBoxGyroSource::init(const Gyroscope_Init_Parameters &params) {
+  return inner_.init(params);
+}
+
+void BlackBoxGyroSource::begin(const Capture_Session &session) {
+  clock_.reset();
+  clock_.start();
+  box_.begin(session);
+}
+
+bool BlackBoxGyroSource::read(Gyroscope_RawData &sample) {
+  if (!inner_.read(sample)) return false;
+  box_.add_sample((uint32_t)clock_.elapsed_time().count(), sample);
+  return true;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file blackbox.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Black box recorder of the last unlock attempts: raw samples,
+ * scores, stage timings and verdict, in a ring of slots in SDRAM.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Once an attempt is over its recording is gone, so a gesture that "won't
+ * unlock" leaves nothing to look at. The black box keeps the last
+ * BLACKBOX_ATTEMPTS recordings (enrollments too) in a region carved out
+ * once at boot, on the board SdramArena(ARENA_BLACKBOX):
+ *
+ *   header | slot 0 | slot 1 | ... | slot N-1
+ *
+ * Attempt n goes to slot (n - 1) % N, overwriting the oldest. begin()
+ * claims the slot, add_sample() writes each raw sample straight into it
+ * (8 bytes, no copies, nothing allocated) and finish() adds the verdict,
+ * the scores and the time each profiled stage took since begin(). A slot
+ * begun but never finished is kept as CAPTURE_OUTCOME_INCOMPLETE.
+ *
+ * dump() writes the attempts, oldest first, as capture sessions (see
+ * capture_format.h) with an ATTEMPT frame each, so `sentry_capture record`
+ * saves them and `sentry_capture info` and `replay` read them back.
+ *
+ * A warm reset normally leaves the SDRAM contents intact, and init() keeps
+ * the attempts of a region whose header matches; after a power cycle the
+ * box starts empty.
+ *
+ * The gyroscope thread records; dump() and clear() may run on another
+ * thread. dump() skips the attempt being recorded and streams the samples
+ * without the lock, so an attempt whose slot is claimed meanwhile is cut
+ * short and marked CAPTURE_OUTCOME_INCOMPLETE.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef BLACKBOX_H
+#define BLACKBOX_H
+
+#include <atomic>
+
+#include "capture_format.h"
+#include "gyro_source.h"
+#include "matcher.h"
+#include "system_config.h"
+
+// One raw sample in a slot
+typedef struct {
+  uint16_t delta_us;  // time since the previous sample (saturated)
+  int16_t x_raw;
+  int16_t y_raw;
+  int16_t z_raw;
+} Blackbox_Sample;
+
+// One attempt
+typedef struct {
+  uint32_t attempt;  // attempt number, 0 if the slot was never used
+  bool open;         // begun, not finished yet
+  uint16_t count;    // samples kept
+  uint32_t dropped;  // samples past BLACKBOX_SAMPLES
+  uint32_t last_us;  // timestamp of the last sample
+  Capture_Session session;
+  Capture_Attempt result;
+  Blackbox_Sample samples[BLACKBOX_SAMPLES];
+} Blackbox_Slot;
+
+// Start of the region; a mismatch on init() clears the box
+typedef struct {
+  uint32_t magic;
+  uint32_t slot_size;     // sizeof(Blackbox_Slot)
+  uint32_t slots;
+  uint32_t next_attempt;  // number of the next attempt, from 1
+} Blackbox_Header;
+
+class BlackBox {
+ public:
+  BlackBox();
+
+  /**
+   * @brief Bytes of region needed for a number of attempts
+   */
+  static size_t region_size(size_t attempts) {
+    return sizeof(Blackbox_Header) + attempts * sizeof(Blackbox_Slot);
+  }
+
+  /**
+   * @brief Take over a region, keeping the attempts already in it
+   * @param memory: the region, aligned for Blackbox_Slot (nullptr disables
+   *        the box)
+   * @param size: its size; the number of slots is what fits
+   * @return false if not even one attempt fits
+   */
+  bool init(void *memory, size_t size);
+
+  /**
+   * @brief Start recording an attempt in the oldest slot
+   * @param session: sensor and calibration of the recording
+   */
+  void begin(const Capture_Session &session);
+
+  /**
+   * @brief Append a raw sample to the attempt being recorded; O(1)
+   * @param timestamp_us: capture time, since begin()
+   * @param sample: the raw sensor output
+   */
+  void add_sample(uint32_t timestamp_us, const Gyroscope_RawData &sample) {
+    Blackbox_Slot *slot = open_.load(std::memory_order_acquire);
+    if (slot == nullptr) return;
+    if (slot->count == BLACKBOX_SAMPLES) {
+      slot->dropped++;
+      return;
+    }
+    uint32_t delta = timestamp_us - slot->last_us;
+    Blackbox_Sample &s = slot->samples[slot->count];
+    s.delta_us = delta > 0xFFFF ? 0xFFFF : (uint16_t)delta;
+    s.x_raw = sample.x_raw;
+    s.y_raw = sample.y_raw;
+    s.z_raw = sample.z_raw;
+    slot->last_us = timestamp_us;
+    slot->count++;
+  }
+
+  /**
+   * @brief Close the attempt with a verdict without scores
+   * @param outcome: CAPTURE_OUTCOME_ENROLLED or CAPTURE_OUTCOME_NO_KEY
+   */
+  void finish(uint8_t outcome);
+
+  /**
+   * @brief Close the attempt with the result of the matcher
+   */
+  void finish(const Match_Result &match);
+
+  /**
+   * @brief Write the attempts held, oldest first, as capture sessions
+   * @param writer: where to write them
+   * @return the number of attempts written
+   */
+  size_t dump(CaptureWriter &writer);
+
+  /**
+   * @brief Forget every attempt
+   */
+  void clear();
+
+  size_t capacity() const { return slots_count_; }
+
+  /**
+   * @brief Attempts currently held
+   */
+  size_t count() const;
+
+ private:
+  Blackbox_Slot *slot_of(uint32_t attempt) const;
+  bool reclaimed(uint32_t attempt, uint32_t last, uint32_t claims) const;
+  void close(uint8_t outcome, const Match_Result *match);
+
+  Mutex mutex_;  // between a dump and the start or end of an attempt
+  Blackbox_Header *header_;
+  Blackbox_Slot *slots_;
+  size_t slots_count_;
+  std::atomic<Blackbox_Slot *> open_;  // slot being recorded
+  std::atomic<uint32_t> claims_;  // slots begin() claimed; clear() all
+  uint64_t stage_start_[PROFILE_STAGE_COUNT];
+};
+
+/**
+ * @brief A GyroSource decorator that records every sample it reads into
+ * the black box.
+ */
+class BlackBoxGyroSource : public GyroSource {
+ public:
+  BlackBoxGyroSource(GyroSource &inner, BlackBox &box);
+
+  /**
+   * @brief Start an attempt in the black box; samples are timed from here
+   */
+  void begin(const Capture_Session &session);
+
+  bool init(const Gyroscope_Init_Parameters &params) override;
+  bool read(Gyroscope_RawData &sample) override;
+  float sensitivity() const override { return inner_.sensitivity(); }
+  void power_off() override { inner_.power_off(); }
+
+ private:
+  GyroSource &inner_;
+  BlackBox &box_;
+  Timer clock_;
+};
+
+#endif  // BLACKBOX_H
@@ -0,0 +1,144 @@
+/**
+ * @file capture.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Calibration and gesture recording over any GyroSource.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "capture.h"
+#include "hampel_filter.h"
+#include "profiler.h"
+
+/*******************************************************************************
+ *
+ * @brief Find the zero-rate level and dead-band of a source held still
+ * @param source: the source to calibrate
+ * @param calibration: receives offsets and thresholds
+ * @param num_samples: samples to average
+ * @return false if the source ran out of samples
+ *
+ * The offset is the mean of the samples; the dead-band is the largest
+ * deviation from that mean seen while still.
+ *
+ * ****************************************************************************/
+bool CalibrateSource(GyroSource &source, Gyroscope_Calibration &calibration,
+                     size_t num_samples) {
+  PROFILE_SCOPE(PROFILE_CALIBRATION);
+  int32_t sum[3] = {0, 0, 0};
+  int16_t lo[3] = {INT16_MAX, INT16_MAX, INT16_MAX};
+  int16_t hi[3] = {INT16_MIN, INT16_MIN, INT16_MIN};
+  size_t taken = 0;
+
+  for (; taken < num_samples; taken++) {
+    Gyroscope_RawData sample;
+    if (!source.read(sample)) break;
+    int16_t axes[3] = {sample.x_raw, sample.y_raw, sample.z_raw};
+    for (int i = 0; i < 3; i++) {
+      sum[i] += axes[i];
+      lo[i] = std::min(lo[i], axes[i]);
+      hi[i] = std::max(hi[i], axes[i]);
+    }
+  }
+  if (taken == 0) return false;
+
+  int16_t offset[3], threshold[3];
+  for (int i = 0; i < 3; i++) {
+    offset[i] = (int16_t)(sum[i] / (int32_t)taken);
+    threshold[i] = (int16_t)std::max(hi[i] - offset[i], offset[i] - lo[i]);
+  }
+  calibration.x_offset = offset[0];
+  calibration.y_offset = offset[1];
+  calibration.z_offset = offset[2];
+  calibration.x_threshold = threshold[0];
+  calibration.y_threshold = threshold[1];
+  calibration.z_threshold = threshold[2];
+
+  return taken == num_samples;
+}
+
+/*******************************************************************************
+ *
+ * @brief Remove the zero-rate level and zero out the dead-band
+ * @param calibration: the calibration to apply
+ * @param sample: the raw sample, calibrated in place
+ *
+ * ****************************************************************************/
+void ApplyCalibration(const Gyroscope_Calibration &calibration,
+                      Gyroscope_RawData &sample) {
+  sample.x_raw -= calibration.x_offset;
+  sample.y_raw -= calibration.y_offset;
+  sample.z_raw -= calibration.z_offset;
+
+  if (abs(sample.x_raw) < calibration.x_threshold) sample.x_raw = 0;
+  if (abs(sample.y_raw) < calibration.y_threshold) sample.y_raw = 0;
+  if (abs(sample.z_raw) < calibration.z_threshold) sample.z_raw = 0;
+}
+
+/*******************************************************************************
+ *
+ * @brief Record a gesture from a source
+ * @param source: the source to record from
+ * @param calibration: calibration from CalibrateSource()
+ * @param num_samples: recorded samples wanted
+ * @param data: receives the recorded samples (appended)
+ * @param stats: optional counters
+ * @return the number of recorded samples appended
+ *
+ * ****************************************************************************/
+template <typename Allocator>
+size_t RecordGesture(GyroSource &source,
+                     const Gyroscope_Calibration &calibration,
+                     size_t num_samples,
+                     vector<array<float, 3>, Allocator> &data,
+                     Capture_Stats *stats) {
+  HampelFilter hampel[3];
+  float sensitivity = source.sensitivity();
+  size_t raw_samples = 0;
+  size_t recorded = 0;
+
+  data.reserve(data.size() + num_samples);
+  while (recorded < num_samples) {
+    array<float, 3> sum = {0.0f, 0.0f, 0.0f};
+    size_t block = 0;
+
+    for (; block < RECORDING_DECIMATION; block++) {
+      Gyroscope_RawData sample;
+      {
+        PROFILE_SCOPE(PROFILE_ACQUISITION);
+        if (!source.read(sample)) break;
+      }
+      raw_samples++;
+
+      PROFILE_SCOPE(PROFILE_FILTERING);
+      ApplyCalibration(calibration, sample);
+      sum[0] += hampel[0].filter(sample.x_raw * sensitivity);
+      sum[1] += hampel[1].filter(sample.y_raw * sensitivity);
+      sum[2] += hampel[2].filter(sample.z_raw * sensitivity);
+    }
+    if (block == 0) break;  // source exhausted
+
+    data.push_back({sum[0] / block, sum[1] / block, sum[2] / block});
+    recorded++;
+    if (block < RECORDING_DECIMATION) break;
+  }
+
+  if (stats != nullptr) {
+    stats->raw_samples = raw_samples;
+    for (int i = 0; i < 3; i++) stats->outliers[i] = hampel[i].outlier_count();
+  }
+  return recorded;
+}
+
+// The sample buffers RecordGesture() is used with
+template size_t RecordGesture(GyroSource &, const Gyroscope_Calibration &,
+                              size_t, vector<array<float, 3>> &,
+                              Capture_Stats *);
+template size_t RecordGesture(GyroSource &, const Gyroscope_Calibration &,
+                              size_t, ArenaSamples &, Capture_Stats *);
@@ -0,0 +1,80 @@
+/**
+ * @file capture.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Source-independent calibration and gesture recording for the
+ * embedded sentry project.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "arena.h"
+#include "gyro_source.h"
+#include "system_config.h"
+
+// Zero-rate level and dead-band of one calibration run
+typedef struct {
+  int16_t x_offset;     // X-axis zero-rate level
+  int16_t y_offset;     // Y-axis zero-rate level
+  int16_t z_offset;     // Z-axis zero-rate level
+  int16_t x_threshold;  // X-axis dead-band
+  int16_t y_threshold;  // Y-axis dead-band
+  int16_t z_threshold;  // Z-axis dead-band
+} Gyroscope_Calibration;
+
+// What happened during one RecordGesture() call
+typedef struct {
+  size_t raw_samples;  // sensor samples consumed
+  size_t outliers[3];  // spikes rejected per axis
+} Capture_Stats;
+
+/**
+ * @brief Find the zero-rate level and dead-band of a source held still
+ * @param source: the source to calibrate
+ * @param calibration: receives offsets and thresholds
+ * @param num_samples: samples to average
+ * @return false if the source ran out of samples
+ */
+bool CalibrateSource(GyroSource &source, Gyroscope_Calibration &calibration,
+                     size_t num_samples = CALIBRATION_SAMPLES);
+
+/**
+ * @brief Remove the zero-rate level and zero out the dead-band
+ * @param calibration: the calibration to apply
+ * @param sample: the raw sample, calibrated in place
+ */
+void ApplyCalibration(const Gyroscope_Calibration &calibration,
+                      Gyroscope_RawData &sample);
+
+/**
+ * @brief Record a gesture from a source
+ *
+ * Each sensor sample is calibrated, converted to dps and passed through a
+ * per-axis Hampel filter, which delays it by HAMPEL_WINDOW_SIZE / 2 samples;
+ * RECORDING_DECIMATION filtered samples are then averaged into one recorded
+ * sample.
+ *
+ * @param source: the source to record from
+ * @param calibration: calibration from CalibrateSource()
+ * @param num_samples: recorded samples wanted
+ * @param data: receives the recorded samples (appended); a heap or an
+ *        ArenaSamples vector
+ * @param stats: optional counters
+ * @return the number of recorded samples appended
+ */
+template <typename Allocator>
+size_t RecordGesture(GyroSource &source,
+                     const Gyroscope_Calibration &calibration,
+                     size_t num_samples,
+                     vector<array<float, 3>, Allocator> &data,
+                     Capture_Stats *stats = nullptr);
+
+#endif  // CAPTURE_H
@@ -0,0 +1,469 @@
+/**
+ * @file capture_format.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Framed binary capture format implementation.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "capture_format.h"
+
+#include <cstring>
+
+#define SESSION_PAYLOAD_SIZE 24
+#define SUMMARY_PAYLOAD_SIZE 8
+#define ATTEMPT_PAYLOAD_SIZE (23 + 4 * PROFILE_STAGE_COUNT)
+
+/*******************************************************************************
+ * Little-endian helpers
+ * ****************************************************************************/
+static void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  put_u16(p, (uint16_t)v);
+  put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+  return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+  return get_u16(p) | (uint32_t)get_u16(p + 2) << 16;
+}
+
+/*******************************************************************************
+ *
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021), nibble-table variant
+ *
+ * ****************************************************************************/
+uint16_t crc16_ccitt(const uint8_t *data, size_t size, uint16_t crc) {
+  static const uint16_t table[16] = {
+      0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+      0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF};
+  for (size_t i = 0; i < size; i++) {
+    crc = (uint16_t)(crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)];
+    crc = (uint16_t)(crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)];
+  }
+  return crc;
+}
+
+/*******************************************************************************
+ * CaptureWriter
+ * ****************************************************************************/
+CaptureWriter::CaptureWriter(Sink sink, void *context)
+    : sink_(sink),
+      context_(context),
+      batch_count_(0),
+      last_timestamp_(0),
+      sample_count_(0),
+      dropped_(0) {}
+
+// One sink call per frame, so a sink that locks its port per call keeps
+// other output out of the frame
+bool CaptureWriter::write_frame(uint8_t type, const uint8_t *payload,
+                                uint16_t size) {
+  uint8_t *frame_payload = frame_ + CAPTURE_HEADER_SIZE;
+  if (payload != frame_payload) memcpy(frame_payload, payload, size);
+  frame_[0] = CAPTURE_SYNC_0;
+  frame_[1] = CAPTURE_SYNC_1;
+  frame_[2] = type;
+  put_u16(frame_ + 3, size);
+  put_u16(frame_payload + size, crc16_ccitt(frame_ + 2, 3 + size));
+
+  size_t length = CAPTURE_HEADER_SIZE + size + 2;
+  return sink_(context_, frame_, length) == length;
+}
+
+void CaptureWriter::begin_session(const Capture_Session &session) {
+  uint8_t p[SESSION_PAYLOAD_SIZE];
+  uint32_t sensitivity_bits;
+  memcpy(&sensitivity_bits, &session.sensitivity, sizeof(sensitivity_bits));
+
+  p[0] = CAPTURE_VERSION;
+  put_u32(p + 1, session.session_id);
+  put_u16(p + 5, session.sample_rate_hz);
+  p[7] = session.full_scale;
+  put_u32(p + 8, sensitivity_bits);
+  put_u16(p + 12, (uint16_t)session.calibration.x_offset);
+  put_u16(p + 14, (uint16_t)session.calibration.y_offset);
+  put_u16(p + 16, (uint16_t)session.calibration.z_offset);
+  put_u16(p + 18, (uint16_t)session.calibration.x_threshold);
+  put_u16(p + 20, (uint16_t)session.calibration.y_threshold);
+  put_u16(p + 22, (uint16_t)session.calibration.z_threshold);
+
+  batch_count_ = 0;
+  last_timestamp_ = 0;
+  sample_count_ = 0;
+  dropped_ = 0;
+  write_frame(CAPTURE_SESSION_START, p, sizeof(p));
+}
+
+// SAMPLES payload: base timestamp (u32), count (u8), then per sample the
+// delta to the previous timestamp (u16) and x, y, z (i16)
+void CaptureWriter::add_sample(uint32_t timestamp_us,
+                               const Gyroscope_RawData &sample) {
+  uint32_t delta = timestamp_us - last_timestamp_;
+  if (batch_count_ > 0 && delta > 0xFFFF) flush();  // start a new base
+  uint8_t *batch = frame_ + CAPTURE_HEADER_SIZE;
+  if (batch_count_ == 0) {
+    put_u32(batch, timestamp_us);
+    delta = 0;
+  }
+
+  uint8_t *p = batch + 5 + batch_count_ * CAPTURE_SAMPLE_SIZE;
+  put_u16(p, (uint16_t)delta);
+  put_u16(p + 2, (uint16_t)sample.x_raw);
+  put_u16(p + 4, (uint16_t)sample.y_raw);
+  put_u16(p + 6, (uint16_t)sample.z_raw);
+  batch_count_++;
+  last_timestamp_ = timestamp_us;
+  sample_count_++;
+
+  if (batch_count_ == CAPTURE_BATCH_SAMPLES) flush();
+}
+
+void CaptureWriter::flush() {
+  if (batch_count_ == 0) return;
+  uint8_t *batch = frame_ + CAPTURE_HEADER_SIZE;
+  batch[4] = batch_count_;
+  if (!write_frame(CAPTURE_SAMPLES, batch,
+                   (uint16_t)(5 + batch_count_ * CAPTURE_SAMPLE_SIZE))) {
+    dropped_ += batch_count_;
+  }
+  batch_count_ = 0;
+}
+
+// ATTEMPT payload: attempt (u32), uptime (u32), outcome (u8), axes matched
+// (u8), correlation x, y, z (f32), stage count (u8), then per stage the
+// time in us (u32)
+void CaptureWriter::add_attempt(const Capture_Attempt &attempt) {
+  flush();
+  uint8_t p[ATTEMPT_PAYLOAD_SIZE];
+  put_u32(p, attempt.attempt);
+  put_u32(p + 4, attempt.uptime_ms);
+  p[8] = attempt.outcome;
+  p[9] = attempt.axes_matched;
+  for (int i = 0; i < 3; i++) {
+    uint32_t bits;
+    memcpy(&bits, &attempt.correlation[i], sizeof(bits));
+    put_u32(p + 10 + 4 * i, bits);
+  }
+  p[22] = PROFILE_STAGE_COUNT;
+  for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    put_u32(p + 23 + 4 * i, attempt.stage_us[i]);
+  }
+  write_frame(CAPTURE_ATTEMPT, p, sizeof(p));
+}
+
+void CaptureWriter::end_session() {
+  flush();
+  uint8_t p[SUMMARY_PAYLOAD_SIZE];
+  put_u32(p, sample_count_);
+  put_u32(p + 4, dropped_);
+  write_frame(CAPTURE_SESSION_END, p, sizeof(p));
+}
+
+/*******************************************************************************
+ * CaptureParser
+ * ****************************************************************************/
+CaptureParser::CaptureParser() : crc_errors_(0), skipped_(0) { reset(); }
+
+void CaptureParser::reset() {
+  state_ = SYNC_0;
+  size_ = 0;
+  received_ = 0;
+}
+
+bool CaptureParser::push(uint8_t byte) {
+  switch (state_) {
+    case SYNC_0:
+      if (byte == CAPTURE_SYNC_0) {
+        state_ = SYNC_1;
+      } else {
+        skipped_++;
+      }
+      return false;
+
+    case SYNC_1:
+      if (byte == CAPTURE_SYNC_1) {
+        state_ = TYPE;
+      } else {
+        skipped_++;
+        state_ = byte == CAPTURE_SYNC_0 ? SYNC_1 : SYNC_0;
+      }
+      return false;
+
+    case TYPE:
+      type_ = byte;
+      crc_ = crc16_ccitt(&byte, 1);
+      state_ = LEN_LO;
+      return false;
+
+    case LEN_LO:
+      size_ = byte;
+      crc_ = crc16_ccitt(&byte, 1, crc_);
+      state_ = LEN_HI;
+      return false;
+
+    case LEN_HI:
+      size_ |= (uint16_t)byte << 8;
+      crc_ = crc16_ccitt(&byte, 1, crc_);
+      received_ = 0;
+      if (size_ > CAPTURE_MAX_PAYLOAD) {
+        crc_errors_++;  // cannot be a frame of ours
+        reset();
+      } else {
+        state_ = size_ > 0 ? PAYLOAD : CRC_LO;
+      }
+      return false;
+
+    case PAYLOAD:
+      payload_[received_++] = byte;
+      if (received_ == size_) {
+        crc_ = crc16_ccitt(payload_, size_, crc_);
+        state_ = CRC_LO;
+      }
+      return false;
+
+    case CRC_LO:
+      crc_lo_ = byte;
+      state_ = CRC_HI;
+      return false;
+
+    case CRC_HI: {
+      uint16_t crc = (uint16_t)(crc_lo_ | byte << 8);
+      state_ = SYNC_0;
+      if (crc != crc_) {
+        crc_errors_++;
+        return false;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+/*******************************************************************************
+ * Payload decoders
+ * ****************************************************************************/
+bool DecodeCaptureSession(const uint8_t *p, uint16_t size,
+                          Capture_Session &session) {
+  if (size < SESSION_PAYLOAD_SIZE || p[0] != CAPTURE_VERSION) return false;
+
+  uint32_t sensitivity_bits = get_u32(p + 8);
+  session.session_id = get_u32(p + 1);
+  session.sample_rate_hz = get_u16(p + 5);
+  session.full_scale = p[7];
+  memcpy(&session.sensitivity, &sensitivity_bits, sizeof(session.sensitivity));
+  session.calibration.x_offset = (int16_t)get_u16(p + 12);
+  session.calibration.y_offset = (int16_t)get_u16(p + 14);
+  session.calibration.z_offset = (int16_t)get_u16(p + 16);
+  session.calibration.x_threshold = (int16_t)get_u16(p + 18);
+  session.calibration.y_threshold = (int16_t)get_u16(p + 20);
+  session.calibration.z_threshold = (int16_t)get_u16(p + 22);
+  return true;
+}
+
+size_t DecodeCaptureSamples(const uint8_t *p, uint16_t size,
+                            Capture_Sample *samples) {
+  if (size < 5) return 0;
+  size_t count = p[4];
+  if (count > CAPTURE_BATCH_SAMPLES ||
+      size != 5 + count * CAPTURE_SAMPLE_SIZE) {
+    return 0;
+  }
+
+  uint32_t timestamp = get_u32(p);
+  p += 5;
+  for (size_t i = 0; i < count; i++, p += CAPTURE_SAMPLE_SIZE) {
+    timestamp += get_u16(p);
+    samples[i].timestamp_us = timestamp;
+    samples[i].data.x_raw = (int16_t)get_u16(p + 2);
+    samples[i].data.y_raw = (int16_t)get_u16(p + 4);
+    samples[i].data.z_raw = (int16_t)get_u16(p + 6);
+  }
+  return count;
+}
+
+// Stages the writer did not know read as 0, extra ones are ignored
+bool DecodeCaptureAttempt(const uint8_t *p, uint16_t size,
+                          Capture_Attempt &attempt) {
+  if (size < 23 || size != 23 + 4 * p[22]) return false;
+  attempt.attempt = get_u32(p);
+  attempt.uptime_ms = get_u32(p + 4);
+  attempt.outcome = p[8];
+  attempt.axes_matched = p[9];
+  for (int i = 0; i < 3; i++) {
+    uint32_t bits = get_u32(p + 10 + 4 * i);
+    memcpy(&attempt.correlation[i], &bits, sizeof(bits));
+  }
+  for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    attempt.stage_us[i] = i < p[22] ? get_u32(p + 23 + 4 * i) : 0;
+  }
+  return true;
+}
+
+bool DecodeCaptureSummary(const uint8_t *p, uint16_t size,
+                          Capture_Summary &summary) {
+  if (size < SUMMARY_PAYLOAD_SIZE) return false;
+  summary.sample_count = get_u32(p);
+  summary.dropped = get_u32(p + 4);
+  return true;
+}
+
+/*******************************************************************************
+ * SessionReplaySource
+ * ****************************************************************************/
+SessionReplaySource::SessionReplaySource(const char *path, float speed)
+    : path_(path),
+      file_(nullptr),
+      speed_(speed),
+      pending_start_(false),
+      in_session_(false),
+      has_attempt_(false),
+      batch_size_(0),
+      batch_pos_(0),
+      timestamp_us_(0) {
+  memset(&session_, 0, sizeof(session_));
+}
+
+SessionReplaySource::~SessionReplaySource() {
+  if (file_ != nullptr) fclose(file_);
+}
+
+bool SessionReplaySource::init(const Gyroscope_Init_Parameters &params) {
+  (void)params;  // the session metadata describes the sensor
+  if (file_ != nullptr) fclose(file_);
+  file_ = fopen(path_, "rb");
+  if (file_ == nullptr) {
+    printf("Replay: cannot open %s\n", path_);
+    return false;
+  }
+  parser_.reset();
+  pending_start_ = false;
+  in_session_ = false;
+  return next_session();
+}
+
+// Parse up to and including the next frame; false at the end of the file
+bool SessionReplaySource::next_frame() {
+  int c;
+  while ((c = getc(file_)) != EOF) {
+    if (!parser_.push((uint8_t)c)) continue;
+
+    switch (parser_.type()) {
+      case CAPTURE_SESSION_START:
+        if (DecodeCaptureSession(parser_.payload(), parser_.size(),
+                                 pending_)) {
+          pending_start_ = true;
+          in_session_ = false;  // a session without its end frame
+        }
+        return true;
+
+      case CAPTURE_SAMPLES:
+        if (in_session_) {
+          batch_size_ = DecodeCaptureSamples(parser_.payload(),
+                                             parser_.size(), batch_);
+          batch_pos_ = 0;
+        }
+        return true;
+
+      case CAPTURE_ATTEMPT:
+        if (in_session_) {
+          has_attempt_ = DecodeCaptureAttempt(parser_.payload(),
+                                              parser_.size(), attempt_);
+        }
+        return true;
+
+      case CAPTURE_SESSION_END:
+        in_session_ = false;
+        return true;
+
+      default:
+        return true;  // unknown frame types are skipped
+    }
+  }
+  return false;
+}
+
+bool SessionReplaySource::next_session() {
+  if (file_ == nullptr) return false;
+
+  in_session_ = false;
+  while (!pending_start_) {
+    if (!next_frame()) return false;
+  }
+  session_ = pending_;
+  pending_start_ = false;
+  in_session_ = true;
+  has_attempt_ = false;
+  batch_size_ = 0;
+  batch_pos_ = 0;
+  timestamp_us_ = 0;
+  clock_.reset();
+  clock_.start();
+  return true;
+}
+
+bool SessionReplaySource::attempt(Capture_Attempt &attempt) const {
+  if (has_attempt_) attempt = attempt_;
+  return has_attempt_;
+}
+
+bool SessionReplaySource::read(Gyroscope_RawData &sample) {
+  while (batch_pos_ == batch_size_) {
+    if (!in_session_ || !next_frame()) return false;
+  }
+  const Capture_Sample &next = batch_[batch_pos_++];
+  if (speed_ > 0.0f) pace(next.timestamp_us);
+  timestamp_us_ = next.timestamp_us;
+  sample = next.data;
+  return true;
+}
+
+// Sleep until the (scaled) capture time of the sample; short gaps are
+// accumulated rather than slept, so high speeds stay accurate on average
+void SessionReplaySource::pace(uint32_t timestamp_us) {
+  int64_t due = (int64_t)(timestamp_us / speed_);
+  int64_t now = clock_.elapsed_time().count();
+  if (due - now > 200) wait_us((int)(due - now));
+}
+
+/*******************************************************************************
+ * CapturingGyroSource
+ * ****************************************************************************/
+CapturingGyroSource::CapturingGyroSource(GyroSource &inner,
+                                         CaptureWriter &writer)
+    : inner_(inner), writer_(writer) {}
+
+bool CapturingGyroSource::init(const Gyroscope_Init_Parameters &params) {
+  return inner_.init(params);
+}
+
+void CapturingGyroSource::begin(const Capture_Session &session) {
+  clock_.reset();
+  clock_.start();
+  writer_.begin_session(session);
+}
+
+void CapturingGyroSource::end() {
+  clock_.stop();
+  writer_.end_session();
+}
+
+bool CapturingGyroSource::read(Gyroscope_RawData &sample) {
+  if (!inner_.read(sample)) return false;
+  uint32_t now = (uint32_t)clock_.elapsed_time().count();
+  writer_.add_sample(now, sample);
+  return true;
+}
@@ -0,0 +1,303 @@
+/**
+ * @file capture_format.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Framed binary capture format for raw gyro sessions.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * A capture is a byte stream of frames, on the serial port or in a file:
+ *
+ *   0xA5 0x5A | type (u8) | length (u16) | payload | CRC-16/CCITT (u16)
+ *
+ * All integers are little-endian and the CRC covers type, length and
+ * payload. A session is a SESSION_START frame, any number of SAMPLES frames
+ * and a SESSION_END frame. Bytes outside frames (console text) are skipped
+ * by the parser, so frames can share the port with printf output as long as
+ * no text lands inside a frame: a writer hands each frame to its sink in a
+ * single call, and the firmware's console sink holds the console's lock
+ * for that call (see SerialConsole in main.cpp).
+ *
+ * Sessions dumped from the black box (see blackbox.h) also carry an
+ * ATTEMPT frame before their SESSION_END: the verdict, scores and stage
+ * timings of the attempt. Readers that do not know it skip it.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef CAPTURE_FORMAT_H
+#define CAPTURE_FORMAT_H
+
+#include "capture.h"
+#include "profiler.h"
+#include "system_config.h"
+
+#define CAPTURE_SYNC_0 0xA5
+#define CAPTURE_SYNC_1 0x5A
+#define CAPTURE_VERSION 1
+#define CAPTURE_HEADER_SIZE 5        // sync, sync, type, length
+#define CAPTURE_BATCH_SAMPLES 32     // samples per SAMPLES frame
+#define CAPTURE_SAMPLE_SIZE 8        // delta-t (u16) + x, y, z (i16)
+#define CAPTURE_MAX_PAYLOAD (5 + CAPTURE_BATCH_SAMPLES * CAPTURE_SAMPLE_SIZE)
+#define CAPTURE_MAX_FRAME (CAPTURE_HEADER_SIZE + CAPTURE_MAX_PAYLOAD + 2)
+
+// Frame types
+#define CAPTURE_SESSION_START 0x01
+#define CAPTURE_SAMPLES 0x02
+#define CAPTURE_SESSION_END 0x03
+#define CAPTURE_ATTEMPT 0x04
+
+// Outcomes in an ATTEMPT frame
+#define CAPTURE_OUTCOME_INCOMPLETE 0  // no verdict (interrupted or reset)
+#define CAPTURE_OUTCOME_ENROLLED 1    // the recording became the key
+#define CAPTURE_OUTCOME_UNLOCKED 2
+#define CAPTURE_OUTCOME_REJECTED 3
+#define CAPTURE_OUTCOME_NO_KEY 4      // unlock attempt without a key
+
+// Metadata written at the start of a session
+typedef struct {
+  uint32_t session_id;                // increments per session
+  uint16_t sample_rate_hz;            // sensor output data rate
+  uint8_t full_scale;                 // CTRL_REG_4 full-scale selection
+  float sensitivity;                  // dps/digit of the raw samples
+  Gyroscope_Calibration calibration;  // zero-rate level and dead-band
+} Capture_Session;
+
+// One raw sample with its capture time
+typedef struct {
+  uint32_t timestamp_us;   // since the start of the session
+  Gyroscope_RawData data;  // uncalibrated sensor output
+} Capture_Sample;
+
+// What became of the recording of a session
+typedef struct {
+  uint32_t attempt;                         // black box attempt number
+  uint32_t uptime_ms;                       // when the recording started
+  uint8_t outcome;                          // CAPTURE_OUTCOME_*
+  uint8_t axes_matched;                     // axes above the threshold
+  float correlation[3];                     // per-axis scores (NaN if none)
+  uint32_t stage_us[PROFILE_STAGE_COUNT];   // profiled time per stage
+} Capture_Attempt;
+
+// Trailer written at the end of a session
+typedef struct {
+  uint32_t sample_count;  // samples written in the session
+  uint32_t dropped;       // samples the sink refused
+} Capture_Summary;
+
+/**
+ * @brief CRC-16/CCITT-FALSE
+ * @param data: bytes to checksum
+ * @param size: number of bytes
+ * @param crc: running value (0xFFFF to start)
+ * @return the updated CRC
+ */
+uint16_t crc16_ccitt(const uint8_t *data, size_t size, uint16_t crc = 0xFFFF);
+
+/**
+ * @brief Encodes a session into frames and hands them to a byte sink.
+ *
+ * Samples are batched CAPTURE_BATCH_SAMPLES per frame with 16-bit time
+ * deltas, 8 bytes per sample plus 10 bytes of framing per batch. Every frame
+ * is assembled whole and given to the sink in one call.
+ */
+class CaptureWriter {
+ public:
+  // Writes bytes somewhere; returns how many were accepted. Called once per
+  // frame, with the whole frame.
+  typedef size_t (*Sink)(void *context, const uint8_t *data, size_t size);
+
+  CaptureWriter(Sink sink, void *context);
+
+  void begin_session(const Capture_Session &session);
+  void add_sample(uint32_t timestamp_us, const Gyroscope_RawData &sample);
+
+  /**
+   * @brief Emit an ATTEMPT frame (after the samples of the session)
+   */
+  void add_attempt(const Capture_Attempt &attempt);
+
+  void end_session();
+
+  /**
+   * @brief Emit the pending batch, if any
+   */
+  void flush();
+
+  uint32_t sample_count() const { return sample_count_; }
+  uint32_t dropped() const { return dropped_; }
+
+ private:
+  bool write_frame(uint8_t type, const uint8_t *payload, uint16_t size);
+
+  Sink sink_;
+  void *context_;
+  uint8_t frame_[CAPTURE_MAX_FRAME];  // the payload is built in place
+  uint8_t batch_count_;
+  uint32_t last_timestamp_;
+  uint32_t sample_count_;
+  uint32_t dropped_;
+};
+
+/**
+ * @brief Incremental frame parser for a capture byte stream.
+ *
+ * Feed bytes one at a time; push() returns true when a frame with a valid
+ * CRC is complete and can be read through type()/payload()/size(). Frames
+ * failing the CRC are counted and skipped.
+ */
+class CaptureParser {
+ public:
+  CaptureParser();
+
+  bool push(uint8_t byte);
+  void reset();
+
+  uint8_t type() const { return type_; }
+  const uint8_t *payload() const { return payload_; }
+  uint16_t size() const { return size_; }
+  uint32_t crc_errors() const { return crc_errors_; }
+  uint32_t skipped_bytes() const { return skipped_; }
+
+ private:
+  enum State { SYNC_0, SYNC_1, TYPE, LEN_LO, LEN_HI, PAYLOAD, CRC_LO, CRC_HI };
+
+  State state_;
+  uint8_t type_;
+  uint16_t size_;
+  uint16_t received_;
+  uint16_t crc_;
+  uint8_t crc_lo_;
+  uint8_t payload_[CAPTURE_MAX_PAYLOAD];
+  uint32_t crc_errors_;
+  uint32_t skipped_;
+};
+
+/**
+ * @brief Decode a SESSION_START payload
+ * @return false if the payload is malformed or of an unknown version
+ */
+bool DecodeCaptureSession(const uint8_t *payload, uint16_t size,
+                          Capture_Session &session);
+
+/**
+ * @brief Decode a SAMPLES payload
+ * @param samples: receives up to CAPTURE_BATCH_SAMPLES samples
+ * @return the number of samples decoded (0 if malformed)
+ */
+size_t DecodeCaptureSamples(const uint8_t *payload, uint16_t size,
+                            Capture_Sample *samples);
+
+/**
+ * @brief Decode an ATTEMPT payload
+ * @return false if the payload is malformed
+ */
+bool DecodeCaptureAttempt(const uint8_t *payload, uint16_t size,
+                          Capture_Attempt &attempt);
+
+/**
+ * @brief Decode a SESSION_END payload
+ * @return false if the payload is malformed
+ */
+bool DecodeCaptureSummary(const uint8_t *payload, uint16_t size,
+                          Capture_Summary &summary);
+
+/**
+ * @brief Replays the sessions of a capture file into the pipeline.
+ *
+ * read() delivers the raw samples of the current session and returns false
+ * at its SESSION_END; next_session() moves on to the following one. With a
+ * speed of 0 samples are delivered as fast as the file is read, otherwise
+ * the capture timestamps are honored, divided by the speed factor (1000
+ * replays a 3 s recording in 3 ms).
+ */
+class SessionReplaySource : public GyroSource {
+ public:
+  explicit SessionReplaySource(const char *path, float speed = 0.0f);
+  ~SessionReplaySource() override;
+
+  /**
+   * @brief Open the file and position on its first session
+   * @return false if the file cannot be opened or holds no session
+   */
+  bool init(const Gyroscope_Init_Parameters &params) override;
+  bool read(Gyroscope_RawData &sample) override;
+  float sensitivity() const override { return session_.sensitivity; }
+
+  /**
+   * @brief Skip to the start of the next session in the file
+   * @return false at the end of the file
+   */
+  bool next_session();
+
+  const Capture_Session &session() const { return session_; }
+
+  /**
+   * @brief The ATTEMPT frame of the current session, once read() has
+   * reached its end
+   * @return false if the session has none
+   */
+  bool attempt(Capture_Attempt &attempt) const;
+
+  uint32_t timestamp_us() const { return timestamp_us_; }
+  void set_speed(float speed) { speed_ = speed; }
+  uint32_t crc_errors() const { return parser_.crc_errors(); }
+
+ private:
+  SessionReplaySource(const SessionReplaySource &) = delete;
+  SessionReplaySource &operator=(const SessionReplaySource &) = delete;
+
+  bool next_frame();
+  void pace(uint32_t timestamp_us);
+
+  const char *path_;
+  FILE *file_;
+  float speed_;
+  CaptureParser parser_;
+  Capture_Session session_;
+  Capture_Session pending_;
+  Capture_Attempt attempt_;
+  bool pending_start_;
+  bool in_session_;
+  bool has_attempt_;
+  Capture_Sample batch_[CAPTURE_BATCH_SAMPLES];
+  size_t batch_size_;
+  size_t batch_pos_;
+  uint32_t timestamp_us_;
+  Timer clock_;
+};
+
+/**
+ * @brief A GyroSource decorator that streams every sample it reads.
+ *
+ * Wraps the live source during a recording; the timestamps are taken from
+ * a Timer started by begin().
+ */
+class CapturingGyroSource : public GyroSource {
+ public:
+  CapturingGyroSource(GyroSource &inner, CaptureWriter &writer);
+
+  /**
+   * @brief Start a session with the given calibration
+   */
+  void begin(const Capture_Session &session);
+
+  /**
+   * @brief Close the session
+   */
+  void end();
+
+  bool init(const Gyroscope_Init_Parameters &params) override;
+  bool read(Gyroscope_RawData &sample) override;
+  float sensitivity() const override { return inner_.sensitivity(); }
+  void power_off() override { inner_.power_off(); }
+
+ private:
+  GyroSource &inner_;
+  CaptureWriter &writer_;
+  Timer clock_;
+};
+
+#endif  // CAPTURE_FORMAT_H
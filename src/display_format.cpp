@@ -0,0 +1,86 @@
+/**
+ * @file display_format.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Pixel format of the display's frame buffers.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "display_format.h"
+
+// The LCD_COLOR_ colors, first so they map to themselves
+static const uint32_t kNamedColors[] = {
+    LCD_COLOR_BLUE,      LCD_COLOR_GREEN,        LCD_COLOR_RED,
+    LCD_COLOR_CYAN,      LCD_COLOR_MAGENTA,      LCD_COLOR_YELLOW,
+    LCD_COLOR_LIGHTBLUE, LCD_COLOR_LIGHTGREEN,   LCD_COLOR_LIGHTRED,
+    LCD_COLOR_LIGHTCYAN, LCD_COLOR_LIGHTMAGENTA, LCD_COLOR_LIGHTYELLOW,
+    LCD_COLOR_DARKBLUE,  LCD_COLOR_DARKGREEN,    LCD_COLOR_DARKRED,
+    LCD_COLOR_DARKCYAN,  LCD_COLOR_DARKMAGENTA,  LCD_COLOR_DARKYELLOW,
+    LCD_COLOR_WHITE,     LCD_COLOR_LIGHTGRAY,    LCD_COLOR_GRAY,
+    LCD_COLOR_DARKGRAY,  LCD_COLOR_BLACK,        LCD_COLOR_BROWN,
+    LCD_COLOR_ORANGE};
+
+/*******************************************************************************
+ *
+ * @brief The named colors, a 6x6x6 color cube, then grays up to 256 entries
+ *
+ * ****************************************************************************/
+uint32_t *DisplayPalette() {
+  static uint32_t palette[DISPLAY_PALETTE_SIZE];
+  static bool built = false;
+  if (built) return palette;
+
+  size_t n = 0;
+  for (uint32_t color : kNamedColors) palette[n++] = color & 0x00FFFFFF;
+  for (uint32_t r = 0; r < 6; r++) {
+    for (uint32_t g = 0; g < 6; g++) {
+      for (uint32_t b = 0; b < 6; b++) {
+        palette[n++] = (r * 51) << 16 | (g * 51) << 8 | b * 51;
+      }
+    }
+  }
+  size_t grays = DISPLAY_PALETTE_SIZE - n;
+  for (size_t i = 0; i < grays; i++) {
+    uint32_t level = (uint32_t)(255 * (i + 1) / (grays + 1));
+    palette[n++] = level << 16 | level << 8 | level;
+  }
+  built = true;
+  return palette;
+}
+
+void DisplayFormatApply(LCD_DISCO_F429ZI &lcd, uint32_t format) {
+  if (format == LCD_PIXEL_FORMAT_L8) {
+    lcd.SetCLUT(0, DisplayPalette(), DISPLAY_PALETTE_SIZE);
+  }
+  lcd.SetPixelFormat(0, format);
+}
+
+Display_Format_Report DisplayFormatReport(LCD_DISCO_F429ZI &lcd) {
+  Display_Format_Report report;
+  switch (lcd.GetPixelFormat(0)) {
+    case LCD_PIXEL_FORMAT_ARGB8888:
+      report.name = "ARGB8888";
+      break;
+    case LCD_PIXEL_FORMAT_RGB565:
+      report.name = "RGB565";
+      break;
+    case LCD_PIXEL_FORMAT_L8:
+      report.name = "L8";
+      break;
+    default:
+      report.name = "other";
+      break;
+  }
+  report.bytes_per_pixel = lcd.GetBytesPerPixel(0);
+  report.frame_bytes = lcd.GetXSize() * lcd.GetYSize() * report.bytes_per_pixel;
+  report.buffers_bytes = 2 * report.frame_bytes;
+  report.scanout_bytes_per_s =
+      (uint32_t)((uint64_t)report.frame_bytes * 1000000 / DISPLAY_REFRESH_US);
+  return report;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file display_format.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Pixel format of the display's frame buffers, and what it costs in
+ * SDRAM and bus traffic.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * The LTDC reads the frame buffer it scans out from the SDRAM every refresh,
+ * over the FMC bus the capture and scratch arenas share: 300 KB a frame, 20
+ * MB/s, in ARGB8888, and every fill, copy and glyph writes 4 bytes a pixel.
+ * DisplayFormatApply() puts layer 0 in DISPLAY_PIXEL_FORMAT instead:
+ *
+ *   - LCD_PIXEL_FORMAT_RGB565: 2 bytes a pixel. The DMA2D fills, copies
+ *     and blends glyphs in it as in ARGB8888, converting on the way out;
+ *     colors lose their low bits (5-6-5).
+ *   - LCD_PIXEL_FORMAT_L8: 1 byte a pixel, an index into a 256-color CLUT
+ *     (DisplayPalette(): the LCD_COLOR_ colors, a 6x6x6 cube and grays). A
+ *     color is stored as its nearest entry. The DMA2D cannot write L8, so
+ *     fills, copies and text are CPU stores.
+ *   - LCD_PIXEL_FORMAT_ARGB8888: as the BSP sets the layer up.
+ *
+ * Colors are given in ARGB8888 everywhere still; the BSP converts them as
+ * it stores them. The buffers stay where they are (DISPLAY_FRONT_BUFFER,
+ * DISPLAY_BACK_BUFFER), each using the front of its ARGB8888 space.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef DISPLAY_FORMAT_H
+#define DISPLAY_FORMAT_H
+
+#include "system_config.h"
+
+#define DISPLAY_PALETTE_SIZE 256
+
+// Frame buffer memory and traffic of a display format
+typedef struct {
+  const char *name;              // "ARGB8888", "RGB565" or "L8"
+  uint32_t bytes_per_pixel;
+  uint32_t frame_bytes;          // one frame buffer
+  uint32_t buffers_bytes;        // the two FrameBuffers flips between
+  uint32_t scanout_bytes_per_s;  // read by the LTDC, one frame a refresh
+} Display_Format_Report;
+
+/**
+ * @brief The palette of L8 frame buffers, RGB in the low 24 bits
+ */
+uint32_t *DisplayPalette();
+
+/**
+ * @brief Put layer 0 in a pixel format, with DisplayPalette() as its CLUT
+ * for L8; what it shows has to be redrawn
+ */
+void DisplayFormatApply(LCD_DISCO_F429ZI &lcd,
+                        uint32_t format = DISPLAY_PIXEL_FORMAT);
+
+/**
+ * @brief The memory and traffic of layer 0's format
+ */
+Display_Format_Report DisplayFormatReport(LCD_DISCO_F429ZI &lcd);
+
+#endif  // DISPLAY_FORMAT_H
@@ -22,8 +22,149 @@
 #define LCD_FRAME_BUFFER_LAYER1                  LCD_FRAME_BUFFER
 #define CONVERTED_FRAME_BUFFER                   (LCD_FRAME_BUFFER+0x260000)
 
+/* The BSP's LTDC handle, with the layers' frame buffer addresses */
+extern "C" LTDC_HandleTypeDef LtdcHandler;
+
+static DMA2D_HandleTypeDef Dma2dCopyHandler;
+static DMA2D_HandleTypeDef Dma2dBlendHandler;
+
+/**
+  * @brief  Copies a rectangle of pixels with the CPU, line by line, first
+  *         to last as the DMA2D copies; each line may overlap its source.
+  * @param  From: first pixel of the source
+  * @param  To: first pixel of the destination
+  * @param  Width: rectangle width
+  * @param  Height: rectangle height
+  * @param  LineOffset: pixels between the end of a line and the next one
+  * @param  Bytes: bytes per pixel
+  */
+static void CopyLines(uint32_t From, uint32_t To, uint16_t Width, uint16_t Height, uint32_t LineOffset, uint32_t Bytes)
+{
+  uint32_t pitch = (Width + LineOffset) * Bytes;
+
+  for (uint16_t y = 0; y < Height; y++)
+  {
+    memmove((uint8_t *)To + y * pitch, (const uint8_t *)From + y * pitch, Width * Bytes);
+  }
+}
+
+/**
+  * @brief  Copies a rectangle of pixels with the DMA2D, first line to last.
+  * @param  From: first pixel of the source
+  * @param  To: first pixel of the destination
+  * @param  Width: rectangle width
+  * @param  Height: rectangle height
+  * @param  LineOffset: pixels between the end of a line and the next one
+  * @param  Bytes: bytes per pixel, 4 (ARGB8888) or 2 (RGB565)
+  * @retval HAL status; HAL_ERROR for L8, which the DMA2D cannot write
+  */
+static HAL_StatusTypeDef CopyBuffer(uint32_t From, uint32_t To, uint16_t Width, uint16_t Height, uint32_t LineOffset, uint32_t Bytes)
+{
+  HAL_StatusTypeDef status;
+
+  if ((Width == 0) || (Height == 0))
+  {
+    return HAL_OK;
+  }
+  if ((Bytes != 4) && (Bytes != 2))
+  {
+    return HAL_ERROR;
+  }
+
+  /* Memory to memory, the same format in and out */
+  Dma2dCopyHandler.Instance = DMA2D;
+  Dma2dCopyHandler.Init.Mode         = DMA2D_M2M;
+  Dma2dCopyHandler.Init.ColorMode    = (Bytes == 2) ? DMA2D_RGB565 : DMA2D_ARGB8888;
+  Dma2dCopyHandler.Init.OutputOffset = LineOffset;
+  Dma2dCopyHandler.LayerCfg[1].AlphaMode = DMA2D_NO_MODIF_ALPHA;
+  Dma2dCopyHandler.LayerCfg[1].InputAlpha = 0xFF;
+  Dma2dCopyHandler.LayerCfg[1].InputColorMode = (Bytes == 2) ? CM_RGB565 : CM_ARGB8888;
+  Dma2dCopyHandler.LayerCfg[1].InputOffset = LineOffset;
+
+  status = HAL_DMA2D_Init(&Dma2dCopyHandler);
+  if (status == HAL_OK)
+  {
+    status = HAL_DMA2D_ConfigLayer(&Dma2dCopyHandler, 1);
+  }
+  if (status == HAL_OK)
+  {
+    status = HAL_DMA2D_Start(&Dma2dCopyHandler, From, To, Width, Height);
+  }
+  if (status == HAL_OK)
+  {
+    status = HAL_DMA2D_PollForTransfer(&Dma2dCopyHandler, 10);
+  }
+  if (status == HAL_TIMEOUT)
+  {
+    /* Timed out: stop the transfer before the CPU writes the same pixels */
+    HAL_DMA2D_Abort(&Dma2dCopyHandler);
+  }
+  return status;
+}
+
+/**
+  * @brief  Draws an A8 mask with the DMA2D: each pixel is the foreground
+  *         color blended over the background color by the mask's alpha,
+  *         converted to ARGB8888 or RGB565.
+  * @param  pMask: Width x Height alpha values
+  * @param  pOpaque: as many 0xFF values, the background's alpha
+  * @param  To: first pixel of the destination
+  * @param  Width: mask width
+  * @param  Height: mask height
+  * @param  LineOffset: pixels between the end of a line and the next one
+  * @param  Foreground: foreground color ARGB(8-8-8-8)
+  * @param  Background: background color ARGB(8-8-8-8)
+  * @param  Bytes: bytes per pixel of the destination, 4 or 2
+  * @retval HAL status; HAL_ERROR for any other pixel size
+  */
+static HAL_StatusTypeDef BlendMask(const uint8_t *pMask, const uint8_t *pOpaque, uint32_t To, uint16_t Width, uint16_t Height, uint32_t LineOffset, uint32_t Foreground, uint32_t Background, uint32_t Bytes)
+{
+  HAL_StatusTypeDef status;
+
+  if ((Bytes != 4) && (Bytes != 2))
+  {
+    return HAL_ERROR;
+  }
+
+  /* Memory to memory with blending, A8 in, ARGB8888 or RGB565 out */
+  Dma2dBlendHandler.Instance = DMA2D;
+  Dma2dBlendHandler.Init.Mode         = DMA2D_M2M_BLEND;
+  Dma2dBlendHandler.Init.ColorMode    = (Bytes == 2) ? DMA2D_RGB565 : DMA2D_ARGB8888;
+  Dma2dBlendHandler.Init.OutputOffset = LineOffset;
+
+  /* In A8 mode a layer's color comes from InputAlpha, its alpha from memory */
+  Dma2dBlendHandler.LayerCfg[1].AlphaMode = DMA2D_NO_MODIF_ALPHA;
+  Dma2dBlendHandler.LayerCfg[1].InputAlpha = Foreground & 0x00FFFFFF;
+  Dma2dBlendHandler.LayerCfg[1].InputColorMode = CM_A8;
+  Dma2dBlendHandler.LayerCfg[1].InputOffset = 0;
+  Dma2dBlendHandler.LayerCfg[0].AlphaMode = DMA2D_NO_MODIF_ALPHA;
+  Dma2dBlendHandler.LayerCfg[0].InputAlpha = Background & 0x00FFFFFF;
+  Dma2dBlendHandler.LayerCfg[0].InputColorMode = CM_A8;
+  Dma2dBlendHandler.LayerCfg[0].InputOffset = 0;
+
+  status = HAL_DMA2D_Init(&Dma2dBlendHandler);
+  if (status == HAL_OK)
+  {
+    status = HAL_DMA2D_ConfigLayer(&Dma2dBlendHandler, 0);
+  }
+  if (status == HAL_OK)
+  {
+    status = HAL_DMA2D_ConfigLayer(&Dma2dBlendHandler, 1);
+  }
+  if (status == HAL_OK)
+  {
+    status = HAL_DMA2D_BlendingStart(&Dma2dBlendHandler, (uint32_t)pMask, (uint32_t)pOpaque, To, Width, Height);
+  }
+  if (status == HAL_OK)
+  {
+    status = HAL_DMA2D_PollForTransfer(&Dma2dBlendHandler, 10);
+  }
+  return status;
+}
+
 // Constructor
 LCD_DISCO_F429ZI::LCD_DISCO_F429ZI()
+  : ActiveLayer(0), pAtlasFont(NULL), pAtlas(NULL)
 {
   BSP_LCD_Init();  
   BSP_LCD_LayerDefaultInit(1, LCD_FRAME_BUFFER_LAYER1);
@@ -71,6 +212,7 @@ void LCD_DISCO_F429ZI::LayerDefaultInit(uint16_t LayerIndex, uint32_t FB_Address
 
 void LCD_DISCO_F429ZI::SelectLayer(uint32_t LayerIndex)
 {
+  ActiveLayer = LayerIndex;
   BSP_LCD_SelectLayer(LayerIndex);
 }
 
@@ -89,6 +231,42 @@ void LCD_DISCO_F429ZI::SetLayerAddress(uint32_t LayerIndex, uint32_t Address)
   BSP_LCD_SetLayerAddress(LayerIndex, Address);
 }
 
+void LCD_DISCO_F429ZI::SetLayerAddress_NoReload(uint32_t LayerIndex, uint32_t Address)
+{
+  BSP_LCD_SetLayerAddress_NoReload(LayerIndex, Address);
+}
+
+void LCD_DISCO_F429ZI::SetPixelFormat(uint32_t LayerIndex, uint32_t PixelFormat)
+{
+  BSP_LCD_SetPixelFormat(LayerIndex, PixelFormat);
+}
+
+void LCD_DISCO_F429ZI::SetCLUT(uint32_t LayerIndex, uint32_t *pCLUT, uint32_t Size)
+{
+  BSP_LCD_SetCLUT(LayerIndex, pCLUT, Size);
+}
+
+uint32_t LCD_DISCO_F429ZI::GetPixelFormat(uint32_t LayerIndex)
+{
+  return BSP_LCD_GetPixelFormat(LayerIndex);
+}
+
+uint32_t LCD_DISCO_F429ZI::GetBytesPerPixel(uint32_t LayerIndex)
+{
+  return BSP_LCD_GetBytesPerPixel(LayerIndex);
+}
+
+void LCD_DISCO_F429ZI::Reload(uint32_t ReloadType)
+{
+  BSP_LCD_Relaod(ReloadType);
+}
+
+uint8_t LCD_DISCO_F429ZI::ReloadPending(void)
+{
+  /* The LTDC clears the reload bits once the shadow registers are loaded */
+  return (LTDC->SRCR & (LTDC_SRCR_IMR | LTDC_SRCR_VBR)) != 0;
+}
+
 void LCD_DISCO_F429ZI::SetLayerWindow(uint16_t LayerIndex, uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height)
 {
   BSP_LCD_SetLayerWindow(LayerIndex, Xpos, Ypos, Width, Height);
@@ -151,12 +329,61 @@ void LCD_DISCO_F429ZI::ClearStringLine(uint32_t Line)
 
 void LCD_DISCO_F429ZI::DisplayChar(uint16_t Xpos, uint16_t Ypos, uint8_t Ascii)
 {
+  sFONT *font = BSP_LCD_GetFont();
+  uint32_t text = BSP_LCD_GetTextColor();
+  uint32_t back = BSP_LCD_GetBackColor();
+
+  /* A blend of opaque colors by a 0x00/0xFF mask writes what DrawChar writes,
+     for a glyph that starts on the screen and ends in the frame buffer */
+  if ((pAtlas != NULL) && (font == pAtlasFont) && (Ascii >= ' ') && (Ascii < ' ' + LCD_ATLAS_GLYPHS) &&
+      ((text >> 24) == 0xFF) && ((back >> 24) == 0xFF) && (Xpos < BSP_LCD_GetXSize()) &&
+      ((Ypos + font->Height - 1) * BSP_LCD_GetXSize() + Xpos + font->Width <= BSP_LCD_GetXSize() * BSP_LCD_GetYSize()))
+  {
+    uint32_t cell = font->Width * font->Height;
+    uint32_t bytes = BSP_LCD_GetBytesPerPixel(ActiveLayer);
+    uint32_t to = LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + bytes * (Ypos * BSP_LCD_GetXSize() + Xpos);
+
+    /* The DMA2D cannot write L8; BlendMask() refuses and the BSP draws */
+    if (BlendMask(pAtlas + (Ascii - ' ') * cell, pAtlas + LCD_ATLAS_GLYPHS * cell, to, font->Width, font->Height,
+                  BSP_LCD_GetXSize() - font->Width, text, back, bytes) == HAL_OK)
+    {
+      return;
+    }
+  }
   BSP_LCD_DisplayChar(Xpos, Ypos, Ascii);
 }
 
+void LCD_DISCO_F429ZI::SetGlyphAtlas(sFONT *pFonts, const uint8_t *pAtlas)
+{
+  this->pAtlasFont = pFonts;
+  this->pAtlas = pAtlas;
+}
+
 void LCD_DISCO_F429ZI::DisplayStringAt(uint16_t X, uint16_t Y, uint8_t *pText, Text_AlignModeTypdef mode)
 {
-  BSP_LCD_DisplayStringAt(X, Y, pText, mode);
+  sFONT *font = BSP_LCD_GetFont();
+  uint16_t refcolumn = X;
+  uint32_t size = strlen((const char *)pText);
+  uint32_t xsize = BSP_LCD_GetXSize() / font->Width;
+
+  /* BSP_LCD_DisplayStringAt()'s layout, through DisplayChar() */
+  switch (mode)
+  {
+  case CENTER_MODE:
+    refcolumn = X + ((xsize - size) * font->Width) / 2;
+    break;
+  case RIGHT_MODE:
+    refcolumn = X + ((xsize - size) * font->Width);
+    break;
+  default:
+    break;
+  }
+
+  for (uint32_t i = 0; (*pText != 0) && (((BSP_LCD_GetXSize() - i * font->Width) & 0xFFFF) >= font->Width); i++)
+  {
+    DisplayChar(refcolumn, Y, *pText++);
+    refcolumn += font->Width;
+  }
 }
 
 void LCD_DISCO_F429ZI::DisplayStringAtLine(uint16_t Line, uint8_t *ptr)
@@ -209,6 +436,52 @@ void LCD_DISCO_F429ZI::FillRect(uint16_t Xpos, uint16_t Ypos, uint16_t Width, ui
   BSP_LCD_FillRect(Xpos, Ypos, Width, Height);
 }
 
+void LCD_DISCO_F429ZI::CopyRect(uint32_t FromAddress, uint32_t ToAddress, uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height)
+{
+  uint32_t bytes = BSP_LCD_GetBytesPerPixel(ActiveLayer);
+  uint32_t offset = bytes * (Ypos * BSP_LCD_GetXSize() + Xpos);
+  uint32_t skip = BSP_LCD_GetXSize() - Width;
+
+  /* The CPU copies what the DMA2D cannot (L8) or did not finish */
+  if (CopyBuffer(FromAddress + offset, ToAddress + offset, Width, Height, skip, bytes) != HAL_OK)
+  {
+    CopyLines(FromAddress + offset, ToAddress + offset, Width, Height, skip, bytes);
+  }
+}
+
+void LCD_DISCO_F429ZI::MoveRect(uint32_t Address, uint16_t FromX, uint16_t FromY, uint16_t ToX, uint16_t ToY, uint16_t Width, uint16_t Height)
+{
+  uint32_t bytes = BSP_LCD_GetBytesPerPixel(ActiveLayer);
+  uint32_t pitch = bytes * BSP_LCD_GetXSize();
+  uint32_t from = Address + FromY * pitch + bytes * FromX;
+  uint32_t to = Address + ToY * pitch + bytes * ToX;
+  uint32_t skip = BSP_LCD_GetXSize() - Width;
+  bool overlap = (ToY < FromY + Height) && (FromY < ToY + Height) && (ToX < FromX + Width) && (FromX < ToX + Width);
+
+  if (overlap && (ToY > FromY))
+  {
+    /* Down: last line first, or the first lines moved overwrite the source
+       of the last ones */
+    for (uint16_t y = Height; y > 0; y--)
+    {
+      uint32_t line = (y - 1) * pitch;
+      if (CopyBuffer(from + line, to + line, Width, 1, skip, bytes) != HAL_OK)
+      {
+        CopyLines(from + line, to + line, Width, 1, skip, bytes);
+      }
+    }
+  }
+  else if (overlap && (ToY == FromY) && (ToX > FromX))
+  {
+    /* Right along the same lines: only memmove copies a line over itself */
+    CopyLines(from, to, Width, Height, skip, bytes);
+  }
+  else if (CopyBuffer(from, to, Width, Height, skip, bytes) != HAL_OK)
+  {
+    CopyLines(from, to, Width, Height, skip, bytes);
+  }
+}
+
 void LCD_DISCO_F429ZI::FillCircle(uint16_t Xpos, uint16_t Ypos, uint16_t Radius)
 {
   BSP_LCD_FillCircle(Xpos, Ypos, Radius);
@@ -24,6 +24,9 @@
 #include "mbed.h"
 #include "stm32f429i_discovery_lcd.h"
 
+/* Glyphs of a glyph atlas, ' ' to '~'; the opaque cell follows them */
+#define LCD_ATLAS_GLYPHS 95
+
 /*
   This class drives the LCD display (ILI9341 240x320) present on DISCO_F429ZI board.
 
@@ -117,6 +120,68 @@ public:
     */
   void SetLayerAddress(uint32_t LayerIndex, uint32_t Address);
 
+  /**
+    * @brief  Sets a LCD layer frame buffer address without reloading.
+    *         Drawing goes to the new address at once; the LTDC scans it
+    *         out after the next Reload().
+    * @param  LayerIndex: specifies the Layer foreground or background
+    * @param  Address: new LCD frame buffer value
+    * @retval None
+    */
+  void SetLayerAddress_NoReload(uint32_t LayerIndex, uint32_t Address);
+
+  /**
+    * @brief  Sets the pixel format of a LCD layer's frame buffer.
+    *         Colors are still given in ARGB(8-8-8-8); they are converted
+    *         as they are drawn. In LCD_PIXEL_FORMAT_RGB565 the DMA2D fills,
+    *         copies and blends as in ARGB8888; in LCD_PIXEL_FORMAT_L8 the
+    *         CPU does, as the DMA2D cannot write L8.
+    * @param  LayerIndex: specifies the Layer foreground or background
+    * @param  PixelFormat: LCD_PIXEL_FORMAT_ARGB8888, LCD_PIXEL_FORMAT_RGB565
+    *         or LCD_PIXEL_FORMAT_L8
+    * @retval None
+    */
+  void SetPixelFormat(uint32_t LayerIndex, uint32_t PixelFormat);
+
+  /**
+    * @brief  Loads the color look-up table of a LCD_PIXEL_FORMAT_L8 layer.
+    *         A color drawn is stored as the index of its nearest entry.
+    * @param  LayerIndex: specifies the Layer foreground or background
+    * @param  pCLUT: the colors RGB(8-8-8), kept by reference
+    * @param  Size: number of colors, at most 256
+    * @retval None
+    */
+  void SetCLUT(uint32_t LayerIndex, uint32_t *pCLUT, uint32_t Size);
+
+  /**
+    * @brief  Gets the pixel format of a LCD layer.
+    * @param  LayerIndex: specifies the Layer foreground or background
+    * @retval The LCD_PIXEL_FORMAT_ value
+    */
+  uint32_t GetPixelFormat(uint32_t LayerIndex);
+
+  /**
+    * @brief  Gets the bytes a pixel takes in a LCD layer's frame buffer.
+    * @param  LayerIndex: specifies the Layer foreground or background
+    * @retval 4, 2 or 1
+    */
+  uint32_t GetBytesPerPixel(uint32_t LayerIndex);
+
+  /**
+    * @brief  Reloads the layer configurations set with the _NoReload calls.
+    * @param  ReloadType: LCD_RELOAD_IMMEDIATE or
+    *         LCD_RELOAD_VERTICAL_BLANKING
+    * @retval None
+    */
+  void Reload(uint32_t ReloadType);
+
+  /**
+    * @brief  Whether a reload is still waiting for the vertical blanking.
+    * @param  None
+    * @retval 1 until the LTDC has taken the new configuration, else 0
+    */
+  uint8_t ReloadPending(void);
+
   /**
     * @brief  Sets the Display window.
     * @param  LayerIndex: layer index
@@ -189,7 +254,7 @@ public:
     * @brief  Reads Pixel.
     * @param  Xpos: the X position
     * @param  Ypos: the Y position 
-    * @retval RGB pixel color
+    * @retval RGB pixel color, in ARGB(8-8-8-8) for RGB565 and L8 layers
     */
   uint32_t ReadPixel(uint16_t Xpos, uint16_t Ypos);
 
@@ -209,6 +274,10 @@ public:
 
   /**
     * @brief  Displays one character.
+    *         With a glyph atlas set for the current font, opaque text
+    *         and back colors and an ARGB8888 or RGB565 layer, the glyph is
+    *         blended from the atlas by the DMA2D in one transfer; otherwise the BSP draws it pixel by
+    *         pixel. The pixels written are the same either way.
     * @param  Xpos: start column address
     * @param  Ypos: the Line where to display the character shape
     * @param  Ascii: character ascii code, must be between 0x20 and 0x7E
@@ -216,8 +285,22 @@ public:
     */
   void DisplayChar(uint16_t Xpos, uint16_t Ypos, uint8_t Ascii);
 
+  /**
+    * @brief  Sets the glyph atlas DisplayChar() and DisplayStringAt() draw
+    *         from while pFonts is the current font.
+    * @param  pFonts: the font the atlas was expanded from
+    * @param  pAtlas: one A8 cell of Width x Height bytes per glyph, 0xFF
+    *         where the font's bit is set and 0x00 elsewhere, for the
+    *         LCD_ATLAS_GLYPHS glyphs from ' ', then a cell of 0xFF. It must
+    *         be in memory the DMA2D reaches (not the CCM RAM).
+    *         NULL goes back to the BSP's drawing.
+    * @retval None
+    */
+  void SetGlyphAtlas(sFONT *pFonts, const uint8_t *pAtlas);
+
   /**
     * @brief  Displays a maximum of 60 char on the LCD.
+    *         The characters are drawn with DisplayChar().
     * @param  X: pointer to x position (in pixel);
     * @param  Y: pointer to y position (in pixel);    
     * @param  pText: pointer to string to display on LCD
@@ -322,6 +405,35 @@ public:
     */
   void FillRect(uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height);
 
+  /**
+    * @brief  Copies a rectangle between two frame buffers with the DMA2D,
+    *         or with the CPU in L8 or if the DMA2D fails.
+    * @param  FromAddress: the source frame buffer
+    * @param  ToAddress: the destination frame buffer
+    * @param  Xpos: the X position
+    * @param  Ypos: the Y position
+    * @param  Width: rectangle width
+    * @param  Height: rectangle height
+    * @retval None
+    */
+  void CopyRect(uint32_t FromAddress, uint32_t ToAddress, uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height);
+
+  /**
+    * @brief  Moves a rectangle within a frame buffer with the DMA2D.
+    *         The DMA2D copies forward, so an overlapping move down is done
+    *         a line at a time from the last, and one to the right along
+    *         the same lines by the CPU.
+    * @param  Address: the frame buffer
+    * @param  FromX: the X position of the source
+    * @param  FromY: the Y position of the source
+    * @param  ToX: the X position of the destination
+    * @param  ToY: the Y position of the destination
+    * @param  Width: rectangle width
+    * @param  Height: rectangle height
+    * @retval None
+    */
+  void MoveRect(uint32_t Address, uint16_t FromX, uint16_t FromY, uint16_t ToX, uint16_t ToY, uint16_t Width, uint16_t Height);
+
   /**
     * @brief  Displays a full circle.
     * @param  Xpos: the X position
@@ -385,7 +497,9 @@ public:
   void DrawPixel(uint16_t Xpos, uint16_t Ypos, uint32_t RGB_Code);
 
 private:
-
+  uint32_t ActiveLayer;     /* the layer selected, drawn into */
+  sFONT *pAtlasFont;        /* the font of pAtlas */
+  const uint8_t *pAtlas;    /* see SetGlyphAtlas() */
 };
 
 #else
@@ -58,6 +58,9 @@
        using the following functions :
        - LCD_SetTransparency()
        - LCD_SetLayerAddress() 
+     o Draw into an RGB565 or L8 frame buffer instead of ARGB8888 with
+       LCD_SetPixelFormat() (and LCD_SetCLUT() for L8). Colors are still
+       given as ARGB8888; they are converted as they are stored.
   
   + Display on LCD
       o Clear the hole LCD using LCD_Clear() function or only one specified string
@@ -74,6 +77,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "stm32f429i_discovery_lcd.h"
 #include "fonts.h"
+#include <string.h>
 //#include "font24.c"
 //#include "font20.c"
 //#include "font16.c"
@@ -127,6 +131,13 @@ static RCC_PeriphCLKInitTypeDef  PeriphClkInitStruct;
 /* Default LCD configuration with LCD Layer 1 */
 static uint32_t ActiveLayer = 0;
 static LCD_DrawPropTypeDef DrawProp[MAX_LAYER_NUMBER];
+
+/* Color look-up tables of the L8 layers, and the last color mapped */
+static uint32_t *LayerCLUT[MAX_LAYER_NUMBER];
+static uint32_t LayerCLUTSize[MAX_LAYER_NUMBER];
+static uint32_t CLUTCacheColor[MAX_LAYER_NUMBER];
+static uint8_t CLUTCacheIndex[MAX_LAYER_NUMBER];
+static uint8_t CLUTCacheValid[MAX_LAYER_NUMBER];
 LCD_DrvTypeDef  *LcdDrv;
 /**
   * @}
@@ -137,7 +148,9 @@ LCD_DrvTypeDef  *LcdDrv;
   */ 
 static void DrawChar(uint16_t Xpos, uint16_t Ypos, const uint8_t *c);
 static void FillBuffer(uint32_t LayerIndex, void *pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLine, uint32_t ColorIndex);
-static void ConvertLineToARGB8888(void *pSrc, void *pDst, uint32_t xSize, uint32_t ColorMode);
+static void ConvertLine(void *pSrc, void *pDst, uint32_t xSize, uint32_t ColorMode);
+static uint32_t PixelBytes(uint32_t LayerIndex);
+static uint32_t ColorToPixel(uint32_t LayerIndex, uint32_t Color);
 /**
   * @}
   */ 
@@ -377,6 +390,56 @@ void BSP_LCD_SetLayerAddress_NoReload(uint32_t LayerIndex, uint32_t Address)
   HAL_LTDC_SetAddress_NoReload(&LtdcHandler, Address, LayerIndex);
 }
 
+/**
+  * @brief  Sets the pixel format of a layer's frame buffer and reloads.
+  *         LCD_PIXEL_FORMAT_ARGB8888, LCD_PIXEL_FORMAT_RGB565 and
+  *         LCD_PIXEL_FORMAT_L8 are drawn into; other formats are drawn as
+  *         ARGB8888. An L8 layer needs its CLUT set with BSP_LCD_SetCLUT().
+  * @param  LayerIndex: Layer foreground or background
+  * @param  PixelFormat: the new pixel format
+  */
+void BSP_LCD_SetPixelFormat(uint32_t LayerIndex, uint32_t PixelFormat)
+{
+  HAL_LTDC_SetPixelFormat(&LtdcHandler, PixelFormat, LayerIndex);
+}
+
+/**
+  * @brief  Loads and enables the color look-up table of an L8 layer.
+  *         A color drawn into the layer is stored as the index of the
+  *         nearest color of the table.
+  * @param  LayerIndex: Layer foreground or background
+  * @param  pCLUT: the colors, RGB in the low 24 bits; kept by reference
+  * @param  Size: number of colors, at most 256
+  */
+void BSP_LCD_SetCLUT(uint32_t LayerIndex, uint32_t *pCLUT, uint32_t Size)
+{
+  HAL_LTDC_ConfigCLUT(&LtdcHandler, pCLUT, Size, LayerIndex);
+  HAL_LTDC_EnableCLUT(&LtdcHandler, LayerIndex);
+  LayerCLUT[LayerIndex] = pCLUT;
+  LayerCLUTSize[LayerIndex] = Size;
+  CLUTCacheValid[LayerIndex] = 0;
+}
+
+/**
+  * @brief  Gets the pixel format of a layer.
+  * @param  LayerIndex: Layer foreground or background
+  * @retval The LCD_PIXEL_FORMAT_ value
+  */
+uint32_t BSP_LCD_GetPixelFormat(uint32_t LayerIndex)
+{
+  return LtdcHandler.LayerCfg[LayerIndex].PixelFormat;
+}
+
+/**
+  * @brief  Gets the bytes a pixel of a layer takes in its frame buffer.
+  * @param  LayerIndex: Layer foreground or background
+  * @retval 4, 2 or 1
+  */
+uint32_t BSP_LCD_GetBytesPerPixel(uint32_t LayerIndex)
+{
+  return PixelBytes(LayerIndex);
+}
+
 /**
   * @brief  Sets the Display window.
   * @param  LayerIndex: layer index
@@ -528,13 +591,27 @@ sFONT *BSP_LCD_GetFont(void)
   * @brief  Reads Pixel.
   * @param  Xpos: the X position
   * @param  Ypos: the Y position 
-  * @retval RGB pixel color
+  * @retval RGB pixel color; ARGB8888 for RGB565 and L8 layers
   */
 uint32_t BSP_LCD_ReadPixel(uint16_t Xpos, uint16_t Ypos)
 {
   uint32_t ret = 0;
   
-  if(LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_ARGB8888)
+  if(LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_RGB565)
+  {
+    /* Read data value from SDRAM memory, the low bits of a component
+       repeat its high bits as the LTDC expands them */
+    ret = *(__IO uint16_t*) (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + (2*(Ypos*BSP_LCD_GetXSize() + Xpos)));
+    ret = 0xFF000000 | ((ret & 0xF800) << 8) | ((ret & 0xE000) << 3) |
+          ((ret & 0x07E0) << 5) | ((ret & 0x0600) >> 1) | ((ret & 0x001F) << 3) | ((ret & 0x001C) >> 2);
+  }
+  else if((LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_L8) && (LayerCLUT[ActiveLayer] != NULL))
+  {
+    /* Read data value from SDRAM memory and look it up */
+    ret = *(__IO uint8_t*) (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + (Ypos*BSP_LCD_GetXSize() + Xpos));
+    ret = (ret < LayerCLUTSize[ActiveLayer]) ? (0xFF000000 | LayerCLUT[ActiveLayer][ret]) : 0xFF000000;
+  }
+  else if(LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_ARGB8888)
   {
     /* Read data value from SDRAM memory */
     ret = *(__IO uint32_t*) (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + (4*(Ypos*BSP_LCD_GetXSize() + Xpos)));
@@ -544,8 +621,7 @@ uint32_t BSP_LCD_ReadPixel(uint16_t Xpos, uint16_t Ypos)
     /* Read data value from SDRAM memory */
     ret = (*(__IO uint32_t*) (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + (4*(Ypos*BSP_LCD_GetXSize() + Xpos))) & 0x00FFFFFF);
   }
-  else if((LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_RGB565) || \
-          (LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_ARGB4444) || \
+  else if((LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_ARGB4444) || \
           (LtdcHandler.LayerCfg[ActiveLayer].PixelFormat == LTDC_PIXEL_FORMAT_AL88))  
   {
     /* Read data value from SDRAM memory */
@@ -679,7 +755,7 @@ void BSP_LCD_DrawHLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length)
   uint32_t xaddress = 0;
   
   /* Get the line address */
-  xaddress = (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress) + 4*(BSP_LCD_GetXSize()*Ypos + Xpos);
+  xaddress = (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress) + PixelBytes(ActiveLayer)*(BSP_LCD_GetXSize()*Ypos + Xpos);
 
   /* Write line */
   FillBuffer(ActiveLayer, (uint32_t *)xaddress, Length, 1, 0, DrawProp[ActiveLayer].TextColor);
@@ -696,7 +772,7 @@ void BSP_LCD_DrawVLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length)
   uint32_t xaddress = 0;
   
   /* Get the line address */
-  xaddress = (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress) + 4*(BSP_LCD_GetXSize()*Ypos + Xpos);
+  xaddress = (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress) + PixelBytes(ActiveLayer)*(BSP_LCD_GetXSize()*Ypos + Xpos);
   
   /* Write line */
   FillBuffer(ActiveLayer, (uint32_t *)xaddress, 1, Length, (BSP_LCD_GetXSize() - 1), DrawProp[ActiveLayer].TextColor);
@@ -917,7 +993,7 @@ void BSP_LCD_DrawBitmap(uint32_t X, uint32_t Y, uint8_t *pBmp)
   bitpixel = pBmp[28] + (pBmp[29] << 8);   
  
   /* Set Address */
-  address = LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + (((BSP_LCD_GetXSize()*Y) + X)*(4));
+  address = LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + (((BSP_LCD_GetXSize()*Y) + X)*PixelBytes(ActiveLayer));
 
   /* Get the Layer pixel format */    
   if ((bitpixel/8) == 4)
@@ -936,14 +1012,39 @@ void BSP_LCD_DrawBitmap(uint32_t X, uint32_t Y, uint8_t *pBmp)
   /* bypass the bitmap header */
   pBmp += (index + (width * (height - 1) * (bitpixel/8)));
 
-  /* Convert picture to ARGB8888 pixel format */
+  /* The DMA2D cannot write L8: the CPU maps the pixels one by one */
+  if (PixelBytes(ActiveLayer) == 1)
+  {
+    uint32_t i, j, color;
+    for (i = 0; i < height; i++)
+    {
+      for (j = 0; j < width; j++)
+      {
+        uint8_t *p = pBmp + j * (bitpixel/8);
+        if (inputcolormode == CM_RGB565)
+        {
+          color = p[0] | (p[1] << 8);
+          color = ((color & 0xF800) << 8) | ((color & 0x07E0) << 5) | ((color & 0x001F) << 3);
+        }
+        else
+        {
+          color = p[0] | (p[1] << 8) | (p[2] << 16);
+        }
+        BSP_LCD_DrawPixel(X + j, Y + i, 0xFF000000 | color);
+      }
+      pBmp -= width*(bitpixel/8);
+    }
+    return;
+  }
+
+  /* Convert picture to the layer's pixel format */
   for(index=0; index < height; index++)
   {
   /* Pixel format conversion */
-  ConvertLineToARGB8888((uint32_t *)pBmp, (uint32_t *)address, width, inputcolormode);
+  ConvertLine((uint32_t *)pBmp, (uint32_t *)address, width, inputcolormode);
 
   /* Increment the source and destination buffers */
-  address+=  ((BSP_LCD_GetXSize() - width + width)*4);
+  address+=  ((BSP_LCD_GetXSize() - width + width)*PixelBytes(ActiveLayer));
   pBmp -= width*(bitpixel/8);
   }
 }
@@ -963,7 +1064,7 @@ void BSP_LCD_FillRect(uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Hei
   BSP_LCD_SetTextColor(DrawProp[ActiveLayer].TextColor);
 
   /* Get the rectangle start address */
-  xaddress = (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress) + 4*(BSP_LCD_GetXSize()*Ypos + Xpos);
+  xaddress = (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress) + PixelBytes(ActiveLayer)*(BSP_LCD_GetXSize()*Ypos + Xpos);
 
   /* Fill the rectangle */
   FillBuffer(ActiveLayer, (uint32_t *)xaddress, Width, Height, (BSP_LCD_GetXSize() - Width), DrawProp[ActiveLayer].TextColor);
@@ -1307,8 +1408,21 @@ __weak void BSP_LCD_MspInit(void)
   */
 void BSP_LCD_DrawPixel(uint16_t Xpos, uint16_t Ypos, uint32_t RGB_Code)
 {
-  /* Write data value to all SDRAM memory */
-  *(__IO uint32_t*) (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + (4*(Ypos*BSP_LCD_GetXSize() + Xpos))) = RGB_Code;
+  uint32_t offset = Ypos*BSP_LCD_GetXSize() + Xpos;
+
+  /* Write data value to all SDRAM memory, in the layer's pixel format */
+  switch (PixelBytes(ActiveLayer))
+  {
+  case 1:
+    *(__IO uint8_t*) (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + offset) = ColorToPixel(ActiveLayer, RGB_Code);
+    break;
+  case 2:
+    *(__IO uint16_t*) (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + (2*offset)) = ColorToPixel(ActiveLayer, RGB_Code);
+    break;
+  default:
+    *(__IO uint32_t*) (LtdcHandler.LayerCfg[ActiveLayer].FBStartAdress + (4*offset)) = RGB_Code;
+    break;
+  }
 }
 
 /**
@@ -1376,10 +1490,24 @@ static void DrawChar(uint16_t Xpos, uint16_t Ypos, const uint8_t *c)
   */
 static void FillBuffer(uint32_t LayerIndex, void * pDst, uint32_t xSize, uint32_t ySize, uint32_t OffLine, uint32_t ColorIndex) 
 {
-  
-  /* Register to memory mode with ARGB8888 as color Mode */ 
+  /* The DMA2D cannot write L8: the CPU fills the lines */
+  if (PixelBytes(LayerIndex) == 1)
+  {
+    uint8_t index = ColorToPixel(LayerIndex, ColorIndex);
+    uint8_t *line = (uint8_t *)pDst;
+    uint32_t y;
+    for (y = 0; y < ySize; y++)
+    {
+      memset(line, index, xSize);
+      line += xSize + OffLine;
+    }
+    return;
+  }
+
+  /* Register to memory mode in the layer's color mode; the HAL converts
+     the ARGB8888 color */ 
   Dma2dHandler.Init.Mode         = DMA2D_R2M;
-  Dma2dHandler.Init.ColorMode    = DMA2D_ARGB8888;
+  Dma2dHandler.Init.ColorMode    = (PixelBytes(LayerIndex) == 2) ? DMA2D_RGB565 : DMA2D_ARGB8888;
   Dma2dHandler.Init.OutputOffset = OffLine;      
   
   Dma2dHandler.Instance = DMA2D; 
@@ -1399,17 +1527,18 @@ static void FillBuffer(uint32_t LayerIndex, void * pDst, uint32_t xSize, uint32_
 }
 
 /**
-  * @brief  Converts Line to ARGB8888 pixel format.
+  * @brief  Converts Line to the active layer's pixel format, ARGB8888 or
+  *         RGB565.
   * @param  pSrc: pointer to source buffer
   * @param  pDst: output color
   * @param  xSize: buffer width
   * @param  ColorMode: input color mode   
   */
-static void ConvertLineToARGB8888(void * pSrc, void * pDst, uint32_t xSize, uint32_t ColorMode)
+static void ConvertLine(void * pSrc, void * pDst, uint32_t xSize, uint32_t ColorMode)
 {    
   /* Configure the DMA2D Mode, Color Mode and output offset */
   Dma2dHandler.Init.Mode         = DMA2D_M2M_PFC;
-  Dma2dHandler.Init.ColorMode    = DMA2D_ARGB8888;
+  Dma2dHandler.Init.ColorMode    = (PixelBytes(ActiveLayer) == 2) ? DMA2D_RGB565 : DMA2D_ARGB8888;
   Dma2dHandler.Init.OutputOffset = 0;     
   
   /* Foreground Configuration */
@@ -1434,6 +1563,74 @@ static void ConvertLineToARGB8888(void * pSrc, void * pDst, uint32_t xSize, uint
   } 
 }
 
+/**
+  * @brief  Bytes a pixel of a layer takes in its frame buffer.
+  * @param  LayerIndex: layer index
+  * @retval 1 for L8, 2 for RGB565, 4 otherwise
+  */
+static uint32_t PixelBytes(uint32_t LayerIndex)
+{
+  switch (LtdcHandler.LayerCfg[LayerIndex].PixelFormat)
+  {
+  case LTDC_PIXEL_FORMAT_L8:
+    return 1;
+  case LTDC_PIXEL_FORMAT_RGB565:
+    return 2;
+  default:
+    return 4;
+  }
+}
+
+/**
+  * @brief  Converts an ARGB8888 color to a pixel of a layer: RGB565
+  *         truncated as the DMA2D converts, or, in L8, the index of the
+  *         nearest CLUT color (lowest index on a tie). The last color
+  *         looked up is cached per layer.
+  * @param  LayerIndex: layer index
+  * @param  Color: the color in ARGB mode (8-8-8-8)
+  * @retval The pixel value
+  */
+static uint32_t ColorToPixel(uint32_t LayerIndex, uint32_t Color)
+{
+  uint32_t i, best = 0, best_distance = 0xFFFFFFFF;
+
+  if (PixelBytes(LayerIndex) == 2)
+  {
+    return ((Color >> 8) & 0xF800) | ((Color >> 5) & 0x07E0) | ((Color >> 3) & 0x001F);
+  }
+  if (PixelBytes(LayerIndex) != 1)
+  {
+    return Color;
+  }
+
+  Color &= 0x00FFFFFF;
+  if (CLUTCacheValid[LayerIndex] && (CLUTCacheColor[LayerIndex] == Color))
+  {
+    return CLUTCacheIndex[LayerIndex];
+  }
+  for (i = 0; (LayerCLUT[LayerIndex] != NULL) && (i < LayerCLUTSize[LayerIndex]); i++)
+  {
+    uint32_t entry = LayerCLUT[LayerIndex][i] & 0x00FFFFFF;
+    int32_t r = (int32_t)((entry >> 16) & 0xFF) - (int32_t)((Color >> 16) & 0xFF);
+    int32_t g = (int32_t)((entry >> 8) & 0xFF) - (int32_t)((Color >> 8) & 0xFF);
+    int32_t b = (int32_t)(entry & 0xFF) - (int32_t)(Color & 0xFF);
+    uint32_t distance = (uint32_t)(r*r + g*g + b*b);
+    if (distance < best_distance)
+    {
+      best = i;
+      best_distance = distance;
+      if (distance == 0)
+      {
+        break;
+      }
+    }
+  }
+  CLUTCacheColor[LayerIndex] = Color;
+  CLUTCacheIndex[LayerIndex] = (uint8_t)best;
+  CLUTCacheValid[LayerIndex] = 1;
+  return best;
+}
+
 /**
   * @}
   */ 
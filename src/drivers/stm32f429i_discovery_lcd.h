@@ -191,6 +191,10 @@ void     BSP_LCD_SetTransparency(uint32_t LayerIndex, uint8_t Transparency);
 void     BSP_LCD_SetTransparency_NoReload(uint32_t LayerIndex, uint8_t Transparency);
 void     BSP_LCD_SetLayerAddress(uint32_t LayerIndex, uint32_t Address);
 void     BSP_LCD_SetLayerAddress_NoReload(uint32_t LayerIndex, uint32_t Address);
+void     BSP_LCD_SetPixelFormat(uint32_t LayerIndex, uint32_t PixelFormat);
+void     BSP_LCD_SetCLUT(uint32_t LayerIndex, uint32_t *pCLUT, uint32_t Size);
+uint32_t BSP_LCD_GetPixelFormat(uint32_t LayerIndex);
+uint32_t BSP_LCD_GetBytesPerPixel(uint32_t LayerIndex);
 void     BSP_LCD_SetColorKeying(uint32_t LayerIndex, uint32_t RGBValue);
 void     BSP_LCD_SetColorKeying_NoReload(uint32_t LayerIndex, uint32_t RGBValue);
 void     BSP_LCD_ResetColorKeying(uint32_t LayerIndex);
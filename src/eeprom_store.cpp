@@ -0,0 +1,270 @@
+/**
+ * @file eeprom_store.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Small-record store in the M24LR64 I2C EEPROM, cached in RAM and
+ * written back in page-aligned batches.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "eeprom_store.h"
+#include "capture_format.h"
+
+#ifndef SENTRY_HOST_BUILD
+extern "C" volatile uint16_t EEPROMAddress;  // set by BSP_EEPROM_Init()
+#endif
+
+static_assert(sizeof(Eeprom_Record_Copy) % EEPROM_PAGESIZE == 0,
+              "record copies have to fill whole EEPROM pages");
+static_assert(EEPROM_STORE_ADDRESS % EEPROM_PAGESIZE == 0,
+              "the store has to start on a page");
+static_assert(EEPROM_STORE_ADDRESS + EEPROM_STORE_SIZE <= EEPROM_MAX_SIZE,
+              "the store does not fit in the EEPROM");
+static_assert(EEPROM_RECORD_PAYLOAD <= UINT8_MAX, "payload length is a byte");
+
+static uint16_t copy_crc(uint8_t id, const Eeprom_Record_Copy &copy) {
+  uint16_t crc = crc16_ccitt(&id, 1);
+  crc = crc16_ccitt(&copy.sequence, 2, crc);  // sequence and length
+  return crc16_ccitt(copy.payload, copy.length, crc);
+}
+
+static bool copy_valid(uint8_t id, const Eeprom_Record_Copy &copy) {
+  return copy.length <= EEPROM_RECORD_PAYLOAD &&
+         copy.crc == copy_crc(id, copy);
+}
+
+EepromStore::EepromStore(Mutex *bus) : bus_(bus), present_(false) {
+  memset(cache_, 0, sizeof(cache_));
+  memset(dirty_, 0, sizeof(dirty_));
+  memset(newest_, -1, sizeof(newest_));
+  memset(pending_, 0, sizeof(pending_));
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+/*******************************************************************************
+ *
+ * @brief Find the chip and load the records into RAM
+ *
+ * One sequential read covers the whole store. Of the two copies of a
+ * record, the newer one with a good CRC wins; a copy cut short by a reset
+ * fails its CRC and the other copy is used.
+ *
+ * ****************************************************************************/
+bool EepromStore::mount() {
+  ScopedLock<Mutex> lock(mutex_);
+  memset(cache_, 0, sizeof(cache_));
+  memset(dirty_, 0, sizeof(dirty_));
+  memset(newest_, -1, sizeof(newest_));
+  memset(pending_, 0, sizeof(pending_));
+  memset(&stats_, 0, sizeof(stats_));
+
+  lock_bus();
+  uint16_t size = EEPROM_STORE_SIZE;
+  present_ = BSP_EEPROM_Init() == EEPROM_OK &&
+             BSP_EEPROM_ReadBuffer((uint8_t *)cache_, EEPROM_STORE_ADDRESS,
+                                   &size) == EEPROM_OK;
+  unlock_bus();
+  if (!present_) {
+    memset(cache_, 0, sizeof(cache_));
+    return false;
+  }
+
+  for (uint8_t id = 0; id < EEPROM_RECORDS; id++) {
+    bool valid[2];
+    for (int c = 0; c < 2; c++) {
+      valid[c] = copy_valid(id, cache_[id][c]);
+      // A blank copy is not damage
+      const uint8_t *bytes = (const uint8_t *)&cache_[id][c];
+      bool blank = std::all_of(bytes, bytes + sizeof(Eeprom_Record_Copy),
+                               [](uint8_t b) { return b == 0xFF; });
+      if (!valid[c] && !blank) stats_.corrupt_copies++;
+    }
+    if (valid[0] && valid[1]) {
+      int8_t age = (int8_t)(cache_[id][1].sequence - cache_[id][0].sequence);
+      newest_[id] = age > 0 ? 1 : 0;
+    } else if (valid[0] || valid[1]) {
+      newest_[id] = valid[0] ? 0 : 1;
+    }
+  }
+  return true;
+}
+
+bool EepromStore::read(uint8_t id, void *data, size_t length) const {
+  ScopedLock<Mutex> lock(mutex_);
+  if (id >= EEPROM_RECORDS || newest_[id] < 0) return false;
+  const Eeprom_Record_Copy &copy = cache_[id][newest_[id]];
+  if (copy.length != length) return false;
+  memcpy(data, copy.payload, length);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * @brief Update a record in the cache and mark the pages that changed
+ *
+ * The first write after a flush moves the record to its older copy with
+ * the next sequence number. Further writes before the flush rewrite that
+ * same copy, so the last value that reached the EEPROM stays intact in
+ * the other one.
+ *
+ * ****************************************************************************/
+bool EepromStore::write(uint8_t id, const void *data, size_t length) {
+  if (id >= EEPROM_RECORDS || length > EEPROM_RECORD_PAYLOAD) return false;
+  ScopedLock<Mutex> lock(mutex_);
+
+  if (newest_[id] >= 0) {
+    const Eeprom_Record_Copy &current = cache_[id][newest_[id]];
+    if (current.length == length &&
+        memcmp(current.payload, data, length) == 0) {
+      stats_.unchanged++;
+      return true;
+    }
+  }
+
+  Eeprom_Record_Copy copy;
+  int target;
+  if (pending_[id]) {
+    target = newest_[id];
+    copy.sequence = cache_[id][target].sequence;
+  } else if (newest_[id] >= 0) {
+    target = 1 - newest_[id];
+    copy.sequence = cache_[id][newest_[id]].sequence + 1;
+  } else {
+    target = 0;
+    copy.sequence = 0;
+  }
+  copy.length = length;
+  memset(copy.payload, 0xFF, sizeof(copy.payload));
+  memcpy(copy.payload, data, length);
+  copy.crc = copy_crc(id, copy);
+
+  // Mark only the pages whose bytes differ from the cache
+  uint8_t *cached = (uint8_t *)&cache_[id][target];
+  const uint8_t *bytes = (const uint8_t *)&copy;
+  size_t first_page = (cached - (uint8_t *)cache_) / EEPROM_PAGESIZE;
+  for (size_t p = 0; p < sizeof(copy) / EEPROM_PAGESIZE; p++) {
+    size_t offset = p * EEPROM_PAGESIZE;
+    if (memcmp(cached + offset, bytes + offset, EEPROM_PAGESIZE) != 0) {
+      dirty_[first_page + p] = true;
+    }
+  }
+  memcpy(cached, &copy, sizeof(copy));
+  newest_[id] = target;
+  pending_[id] = true;
+  stats_.writes++;
+  return true;
+}
+
+bool EepromStore::dirty() const {
+  ScopedLock<Mutex> lock(mutex_);
+  for (uint8_t id = 0; id < EEPROM_RECORDS; id++) {
+    if (pending_[id]) return true;
+  }
+  return false;
+}
+
+/*******************************************************************************
+ *
+ * @brief Write the marked pages in address order
+ *
+ * The cache lock is only held to take a page, so read() and write() go on
+ * during the write cycles. A record stays pending until none of its pages
+ * is marked, which keeps write() from switching copies under a flush.
+ *
+ * ****************************************************************************/
+bool EepromStore::flush() {
+  if (!present_) return false;
+  bool ok = true;
+  uint32_t pages = 0, polls = 0, failures = 0;
+  for (size_t page = 0; page < EEPROM_STORE_PAGES && ok; page++) {
+    uint8_t data[EEPROM_PAGESIZE];
+    {
+      ScopedLock<Mutex> lock(mutex_);
+      if (!dirty_[page]) continue;
+      memcpy(data, (const uint8_t *)cache_ + page * EEPROM_PAGESIZE,
+             EEPROM_PAGESIZE);
+      dirty_[page] = false;
+    }
+    if (write_page(EEPROM_STORE_ADDRESS + page * EEPROM_PAGESIZE, data,
+                   polls)) {
+      pages++;
+    } else {
+      ScopedLock<Mutex> lock(mutex_);
+      dirty_[page] = true;
+      failures++;
+      ok = false;  // the chip is gone or stuck; try again next flush
+    }
+  }
+
+  ScopedLock<Mutex> lock(mutex_);
+  const size_t record_pages = 2 * sizeof(Eeprom_Record_Copy) / EEPROM_PAGESIZE;
+  for (uint8_t id = 0; id < EEPROM_RECORDS; id++) {
+    const bool *record = &dirty_[id * record_pages];
+    if (std::none_of(record, record + record_pages,
+                     [](bool d) { return d; })) {
+      pending_[id] = false;
+    }
+  }
+  if (pages > 0) stats_.flushes++;
+  stats_.pages += pages;
+  stats_.polls += polls;
+  stats_.failures += failures;
+  return ok;
+}
+
+Eeprom_Store_Stats EepromStore::stats() const {
+  ScopedLock<Mutex> lock(mutex_);
+  return stats_;
+}
+
+/*******************************************************************************
+ *
+ * @brief Program one page and wait for the write cycle without spinning
+ *
+ * The page goes out by DMA. The bus stays ours while the transfer runs
+ * (the HAL reports HAL_BUSY); then the chip NACKs its address until the
+ * write cycle is over. Each poll is a single addressing attempt, with a
+ * sleep of EEPROM_POLL_MS before it, and the bus is released between the
+ * polls of the write cycle.
+ *
+ * @param address: EEPROM address of the page
+ * @param data: EEPROM_PAGESIZE bytes, valid until the call returns
+ * @param polls: incremented for each poll
+ * @return false if the chip did not take the page
+ *
+ * ****************************************************************************/
+bool EepromStore::write_page(uint16_t address, uint8_t *data,
+                             uint32_t &polls) {
+  lock_bus();
+  if (EEPROM_IO_WriteData(EEPROMAddress, address, data, EEPROM_PAGESIZE) !=
+      HAL_OK) {
+    unlock_bus();
+    return false;
+  }
+
+  HAL_StatusTypeDef status = HAL_BUSY;  // the bus is held while HAL_BUSY
+  for (int i = 0; i < EEPROM_POLL_LIMIT; i++) {
+    ThisThread::sleep_for(std::chrono::milliseconds(EEPROM_POLL_MS));
+    if (status != HAL_BUSY) lock_bus();
+    status = EEPROM_IO_IsDeviceReady(EEPROMAddress, 1);
+    polls++;
+    if (status != HAL_BUSY) unlock_bus();
+    if (status == HAL_OK) return true;
+  }
+  if (status == HAL_BUSY) unlock_bus();
+  return false;
+}
+
+void EepromStore::lock_bus() {
+  if (bus_ != nullptr) bus_->lock();
+}
+
+void EepromStore::unlock_bus() {
+  if (bus_ != nullptr) bus_->unlock();
+}
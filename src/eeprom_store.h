@@ -0,0 +1,144 @@
+/**
+ * @file eeprom_store.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Small-record store in the M24LR64 I2C EEPROM, cached in RAM and
+ * written back in page-aligned batches.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * State that changes often and is only a few bytes (attempt counters,
+ * calibration, thresholds) does not belong in the template store, where
+ * every update appends to a log that has to be compacted by erasing 16 KB.
+ * The EEPROM is rewritten in place, 4 bytes at a time.
+ *
+ * The store owns EEPROM_RECORDS records of up to EEPROM_RECORD_PAYLOAD
+ * bytes from EEPROM_STORE_ADDRESS on. Each record has two copies, and a
+ * write goes to the older one, so a reset during a write leaves the
+ * previous value in the other copy:
+ *
+ *   record 0: copy 0 | copy 1, record 1: copy 0 | copy 1, ...
+ *
+ * mount() reads the whole area into RAM with one DMA read. After that,
+ * read() and write() only touch the RAM copy and mark the 4-byte pages
+ * whose bytes changed. flush() writes the marked pages in address order,
+ * so any number of updates between two flushes cost one write cycle per
+ * changed page, and a record written twice before a flush is written once.
+ *
+ * Every page write is followed by the chip's write cycle (5 ms), during
+ * which it does not acknowledge its address. The BSP waits for it with
+ * EEPROM_MAX_TRIALS back-to-back polls; here the flushing thread sleeps
+ * EEPROM_POLL_MS between single polls instead, so the CPU and the I2C bus
+ * (shared with the touch controller) stay free.
+ *
+ * The M24LR64 sits on the ANT7-M24LR-A module, which does not come with
+ * the board. Without it mount() fails, the records live in RAM only and
+ * flush() reports failure.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef EEPROM_STORE_H
+#define EEPROM_STORE_H
+
+#include "system_config.h"
+
+#ifndef SENTRY_HOST_BUILD
+#include "drivers/stm32f429i_discovery_eeprom.h"
+#endif
+
+// One copy of a record, page aligned
+typedef struct {
+  uint8_t sequence;  // the newer of the two copies wins, modulo 256
+  uint8_t length;    // payload bytes, <= EEPROM_RECORD_PAYLOAD
+  uint16_t crc;      // CRC-16/CCITT of id, sequence, length and payload
+  uint8_t payload[EEPROM_RECORD_PAYLOAD];
+} Eeprom_Record_Copy;
+
+#define EEPROM_STORE_SIZE (EEPROM_RECORDS * 2 * sizeof(Eeprom_Record_Copy))
+#define EEPROM_STORE_PAGES (EEPROM_STORE_SIZE / EEPROM_PAGESIZE)
+
+// Activity since mount, for diagnostics and the host benchmark
+typedef struct {
+  uint32_t writes;     // write() calls that changed a record
+  uint32_t unchanged;  // write() calls with the value already stored
+  uint32_t flushes;    // flush() calls that wrote anything
+  uint32_t pages;      // pages written
+  uint32_t polls;      // standby polls while waiting for write cycles
+  uint32_t failures;   // pages the chip did not take
+  uint32_t corrupt_copies;  // copies with a bad CRC seen at mount
+} Eeprom_Store_Stats;
+
+class EepromStore {
+ public:
+  /**
+   * @brief Construct a store (nothing is read yet)
+   * @param bus: optional lock of the I2C bus, held for each transfer
+   */
+  explicit EepromStore(Mutex *bus = nullptr);
+
+  /**
+   * @brief Find the chip and load the records into RAM
+   * @return false if there is no EEPROM (the store then works in RAM)
+   */
+  bool mount();
+
+  /**
+   * @brief Whether mount() found the chip
+   */
+  bool present() const { return present_; }
+
+  /**
+   * @brief Copy a record out of the cache
+   * @param id: the record, < EEPROM_RECORDS
+   * @param data: receives the payload
+   * @param length: expected payload size
+   * @return false if the record was never written or has another size
+   */
+  bool read(uint8_t id, void *data, size_t length) const;
+
+  /**
+   * @brief Update a record in the cache; flush() makes it persistent
+   * @param id: the record, < EEPROM_RECORDS
+   * @param data: the payload
+   * @param length: payload size, <= EEPROM_RECORD_PAYLOAD
+   * @return false if the id or the size is invalid
+   */
+  bool write(uint8_t id, const void *data, size_t length);
+
+  /**
+   * @brief Whether the cache holds updates that are not in the EEPROM yet
+   */
+  bool dirty() const;
+
+  /**
+   * @brief Write the changed pages to the EEPROM
+   *
+   * Blocks for about one write cycle per page, sleeping while the chip is
+   * busy. Pages that fail stay marked for the next flush. Call it from
+   * one thread only.
+   *
+   * @return false if there is no EEPROM or a page failed
+   */
+  bool flush();
+
+  Eeprom_Store_Stats stats() const;
+
+ private:
+  bool write_page(uint16_t address, uint8_t *data, uint32_t &polls);
+  void lock_bus();
+  void unlock_bus();
+
+  Mutex *bus_;
+  mutable Mutex mutex_;  // guards the cache against concurrent flush()
+  Eeprom_Record_Copy cache_[EEPROM_RECORDS][2];
+  bool dirty_[EEPROM_STORE_PAGES];  // page differs from the EEPROM
+  int8_t newest_[EEPROM_RECORDS];   // copy holding the record, -1 if none
+  bool pending_[EEPROM_RECORDS];    // newest_ is not fully written yet
+  bool present_;
+  Eeprom_Store_Stats stats_;
+};
+
+#endif  // EEPROM_STORE_H
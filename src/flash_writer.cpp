@@ -0,0 +1,181 @@
+/**
+ * @file flash_writer.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Background thread that owns all slow template store work.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "flash_writer.h"
+
+FlashWriter::FlashWriter(TemplateStore &store)
+    : store_(store),
+      thread_(osPriorityBelowNormal, sizeof(stack_), stack_, "flash writer"),
+      changed_(mutex_),
+      head_(0),
+      count_(0),
+      running_slot_(-1),
+      running_(false),
+      started_(false),
+      stopping_(false) {
+  memset(&stats_, 0, sizeof(stats_));
+  // Enrollment then copies into existing buffers instead of allocating
+  for (auto &job : jobs_) job.samples.reserve(RECORDING_SAMPLES);
+  current_.samples.reserve(RECORDING_SAMPLES);
+}
+
+FlashWriter::~FlashWriter() {
+  mutex_.lock();
+  stopping_ = true;
+  changed_.notify_all();
+  bool started = started_;
+  mutex_.unlock();
+  if (started) thread_.join();
+}
+
+void FlashWriter::start() {
+  ScopedLock<Mutex> lock(mutex_);
+  if (started_) return;
+  started_ = true;
+  thread_.start(callback(this, &FlashWriter::run));
+}
+
+bool FlashWriter::persist(uint8_t slot, const vector<array<float, 3>> &samples,
+                          uint16_t sample_rate_hz, Done done) {
+  return enqueue(TEMPLATE_RECORD_DATA, slot, &samples, sample_rate_hz, done);
+}
+
+bool FlashWriter::remove(uint8_t slot, Done done) {
+  return enqueue(TEMPLATE_RECORD_TOMBSTONE, slot, nullptr, 0, done);
+}
+
+bool FlashWriter::pending(uint8_t slot) const {
+  ScopedLock<Mutex> lock(mutex_);
+  if (running_slot_ == slot) return true;
+  for (size_t i = 0; i < count_; i++) {
+    if (jobs_[(head_ + i) % FLASH_WRITER_QUEUE].slot == slot) return true;
+  }
+  return false;
+}
+
+void FlashWriter::flush() {
+  mutex_.lock();
+  while (count_ > 0 || running_) changed_.wait();
+  mutex_.unlock();
+}
+
+Flash_Writer_Stats FlashWriter::stats() const {
+  ScopedLock<Mutex> lock(mutex_);
+  return stats_;
+}
+
+/*******************************************************************************
+ *
+ * @brief Add a job, or replace the one waiting for the same slot
+ * @return false if the queue is full
+ *
+ * ****************************************************************************/
+bool FlashWriter::enqueue(uint8_t type, uint8_t slot,
+                          const vector<array<float, 3>> *samples,
+                          uint16_t sample_rate_hz, Done done) {
+  Done superseded;
+  {
+    ScopedLock<Mutex> lock(mutex_);
+    Job *job = nullptr;
+    for (size_t i = 0; i < count_ && job == nullptr; i++) {
+      Job &waiting = jobs_[(head_ + i) % FLASH_WRITER_QUEUE];
+      if (waiting.slot == slot) job = &waiting;
+    }
+
+    if (job != nullptr) {
+      superseded = job->done;
+      stats_.coalesced++;
+    } else if (count_ == FLASH_WRITER_QUEUE) {
+      stats_.rejected++;
+      return false;
+    } else {
+      job = &jobs_[(head_ + count_) % FLASH_WRITER_QUEUE];
+      count_++;
+      stats_.max_depth = std::max<uint32_t>(stats_.max_depth, count_);
+    }
+
+    job->type = type;
+    job->slot = slot;
+    job->sample_rate_hz = sample_rate_hz;
+    if (samples != nullptr) {
+      job->samples.assign(samples->begin(), samples->end());
+    } else {
+      job->samples.clear();
+    }
+    job->done = done;
+    stats_.queued++;
+    changed_.notify_all();
+  }
+
+  if (superseded) superseded(slot, FLASH_JOB_SUPERSEDED);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * @brief Writer thread: run the jobs in order, reclaim space while idle
+ *
+ * The queue lock is released while the store works, so queuing never
+ * waits for the flash. A job stops being pending before its callback
+ * runs, so the callback and whoever it wakes see the slot settled.
+ *
+ * ****************************************************************************/
+void FlashWriter::run() {
+  mutex_.lock();
+  while (true) {
+    while (count_ == 0 && !stopping_) {
+      mutex_.unlock();
+      bool reclaimed = store_.maintain();
+      mutex_.lock();
+      if (count_ == 0 && !stopping_ && !reclaimed) {
+        changed_.wait_for(std::chrono::milliseconds(FLASH_WRITER_IDLE_MS));
+      }
+    }
+    if (count_ == 0) break;  // stopping, and nothing left to do
+
+    // Take the oldest job; swapping keeps the buffers of both entries
+    Job &next = jobs_[head_];
+    current_.type = next.type;
+    current_.slot = next.slot;
+    current_.sample_rate_hz = next.sample_rate_hz;
+    current_.samples.swap(next.samples);
+    current_.done = next.done;
+    next.done = nullptr;
+    head_ = (head_ + 1) % FLASH_WRITER_QUEUE;
+    count_--;
+    running_slot_ = current_.slot;
+    running_ = true;
+    mutex_.unlock();
+
+    bool ok = current_.type == TEMPLATE_RECORD_DATA
+                  ? store_.write(current_.slot, current_.samples,
+                                 current_.sample_rate_hz)
+                  : store_.remove(current_.slot);
+
+    mutex_.lock();
+    Done done = current_.done;
+    current_.done = nullptr;
+    running_slot_ = -1;
+    stats_.completed++;
+    if (!ok) stats_.failed++;
+    mutex_.unlock();
+
+    if (done) done(current_.slot, ok ? FLASH_JOB_DONE : FLASH_JOB_FAILED);
+
+    mutex_.lock();
+    running_ = false;
+    changed_.notify_all();
+  }
+  mutex_.unlock();
+}
@@ -0,0 +1,137 @@
+/**
+ * @file flash_writer.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Background thread that owns all slow template store work.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Programming a template takes milliseconds and reclaiming a sector a
+ * quarter second per 16 KB erase, so the threads that drive the UI hand
+ * writes and deletes to a FlashWriter instead of calling the store. Jobs
+ * wait in a bounded queue of FLASH_WRITER_QUEUE entries and run in order
+ * on a low-priority thread, which also calls TemplateStore::maintain()
+ * while idle.
+ *
+ * A job for a slot that already has one waiting replaces it (the waiting
+ * job reports FLASH_JOB_SUPERSEDED), so enrolling twice in a row programs
+ * the flash once. A job that is already running is never replaced.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef FLASH_WRITER_H
+#define FLASH_WRITER_H
+
+#include "system_config.h"
+#include "template_store.h"
+
+// How a job ended
+typedef enum {
+  FLASH_JOB_DONE,        // the store has it
+  FLASH_JOB_FAILED,      // the store refused it (no space, bad slot, flash)
+  FLASH_JOB_SUPERSEDED,  // replaced by a newer job for its slot
+} Flash_Job_Status;
+
+// Queue activity, for diagnostics and the host benchmark
+typedef struct {
+  uint32_t queued;     // jobs accepted
+  uint32_t coalesced;  // jobs replaced while waiting
+  uint32_t rejected;   // jobs refused because the queue was full
+  uint32_t completed;  // jobs that reached the store
+  uint32_t failed;     // of those, the ones the store refused
+  uint32_t max_depth;  // most jobs waiting at once
+} Flash_Writer_Stats;
+
+class FlashWriter {
+ public:
+  /**
+   * @brief Completion callback: slot and outcome
+   *
+   * DONE and FAILED are reported from the writer thread once the job is
+   * no longer pending(), SUPERSEDED from the thread that queued the
+   * replacement. Keep it short, it holds up the next job.
+   */
+  typedef Callback<void(uint8_t, Flash_Job_Status)> Done;
+
+  explicit FlashWriter(TemplateStore &store);
+
+  /**
+   * @brief Finishes the queued jobs, then stops the thread
+   */
+  ~FlashWriter();
+
+  /**
+   * @brief Start the writer thread
+   */
+  void start();
+
+  /**
+   * @brief Queue a template write (the samples are copied)
+   * @param slot: the slot, < TEMPLATE_SLOTS
+   * @param samples: the template
+   * @param sample_rate_hz: the rate of the samples
+   * @param done: optional completion callback
+   * @return false if the queue is full
+   */
+  bool persist(uint8_t slot, const vector<array<float, 3>> &samples,
+               uint16_t sample_rate_hz, Done done = nullptr);
+
+  /**
+   * @brief Queue the deletion of a slot
+   * @return false if the queue is full
+   */
+  bool remove(uint8_t slot, Done done = nullptr);
+
+  /**
+   * @brief Whether a job for the slot is waiting or running
+   */
+  bool pending(uint8_t slot) const;
+
+  /**
+   * @brief Block until every queued job has run and reported
+   */
+  void flush();
+
+  Flash_Writer_Stats stats() const;
+
+  /**
+   * @brief The stack of the writer thread, to paint before start() (see
+   * memory_report.h)
+   */
+  unsigned char *stack() { return stack_; }
+  size_t stack_size() const { return sizeof(stack_); }
+
+ private:
+  struct Job {
+    uint8_t type;  // TEMPLATE_RECORD_DATA or _TOMBSTONE
+    uint8_t slot;
+    uint16_t sample_rate_hz;
+    vector<array<float, 3>> samples;
+    Done done;
+  };
+
+  bool enqueue(uint8_t type, uint8_t slot,
+               const vector<array<float, 3>> *samples, uint16_t sample_rate_hz,
+               Done done);
+  void run();
+
+  TemplateStore &store_;
+  MBED_ALIGN(8) unsigned char stack_[FLASH_WRITER_STACK_SIZE];
+  Thread thread_;
+  mutable Mutex mutex_;
+  ConditionVariable changed_;
+  Job jobs_[FLASH_WRITER_QUEUE];  // ring buffer, capacity kept between jobs
+  Job current_;                   // the job being run
+  size_t head_;                   // oldest waiting job
+  size_t count_;                  // jobs waiting
+  int running_slot_;              // slot of current_, -1 if idle
+  bool running_;                  // current_ is running or reporting
+  bool started_;
+  bool stopping_;
+  Flash_Writer_Stats stats_;
+};
+
+#endif  // FLASH_WRITER_H
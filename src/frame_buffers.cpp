@@ -0,0 +1,149 @@
+/**
+ * @file frame_buffers.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Double-buffered drawing on LTDC layer 0, flipped at vertical
+ * blanking.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "frame_buffers.h"
+
+#include <cstring>
+
+#include "profiler.h"
+
+static const Frame_Rect kNoDamage = {0, 0, 0, 0};
+
+FrameBuffers::FrameBuffers(LCD_DISCO_F429ZI &lcd, uint32_t front,
+                           uint32_t back, uint32_t budget_us)
+    : lcd_(lcd),
+      buffers_{front, back},
+      front_(0),
+      budget_us_(budget_us),
+      enabled_(false),
+      open_(false),
+      started_(0),
+      presented_(kNoDamage),
+      drawn_(kNoDamage) {
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+void FrameBuffers::enable() {
+  ScopedLock<Mutex> lock(mutex_);
+  if (enabled_) return;
+  lcd_.CopyRect(buffers_[front_], buffers_[1 - front_], 0, 0,
+                lcd_.GetXSize(), lcd_.GetYSize());
+  stats_.copied_pixels += lcd_.GetXSize() * lcd_.GetYSize();
+  enabled_ = true;
+}
+
+Frame_Buffers_Stats FrameBuffers::stats() const {
+  ScopedLock<Mutex> lock(mutex_);
+  return stats_;
+}
+
+/*******************************************************************************
+ *
+ * @brief Wait until the LTDC scans out the frame last presented
+ *
+ * The old front buffer is on screen until then and must not be drawn into.
+ *
+ * ****************************************************************************/
+void FrameBuffers::wait_for_flip() {
+  if (!lcd_.ReloadPending()) return;
+  uint32_t start = ProfilerNow();
+  while (lcd_.ReloadPending()) {
+    ThisThread::sleep_for(std::chrono::milliseconds(1));
+  }
+  stats_.waits++;
+  stats_.wait_us += (ProfilerNow() - start) / ProfilerTicksPerUs();
+}
+
+uint32_t FrameBuffers::drawing() const {
+  ScopedLock<Mutex> lock(mutex_);
+  return enabled_ && open_ ? buffers_[1 - front_] : buffers_[front_];
+}
+
+void FrameBuffers::begin() {
+  mutex_.lock();  // until present()
+  if (enabled_) wait_for_flip();
+  start_frame();
+}
+
+bool FrameBuffers::try_begin() {
+  if (!mutex_.trylock()) return false;
+  if (open_ || (enabled_ && lcd_.ReloadPending())) {
+    mutex_.unlock();
+    return false;
+  }
+  start_frame();
+  return true;
+}
+
+// Bring the back buffer up to date and draw into it
+void FrameBuffers::start_frame() {
+  open_ = true;
+  if (!enabled_) return;
+
+  uint32_t back = buffers_[1 - front_];
+  if (presented_.x1 > presented_.x0) {
+    uint16_t width = presented_.x1 - presented_.x0;
+    uint16_t height = presented_.y1 - presented_.y0;
+    lcd_.CopyRect(buffers_[front_], back, presented_.x0, presented_.y0, width,
+                  height);
+    stats_.copied_pixels += (uint32_t)width * height;
+  }
+  lcd_.SetLayerAddress_NoReload(0, back);
+  drawn_ = kNoDamage;
+  started_ = ProfilerNow();
+}
+
+void FrameBuffers::damage(uint16_t x, uint16_t y, uint16_t width,
+                          uint16_t height) {
+  ScopedLock<Mutex> lock(mutex_);
+  uint16_t x1 = min<uint32_t>(x + width, lcd_.GetXSize());
+  uint16_t y1 = min<uint32_t>(y + height, lcd_.GetYSize());
+  if (x >= x1 || y >= y1) return;
+  if (drawn_.x1 == drawn_.x0) {
+    drawn_ = {x, y, x1, y1};
+    return;
+  }
+  drawn_.x0 = min(drawn_.x0, x);
+  drawn_.y0 = min(drawn_.y0, y);
+  drawn_.x1 = max(drawn_.x1, x1);
+  drawn_.y1 = max(drawn_.y1, y1);
+}
+
+/*******************************************************************************
+ *
+ * @brief Flip to the frame drawn since begin() at the next vertical blanking
+ *
+ * A frame that took longer than the budget kept the old one on screen for
+ * every whole budget it ran over; those refreshes are counted as dropped.
+ *
+ * ****************************************************************************/
+void FrameBuffers::present() {
+  open_ = false;
+  if (enabled_) {
+    uint32_t us = (ProfilerNow() - started_) / ProfilerTicksPerUs();
+    lcd_.Reload(LCD_RELOAD_VERTICAL_BLANKING);
+    front_ = 1 - front_;
+    presented_ = drawn_;
+
+    stats_.frames++;
+    stats_.last_us = us;
+    stats_.max_us = max(stats_.max_us, us);
+    if (us > budget_us_) {
+      stats_.over_budget++;
+      stats_.dropped += us / budget_us_;
+    }
+  }
+  mutex_.unlock();
+}
@@ -0,0 +1,138 @@
+/**
+ * @file frame_buffers.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Double-buffered drawing on LTDC layer 0, flipped at vertical
+ * blanking.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Drawing straight into the buffer the LTDC scans out shows every step of
+ * it: a status line is seen cleared, then filled in glyph by glyph. With
+ * FrameBuffers the screen has two buffers in SDRAM; the panel shows the
+ * front one while the next frame is drawn into the back one:
+ *
+ *   begin()    waits for the last flip to happen, brings the back buffer
+ *              up to date and points the BSP's drawing at it
+ *              (SetLayerAddress_NoReload(): the handle changes, the active
+ *              registers do not);
+ *   damage()   notes a rectangle the frame drew;
+ *   present()  asks the LTDC to load the new address at the next vertical
+ *              blanking (Reload(LCD_RELOAD_VERTICAL_BLANKING)), so the
+ *              panel switches between two refreshes, and swaps the roles.
+ *
+ * The back buffer is one frame behind: the next begin() copies the damage
+ * of the frame just presented into it with a DMA2D copy, so callers that
+ * draw incrementally (StatusLine) find what they drew last time. The damage
+ * is kept as one bounding rectangle.
+ *
+ * Until enable() the class stays out of the way and drawing goes to the
+ * screen as before; enable() copies the screen into the other buffer once.
+ * A frame runs from begin() to present() under a lock, so frames from
+ * several threads do not interleave. Drawing outside a frame goes to the
+ * front buffer and never reaches the back one. try_begin() is begin() for
+ * callers that must not block (the rate plot, drawn from the acquisition
+ * loop): it gives up if another frame is open or the last flip is still
+ * pending.
+ *
+ * stats() counts the frames, the time they took against the frame budget
+ * (one refresh, DISPLAY_FRAME_BUDGET_US), the refreshes that showed an old
+ * frame because a new one ran over the budget (dropped), and the waits for
+ * a flip when frames come faster than the panel refreshes. The host build
+ * runs the same code against the framebuffer emulator (see
+ * host/bench/flip_bench.cpp).
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef FRAME_BUFFERS_H
+#define FRAME_BUFFERS_H
+
+#include "system_config.h"
+
+// A rectangle of the screen, [x0, x1) x [y0, y1); empty if x0 == x1
+typedef struct {
+  uint16_t x0, y0;
+  uint16_t x1, y1;
+} Frame_Rect;
+
+// Frames presented and what they cost
+typedef struct {
+  uint32_t frames;         // present() calls
+  uint32_t over_budget;    // frames drawn in more than the budget
+  uint32_t dropped;        // refreshes those frames missed
+  uint32_t waits;          // begin() calls that waited for a flip
+  uint32_t wait_us;        // time spent waiting
+  uint32_t last_us;        // drawing time of the last frame
+  uint32_t max_us;         // and of the longest one
+  uint64_t copied_pixels;  // damage copied into the back buffer
+} Frame_Buffers_Stats;
+
+class FrameBuffers {
+ public:
+  /**
+   * @param lcd: the display; layer 0 must be showing front
+   * @param front: the buffer on screen
+   * @param back: the other one, a whole frame of SDRAM nothing else uses
+   * @param budget_us: time a frame may take, one refresh by default
+   */
+  FrameBuffers(LCD_DISCO_F429ZI &lcd, uint32_t front, uint32_t back,
+               uint32_t budget_us = DISPLAY_FRAME_BUDGET_US);
+
+  /**
+   * @brief Start double buffering: the screen as it is is copied into the
+   * back buffer
+   */
+  void enable();
+  bool enabled() const { return enabled_; }
+
+  /**
+   * @brief Start a frame; drawing goes to the back buffer until present()
+   */
+  void begin();
+
+  /**
+   * @brief begin() without waiting
+   * @return false, with no frame started, if it would have waited
+   */
+  bool try_begin();
+
+  /**
+   * @brief The frame drew this rectangle
+   */
+  void damage(uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+
+  /**
+   * @brief End the frame; it is shown from the next vertical blanking
+   */
+  void present();
+
+  uint32_t budget_us() const { return budget_us_; }
+  uint32_t front() const { return buffers_[front_]; }
+
+  /**
+   * @brief The buffer drawing goes to: the back one during a frame
+   */
+  uint32_t drawing() const;
+  Frame_Buffers_Stats stats() const;
+
+ private:
+  void wait_for_flip();
+  void start_frame();
+
+  mutable Mutex mutex_;
+  LCD_DISCO_F429ZI &lcd_;
+  uint32_t buffers_[2];
+  size_t front_;
+  uint32_t budget_us_;
+  bool enabled_;
+  bool open_;             // between begin() and present()
+  uint32_t started_;      // ProfilerNow() at begin()
+  Frame_Rect presented_;  // damage of the frame on screen
+  Frame_Rect drawn_;      // damage of the frame being drawn
+  Frame_Buffers_Stats stats_;
+};
+
+#endif  // FRAME_BUFFERS_H
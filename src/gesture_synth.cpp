@@ -0,0 +1,250 @@
+/**
+ * @file gesture_synth.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Parametric synthetic gesture generator implementation.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "gesture_synth.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace synth {
+
+namespace {
+
+const float PI = 3.14159265358979f;
+
+inline uint32_t rotl(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+
+uint64_t splitmix64(uint64_t &state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+Vec3 scale(const Vec3 &v, float s) { return {v[0] * s, v[1] * s, v[2] * s}; }
+
+Vec3 cross(const Vec3 &a, const Vec3 &b) {
+  return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2],
+          a[0] * b[1] - a[1] * b[0]};
+}
+
+Vec3 normalized(const Vec3 &v) {
+  float n = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  return n > 0.0f ? scale(v, 1.0f / n) : Vec3{1.0f, 0.0f, 0.0f};
+}
+
+// Rotation matrix for `angle` radians about the unit vector `axis`
+std::array<Vec3, 3> rotation(const Vec3 &axis, float angle) {
+  float c = std::cos(angle), s = std::sin(angle), t = 1.0f - c;
+  float x = axis[0], y = axis[1], z = axis[2];
+  return {{{t * x * x + c, t * x * y - s * z, t * x * z + s * y},
+           {t * x * y + s * z, t * y * y + c, t * y * z - s * x},
+           {t * x * z - s * y, t * y * z + s * x, t * z * z + c}}};
+}
+
+Vec3 apply(const std::array<Vec3, 3> &m, const Vec3 &v) {
+  return {m[0][0] * v[0] + m[0][1] * v[1] + m[0][2] * v[2],
+          m[1][0] * v[0] + m[1][1] * v[1] + m[1][2] * v[2],
+          m[2][0] * v[0] + m[2][1] * v[1] + m[2][2] * v[2]};
+}
+
+// Unit-peak rate of the ideal gesture at normalized time tau in [0, 1]
+Vec3 shape_rate(const GestureSpec &spec, float tau) {
+  switch (spec.shape) {
+    case Shape::Stroke: {
+      // Minimum-jerk rate bell per segment, peak 1 mid-segment
+      int n = std::max(1, std::min(spec.segments, SYNTH_MAX_SEGMENTS));
+      int j = std::min(n - 1, (int)(tau * n));
+      float u = tau * n - j;
+      float bell = 16.0f * u * u * (1.0f - u) * (1.0f - u);
+      return scale(spec.axes[j], bell);
+    }
+    case Shape::Circle: {
+      Vec3 normal = spec.axes[0];
+      Vec3 helper = std::fabs(normal[0]) < 0.9f ? Vec3{1.0f, 0.0f, 0.0f}
+                                                : Vec3{0.0f, 1.0f, 0.0f};
+      Vec3 u = normalized(cross(normal, helper));
+      Vec3 v = cross(normal, u);
+      float envelope = std::sin(PI * tau);
+      float angle = 2.0f * PI * spec.turns * tau;
+      float cu = envelope * std::cos(angle), cv = envelope * std::sin(angle);
+      return {cu * u[0] + cv * v[0], cu * u[1] + cv * v[1],
+              cu * u[2] + cv * v[2]};
+    }
+    case Shape::Flick: {
+      // Derivative of a gaussian, scaled to a unit peak
+      const float sigma = 0.12f;
+      float d = tau - 0.5f;
+      float pulse = -(d / sigma) * std::exp(-d * d / (2.0f * sigma * sigma));
+      return scale(spec.axes[0], pulse / 0.60653066f);
+    }
+  }
+  return {0.0f, 0.0f, 0.0f};
+}
+
+}  // namespace
+
+/*******************************************************************************
+ * Rng
+ * ****************************************************************************/
+Rng::Rng(uint64_t seed) : spare_(0.0f), has_spare_(false) {
+  uint64_t state = seed;
+  uint64_t a = splitmix64(state), b = splitmix64(state);
+  s_[0] = (uint32_t)a;
+  s_[1] = (uint32_t)(a >> 32);
+  s_[2] = (uint32_t)b;
+  s_[3] = (uint32_t)(b >> 32);
+}
+
+uint32_t Rng::next() {
+  uint32_t result = rotl(s_[1] * 5, 7) * 9;
+  uint32_t t = s_[1] << 9;
+  s_[2] ^= s_[0];
+  s_[3] ^= s_[1];
+  s_[1] ^= s_[2];
+  s_[0] ^= s_[3];
+  s_[2] ^= t;
+  s_[3] = rotl(s_[3], 11);
+  return result;
+}
+
+float Rng::uniform() { return (next() >> 8) * (1.0f / 16777216.0f); }
+
+float Rng::uniform(float lo, float hi) { return lo + (hi - lo) * uniform(); }
+
+// Box-Muller, caching the second value
+float Rng::normal() {
+  if (has_spare_) {
+    has_spare_ = false;
+    return spare_;
+  }
+  float u1 = 1.0f - uniform();  // (0, 1]
+  float u2 = uniform();
+  float r = std::sqrt(-2.0f * std::log(u1));
+  spare_ = r * std::sin(2.0f * PI * u2);
+  has_spare_ = true;
+  return r * std::cos(2.0f * PI * u2);
+}
+
+Vec3 Rng::unit_vector() {
+  return normalized({normal(), normal(), normal()});
+}
+
+/*******************************************************************************
+ * Presets
+ * ****************************************************************************/
+Variation clean_variation() {
+  Variation v = {};
+  v.time_warp = 0.05f;
+  v.speed_jitter = 0.03f;
+  v.amplitude_jitter = 0.03f;
+  v.rotation_deg = 2.0f;
+  v.noise_dps = 0.5f;
+  v.idle_s = 0.3f;
+  return v;
+}
+
+Variation typical_variation() {
+  Variation v = {};
+  v.time_warp = 0.25f;
+  v.speed_jitter = 0.12f;
+  v.amplitude_jitter = 0.15f;
+  v.rotation_deg = 10.0f;
+  v.noise_dps = 3.0f;
+  v.bias_dps = 1.0f;
+  v.drift_dps_per_s = 0.5f;
+  v.spike_probability = 0.005f;
+  v.spike_dps = 400.0f;
+  v.idle_s = 0.5f;
+  return v;
+}
+
+GestureSpec random_spec(Rng &rng) {
+  GestureSpec spec = {};
+  switch (rng.next() % 3) {
+    case 0:
+      spec.shape = Shape::Stroke;
+      spec.duration_s = rng.uniform(0.8f, 2.5f);
+      spec.amplitude_dps = rng.uniform(80.0f, 300.0f);
+      spec.segments = 1 + (int)(rng.next() % SYNTH_MAX_SEGMENTS);
+      break;
+    case 1:
+      spec.shape = Shape::Circle;
+      spec.duration_s = rng.uniform(1.0f, 2.5f);
+      spec.amplitude_dps = rng.uniform(80.0f, 250.0f);
+      spec.segments = 1;
+      spec.turns = rng.uniform(0.5f, 2.0f);
+      break;
+    default:
+      spec.shape = Shape::Flick;
+      spec.duration_s = rng.uniform(0.3f, 0.6f);
+      spec.amplitude_dps = rng.uniform(300.0f, 600.0f);
+      spec.segments = 1;
+      break;
+  }
+  for (int i = 0; i < SYNTH_MAX_SEGMENTS; i++) spec.axes[i] = rng.unit_vector();
+  return spec;
+}
+
+/*******************************************************************************
+ * Generation
+ * ****************************************************************************/
+void generate(const GestureSpec &spec, const Variation &variation,
+              uint64_t seed, Gesture &out, float sample_rate_hz) {
+  Rng rng(seed);
+
+  float speed = std::max(0.5f, 1.0f + variation.speed_jitter * rng.normal());
+  float amplitude = spec.amplitude_dps *
+                    std::max(0.1f, 1.0f + variation.amplitude_jitter *
+                                              rng.normal());
+  std::array<Vec3, 3> orientation =
+      rotation(rng.unit_vector(),
+               variation.rotation_deg * rng.normal() * (PI / 180.0f));
+  // Monotonic because |warp| < 1: d/dtau = 1 + warp * cos(2 pi tau) > 0
+  float warp = std::min(0.9f, variation.time_warp) * rng.uniform(-1.0f, 1.0f);
+
+  Vec3 bias, drift;
+  for (int a = 0; a < 3; a++) {
+    bias[a] = variation.bias_dps * rng.normal();
+    drift[a] = variation.drift_dps_per_s * rng.normal();
+  }
+
+  size_t idle = (size_t)std::lround(variation.idle_s * sample_rate_hz);
+  size_t active = std::max<size_t>(
+      2, (size_t)std::lround(spec.duration_s * speed * sample_rate_hz));
+  out.resize(2 * idle + active);
+
+  for (size_t i = 0; i < out.size(); i++) {
+    Vec3 rate = {0.0f, 0.0f, 0.0f};
+    if (i >= idle && i < idle + active) {
+      float tau = (float)(i - idle) / (active - 1);
+      tau += warp * std::sin(2.0f * PI * tau) / (2.0f * PI);
+      rate = apply(orientation, scale(shape_rate(spec, tau), amplitude));
+    }
+
+    float t = i / sample_rate_hz;
+    for (int a = 0; a < 3; a++) {
+      rate[a] += bias[a] + drift[a] * t;
+      if (variation.noise_dps > 0.0f) rate[a] += variation.noise_dps * rng.normal();
+    }
+    if (variation.spike_probability > 0.0f &&
+        rng.uniform() < variation.spike_probability) {
+      float sign = rng.uniform() < 0.5f ? -1.0f : 1.0f;
+      rate[rng.next() % 3] += sign * variation.spike_dps;
+    }
+    out[i] = rate;
+  }
+}
+
+}  // namespace synth
@@ -0,0 +1,118 @@
+/**
+ * @file gesture_synth.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Parametric synthetic gesture generator for SyntheticGyroSource,
+ * host benchmarks and accuracy runs.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Gestures are 3-axis angular-rate sequences in dps at the recording rate,
+ * in the same vector<array<float, 3>> form the matcher consumes. A
+ * GestureSpec describes a gesture class (what a user would enroll); a
+ * Variation describes how one performance of it differs from the ideal
+ * (timing, strength, orientation, sensor imperfections). Generation is a
+ * pure function of (spec, variation, seed), so any instance can be rebuilt
+ * on its own and batches can be generated in parallel. SyntheticGyroSource
+ * plays the same gestures as raw sensor samples, so a replay on the board
+ * and a host evaluation see the same data.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef GESTURE_SYNTH_H
+#define GESTURE_SYNTH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace synth {
+
+typedef std::array<float, 3> Vec3;
+typedef std::vector<Vec3> Gesture;
+
+/**
+ * @brief Small, fast, seedable generator (xoshiro128**, seeded by splitmix64)
+ */
+class Rng {
+ public:
+  explicit Rng(uint64_t seed);
+
+  uint32_t next();
+  float uniform();                     // [0, 1)
+  float uniform(float lo, float hi);   // [lo, hi)
+  float normal();                      // standard normal
+  Vec3 unit_vector();                  // uniform on the sphere
+
+ private:
+  uint32_t s_[4];
+  float spare_;
+  bool has_spare_;
+};
+
+enum class Shape {
+  Stroke,  // up to four straight rotations, each with a smooth rate bell
+  Circle,  // rate vector sweeping around a plane
+  Flick,   // short biphasic pulse: fast rotation and rebound
+};
+
+#define SYNTH_MAX_SEGMENTS 4
+
+// A gesture class
+struct GestureSpec {
+  Shape shape;
+  float duration_s;     // nominal length of the motion
+  float amplitude_dps;  // nominal peak rate
+  int segments;         // Stroke: number of segments in axes[]
+  Vec3 axes[SYNTH_MAX_SEGMENTS];  // Stroke/Flick: rotation axes; Circle: normal
+  float turns;          // Circle: revolutions of the rate vector
+};
+
+// How one performance deviates from its class
+struct Variation {
+  float time_warp;          // 0..0.9, strength of the non-linear time warp
+  float speed_jitter;       // relative spread of the overall duration
+  float amplitude_jitter;   // relative spread of the peak rate
+  float rotation_deg;       // spread of the whole-gesture axis rotation
+  float noise_dps;          // white sensor noise (rms)
+  float bias_dps;           // spread of the constant rate bias
+  float drift_dps_per_s;    // spread of the linear bias drift
+  float spike_probability;  // chance per sample of a single-sample spike
+  float spike_dps;          // spike magnitude
+  float idle_s;             // still time before and after the motion
+};
+
+/**
+ * @brief Variation of a careful user on a good sensor
+ */
+Variation clean_variation();
+
+/**
+ * @brief Variation of a typical genuine attempt with real sensor defects
+ */
+Variation typical_variation();
+
+/**
+ * @brief Draw a random gesture class
+ */
+GestureSpec random_spec(Rng &rng);
+
+/**
+ * @brief Generate one performance of a gesture class
+ * @param spec: the gesture class
+ * @param variation: how far this performance may deviate
+ * @param seed: instance seed; equal arguments give identical output
+ * @param out: receives the samples (its capacity is reused)
+ * @param sample_rate_hz: output rate; the default is the recording rate
+ *        (GYRO_SAMPLE_RATE_HZ / RECORDING_DECIMATION)
+ */
+void generate(const GestureSpec &spec, const Variation &variation,
+              uint64_t seed, Gesture &out, float sample_rate_hz = 20.0f);
+
+}  // namespace synth
+
+#endif  // GESTURE_SYNTH_H
@@ -0,0 +1,67 @@
+/**
+ * @file glyph_atlas.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Font glyphs expanded to A8 cells for DMA2D text.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "glyph_atlas.h"
+
+#include <cstring>
+
+GlyphAtlas::GlyphAtlas() : font_(nullptr) {}
+
+size_t GlyphAtlas::bytes(const sFONT *font) {
+  return (size_t)(LCD_ATLAS_GLYPHS + 1) * font->Width * font->Height;
+}
+
+/*******************************************************************************
+ *
+ * @brief Expand each glyph's rows of bits, as the BSP's DrawChar() reads
+ * them, to a byte per pixel; the last cell is all set
+ *
+ * ****************************************************************************/
+bool GlyphAtlas::build(sFONT *font) {
+  font_ = nullptr;
+  if (bytes(font) > sizeof(cells_)) return false;
+
+  uint16_t width = font->Width;
+  uint16_t height = font->Height;
+  uint32_t stride = (width + 7) / 8;
+  uint8_t offset = 8 * stride - width;
+  uint8_t *cell = cells_;
+  for (uint32_t glyph = 0; glyph < LCD_ATLAS_GLYPHS; glyph++) {
+    const uint8_t *bits = &font->table[glyph * height * stride];
+    for (uint32_t i = 0; i < height; i++) {
+      const uint8_t *row = bits + stride * i;
+      uint32_t line = 0;
+      for (uint32_t b = 0; b < stride && b < 3; b++) {
+        line = (line << 8) | row[b];
+      }
+      for (uint32_t j = 0; j < width; j++) {
+        *cell++ = line & (1 << (width - j + offset - 1)) ? 0xFF : 0x00;
+      }
+    }
+  }
+  memset(cell, 0xFF, (size_t)width * height);
+  font_ = font;
+  return true;
+}
+
+void GlyphAtlas::attach(LCD_DISCO_F429ZI &lcd) const {
+  lcd.SetGlyphAtlas(font_, font_ != nullptr ? cells_ : nullptr);
+}
+
+const uint8_t *GlyphAtlas::glyph(uint8_t ascii) const {
+  if (font_ == nullptr || ascii < ' ' || ascii >= ' ' + LCD_ATLAS_GLYPHS) {
+    return nullptr;
+  }
+  return &cells_[(ascii - ' ') * font_->Width * font_->Height];
+}
@@ -0,0 +1,67 @@
+/**
+ * @file glyph_atlas.h
+ * @author Xhovani Mali (xxm202)
+ * @brief The glyphs of a font expanded to one byte per pixel, for the LCD
+ * to draw text with DMA2D blends.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * The BSP draws a character from the font's bit table one pixel at a time:
+ * 176 CPU stores for a Font16 glyph, each its own write to the
+ * SDRAM, after the bits have been picked out. A GlyphAtlas expands every
+ * glyph once, at boot, to an A8 cell (0xFF where the bit is set, 0x00
+ * elsewhere) in internal SRAM, plus one cell of 0xFF. Attached to the LCD,
+ * DisplayChar() and DisplayStringAt() then draw a glyph as one DMA2D
+ * memory-to-memory blend: the glyph cell in the text color over the opaque
+ * cell in the back color, converted to the layer's format on the way out.
+ * The pixels are the BSP's exactly; the CPU only sets up the transfer.
+ *
+ * The atlas holds one font, GLYPH_ATLAS_BYTES at most; the LCD falls back
+ * to the BSP for any other font, for colors that are not opaque, for a
+ * glyph that does not start on the screen and in L8, which the DMA2D cannot
+ * write.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include "system_config.h"
+
+class GlyphAtlas {
+ public:
+  GlyphAtlas();
+
+  /**
+   * @brief Bytes the atlas of a font takes
+   */
+  static size_t bytes(const sFONT *font);
+
+  /**
+   * @brief Expand the glyphs of a font
+   * @return false if they do not fit in GLYPH_ATLAS_BYTES
+   */
+  bool build(sFONT *font);
+
+  /**
+   * @brief Have the LCD draw text in the atlas's font from it
+   */
+  void attach(LCD_DISCO_F429ZI &lcd) const;
+
+  sFONT *font() const { return font_; }
+
+  /**
+   * @brief The A8 cell of a character, Width x Height bytes, or nullptr
+   */
+  const uint8_t *glyph(uint8_t ascii) const;
+
+ private:
+  sFONT *font_;  // nullptr until built
+  uint8_t cells_[GLYPH_ATLAS_BYTES];
+};
+
+#endif  // GLYPH_ATLAS_H
@@ -14,6 +14,7 @@
 
 
 #include "gyro.h"
+#include "gyro_source.h"
 
 SPI gyroscope(PF_9, PF_8, PF_7); // mosi, miso, sclk
 DigitalOut cs(PC_1);
@@ -78,11 +79,27 @@ void CalibrateGyroscope(Gyroscope_RawData *rawdata)
     printf("========[Calibration finish.]========\r\n");
 }
 
-// Initiate gyroscope, set up control registers
-void InitiateGyroscope(Gyroscope_Init_Parameters *init_parameters, Gyroscope_RawData *init_raw_data)
+// Sensitivity (dps/digit) for a full-scale selection
+float SensitivityFromConfig(uint8_t conf4)
+{
+    switch (conf4)
+    {
+        case FULL_SCALE_245:
+            return SENSITIVITY_245;
+
+        case FULL_SCALE_500:
+            return SENSITIVITY_500;
+
+        case FULL_SCALE_2000:
+        case FULL_SCALE_2000_ALT:
+            return SENSITIVITY_2000;
+    }
+    return 0.0f;
+}
+
+// Set up SPI and the control registers without calibrating
+void ConfigureGyroscope(const Gyroscope_Init_Parameters *init_parameters)
 {
-    printf("\r\n========[Initializing gyroscope...]========\r\n");
-    gyro_raw = init_raw_data;
     cs = 1;
     // set up gyroscope
     gyroscope.format(8, 3);       // 8 bits per SPI frame; polarity 1, phase 0
@@ -92,24 +109,15 @@ void InitiateGyroscope(Gyroscope_Init_Parameters *init_parameters, Gyroscope_Raw
     WriteByte(CTRL_REG_3, init_parameters->conf3);           // DRDY enable
     WriteByte(CTRL_REG_4, init_parameters->conf4);           // LSB, full sacle selection: 500dps
 
-    switch (init_parameters->conf4)
-    {
-        case FULL_SCALE_245:
-            sensitivity = SENSITIVITY_245;
-            break;
-
-        case FULL_SCALE_500:
-            sensitivity = SENSITIVITY_500;
-            break;
-
-        case FULL_SCALE_2000:
-            sensitivity = SENSITIVITY_2000;
-            break;
+    sensitivity = SensitivityFromConfig(init_parameters->conf4);
+}
 
-        case FULL_SCALE_2000_ALT:
-            sensitivity = SENSITIVITY_2000;
-            break;
-    }
+// Initiate gyroscope, set up control registers
+void InitiateGyroscope(Gyroscope_Init_Parameters *init_parameters, Gyroscope_RawData *init_raw_data)
+{
+    printf("\r\n========[Initializing gyroscope...]========\r\n");
+    gyro_raw = init_raw_data;
+    ConfigureGyroscope(init_parameters);
 
     CalibrateGyroscope(gyro_raw); // calibrate the gyroscope and find the threshold for x, y, and z.
     printf("========[Initiation finish.]========\r\n");
@@ -165,3 +173,42 @@ void PowerOff()
 {
     WriteByte(CTRL_REG_1, 0x00);
 }
+
+/*******************************************************************************
+ * L3GD20 SPI backend of GyroSource
+ *
+ * Shares the SPI bus and chip select above with the free functions, so only
+ * one instance should exist per board.
+ * ****************************************************************************/
+L3GD20Source::L3GD20Source(EventFlags *ready_flags, uint32_t ready_flag)
+    : ready_flags_(ready_flags), ready_flag_(ready_flag), sensitivity_(0.0f)
+{
+}
+
+bool L3GD20Source::init(const Gyroscope_Init_Parameters &params)
+{
+    ConfigureGyroscope(&params);
+    sensitivity_ = ::sensitivity;
+    return sensitivity_ > 0.0f;
+}
+
+bool L3GD20Source::read(Gyroscope_RawData &sample)
+{
+    if (ready_flags_ != nullptr)
+    {
+        // DRDY only raises an edge when a fresh sample arrives; if one was
+        // missed the pin stays high, so fall back to reading after a period
+        ready_flags_->wait_any_for(ready_flag_, GYRO_READY_TIMEOUT);
+    }
+    else
+    {
+        wait_us(1000000 / GYRO_SAMPLE_RATE_HZ);
+    }
+    GetGyroValue(&sample);
+    return true;
+}
+
+void L3GD20Source::power_off()
+{
+    PowerOff();
+}
@@ -13,6 +13,9 @@
  * - Temira Koenig 
  */
 
+#ifndef GYRO_H
+#define GYRO_H
+
 #include <mbed.h>
 
 #include "system_config.h"
@@ -51,6 +54,12 @@ void CalibrateGyroscope(Gyroscope_RawData *rawdata);
 void InitiateGyroscope(Gyroscope_Init_Parameters *init_parameters,
                        Gyroscope_RawData *init_raw_data);
 
+// Gyroscope register setup only (no calibration)
+void ConfigureGyroscope(const Gyroscope_Init_Parameters *init_parameters);
+
+// Sensitivity in dps/digit for a full-scale selection (CTRL_REG_4 value)
+float SensitivityFromConfig(uint8_t conf4);
+
 // Data conversion: raw -> dps
 float ConvertToDPS(int16_t rawdata);
 
@@ -65,3 +74,5 @@ void GetCalibratedRawData();
 
 // Turn off the gyroscope
 void PowerOff();
+
+#endif  // GYRO_H
@@ -0,0 +1,88 @@
+/**
+ * @file gyro_source.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Trace replay and synthetic gyroscope sources for the embedded sentry
+ * project. The SPI source lives next to the SPI driver in gyro.cpp.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "gyro_source.h"
+
+/*******************************************************************************
+ *
+ * @brief Replay source
+ *
+ * ****************************************************************************/
+ReplayGyroSource::ReplayGyroSource(const char *path, float sensitivity,
+                                   bool loop)
+    : path_(path), file_(nullptr), sensitivity_(sensitivity), loop_(loop) {}
+
+ReplayGyroSource::~ReplayGyroSource() {
+  if (file_ != nullptr) fclose(file_);
+}
+
+bool ReplayGyroSource::init(const Gyroscope_Init_Parameters &params) {
+  (void)params;  // the trace already carries its own configuration
+  if (file_ != nullptr) fclose(file_);
+  file_ = fopen(path_, "rb");
+  if (file_ == nullptr) {
+    printf("Replay: cannot open %s\n", path_);
+    return false;
+  }
+  return true;
+}
+
+bool ReplayGyroSource::read(Gyroscope_RawData &sample) {
+  if (file_ == nullptr) return false;
+
+  uint8_t record[6];
+  if (fread(record, sizeof(record), 1, file_) != 1) {
+    if (!loop_) return false;
+    ::rewind(file_);
+    if (fread(record, sizeof(record), 1, file_) != 1) return false;
+  }
+  sample.x_raw = (int16_t)(record[0] | record[1] << 8);
+  sample.y_raw = (int16_t)(record[2] | record[3] << 8);
+  sample.z_raw = (int16_t)(record[4] | record[5] << 8);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * @brief Synthetic source
+ *
+ * ****************************************************************************/
+SyntheticGyroSource::SyntheticGyroSource(const synth::GestureSpec &spec,
+                                         const synth::Variation &variation,
+                                         uint64_t seed)
+    : sensitivity_(SENSITIVITY_500), index_(0) {
+  synth::generate(spec, variation, seed, rates_, GYRO_SAMPLE_RATE_HZ);
+}
+
+bool SyntheticGyroSource::init(const Gyroscope_Init_Parameters &params) {
+  sensitivity_ = SensitivityFromConfig(params.conf4);
+  rewind();
+  return sensitivity_ > 0.0f;
+}
+
+void SyntheticGyroSource::rewind() { index_ = 0; }
+
+bool SyntheticGyroSource::read(Gyroscope_RawData &sample) {
+  if (index_ >= rates_.size()) return false;
+
+  const synth::Vec3 &rate = rates_[index_++];
+  int16_t *axes[3] = {&sample.x_raw, &sample.y_raw, &sample.z_raw};
+  for (int i = 0; i < 3; i++) {
+    float digits = rate[i] / sensitivity_;
+    digits = std::max(-32768.0f, std::min(32767.0f, digits));
+    *axes[i] = (int16_t)lrintf(digits);
+  }
+  return true;
+}
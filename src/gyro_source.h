@@ -0,0 +1,153 @@
+/**
+ * @file gyro_source.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Sensor source abstraction for the embedded sentry project: live SPI,
+ * trace replay and synthetic gyroscope backends.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef GYRO_SOURCE_H
+#define GYRO_SOURCE_H
+
+#include <cstdio>
+
+#include "gesture_synth.h"
+#include "gyro.h"
+#include "system_config.h"
+
+/**
+ * @brief A stream of raw (uncalibrated) gyroscope samples.
+ *
+ * Everything above the sensor (calibration, filtering, recording, matching)
+ * consumes this interface, so the same pipeline runs against the board, a
+ * recorded trace or a generator.
+ */
+class GyroSource {
+ public:
+  virtual ~GyroSource() {}
+
+  /**
+   * @brief Configure the source
+   * @param params: output data rate, interrupt and full-scale selection
+   * @return true if the source is ready to deliver samples
+   */
+  virtual bool init(const Gyroscope_Init_Parameters &params) = 0;
+
+  /**
+   * @brief Fetch the next raw sample, blocking if the source is paced
+   * @param sample: receives the sample
+   * @return false once the source is exhausted
+   */
+  virtual bool read(Gyroscope_RawData &sample) = 0;
+
+  /**
+   * @brief Sensitivity of the raw samples in dps/digit
+   */
+  virtual float sensitivity() const = 0;
+
+  /**
+   * @brief Put the sensor into power-down, if there is one
+   */
+  virtual void power_off() {}
+};
+
+/**
+ * @brief The on-board L3GD20 over SPI (implemented in gyro.cpp).
+ *
+ * If ready_flags is given, read() waits for ready_flag (set from the DRDY
+ * interrupt) before each transfer; otherwise it paces itself at
+ * GYRO_SAMPLE_RATE_HZ.
+ */
+class L3GD20Source : public GyroSource {
+ public:
+  L3GD20Source(EventFlags *ready_flags = nullptr, uint32_t ready_flag = 0);
+
+  bool init(const Gyroscope_Init_Parameters &params) override;
+  bool read(Gyroscope_RawData &sample) override;
+  float sensitivity() const override { return sensitivity_; }
+  void power_off() override;
+
+ private:
+  EventFlags *ready_flags_;
+  uint32_t ready_flag_;
+  float sensitivity_;
+};
+
+/**
+ * @brief Replays a raw trace file as fast as it is read.
+ *
+ * The trace is a sequence of Gyroscope_RawData records (x, y, z as
+ * little-endian int16_t), i.e. exactly what GetGyroValue() produced.
+ */
+class ReplayGyroSource : public GyroSource {
+ public:
+  /**
+   * @param path: trace file to replay
+   * @param sensitivity: dps/digit the trace was recorded with
+   * @param loop: restart from the beginning instead of ending the stream
+   */
+  ReplayGyroSource(const char *path, float sensitivity = SENSITIVITY_500,
+                   bool loop = false);
+  ~ReplayGyroSource() override;
+
+  bool init(const Gyroscope_Init_Parameters &params) override;
+  bool read(Gyroscope_RawData &sample) override;
+  float sensitivity() const override { return sensitivity_; }
+
+ private:
+  ReplayGyroSource(const ReplayGyroSource &) = delete;
+  ReplayGyroSource &operator=(const ReplayGyroSource &) = delete;
+
+  const char *path_;
+  FILE *file_;
+  float sensitivity_;
+  bool loop_;
+};
+
+/**
+ * @brief One performance of a synth:: gesture as raw sensor samples.
+ *
+ * The gesture is generated with synth::generate() at GYRO_SAMPLE_RATE_HZ
+ * when the source is built (so read() never allocates), then quantized to
+ * digits of the configured full scale. Noise, bias, drift and spikes come
+ * from the variation; its idle time gives calibration and trimming the
+ * still samples they expect.
+ */
+class SyntheticGyroSource : public GyroSource {
+ public:
+  /**
+   * @param spec: the gesture class
+   * @param variation: how this performance deviates from it
+   * @param seed: instance seed; equal arguments give equal streams
+   */
+  SyntheticGyroSource(const synth::GestureSpec &spec,
+                      const synth::Variation &variation, uint64_t seed);
+
+  bool init(const Gyroscope_Init_Parameters &params) override;
+  bool read(Gyroscope_RawData &sample) override;
+  float sensitivity() const override { return sensitivity_; }
+
+  /**
+   * @brief Restart the stream (same seed, same samples)
+   */
+  void rewind();
+
+  /**
+   * @brief The samples of the stream, in dps
+   */
+  const synth::Gesture &rates() const { return rates_; }
+
+ private:
+  synth::Gesture rates_;
+  float sensitivity_;
+  size_t index_;
+};
+
+#endif  // GYRO_SOURCE_H
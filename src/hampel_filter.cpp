@@ -0,0 +1,139 @@
+/**
+ * @file hampel_filter.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Streaming Hampel filter implementation for the embedded sentry
+ * project.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "hampel_filter.h"
+
+static_assert(HAMPEL_WINDOW_SIZE % 2 == 1,
+              "HAMPEL_WINDOW_SIZE must be odd so the median is a sample");
+
+// How many samples late the stream comes out: the judged sample is the
+// middle of the window
+static const size_t DELAY = HAMPEL_WINDOW_SIZE / 2;
+
+// Scale factor turning a MAD into a standard deviation estimate for
+// normally distributed noise
+static const float MAD_TO_SIGMA = 1.4826f;
+
+HampelFilter::HampelFilter(float n_sigmas, float min_deviation)
+    : n_sigmas_(n_sigmas), min_deviation_(min_deviation) {
+  reset();
+}
+
+void HampelFilter::reset() {
+  head_ = 0;
+  count_ = 0;
+  last_outlier_ = false;
+  outliers_ = 0;
+}
+
+/*******************************************************************************
+ *
+ * @brief Push one sample through the filter
+ * @param sample: the new sample
+ * @return the sample DELAY calls before (the first one until there is
+ * such), or the window median if it was rejected
+ *
+ * ****************************************************************************/
+float HampelFilter::filter(float sample) {
+  insert(sample);
+  last_outlier_ = false;
+
+  // The first sample stands in for the ones before the stream started
+  if (count_ <= DELAY) return ring_[0];
+  float middle =
+      ring_[(head_ + HAMPEL_WINDOW_SIZE - 1 - DELAY) % HAMPEL_WINDOW_SIZE];
+
+  // Not enough history yet to tell a spike from motion
+  if (count_ < HAMPEL_WINDOW_SIZE) return middle;
+
+  float median = sorted_[HAMPEL_WINDOW_SIZE / 2];
+  float limit = n_sigmas_ * MAD_TO_SIGMA * median_abs_deviation(median);
+  if (limit < min_deviation_) limit = min_deviation_;
+
+  if (abs(middle - median) > limit) {
+    last_outlier_ = true;
+    outliers_++;
+    return median;
+  }
+  return middle;
+}
+
+/*******************************************************************************
+ *
+ * @brief Add a sample to the window, evicting the oldest one when full
+ * @param sample: the new sample
+ *
+ * Both the eviction and the insertion are a single shift over the sorted
+ * array, so a full update touches at most HAMPEL_WINDOW_SIZE elements.
+ *
+ * ****************************************************************************/
+void HampelFilter::insert(float sample) {
+  size_t n = count_;
+
+  if (count_ == HAMPEL_WINDOW_SIZE) {
+    // Remove the oldest value from the sorted view
+    float oldest = ring_[head_];
+    size_t pos = 0;
+    while (pos + 1 < n && sorted_[pos] != oldest) pos++;
+    for (; pos + 1 < n; pos++) sorted_[pos] = sorted_[pos + 1];
+    n--;
+  } else {
+    count_++;
+  }
+
+  // Insertion step: shift larger values up by one
+  size_t pos = n;
+  while (pos > 0 && sorted_[pos - 1] > sample) {
+    sorted_[pos] = sorted_[pos - 1];
+    pos--;
+  }
+  sorted_[pos] = sample;
+
+  ring_[head_] = sample;
+  head_ = (head_ + 1) % HAMPEL_WINDOW_SIZE;
+}
+
+/*******************************************************************************
+ *
+ * @brief Median absolute deviation of the (full) window around its median
+ * @param median: the window median
+ * @return the MAD
+ *
+ * Deviations grow monotonically when walking outward from the median in the
+ * sorted window, so the median deviation is found by merging the two sides
+ * for half a window instead of sorting the deviations.
+ *
+ * ****************************************************************************/
+float HampelFilter::median_abs_deviation(float median) const {
+  size_t mid = HAMPEL_WINDOW_SIZE / 2;
+  size_t lo = mid;      // next candidate below is sorted_[lo - 1]
+  size_t hi = mid + 1;  // next candidate above is sorted_[hi]
+  float deviation = 0.0f;  // the median itself
+
+  for (size_t taken = 0; taken < HAMPEL_WINDOW_SIZE / 2; taken++) {
+    float below = lo > 0 ? median - sorted_[lo - 1]
+                         : numeric_limits<float>::infinity();
+    float above = hi < HAMPEL_WINDOW_SIZE ? sorted_[hi] - median
+                                          : numeric_limits<float>::infinity();
+    if (below <= above) {
+      deviation = below;
+      lo--;
+    } else {
+      deviation = above;
+      hi++;
+    }
+  }
+  return deviation;
+}
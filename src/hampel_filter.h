@@ -0,0 +1,84 @@
+/**
+ * @file hampel_filter.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Streaming Hampel (median/MAD) spike rejection for the gyro stream.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef HAMPEL_FILTER_H
+#define HAMPEL_FILTER_H
+
+#include "system_config.h"
+
+/**
+ * @brief Single-axis streaming Hampel filter.
+ *
+ * Keeps the last HAMPEL_WINDOW_SIZE samples both in arrival order (ring) and
+ * in sorted order, so the window median and the median absolute deviation
+ * (MAD) are available without sorting or allocating. The sample judged is
+ * the one in the middle of the window, with as many newer samples as older
+ * around it: if it lies further than max(n_sigmas * 1.4826 * MAD,
+ * min_deviation) from the median it is replaced by the median. A spike is
+ * one sample among its neighbours and goes; a step or a ramp leaves the
+ * middle sample at (or next to) the median and passes unchanged. The
+ * stream comes out HAMPEL_WINDOW_SIZE / 2 samples late, the first sample
+ * standing in until then. The cost per sample is bounded by the window
+ * size, which is a compile-time constant.
+ */
+class HampelFilter {
+ public:
+  /**
+   * @brief Construct a filter
+   * @param n_sigmas: rejection threshold in (MAD-estimated) standard deviations
+   * @param min_deviation: smallest deviation from the median ever treated as
+   *        an outlier, in the units of the stream (keeps flat, dead-banded
+   *        windows with MAD == 0 from rejecting every real motion onset)
+   */
+  HampelFilter(float n_sigmas = HAMPEL_N_SIGMAS,
+               float min_deviation = HAMPEL_MIN_DEVIATION);
+
+  /**
+   * @brief Push one sample through the filter
+   * @param sample: the new sample
+   * @return the sample HAMPEL_WINDOW_SIZE / 2 calls before (the first one
+   *         until there is such), or the window median if it was rejected
+   */
+  float filter(float sample);
+
+  /**
+   * @brief Forget the window contents (e.g. at the start of a recording)
+   */
+  void reset();
+
+  /**
+   * @brief Whether the sample last returned by filter() was rejected
+   */
+  bool last_was_outlier() const { return last_outlier_; }
+
+  /**
+   * @brief Number of samples rejected since the last reset()
+   */
+  size_t outlier_count() const { return outliers_; }
+
+ private:
+  void insert(float sample);
+  float median_abs_deviation(float median) const;
+
+  float ring_[HAMPEL_WINDOW_SIZE];    // samples in arrival order
+  float sorted_[HAMPEL_WINDOW_SIZE];  // the same samples, ascending
+  size_t head_;                       // next ring slot to overwrite
+  size_t count_;                      // number of valid samples (<= window)
+  float n_sigmas_;
+  float min_deviation_;
+  bool last_outlier_;
+  size_t outliers_;
+};
+
+#endif  // HAMPEL_FILTER_H
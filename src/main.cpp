@@ -17,6 +17,23 @@
 #include <array>                      // For array usage
 #include "utilities.h"                // Utility functions
 #include "gyro.h"                     // Gyroscope functions
+#include "arena.h"                    // SDRAM arenas
+#include "blackbox.h"                 // Recorder of the last attempts
+#include "capture.h"                  // Calibration and recording
+#include "capture_format.h"           // Binary capture stream
+#include "display_format.h"           // Frame buffer pixel format
+#include "eeprom_store.h"             // Small records in the I2C EEPROM
+#include "flash_writer.h"             // Background flash jobs
+#include "frame_buffers.h"            // Double-buffered display
+#include "glyph_atlas.h"              // Text drawn with DMA2D blends
+#include "matcher.h"                  // Unlock matching
+#include "memory_report.h"            // Stack and heap usage
+#include "profiler.h"                 // Stage profiler
+#include "rate_plot.h"                // Rate plot while recording
+#include "status_line.h"              // Status line redrawn by glyph
+#include "template_store.h"           // Gesture keys in flash
+#include "touch_input.h"              // Interrupt-driven touch presses
+#include "ui_renderer.h"              // UI thread and its command queue
 #include "system_config.h"            // System configuration
 #include "drivers/LCD_DISCO_F429ZI.h" // LCD driver
 #include "drivers/TS_DISCO_F429ZI.h"  // Touch screen driver
@@ -28,36 +45,115 @@ DigitalOut led_status_green(LED1);
 DigitalOut led_status_red(LED2);
 
 LCD_DISCO_F429ZI lcd; // LCD object
+// The LCD font's glyphs, one byte per pixel, for DMA2D text
+GlyphAtlas glyph_atlas;
+// Frames drawn off screen and flipped at vertical blanking
+FrameBuffers frame_buffers(lcd, DISPLAY_FRONT_BUFFER, DISPLAY_BACK_BUFFER);
 TS_DISCO_F429ZI ts; // Touch screen object
 
 EventFlags flags; // Event flags
 
 Timer timer; // Timer
 
-float movingAverageFilter(float new_value, std::array<float, WINDOW_SIZE>& buffer, size_t& index, float& sum);
-void normalize(vector<array<float, 3>>& data);
+// The on-board gyroscope, paced by its data-ready interrupt
+L3GD20Source gyro_source(&flags, DATA_READY_FLAG);
 
-// Global variables for moving average filter
-float gyro_buffer_x[WINDOW_SIZE] = {0};  // Buffers for x, y, z data
-float gyro_buffer_y[WINDOW_SIZE] = {0};
-float gyro_buffer_z[WINDOW_SIZE] = {0};
-size_t gyro_index_x = 0, gyro_index_y = 0, gyro_index_z = 0;  // Index for each buffer
-float gyro_sum_x = 0, gyro_sum_y = 0, gyro_sum_z = 0;  // Sum for each axis
+// The last attempts, kept in SDRAM for diagnosis (see blackbox.h)
+BlackBox black_box;
+BlackBoxGyroSource blackbox_source(gyro_source, black_box);
+
+// The rate plotted below the status line while recording (see rate_plot.h)
+RatePlot rate_plot(lcd, frame_buffers, 0, RATE_PLOT_Y, lcd.GetXSize(), RATE_PLOT_HEIGHT);
+PlottingGyroSource plotting_source(blackbox_source, rate_plot);
+
+// The serial console, shared by printf from every thread and the binary
+// capture frames. Each write holds the lock for all of its bytes (the
+// serial's own lock is let go while its buffer drains), and a frame is one
+// write, so text can come between frames but never inside one.
+class SerialConsole : public BufferedSerial
+{
+public:
+    SerialConsole() : BufferedSerial(CONSOLE_TX, CONSOLE_RX, MBED_CONF_PLATFORM_STDIO_BAUD_RATE) {}
+
+    ssize_t write(const void *buffer, size_t size) override
+    {
+        ScopedLock<Mutex> lock(mutex_);
+        return BufferedSerial::write(buffer, size);
+    }
+
+private:
+    Mutex mutex_;
+};
+
+SerialConsole &serial_console()
+{
+    static SerialConsole instance;
+    return instance;
+}
+
+// stdio (printf, getchar) goes through the same console
+FileHandle *mbed::mbed_override_console(int fd)
+{
+    (void)fd;
+    return &serial_console();
+}
+
+// Binary capture of every recording on the console (see capture_format.h):
+// straight to the console, one frame per write, not through stdio's buffer
+size_t console_sink(void *context, const uint8_t *data, size_t size)
+{
+    (void)context;
+    ssize_t written = serial_console().write(data, size);
+    return written > 0 ? (size_t)written : 0;
+}
+CaptureWriter capture_writer(console_sink, nullptr);
+CapturingGyroSource capturing_source(plotting_source, capture_writer);
+uint32_t capture_session_id = 0;
+
+// Gesture keys in internal flash, written in the background
+TemplateStore template_store;
+FlashWriter flash_writer(template_store);
+
+// What the matcher needs of the key, computed once per key (see
+// template_features.h)
+TemplateFeatures key_features(&SdramArena(ARENA_TEMPLATE));
+
+// I2C3 is shared by the touch controller and the EEPROM
+Mutex i2c_bus;
+
+// Unlock attempt counters, kept in EEPROM_RECORD_ATTEMPTS
+typedef struct
+{
+    uint32_t attempts;       // unlock attempts against an enrolled key
+    uint32_t failures;       // of those, the ones that failed
+    uint32_t failure_streak; // failures since the last success
+} Unlock_Attempts;
+
+EepromStore eeprom_store(&i2c_bus);
+
+// Touch presses, woken by the STMPE811 interrupt
+TouchInput touch_input(ts, i2c_bus);
+Unlock_Attempts unlock_attempts = {0, 0, 0};
+
+// Thread stacks, painted for the memory report (see memory_report.h)
+MBED_ALIGN(8) unsigned char gyroscope_stack[GYROSCOPE_STACK_SIZE];
+MBED_ALIGN(8) unsigned char touch_stack[TOUCH_STACK_SIZE];
+MBED_ALIGN(8) unsigned char console_stack[CONSOLE_STACK_SIZE];
 
 /*******************************************************************************
  * Function Prototypes of LCD and Touch Screen
  * ****************************************************************************/
 void draw_button(int x, int y, int width, int height, const char *label);
+void display_status(Status_Message_Id message);
 bool is_touch_inside_button(int touch_x, int touch_y, int button_x, int button_y, int button_width, int button_height);
 
+bool key_enrolled();
+void key_persisted(uint8_t slot, Flash_Job_Status status);
+void build_key_features(const Template_View &key);
+
 void gyroscope_thread();
 void touch_screen_thread();
-
-bool storeGyroDataToFlash(vector<array<float, 3>> &gesture_key, uint32_t flash_address);
-vector<array<float, 3>> readGyroDataFromFlash(uint32_t flash_address, size_t data_size);
-
-// moving average filter will be defined after main()
-float movingAverageFilter(float input, float display_buffer[], size_t N, size_t &index, float &sum);
+void console_thread();
 
 /*******************************************************************************
  * ISR Callback Functions
@@ -74,7 +170,7 @@ void onGyroDataReady() // Gyrscope data ready ISR
 /*******************************************************************************
  * @brief Global Variables
  * ****************************************************************************/
-vector<array<float, 3>> gesture_key; // the gesture key
+vector<array<float, 3>> gesture_key; // the gesture key, until it is stored in flash
 vector<array<float, 3>> unlocking_record; // the unlocking record
 
 const int button1_x = 60;
@@ -90,21 +186,45 @@ const char *button2_label = "UNLOCK";
 const int message_x = 5;
 const int message_y = 30;
 const char *message = "EMBEDDED SENTRY";
-const int text_x = 5;
-const int text_y = 270;
-const char *text_0 = "NO KEY RECORDED";
-const char *text_1 = "LOCKED";
+// The status messages, redrawn only where they change
+StatusLine status_line(lcd, STATUS_TEXT_X, STATUS_TEXT_Y);
 
+// The one thread drawing the status line and progress bar and setting the LEDs
+UiRenderer ui(lcd, frame_buffers, status_line, led_status_green, led_status_red);
 
-int err = 0; // for error checking
 
 /*******************************************************************************
  * @brief main function
  * ****************************************************************************/
 int main()
 {
+    ProfilerInit();
+    DisplayFormatApply(lcd);
     lcd.Clear(LCD_COLOR_BLACK);
 
+    // Text in the LCD's font is blended from the atlas by the DMA2D
+    if (glyph_atlas.build(lcd.GetFont()))
+    {
+        glyph_atlas.attach(lcd);
+    }
+    else
+    {
+        printf("Glyph atlas: font too large, text is drawn by the CPU\n");
+    }
+
+    // The LCD has brought up the SDRAM; the rest of it goes to the arenas
+    if (!SdramArenaInit())
+    {
+        printf("SDRAM arenas unavailable, recordings use the heap\n");
+    }
+
+    // The black box keeps its attempts across a warm reset
+    size_t blackbox_size = BlackBox::region_size(BLACKBOX_ATTEMPTS);
+    if (black_box.init(SdramArena(ARENA_BLACKBOX).allocate(blackbox_size), blackbox_size))
+    {
+        printf("Black box: %u of %u attempts kept\n", (unsigned)black_box.count(), (unsigned)black_box.capacity());
+    }
+
     // Draw button 1
     draw_button(button1_x, button1_y, button1_width, button1_height, button1_label);
 
@@ -114,37 +234,80 @@ int main()
     // Display the welcome message
     lcd.DisplayStringAt(message_x, message_y, (uint8_t *)message, CENTER_MODE);
 
+    // From here on the status line is drawn off screen and flipped in, by
+    // the UI thread
+    frame_buffers.enable();
+    MemoryWatchStack("ui", ui.stack(), ui.stack_size());
+    ui.start();
+
+    // Mount the template store (formats it on the first boot) and find the
+    // enrolled key, so a reset comes back up locked. The key is matched in
+    // place in flash and never loaded into RAM.
+    uint32_t boot_start = ProfilerNow();
+    Template_View boot_key;
+    if (!template_store.mount())
+    {
+        printf("Template store: mount failed\n");
+    }
+    else if (template_store.acquire(TEMPLATE_KEY_SLOT, boot_key))
+    {
+        printf("Gesture key found in flash (%u bytes)\n", (unsigned)boot_key.length);
+        build_key_features(boot_key);
+        template_store.release();
+    }
+    MemoryWatchStack("flash writer", flash_writer.stack(), flash_writer.stack_size());
+    flash_writer.start();
+    uint32_t boot_us = (ProfilerNow() - boot_start) / ProfilerTicksPerUs();
+    if (boot_us > BOOT_LOAD_BUDGET_MS * 1000)
+    {
+        printf("Template store: boot load took %lu us, over budget\n", (unsigned long)boot_us);
+    }
+
+    // Counters survive resets in the EEPROM, if the module is fitted
+    if (!eeprom_store.mount())
+    {
+        printf("EEPROM not found, attempt counters kept in RAM\n");
+    }
+    else if (eeprom_store.read(EEPROM_RECORD_ATTEMPTS, &unlock_attempts, sizeof(unlock_attempts)))
+    {
+        printf("Unlock attempts: %lu, failed: %lu, failed in a row: %lu\n", (unsigned long)unlock_attempts.attempts,
+               (unsigned long)unlock_attempts.failures, (unsigned long)unlock_attempts.failure_streak);
+    }
+
     // initialize all interrupts
     user_command_button.rise(&button_press);
     gyroscope_interrupt.rise(&onGyroDataReady);
 
-    if (gesture_key.empty())
+    if (!key_enrolled())
     {
-        led_status_red = 0;
-        led_status_green = 1;  // Green LED indicates ready to record
-        lcd.SetTextColor(LCD_COLOR_GREEN);
-        lcd.DisplayStringAt(text_x, text_y, (uint8_t *)text_0, CENTER_MODE);
+        ui.leds(UI_LED_GREEN); // Green LED indicates ready to record
+        display_status(STATUS_NO_KEY);
     }
     else
     {
-        led_status_red = 1;    // Red LED indicates locked
-        led_status_green = 0;
-        lcd.SetTextColor(LCD_COLOR_RED);    // Use RED for locked status
-        lcd.DisplayStringAt(text_x, text_y, (uint8_t *)text_1, CENTER_MODE);
+        ui.leds(UI_LED_RED);   // Red LED indicates locked
+        display_status(STATUS_LOCKED);
     }
 
     // Create the gyroscope thread
-    Thread key_saving;
+    Thread key_saving(osPriorityNormal, sizeof(gyroscope_stack), gyroscope_stack, "gyroscope");
+    MemoryWatchStack("gyroscope", gyroscope_stack, sizeof(gyroscope_stack));
     key_saving.start(callback(gyroscope_thread));
 
     // Create the touch screen thread
-    Thread touch_thread;
+    Thread touch_thread(osPriorityNormal, sizeof(touch_stack), touch_stack, "touch");
+    MemoryWatchStack("touch", touch_stack, sizeof(touch_stack));
     touch_thread.start(callback(touch_screen_thread));
 
-    // keep main thread alive
+    // Create the console command thread
+    Thread console(osPriorityNormal, sizeof(console_stack), console_stack, "console");
+    MemoryWatchStack("console", console_stack, sizeof(console_stack));
+    console.start(callback(console_thread));
+
+    // keep main thread alive (the flash writer reclaims space when idle)
     while (1)
     {
-        ThisThread::sleep_for(100ms);
+        ThisThread::sleep_for(1s);
     }
 }
 
@@ -165,13 +328,10 @@ void gyroscope_thread()
             FULL_SCALE_500     // Full-scale selection
     };
 
-    // Set up gyroscope's raw data
-    Gyroscope_RawData raw_data;
-    char display_buffer[50];
+    // Zero-rate level and dead-band of the latest calibration
+    Gyroscope_Calibration calibration;
 
-    // After gyroscope initialization
-    printf("Gyroscope Initialized: ODR_200_CUTOFF_50, INT2_DRDY, FULL_SCALE_500\n");
-    printf("Gyroscope Raw Data: x = %d, y = %d, z = %d\n", raw_data.x_raw, raw_data.y_raw, raw_data.z_raw);
+    printf("Gyroscope parameters: ODR_200_CUTOFF_50, INT2_DRDY, FULL_SCALE_500\n");
 
     // Ensure the data-ready flag is set if the gyroscope interrupt is triggered
     if (!(flags.get() & DATA_READY_FLAG) && (gyroscope_interrupt.read() == 1))
@@ -182,188 +342,177 @@ void gyroscope_thread()
 
     while (1)
     {
-        vector<array<float, 3>> temp_key; // Temporary key to store recorded gyroscope data
+        // Recorded gyroscope data, in the SDRAM capture arena that is
+        // emptied for every recording
+        SdramArena(ARENA_CAPTURE).reset();
+        ArenaSamples temp_key{ArenaAllocator<array<float, 3>>(SdramArena(ARENA_CAPTURE))};
 
         // Wait for a flag indicating recording, unlocking, or erasing actions
-        auto flag_check = flags.wait_any(KEY_FLAG | UNLOCK_FLAG | ERASE_FLAG);
+        auto flag_check = flags.wait_any(KEY_FLAG | UNLOCK_FLAG | ERASE_FLAG | KEY_STORED_FLAG);
         printf("Waiting for flags: KEY_FLAG | UNLOCK_FLAG | ERASE_FLAG\n");
         printf("Flag check result: %ld\n", flag_check);
 
+        // The key reached flash: match it there and drop the RAM copy, unless
+        // a newer key is still on its way
+        if ((flag_check & KEY_STORED_FLAG) && !flash_writer.pending(TEMPLATE_KEY_SLOT))
+        {
+            vector<array<float, 3>>().swap(gesture_key);
+
+            // Match what a reboot would load: the key as stored
+            Template_View stored;
+            if (template_store.acquire(TEMPLATE_KEY_SLOT, stored))
+            {
+                build_key_features(stored);
+                template_store.release();
+            }
+        }
+
         // Handle key erasing action
         if (flag_check & ERASE_FLAG)
         {
             printf("Erasing gesture key...\n");
-            sprintf(display_buffer, "Erasing....");
-            lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-            lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-            lcd.SetTextColor(LCD_COLOR_YELLOW); // Yellow to indicate erasing
-            lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-
-            // Clear gesture key and unlocking record
-            gesture_key.clear();
-            unlocking_record.clear();
-
-            // Display erasing completion message
-            sprintf(display_buffer, "Key Erasing finish.");
-            lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-            lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-            lcd.SetTextColor(LCD_COLOR_YELLOW); // Yellow color for completion
-            lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-
-            // Reset LED status and print message
-            led_status_green = 1;
-            led_status_red = 0;
-            sprintf(display_buffer, "All Erasing finish.");
-            lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-            lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-            lcd.SetTextColor(LCD_COLOR_YELLOW); // Yellow for success
-            lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
+            display_status(STATUS_ERASING);
+
+            // Queue the erase first: if the writer refuses it the key stays
+            // in flash, so it stays in RAM too and the erase can be retried
+            if (flash_writer.remove(TEMPLATE_KEY_SLOT))
+            {
+                // Clear gesture key and unlocking record
+                vector<array<float, 3>>().swap(gesture_key);
+                key_features.clear();
+                unlocking_record.clear();
+
+                // Display erasing completion message
+                display_status(STATUS_KEY_ERASED);
+
+                // Reset LED status and print message
+                ui.leds(UI_LED_GREEN);
+                display_status(STATUS_ALL_ERASED);
+            }
+            else
+            {
+                printf("Flash writer queue full, key not erased\n");
+                display_status(STATUS_ERASE_FAILED);
+            }
         }
 
         // Handle key recording or unlocking actions
         if (flag_check & (KEY_FLAG | UNLOCK_FLAG))
         {
             printf("Preparing for recording...\n");
-            sprintf(display_buffer, "Hold On");
-            lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-            lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-            lcd.SetTextColor(LCD_COLOR_ORANGE); // Orange for "Hold On"
-            lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
+            MemoryAttemptBegin();
+            display_status(STATUS_HOLD_ON);
 
             ThisThread::sleep_for(1s);
 
             // Calibrate gyroscope
             printf("Calibrating gyroscope...\n");
-            sprintf(display_buffer, "Calibrating...");
-            lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-            lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-            lcd.SetTextColor(LCD_COLOR_LIGHTGRAY); // Light gray to indicate calibration
-            lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
+            display_status(STATUS_CALIBRATING);
 
-            // Initialize the gyroscope
-            InitiateGyroscope(&init_parameters, &raw_data);
-            printf("Gyroscope initialized. Raw data: x = %d, y = %d, z = %d\n", raw_data.x_raw, raw_data.y_raw, raw_data.z_raw);
+            // Initialize and calibrate the gyroscope
+            gyro_source.init(init_parameters);
+            CalibrateSource(gyro_source, calibration);
+            printf("Gyroscope calibrated. Offsets: x = %d, y = %d, z = %d\n", calibration.x_offset, calibration.y_offset, calibration.z_offset);
 
-            // Start recording gesture with countdown
+            // Start recording gesture with countdown, the progress bar
+            // filling by a third each second
             for (int i = 3; i > 0; --i)
             {
-                sprintf(display_buffer, "Recording in %d...", i);
-                lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-                lcd.SetTextColor(LCD_COLOR_ORANGE); // Orange to indicate countdown
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
+                display_status((Status_Message_Id)(STATUS_RECORDING_IN_3 + 3 - i));
+                ui.progress((3 - i) * 1000 / 3);
                 ThisThread::sleep_for(1s);
             }
 
-            sprintf(display_buffer, "Recording...");
-            lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-            lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-            lcd.SetTextColor(LCD_COLOR_GREEN); // Green to indicate recording
-            lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
+            display_status(STATUS_RECORDING);
+            ui.progress(UI_PROGRESS_HIDDEN);
 
-            // Gyro data recording loop (3 seconds)
+            // Gyro data recording (3 seconds at the 20 Hz recording rate)
             printf("Starting gyro data recording...\n");
+            Capture_Stats capture_stats;
+            Capture_Session session = {capture_session_id++, GYRO_SAMPLE_RATE_HZ, init_parameters.conf4,
+                                       gyro_source.sensitivity(), calibration};
             timer.start();
-            while (timer.elapsed_time() < 3s)
+            blackbox_source.begin(session); // the raw samples go to the black box
+            plotting_source.begin(calibration); // and to the rate plot
+            if (CAPTURE_STREAM)
+            {
+                capturing_source.begin(session);
+                RecordGesture(capturing_source, calibration, RECORDING_SAMPLES, temp_key, &capture_stats);
+                capturing_source.end();
+            }
+            else
             {
-                flags.wait_all(DATA_READY_FLAG);
-                GetCalibratedRawData();
-
-                // Initialize smoothed values
-                float smoothed_x = 0.0f;
-                float smoothed_y = 0.0f;
-                float smoothed_z = 0.0f;
-
-                // Apply the moving average filter to smooth gyroscope data
-                smoothed_x = movingAverageFilter(ConvertToDPS(raw_data.x_raw),
-                                                 reinterpret_cast<array<float, 5> &>(gyro_buffer_x), gyro_index_x, gyro_sum_x);
-                smoothed_y = movingAverageFilter(ConvertToDPS(raw_data.y_raw),
-                                                 reinterpret_cast<array<float, 5> &>(gyro_buffer_y), gyro_index_y, gyro_sum_y);
-                smoothed_z = movingAverageFilter(ConvertToDPS(raw_data.z_raw),
-                                                 reinterpret_cast<array<float, 5> &>(gyro_buffer_z), gyro_index_z, gyro_sum_z);
-
-                // Debug print to check raw and smoothed data
-                printf("Raw Gyro Data: x = %d, y = %d, z = %d\n", raw_data.x_raw, raw_data.y_raw, raw_data.z_raw);
-                printf("Smoothed Gyro Data: x = %f, y = %f, z = %f\n", smoothed_x, smoothed_y, smoothed_z);
-
-                temp_key.push_back({ConvertToDPS(raw_data.x_raw), ConvertToDPS(raw_data.y_raw), ConvertToDPS(raw_data.z_raw)});
-                ThisThread::sleep_for(50ms); // 20Hz sampling
+                RecordGesture(plotting_source, calibration, RECORDING_SAMPLES, temp_key, &capture_stats);
             }
             timer.stop();
+            plotting_source.end();
+            printf("Recorded %u samples (%u raw) in %lld ms\n", (unsigned)temp_key.size(),
+                   (unsigned)capture_stats.raw_samples,
+                   (long long)chrono::duration_cast<chrono::milliseconds>(timer.elapsed_time()).count());
+            printf("Spikes rejected: x = %u, y = %u, z = %u\n", (unsigned)capture_stats.outliers[0],
+                   (unsigned)capture_stats.outliers[1], (unsigned)capture_stats.outliers[2]);
             timer.reset();
 
-            // Debugging: Check collected data before trimming
-            printf("Data Collected Before Trimming:\n");
-            for (const auto& data_point : temp_key) {
-                printf("x = %f, y = %f, z = %f\n", data_point[0], data_point[1], data_point[2]);
+            // Debugging: Check collected data before trimming (the binary
+            // capture already carries the raw samples)
+            if (!CAPTURE_STREAM)
+            {
+                printf("Data Collected Before Trimming:\n");
+                for (const auto& data_point : temp_key) {
+                    printf("x = %f, y = %f, z = %f\n", data_point[0], data_point[1], data_point[2]);
+                }
             }
 
             // Trim zero data
-            trim_gyro_data(temp_key);
+            {
+                PROFILE_SCOPE(PROFILE_TRIM);
+                trim_gyro_data(temp_key);
+            }
 
             // Debugging: Check data after trimming
-            printf("Data After Trimming:\n");
-            for (const auto& data_point : temp_key) {
-                printf("x = %f, y = %f, z = %f\n", data_point[0], data_point[1], data_point[2]);
+            if (!CAPTURE_STREAM)
+            {
+                printf("Data After Trimming:\n");
+                for (const auto& data_point : temp_key) {
+                    printf("x = %f, y = %f, z = %f\n", data_point[0], data_point[1], data_point[2]);
+                }
             }
 
-            sprintf(display_buffer, "Finished...");
-            lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-            lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-            lcd.SetTextColor(LCD_COLOR_GREEN); // Green for finished
-            lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
+            display_status(STATUS_FINISHED);
         }
 
         // Handle saving or replacing gesture keys
         if (flag_check & KEY_FLAG)
         {
             printf("Saving gesture key...\n");
-            if (gesture_key.empty())
+            if (!key_enrolled())
             {
-                sprintf(display_buffer, "Saving Key...");
-                lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-                lcd.SetTextColor(LCD_COLOR_LIGHTGREEN); // Light green for saving
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
+                display_status(STATUS_SAVING_KEY);
 
                 // Save new gesture key
-                gesture_key = temp_key;
+                gesture_key.assign(temp_key.begin(), temp_key.end());
                 temp_key.clear();
 
                 // Toggle LED to indicate saving
-                led_status_red = 1;
-                led_status_green = 0;
-
-                sprintf(display_buffer, "Key saved...");
-                lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-                lcd.SetTextColor(LCD_COLOR_LIGHTGREEN); // Light green to confirm
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
+                ui.leds(UI_LED_RED);
+
+                display_status(STATUS_KEY_SAVED);
             }
             else
             {
                 printf("Replacing old gesture key...\n");
-                sprintf(display_buffer, "Removing old key...");
-                lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-                lcd.SetTextColor(LCD_COLOR_ORANGE); // Orange to indicate replacement
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
+                display_status(STATUS_REMOVING_OLD_KEY);
 
                 ThisThread::sleep_for(1s);
 
                 gesture_key.clear();
-                gesture_key = temp_key;
+                gesture_key.assign(temp_key.begin(), temp_key.end());
 
-                sprintf(display_buffer, "New key is saved.");
-                lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-                lcd.SetTextColor(LCD_COLOR_LIGHTGREEN); // Light green for success
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
+                display_status(STATUS_NEW_KEY_SAVED);
 
                 temp_key.clear();
 
-                led_status_red = 1;
-                led_status_green = 0;
+                ui.leds(UI_LED_RED);
             }
 
             printf("Gesture Key Data:\n");
@@ -371,105 +520,109 @@ void gyroscope_thread()
                 printf("x = %f, y = %f, z = %f\n", gesture[0], gesture[1], gesture[2]);
             }
 
+            // Normalize and sum the key once instead of on every attempt
+            Template_View enrolled;
+            enrolled.data = (const uint8_t *)gesture_key.data();
+            enrolled.length = gesture_key.size() * sizeof(gesture_key[0]);
+            enrolled.encoding = TEMPLATE_ENCODING_FLOAT32;
+            enrolled.sample_rate_hz = GYRO_SAMPLE_RATE_HZ / RECORDING_DECIMATION;
+            build_key_features(enrolled);
+
+            black_box.finish(CAPTURE_OUTCOME_ENROLLED);
+
+            // Persist the key in the background so the UI never waits for
+            // the flash; the RAM copy is matched until key_persisted()
+            if (!flash_writer.persist(TEMPLATE_KEY_SLOT, gesture_key, GYRO_SAMPLE_RATE_HZ / RECORDING_DECIMATION, callback(key_persisted)))
+            {
+                printf("Flash writer queue full, key kept in RAM only\n");
+            }
+
         }
         else if (flag_check & UNLOCK_FLAG)
         {
             printf("Unlocking gesture...\n");
             flags.clear(UNLOCK_FLAG);
-            sprintf(display_buffer, "Unlocking...");
-            lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-            lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-            lcd.SetTextColor(LCD_COLOR_LIGHTGRAY); // Light gray for unlocking
-            lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
+            display_status(STATUS_UNLOCKING);
 
-            unlocking_record = temp_key; // Save the unlocking record
+            unlocking_record.assign(temp_key.begin(), temp_key.end()); // Save the unlocking record
             temp_key.clear(); // Clear temp_key
 
-            if (gesture_key.empty())
+            if (!key_enrolled())
             {
-                sprintf(display_buffer, "NO KEY SAVED.");
-                lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-                lcd.SetTextColor(LCD_COLOR_RED); // Red for error
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
+                display_status(STATUS_NO_KEY_SAVED);
 
+                black_box.finish(CAPTURE_OUTCOME_NO_KEY);
                 unlocking_record.clear();
-                led_status_green = 1;
-                led_status_red = 0;
+                ui.leds(UI_LED_GREEN);
             }
             else
             {
-                int unlock_count = 0; // counter for the coordinates that are above threshold
-                // Resize both vectors to the same size before calculation
-                size_t target_size = std::min(gesture_key.size(), unlocking_record.size());
-                gesture_key.resize(target_size);
-                unlocking_record.resize(target_size);
-
-                // Normalize both gesture and unlocking records
-                normalize(gesture_key);
-                normalize(unlocking_record);
-
-                // Ensure that both vectors have the same size
-                if (gesture_key.size() != unlocking_record.size()) {
-                    printf("Error: Vectors have different sizes before correlation!\n");
-                    size_t min_size = std::min(gesture_key.size(), unlocking_record.size());
-                    gesture_key.resize(min_size);
-                    unlocking_record.resize(min_size);
-                    printf("Vectors resized to the same size: %zu\n", min_size);
+                // Truncate, normalize, correlate and vote against the
+                // features of the key; without them, read the key in place
+                // in flash (or in RAM while it is being stored)
+                Match_Result match = {{NAN, NAN, NAN}, 0, false};
+                Template_View key;
+                if (key_features.valid())
+                {
+                    match = MatchFeatures(key_features, unlocking_record);
                 }
-
-                array<float, 3> correlationResult = calculateCorrelationVectors(gesture_key, unlocking_record); // calculate correlation
-
-                if (err != 0)
+                else if (!gesture_key.empty())
                 {
-                    printf("Error calculating correlation: vectors have different sizes\n");
+                    key.data = (const uint8_t *)gesture_key.data();
+                    key.length = gesture_key.size() * sizeof(gesture_key[0]);
+                    key.encoding = TEMPLATE_ENCODING_FLOAT32;
+                    key.sample_rate_hz = GYRO_SAMPLE_RATE_HZ / RECORDING_DECIMATION;
+                    match = MatchTemplate(key, unlocking_record);
                 }
-                else
+                else if (template_store.acquire(TEMPLATE_KEY_SLOT, key))
                 {
-                    printf("Correlation values: x = %f, y = %f, z = %f\n", correlationResult[0], correlationResult[1], correlationResult[2]);
-                    err = -1;
-
-                    // Iterate through correlationResult to check if all values are above the threshold
-                    for (size_t i = 0; i < correlationResult.size(); i++)
-                    {
-                        if (correlationResult[i] > CORRELATION_THRESHOLD) // Ensure the threshold is appropriate (e.g., 0.8 or higher)
-                        {
-                            unlock_count++;
-                        }
-                    }
+                    match = MatchTemplate(key, unlocking_record);
+                    template_store.release();
                 }
+                printf("Correlation values: x = %f, y = %f, z = %f\n", match.correlation[0], match.correlation[1], match.correlation[2]);
+                black_box.finish(match);
 
                 // Update the display and LED status based on unlock result
-                if (unlock_count == 1)  // All axes should match
+                if (match.unlocked)
                 {
-                    sprintf(display_buffer, "UNLOCK: SUCCESS");
-                    lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-                    lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-                    lcd.SetTextColor(LCD_COLOR_GREEN); // Green for success
-                    lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-
-                    led_status_green = 1;
-                    led_status_red = 0;
+                    display_status(STATUS_UNLOCK_SUCCESS);
+
+                    ui.leds(UI_LED_GREEN);
                 }
                 else
                 {
-                    sprintf(display_buffer, "UNLOCK: FAILED");
-                    lcd.SetTextColor(LCD_COLOR_BLACK); // Set background color
-                    lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear the line
-                    lcd.SetTextColor(LCD_COLOR_RED); // Red for failure
-                    lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-
-                    led_status_green = 0;
-                    led_status_red = 1;
+                    display_status(STATUS_UNLOCK_FAILED);
+
+                    ui.leds(UI_LED_RED);
+                }
+
+                // Count the attempt; the flush sleeps through the EEPROM
+                // write cycles
+                unlock_attempts.attempts++;
+                unlock_attempts.failures += match.unlocked ? 0 : 1;
+                unlock_attempts.failure_streak = match.unlocked ? 0 : unlock_attempts.failure_streak + 1;
+                eeprom_store.write(EEPROM_RECORD_ATTEMPTS, &unlock_attempts, sizeof(unlock_attempts));
+                if (eeprom_store.present() && !eeprom_store.flush())
+                {
+                    printf("EEPROM write failed, attempt counters not saved\n");
                 }
 
-                // Clear unlocking record after the attempt
+                // Clear unlocking record after the attempt (the black box
+                // keeps its raw samples)
                 unlocking_record.clear();
 
                 printf("Unlocking Gesture Data:\n");
             }
         }
 
+        // What the attempt left on the heap (see memory_report.h)
+        if (flag_check & (KEY_FLAG | UNLOCK_FLAG))
+        {
+            Memory_Attempt memory = MemoryAttemptEnd();
+            printf("Heap: %lu allocations during the attempt, %ld bytes kept\n", (unsigned long)memory.allocations,
+                   (long)memory.growth);
+        }
+
         ThisThread::sleep_for(50ms);
     }
 }
@@ -481,52 +634,184 @@ void gyroscope_thread()
  * ****************************************************************************/
 void touch_screen_thread()
 {
-    // Add your touch screen initialization and handling code here
-    TS_StateTypeDef ts_state;
-
-    if (ts.Init(lcd.GetXSize(), lcd.GetYSize()) != TS_OK)
+    // The controller and its interrupt; no I2C traffic until a finger is down
+    if (!touch_input.init(lcd.GetXSize(), lcd.GetYSize()))
     {
         printf("Failed to initialize the touch screen!\r\n");
         return;
     }
 
-    // initialize a string display_buffer that can be draw on the LCD to dispaly the status
-    char display_buffer[50];
+    // A press starts the attempt at once: the gyroscope thread holds on
+    // before calibrating, which gives the finger time to leave the board
+    Touch_Event event;
+    while (touch_input.wait(event))
+    {
+        if (event.type != TOUCH_PRESS)
+        {
+            continue;
+        }
+        int touch_x = event.x;
+        int touch_y = event.y;
+
+        // Check if the touch is inside record button
+        if (is_touch_inside_button(touch_x, touch_y, button2_x, button2_y, button1_width, button1_height))
+        {
+            display_status(STATUS_RECORD_INITIATED);
+            flags.set(KEY_FLAG);
+        }
+
+        // Check if the touch is inside unlock button
+        if (is_touch_inside_button(touch_x, touch_y, button1_x, button1_y, button2_width, button2_height))
+        {
+            display_status(STATUS_UNLOCK_INITIATED);
+            flags.set(UNLOCK_FLAG);
+        }
+    }
+}
+
+/*******************************************************************************
+ *
+ * @brief console command thread
+ *
+ * Single-character commands on the serial console:
+ *   p  print the stage profile
+ *   r  reset the stage profile
+ *   b  dump the black box as capture frames (sentry_capture record)
+ *   c  clear the black box
+ *   m  print stack high-water marks and heap usage
+ *   d  print the display's, the rate plot's and the UI thread's counters
+ *   t  print the touch input counters
+ *
+ * ****************************************************************************/
+void console_thread()
+{
+    // A writer of its own: capture_writer belongs to the gyroscope thread
+    CaptureWriter dump_writer(console_sink, nullptr);
 
     while (1)
     {
-        ts.GetState(&ts_state);
-        if (ts_state.TouchDetected)
+        int command = getchar();
+        switch (command)
+        {
+        case 'p':
+            ProfilerPrint();
+            break;
+        case 'r':
+            ProfilerReset();
+            printf("Profile reset.\n");
+            break;
+        case 'b':
+        {
+            size_t dumped = black_box.dump(dump_writer);
+            printf("Black box: %u attempts dumped\n", (unsigned)dumped);
+            break;
+        }
+        case 'c':
+            black_box.clear();
+            printf("Black box cleared.\n");
+            break;
+        case 'm':
+            MemoryPrint();
+            break;
+        case 'd':
         {
-            int touch_x = ts_state.X;
-            int touch_y = ts_state.Y;
+            Frame_Buffers_Stats frames = frame_buffers.stats();
+            printf("Display: %lu frames, last %lu us, max %lu us, budget %lu us\n", (unsigned long)frames.frames,
+                   (unsigned long)frames.last_us, (unsigned long)frames.max_us, (unsigned long)frame_buffers.budget_us());
+            printf("Display: %lu over budget, %lu refreshes dropped, %lu waits for a flip (%lu us)\n",
+                   (unsigned long)frames.over_budget, (unsigned long)frames.dropped, (unsigned long)frames.waits,
+                   (unsigned long)frames.wait_us);
+            Display_Format_Report format = DisplayFormatReport(lcd);
+            printf("Display: %s, %lu bytes a pixel, %lu bytes of frame buffers, scanout %lu bytes/s, %llu bytes "
+                   "copied\n",
+                   format.name, (unsigned long)format.bytes_per_pixel, (unsigned long)format.buffers_bytes,
+                   (unsigned long)format.scanout_bytes_per_s,
+                   (unsigned long long)frames.copied_pixels * format.bytes_per_pixel);
+            Rate_Plot_Stats plot = rate_plot.stats();
+            printf("Rate plot: %lu frames, %lu put off, %lu over budget, max %lu us, %lu columns dropped\n",
+                   (unsigned long)plot.frames, (unsigned long)plot.deferred, (unsigned long)plot.over_budget,
+                   (unsigned long)plot.max_us, (unsigned long)plot.dropped);
+            Ui_Renderer_Stats drawn = ui.stats();
+            Ui_Queue_Stats queued = ui.queue_stats();
+            printf("UI: %lu commands queued, %lu overflowed, %lu coalesced, %lu frames, last %lu us, max %lu us\n",
+                   (unsigned long)queued.pushed, (unsigned long)drawn.overflowed, (unsigned long)drawn.coalesced,
+                   (unsigned long)drawn.frames, (unsigned long)drawn.last_us, (unsigned long)drawn.max_us);
+            break;
+        }
+        case 't':
+        {
+            Touch_Input_Stats touch = touch_input.stats();
+            printf("Touch: %lu interrupts, %lu samples, %lu presses, %lu releases, %lu too short\n",
+                   (unsigned long)touch.interrupts, (unsigned long)touch.samples, (unsigned long)touch.presses,
+                   (unsigned long)touch.releases, (unsigned long)touch.rejected);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
 
-            // Check if the touch is inside record button
-            if (is_touch_inside_button(touch_x, touch_y, button2_x, button2_y, button1_width, button1_height))
-            {
-                sprintf(display_buffer, "Recording Initiated...");
-                lcd.SetTextColor(LCD_COLOR_BLACK);                  // Set the color to the background color
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear a specific line
-                lcd.SetTextColor(LCD_COLOR_BLUE);                   // Reset the text color
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-                ThisThread::sleep_for(1s);
-                flags.set(KEY_FLAG);
-            }
+/*******************************************************************************
+ *
+ * @brief Whether a gesture key exists, in flash or (until it is stored) in RAM
+ *
+ * ****************************************************************************/
+bool key_enrolled()
+{
+    // A queued erase hides the key still in flash
+    return !gesture_key.empty() ||
+           (!flash_writer.pending(TEMPLATE_KEY_SLOT) && template_store.contains(TEMPLATE_KEY_SLOT));
+}
 
-            // Check if the touch is inside unlock button
-            if (is_touch_inside_button(touch_x, touch_y, button1_x, button1_y, button2_width, button2_height))
-            {
-                sprintf(display_buffer, "Unlocking Initiated...");
-                lcd.SetTextColor(LCD_COLOR_BLACK);                  // Set the color to the background color
-                lcd.FillRect(0, text_y, lcd.GetXSize(), FONT_SIZE); // Clear a specific line
-                lcd.SetTextColor(LCD_COLOR_BLUE);                   // Reset the text color
-                lcd.DisplayStringAt(text_x, text_y, (uint8_t *)display_buffer, CENTER_MODE);
-                ThisThread::sleep_for(1s);
-                flags.set(UNLOCK_FLAG);
-            }
-        }
-        ThisThread::sleep_for(10ms);
+/*******************************************************************************
+ *
+ * @brief Flash writer callback for the gesture key (runs on its thread)
+ * @param slot: the template slot
+ * @param status: how the write ended
+ *
+ * ****************************************************************************/
+void key_persisted(uint8_t slot, Flash_Job_Status status)
+{
+    if (status == FLASH_JOB_DONE)
+    {
+        flags.set(KEY_STORED_FLAG); // the gyroscope thread drops the RAM copy
+    }
+    else if (status == FLASH_JOB_FAILED)
+    {
+        printf("Failed to store the gesture key in slot %u, kept in RAM only\n", slot);
+    }
+}
+
+/*******************************************************************************
+ *
+ * @brief Compute the matcher's features of a new key
+ * @param key: the key, in RAM or in flash
+ *
+ * ****************************************************************************/
+void build_key_features(const Template_View &key)
+{
+    if (!key_features.build(key))
+    {
+        printf("Key features not built, matching the key directly\n");
+        return;
     }
+    // An axis that hardly moves cannot beat the correlation threshold
+    printf("Key spread: x = %f, y = %f, z = %f\n", key_features.sigma()[0], key_features.sigma()[1],
+           key_features.sigma()[2]);
+}
+
+/*******************************************************************************
+ *
+ * @brief Show a message on the status line
+ * @param message: the message, in its color from STATUS_MESSAGES
+ *
+ * ****************************************************************************/
+void display_status(Status_Message_Id message)
+{
+    // Queued for the UI thread, which redraws only the glyphs that changed;
+    // with the queue full it still gets the latest status
+    ui.status(STATUS_MESSAGES[message].text, STATUS_MESSAGES[message].color);
 }
 
 /*******************************************************************************
@@ -562,28 +847,3 @@ bool is_touch_inside_button(int touch_x, int touch_y, int button_x, int button_y
     return (touch_x >= button_x && touch_x <= button_x + button_width &&
             touch_y >= button_y && touch_y <= button_y + button_height);
 }
-
-float movingAverageFilter(float new_value, std::array<float, WINDOW_SIZE>& buffer, size_t& index, float& sum) {
-    // Subtract the old value from the sum and add the new value
-    sum -= buffer[index];
-    buffer[index] = new_value;
-    sum += new_value;
-
-    // Move the index in the buffer
-    index = (index + 1) % WINDOW_SIZE;
-
-    // Return the average
-    return sum / WINDOW_SIZE;
-}
-
-// Function to normalize a vector
-void normalize(vector<array<float, 3>>& data) {
-    for (auto& point : data) {
-        float magnitude = sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]);
-        if (magnitude > 0) {
-            point[0] /= magnitude;
-            point[1] /= magnitude;
-            point[2] /= magnitude;
-        }
-    }
-}
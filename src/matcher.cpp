@@ -0,0 +1,249 @@
+/**
+ * @file matcher.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Unlock-attempt matching implementation for the embedded sentry
+ * project.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "matcher.h"
+#include "profiler.h"
+#include "template_codec.h"
+#include "utilities.h"
+
+/*******************************************************************************
+ *
+ * @brief Every axis above the threshold casts a vote
+ *
+ * ****************************************************************************/
+static void vote(Match_Result &result, float threshold) {
+  result.axes_matched = 0;
+  for (size_t i = 0; i < result.correlation.size(); i++) {
+    if (result.correlation[i] > threshold) result.axes_matched++;
+  }
+  result.unlocked = result.axes_matched == UNLOCK_AXES_REQUIRED;
+}
+
+// Raw float samples in place, read with the interface of TemplateDecoder
+class SampleSpan {
+ public:
+  SampleSpan(const uint8_t *data, size_t size)
+      : samples_((const array<float, 3> *)data),
+        count_(size / sizeof(array<float, 3>)),
+        next_(0) {}
+  bool valid() const { return true; }
+  size_t count() const { return count_; }
+  bool next(array<float, 3> &sample) {
+    if (next_ >= count_) return false;
+    sample = samples_[next_++];
+    return true;
+  }
+
+ private:
+  const array<float, 3> *samples_;
+  size_t count_;
+  size_t next_;
+};
+
+template <typename Source>
+static Match_Result match_stream(Source &key,
+                                 const vector<array<float, 3>> &attempt,
+                                 float threshold);
+
+/*******************************************************************************
+ *
+ * @brief Compare an unlock attempt against the gesture key
+ * @param gesture_key: the enrolled key (modified)
+ * @param attempt: the unlock attempt (modified)
+ * @param threshold: correlation an axis has to exceed
+ * @return the per-axis scores and the verdict
+ *
+ * ****************************************************************************/
+Match_Result MatchGesture(vector<array<float, 3>> &gesture_key,
+                          vector<array<float, 3>> &attempt, float threshold) {
+  Match_Result result;
+
+  // Resize both vectors to the same size before calculation
+  size_t target_size = std::min(gesture_key.size(), attempt.size());
+  gesture_key.resize(target_size);
+  attempt.resize(target_size);
+
+  // Normalize both gesture and unlocking records
+  {
+    PROFILE_SCOPE(PROFILE_NORMALIZE);
+    normalize(gesture_key);
+    normalize(attempt);
+  }
+
+  {
+    PROFILE_SCOPE(PROFILE_CORRELATION);
+    result.correlation = calculateCorrelationVectors(gesture_key, attempt);
+  }
+  trace_printf("Correlation values: x = %f, y = %f, z = %f\n",
+               result.correlation[0], result.correlation[1],
+               result.correlation[2]);
+
+  vote(result, threshold);
+  return result;
+}
+
+/*******************************************************************************
+ *
+ * @brief Compare an unlock attempt against an encoded gesture key
+ * @param encoded_key: the encoding
+ * @param size: its size in bytes
+ * @param attempt: the unlock attempt
+ * @param threshold: correlation an axis has to exceed
+ * @return the per-axis scores and the verdict
+ *
+ * ****************************************************************************/
+Match_Result MatchEncodedGesture(const uint8_t *encoded_key, size_t size,
+                                 const vector<array<float, 3>> &attempt,
+                                 float threshold) {
+  TemplateDecoder key(encoded_key, size);
+  return match_stream(key, attempt, threshold);
+}
+
+/*******************************************************************************
+ *
+ * @brief Compare an unlock attempt against a key in place in flash
+ * @param key: the key, from TemplateStore::acquire()
+ * @param attempt: the unlock attempt
+ * @param threshold: correlation an axis has to exceed
+ * @return the per-axis scores and the verdict
+ *
+ * ****************************************************************************/
+Match_Result MatchTemplate(const Template_View &key,
+                           const vector<array<float, 3>> &attempt,
+                           float threshold) {
+  switch (key.encoding) {
+    case TEMPLATE_ENCODING_FLOAT32: {
+      SampleSpan span(key.data, key.length);
+      return match_stream(span, attempt, threshold);
+    }
+    case TEMPLATE_ENCODING_DELTA:
+      return MatchEncodedGesture(key.data, key.length, attempt, threshold);
+    default: {
+      Match_Result result;
+      result.correlation.fill(std::numeric_limits<float>::quiet_NaN());
+      vote(result, threshold);
+      return result;
+    }
+  }
+}
+
+/*******************************************************************************
+ *
+ * @brief Compare an unlock attempt against the features of the key
+ * @param key: the features, from TemplateFeatures::build()
+ * @param attempt: the unlock attempt
+ * @param threshold: correlation an axis has to exceed
+ * @return the per-axis scores and the verdict
+ *
+ * ****************************************************************************/
+Match_Result MatchFeatures(const TemplateFeatures &key,
+                           const vector<array<float, 3>> &attempt,
+                           float threshold) {
+  PROFILE_SCOPE(PROFILE_CORRELATION);
+  Match_Result result;
+  size_t n = std::min(key.count(), attempt.size());
+  if (!key.valid() || n == 0) {
+    result.correlation.fill(std::numeric_limits<float>::quiet_NaN());
+    vote(result, threshold);
+    return result;
+  }
+
+  CorrelationAccumulator axes[3];
+  for (size_t i = 0; i < n; i++) {
+    array<float, 3> a = attempt[i];
+    normalize_sample(a);
+    const Template_Feature_Sample &k = key[i];
+    for (int axis = 0; axis < 3; axis++) {
+      axes[axis].add_b(k.delta[axis], a[axis]);
+    }
+  }
+
+  const Template_Feature_Sample &last = key[n - 1];
+  for (int axis = 0; axis < 3; axis++) {
+    axes[axis].set_a(last.sum[axis], last.sq_sum[axis],
+                     key.first_varying(axis) < n);
+    result.correlation[axis] = axes[axis].result();
+  }
+  vote(result, threshold);
+  return result;
+}
+
+/*******************************************************************************
+ *
+ * @brief DTW distance between a key in place in flash and an attempt
+ * @param key: the key, from TemplateStore::acquire()
+ * @param attempt: the unlock attempt
+ * @param scratch: optional arena for the DTW matrix
+ * @return the DTW distance, NaN for a malformed key
+ *
+ * ****************************************************************************/
+float TemplateDistance(const Template_View &key,
+                       const vector<array<float, 3>> &attempt,
+                       Arena *scratch) {
+  auto distance = [&](auto &source) {
+    return dtw_stream([&](array<float, 3> &s) { return source.next(s); },
+                      source.count(), attempt.data(), attempt.size(), scratch);
+  };
+  switch (key.encoding) {
+    case TEMPLATE_ENCODING_FLOAT32: {
+      SampleSpan span(key.data, key.length);
+      return distance(span);
+    }
+    case TEMPLATE_ENCODING_DELTA: {
+      TemplateDecoder decoder(key.data, key.length);
+      if (!decoder.valid()) return std::numeric_limits<float>::quiet_NaN();
+      return distance(decoder);
+    }
+    default:
+      return std::numeric_limits<float>::quiet_NaN();
+  }
+}
+
+/*******************************************************************************
+ *
+ * @brief Normalize and correlate a key read one sample at a time
+ * @param key: the sample source (TemplateDecoder or SampleSpan)
+ * @param attempt: the unlock attempt
+ * @param threshold: correlation an axis has to exceed
+ *
+ * ****************************************************************************/
+template <typename Source>
+static Match_Result match_stream(Source &key,
+                                 const vector<array<float, 3>> &attempt,
+                                 float threshold) {
+  PROFILE_SCOPE(PROFILE_CORRELATION);
+  Match_Result result;
+  CorrelationAccumulator axes[3];
+
+  size_t n = std::min(key.count(), attempt.size());
+  for (size_t i = 0; i < n; i++) {
+    array<float, 3> k;
+    if (!key.next(k)) break;
+    array<float, 3> a = attempt[i];
+    normalize_sample(k);
+    normalize_sample(a);
+    for (int axis = 0; axis < 3; axis++) axes[axis].add(k[axis], a[axis]);
+  }
+
+  if (!key.valid()) {
+    result.correlation.fill(std::numeric_limits<float>::quiet_NaN());
+  } else {
+    for (int axis = 0; axis < 3; axis++) {
+      result.correlation[axis] = axes[axis].result();
+    }
+  }
+  vote(result, threshold);
+  return result;
+}
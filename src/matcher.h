@@ -0,0 +1,107 @@
+/**
+ * @file matcher.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Unlock-attempt matching for the embedded sentry project.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef MATCHER_H
+#define MATCHER_H
+
+#include "arena.h"
+#include "system_config.h"
+#include "template_features.h"
+#include "template_store.h"
+
+// Outcome of one unlock attempt
+typedef struct {
+  array<float, 3> correlation;  // per-axis correlation (NaN if undefined)
+  int axes_matched;             // axes whose correlation beat the threshold
+  bool unlocked;                // the vote result
+} Match_Result;
+
+/**
+ * @brief Compare an unlock attempt against the gesture key
+ *
+ * Both recordings are truncated to the shorter length and normalized in
+ * place, then correlated per axis. Axes above the threshold vote; the
+ * attempt unlocks when exactly UNLOCK_AXES_REQUIRED axes match.
+ *
+ * @param gesture_key: the enrolled key (modified)
+ * @param attempt: the unlock attempt (modified)
+ * @param threshold: correlation an axis has to exceed
+ * @return the per-axis scores and the verdict
+ */
+Match_Result MatchGesture(vector<array<float, 3>> &gesture_key,
+                          vector<array<float, 3>> &attempt,
+                          float threshold = CORRELATION_THRESHOLD);
+
+/**
+ * @brief MatchGesture() against a key encoded by TemplateEncode()
+ *
+ * The key is decoded, normalized and correlated one sample at a time, so
+ * no decoded copy is made and neither input is modified. The result equals
+ * MatchGesture() on the decoded key.
+ *
+ * @param encoded_key: the encoding
+ * @param size: its size in bytes
+ * @param attempt: the unlock attempt
+ * @param threshold: correlation an axis has to exceed
+ * @return the per-axis scores and the verdict (no match if the encoding is
+ *         malformed)
+ */
+Match_Result MatchEncodedGesture(const uint8_t *encoded_key, size_t size,
+                                 const vector<array<float, 3>> &attempt,
+                                 float threshold = CORRELATION_THRESHOLD);
+
+/**
+ * @brief MatchGesture() against a key in place in flash
+ *
+ * Reads the key straight from the view in either encoding; nothing is
+ * copied and neither input is modified.
+ *
+ * @param key: the key, from TemplateStore::acquire()
+ * @param attempt: the unlock attempt
+ * @param threshold: correlation an axis has to exceed
+ * @return the per-axis scores and the verdict (no match for an unknown
+ *         encoding)
+ */
+Match_Result MatchTemplate(const Template_View &key,
+                           const vector<array<float, 3>> &attempt,
+                           float threshold = CORRELATION_THRESHOLD);
+
+/**
+ * @brief MatchTemplate() against the precomputed features of the key
+ *
+ * Only the attempt is normalized and accumulated; the result equals
+ * MatchTemplate() on the key the features were built from.
+ *
+ * @param key: the features, from TemplateFeatures::build()
+ * @param attempt: the unlock attempt
+ * @param threshold: correlation an axis has to exceed
+ * @return the per-axis scores and the verdict (no match for empty features)
+ */
+Match_Result MatchFeatures(const TemplateFeatures &key,
+                           const vector<array<float, 3>> &attempt,
+                           float threshold = CORRELATION_THRESHOLD);
+
+/**
+ * @brief dtw() between a key in place in flash and an attempt
+ * @param key: the key, from TemplateStore::acquire()
+ * @param attempt: the unlock attempt
+ * @param scratch: optional arena for the DTW matrix (e.g.
+ *        SdramArena(ARENA_DTW)), rewound on return
+ * @return the DTW distance, NaN for a malformed key
+ */
+float TemplateDistance(const Template_View &key,
+                       const vector<array<float, 3>> &attempt,
+                       Arena *scratch = nullptr);
+
+#endif  // MATCHER_H
@@ -0,0 +1,128 @@
+/**
+ * @file memory_report.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Painted thread stacks and heap statistics.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "memory_report.h"
+
+#include <cstring>
+
+#ifndef MBED_HEAP_STATS_ENABLED
+#define MBED_HEAP_STATS_ENABLED 0
+#endif
+
+typedef struct {
+  const char *name;
+  const unsigned char *stack;
+  size_t size;
+} Memory_Stack;
+
+static Memory_Stack stacks[MEMORY_STACKS];
+static size_t stacks_count = 0;
+
+static Memory_Heap attempt_start;
+static Memory_Attempt last_attempt = {0, 0};
+static bool attempt_recorded = false;
+
+bool MemoryWatchStack(const char *name, unsigned char *stack, size_t size) {
+  memset(stack, MEMORY_STACK_PAINT, size);
+
+  core_util_critical_section_enter();
+  bool added = stacks_count < MEMORY_STACKS;
+  if (added) stacks[stacks_count++] = {name, stack, size};
+  core_util_critical_section_exit();
+  return added;
+}
+
+/*******************************************************************************
+ *
+ * @brief Bytes of a painted stack its thread has used at most
+ *
+ * The stack grows down from stack + size; the scan stops at the first byte
+ * above the bottom that is no longer the paint.
+ *
+ * ****************************************************************************/
+size_t MemoryStackUsed(const unsigned char *stack, size_t size) {
+  size_t untouched = 0;
+  while (untouched < size && stack[untouched] == MEMORY_STACK_PAINT) {
+    untouched++;
+  }
+  return size - untouched;
+}
+
+Memory_Heap MemoryHeap() {
+  Memory_Heap heap = {0, 0, 0, 0, 0};
+#if MBED_HEAP_STATS_ENABLED
+  mbed_stats_heap_t stats;
+  mbed_stats_heap_get(&stats);
+  heap.current = stats.current_size;
+  heap.peak = stats.max_size;
+  heap.reserved = stats.reserved_size;
+  heap.allocations = stats.alloc_cnt;
+  heap.failures = stats.alloc_fail_cnt;
+#endif
+  return heap;
+}
+
+void MemoryAttemptBegin() { attempt_start = MemoryHeap(); }
+
+Memory_Attempt MemoryAttemptEnd() {
+  Memory_Heap now = MemoryHeap();
+  Memory_Attempt attempt;
+  attempt.allocations = now.allocations - attempt_start.allocations;
+  attempt.growth = (int32_t)(now.current - attempt_start.current);
+
+  core_util_critical_section_enter();
+  last_attempt = attempt;
+  attempt_recorded = true;
+  core_util_critical_section_exit();
+  return attempt;
+}
+
+/*******************************************************************************
+ *
+ * @brief Print every watched stack, the heap and the last attempt
+ *
+ * ****************************************************************************/
+void MemoryPrint() {
+  printf("%-14s %8s %8s %8s\n", "stack", "size", "used", "free");
+  for (size_t i = 0; i < stacks_count; i++) {
+    const Memory_Stack &s = stacks[i];
+    size_t used = MemoryStackUsed(s.stack, s.size);
+    if (used == 0) {
+      printf("%-14s %8u %8s %8s\n", s.name, (unsigned)s.size, "-", "-");
+    } else {
+      printf("%-14s %8u %8u %8u\n", s.name, (unsigned)s.size, (unsigned)used,
+             (unsigned)(s.size - used));
+    }
+  }
+
+  if (!MBED_HEAP_STATS_ENABLED) {
+    printf("Heap statistics disabled (platform.heap-stats-enabled)\n");
+    return;
+  }
+  Memory_Heap heap = MemoryHeap();
+  printf("heap: %u bytes in use, peak %u", (unsigned)heap.current,
+         (unsigned)heap.peak);
+  if (heap.reserved != 0) printf(" of %u", (unsigned)heap.reserved);
+  printf(", %lu allocations, %lu failed\n", (unsigned long)heap.allocations,
+         (unsigned long)heap.failures);
+
+  core_util_critical_section_enter();
+  Memory_Attempt attempt = last_attempt;
+  bool recorded = attempt_recorded;
+  core_util_critical_section_exit();
+  if (recorded) {
+    printf("last attempt: %lu allocations, %ld bytes kept\n",
+           (unsigned long)attempt.allocations, (long)attempt.growth);
+  }
+}
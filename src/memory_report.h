@@ -0,0 +1,89 @@
+/**
+ * @file memory_report.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Stack high-water marks of the firmware threads and heap usage, per
+ * attempt and overall.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Every thread runs on a stack declared with its size in system_config.h.
+ * MemoryWatchStack() fills a stack with MEMORY_STACK_PAINT before its
+ * thread starts and adds it to the report. Stacks grow down, so the bytes
+ * at the low end that still hold the pattern are headroom the thread has
+ * never touched; the rest is its high-water mark. A frame that happens to
+ * store the pattern byte at the very edge makes the mark a few bytes low.
+ *
+ * The heap figures are mbed's (platform.heap-stats-enabled in
+ * mbed_app.json counts every malloc); the host shim counts global new and
+ * delete into the same mbed_stats_heap_get(). MemoryAttemptBegin() and
+ * MemoryAttemptEnd() bracket one attempt to count what it allocates.
+ *
+ * MemoryPrint() is the 'm' console command. The host build runs threads
+ * on the same painted stacks (see host/bench/memory_bench.cpp), with more
+ * room for x86-64 frames.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef MEMORY_REPORT_H
+#define MEMORY_REPORT_H
+
+#include "system_config.h"
+
+// Fill byte of unused stack
+#define MEMORY_STACK_PAINT 0xA5
+
+// Heap usage, in bytes
+typedef struct {
+  size_t current;        // allocated now
+  size_t peak;           // most allocated at once since boot
+  size_t reserved;       // size of the heap region (0 if unknown)
+  uint32_t allocations;  // allocations since boot
+  uint32_t failures;     // allocations refused
+} Memory_Heap;
+
+// What one attempt did to the heap
+typedef struct {
+  uint32_t allocations;  // allocations made during the attempt
+  int32_t growth;        // bytes still allocated at its end
+} Memory_Attempt;
+
+/**
+ * @brief Paint a thread stack and add it to the report
+ * @param name: shown in the report; must outlive it
+ * @param stack: the stack, before its thread starts
+ * @param size: its size in bytes
+ * @return false if MEMORY_STACKS stacks are watched already (the stack is
+ *         painted all the same)
+ */
+bool MemoryWatchStack(const char *name, unsigned char *stack, size_t size);
+
+/**
+ * @brief Bytes of a painted stack its thread has used at most
+ */
+size_t MemoryStackUsed(const unsigned char *stack, size_t size);
+
+/**
+ * @brief Current heap usage (all zero without heap statistics)
+ */
+Memory_Heap MemoryHeap();
+
+/**
+ * @brief Start counting the allocations of an attempt
+ */
+void MemoryAttemptBegin();
+
+/**
+ * @brief Stop counting; the result is kept for MemoryPrint()
+ */
+Memory_Attempt MemoryAttemptEnd();
+
+/**
+ * @brief Print every watched stack, the heap and the last attempt
+ */
+void MemoryPrint();
+
+#endif  // MEMORY_REPORT_H
@@ -0,0 +1,150 @@
+/**
+ * @file profiler.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Stage histograms behind the PROFILE_SCOPE probes.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "profiler.h"
+
+static Profile_Stats stats[PROFILE_STAGE_COUNT];
+
+static const char *const stage_names[PROFILE_STAGE_COUNT] = {
+    "acquisition", "calibration", "filtering", "trim",
+    "normalize",   "correlation", "lcd",       "flash"};
+
+/*******************************************************************************
+ *
+ * @brief Histogram bucket of a duration
+ *
+ * Values below 4 have a bucket each; above, every power of two is split in
+ * four equal buckets.
+ *
+ * ****************************************************************************/
+static int bucket_of(uint32_t ticks) {
+  if (ticks < 4) return ticks;
+  int msb = 31 - __builtin_clz(ticks);
+  int sub = (ticks >> (msb - 2)) & 3;
+  return (msb - 1) * 4 + sub;
+}
+
+// Largest duration that falls in a bucket
+static uint32_t bucket_upper(int bucket) {
+  if (bucket < 4) return bucket;
+  int msb = bucket / 4 + 1;
+  int sub = bucket % 4;
+  uint64_t lower = (uint64_t)(4 + sub) << (msb - 2);
+  return (uint32_t)(lower + ((uint64_t)1 << (msb - 2)) - 1);
+}
+
+void ProfilerInit() {
+#ifndef SENTRY_HOST_BUILD
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+float ProfilerTicksPerUs() {
+#ifdef SENTRY_HOST_BUILD
+  return 1000.0f;
+#else
+  return SystemCoreClock / 1e6f;
+#endif
+}
+
+/*******************************************************************************
+ *
+ * @brief Add one duration to a stage
+ * @param stage: the stage
+ * @param ticks: the duration in ticks
+ *
+ * Probes run in the gyroscope and touch screen threads, so the update is
+ * done inside a critical section.
+ *
+ * ****************************************************************************/
+void ProfilerRecord(Profile_Stage stage, uint32_t ticks) {
+  if (stage >= PROFILE_STAGE_COUNT) return;
+  int bucket = bucket_of(ticks);
+
+  core_util_critical_section_enter();
+  Profile_Stats &s = stats[stage];
+  if (s.count == 0 || ticks < s.min) s.min = ticks;
+  if (ticks > s.max) s.max = ticks;
+  s.count++;
+  s.total += ticks;
+  s.buckets[bucket]++;
+  core_util_critical_section_exit();
+}
+
+Profile_Stats ProfilerStats(Profile_Stage stage) {
+  core_util_critical_section_enter();
+  Profile_Stats copy = stats[stage];
+  core_util_critical_section_exit();
+  return copy;
+}
+
+const char *ProfilerStageName(Profile_Stage stage) {
+  return stage < PROFILE_STAGE_COUNT ? stage_names[stage] : "?";
+}
+
+uint64_t ProfilerTotal(Profile_Stage stage) {
+  core_util_critical_section_enter();
+  uint64_t total = stats[stage].total;
+  core_util_critical_section_exit();
+  return total;
+}
+
+static uint32_t quantile_of(const Profile_Stats &s, float q) {
+  if (s.count == 0) return 0;
+  uint32_t rank = (uint32_t)ceilf(q * s.count);
+  if (rank == 0) rank = 1;
+  uint32_t seen = 0;
+  for (int i = 0; i < PROFILE_BUCKETS; i++) {
+    seen += s.buckets[i];
+    if (seen >= rank) return std::min(bucket_upper(i), s.max);
+  }
+  return s.max;
+}
+
+uint32_t ProfilerQuantile(Profile_Stage stage, float q) {
+  Profile_Stats s = ProfilerStats(stage);
+  return quantile_of(s, q);
+}
+
+/*******************************************************************************
+ *
+ * @brief Print count, min, mean, p99 and max of every stage that ran
+ *
+ * ****************************************************************************/
+void ProfilerPrint() {
+  if (!PROFILE_ENABLED) {
+    printf("Profiler disabled (PROFILE_ENABLED 0)\n");
+    return;
+  }
+
+  float per_us = ProfilerTicksPerUs();
+  printf("%-12s %8s %11s %11s %11s %11s  (us)\n", "stage", "count", "min",
+         "mean", "p99", "max");
+  for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    Profile_Stats s = ProfilerStats((Profile_Stage)i);
+    if (s.count == 0) continue;
+    printf("%-12s %8lu %11.1f %11.1f %11.1f %11.1f\n", stage_names[i],
+           (unsigned long)s.count, s.min / per_us,
+           (float)s.total / s.count / per_us, quantile_of(s, 0.99f) / per_us,
+           s.max / per_us);
+  }
+}
+
+void ProfilerReset() {
+  core_util_critical_section_enter();
+  memset(stats, 0, sizeof(stats));
+  core_util_critical_section_exit();
+}
@@ -0,0 +1,137 @@
+/**
+ * @file profiler.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Scoped stage probes for the embedded sentry project.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * PROFILE_SCOPE(stage) times the rest of the enclosing block and adds it to
+ * the histogram of that stage. On the board the clock is the DWT cycle
+ * counter (one tick per CPU cycle); in the host build it is
+ * std::chrono::steady_clock in nanoseconds. With PROFILE_ENABLED set to 0
+ * the probes compile to nothing.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "system_config.h"
+
+// Stages of an attempt, in pipeline order
+typedef enum {
+  PROFILE_ACQUISITION,  // one sensor read, including the wait for data-ready
+  PROFILE_CALIBRATION,  // zero-rate calibration of the source
+  PROFILE_FILTERING,    // calibration, conversion and spike rejection per read
+  PROFILE_TRIM,         // trim_gyro_data()
+  PROFILE_NORMALIZE,    // normalization of key and attempt
+  PROFILE_CORRELATION,  // per-axis correlation
+  PROFILE_LCD,          // one status line update or rate plot frame
+  PROFILE_FLASH,        // one gesture key read or write
+  PROFILE_STAGE_COUNT
+} Profile_Stage;
+
+// Log-linear histogram: four buckets per power of two (19 % resolution)
+#define PROFILE_BUCKETS 128
+
+typedef struct {
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;
+  uint32_t buckets[PROFILE_BUCKETS];
+} Profile_Stats;
+
+/**
+ * @brief Start the cycle counter (no-op on the host)
+ */
+void ProfilerInit();
+
+/**
+ * @brief The current tick count
+ */
+static inline uint32_t ProfilerNow() {
+#ifdef SENTRY_HOST_BUILD
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#else
+  return DWT->CYCCNT;
+#endif
+}
+
+/**
+ * @brief Ticks per microsecond of ProfilerNow()
+ */
+float ProfilerTicksPerUs();
+
+/**
+ * @brief Add one duration to a stage (safe from any thread)
+ * @param stage: the stage
+ * @param ticks: the duration in ticks
+ */
+void ProfilerRecord(Profile_Stage stage, uint32_t ticks);
+
+/**
+ * @brief Short name of a stage, as ProfilerPrint() shows it
+ */
+const char *ProfilerStageName(Profile_Stage stage);
+
+/**
+ * @brief Ticks recorded into a stage since the last reset
+ */
+uint64_t ProfilerTotal(Profile_Stage stage);
+
+/**
+ * @brief Upper bound of the q-quantile of a stage, in ticks
+ * @param stage: the stage
+ * @param q: the quantile, 0 to 1
+ */
+uint32_t ProfilerQuantile(Profile_Stage stage, float q);
+
+/**
+ * @brief Copy of the statistics of a stage
+ */
+Profile_Stats ProfilerStats(Profile_Stage stage);
+
+/**
+ * @brief Print count, min, mean, p99 and max of every stage that ran
+ */
+void ProfilerPrint();
+
+/**
+ * @brief Clear all stages
+ */
+void ProfilerReset();
+
+/**
+ * @brief Records the lifetime of the object into a stage
+ */
+class ProfileScope {
+ public:
+  explicit ProfileScope(Profile_Stage stage)
+      : stage_(stage), start_(ProfilerNow()) {}
+  ~ProfileScope() { ProfilerRecord(stage_, ProfilerNow() - start_); }
+
+ private:
+  Profile_Stage stage_;
+  uint32_t start_;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#if PROFILE_ENABLED
+#define PROFILE_SCOPE(stage) \
+  ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(stage)
+#else
+#define PROFILE_SCOPE(stage) \
+  do {                       \
+  } while (0)
+#endif
+
+#endif  // PROFILER_H
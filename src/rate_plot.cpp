@@ -0,0 +1,222 @@
+/**
+ * @file rate_plot.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Scrolling plot of the x, y and z angular rate, drawn while a
+ * gesture is recorded.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "rate_plot.h"
+
+#include <cstring>
+
+#include "profiler.h"
+
+// Trace colors per axis, on a black window with a dark gray zero line
+static const uint32_t kAxisColors[3] = {LCD_COLOR_RED, LCD_COLOR_GREEN,
+                                        LCD_COLOR_CYAN};
+#define RATE_PLOT_BACKGROUND LCD_COLOR_BLACK
+#define RATE_PLOT_ZERO_LINE LCD_COLOR_DARKGRAY
+
+RatePlot::RatePlot(LCD_DISCO_F429ZI &lcd, FrameBuffers &buffers, uint16_t x,
+                   uint16_t y, uint16_t width, uint16_t height,
+                   float full_scale_dps)
+    : lcd_(lcd),
+      buffers_(buffers),
+      x_(x),
+      y_(y),
+      width_(min<uint16_t>(width, RATE_PLOT_MAX_WIDTH)),
+      height_(height),
+      full_scale_dps_(full_scale_dps),
+      max_columns_(RATE_PLOT_MAX_COLUMNS) {
+  reset();
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+void RatePlot::reset() {
+  cleared_ = false;
+  sum_[0] = sum_[1] = sum_[2] = 0.0f;
+  summed_ = 0;
+  pending_first_ = 0;
+  pending_count_ = 0;
+  shown_first_ = 0;
+  shown_count_ = 0;
+}
+
+// Row of a rate in the window, full scale up at the top
+uint16_t RatePlot::row(float dps) const {
+  float half = (height_ - 1) / 2.0f;
+  float row = half - dps / full_scale_dps_ * half + 0.5f;
+  if (row < 0.0f) return 0;
+  if (row > height_ - 1) return height_ - 1;
+  return (uint16_t)row;
+}
+
+void RatePlot::add(float x, float y, float z) {
+  sum_[0] += x;
+  sum_[1] += y;
+  sum_[2] += z;
+  if (++summed_ < RATE_PLOT_SAMPLES_PER_COLUMN) return;
+
+  Rate_Plot_Column column;
+  for (int axis = 0; axis < 3; axis++) {
+    column.row[axis] = row(sum_[axis] / summed_);
+    sum_[axis] = 0.0f;
+  }
+  summed_ = 0;
+
+  if (pending_count_ == RATE_PLOT_PENDING) {
+    pending_first_ = (pending_first_ + 1) % RATE_PLOT_PENDING;
+    pending_count_--;
+    stats_.dropped++;
+  }
+  pending_[(pending_first_ + pending_count_) % RATE_PLOT_PENDING] = column;
+  pending_count_++;
+}
+
+// The zero line and the three segments of one column
+void RatePlot::draw_column(uint16_t column, const Rate_Plot_Column &previous,
+                           const Rate_Plot_Column &current) {
+  lcd_.DrawPixel(column, y_ + height_ / 2, RATE_PLOT_ZERO_LINE);
+  for (int axis = 0; axis < 3; axis++) {
+    uint16_t from = min(previous.row[axis], current.row[axis]);
+    uint16_t to = max(previous.row[axis], current.row[axis]);
+    for (uint16_t r = from; r <= to; r++) {
+      lcd_.DrawPixel(column, y_ + r, kAxisColors[axis]);
+    }
+  }
+}
+
+// Draw the columns on screen from the from-th oldest on, right-aligned
+void RatePlot::draw_history(uint16_t from) {
+  const size_t ring = RATE_PLOT_MAX_WIDTH + 1;
+  size_t visible = min<size_t>(shown_count_, width_);
+  size_t first = shown_count_ - visible;  // index of the oldest on screen
+  for (size_t i = first + from; i < shown_count_; i++) {
+    const Rate_Plot_Column &current = shown_[(shown_first_ + i) % ring];
+    const Rate_Plot_Column &previous =
+        shown_[(shown_first_ + (i > 0 ? i - 1 : 0)) % ring];
+    draw_column(x_ + width_ - (shown_count_ - i), previous, current);
+  }
+}
+
+/*******************************************************************************
+ *
+ * @brief Draw the columns waiting as one frame: move the window left, clear
+ * the columns freed, draw the new ones
+ *
+ * ****************************************************************************/
+size_t RatePlot::render(bool wait) {
+  if (pending_count_ == 0 && cleared_) return 0;
+
+  uint32_t start = ProfilerNow();
+  if (wait) {
+    buffers_.begin();
+  } else if (!buffers_.try_begin()) {
+    stats_.deferred++;
+    return 0;
+  }
+  PROFILE_SCOPE(PROFILE_LCD);
+
+  size_t count = min(min(pending_count_, max_columns_), (size_t)width_);
+  uint16_t fresh = count;  // columns to clear on the right
+  if (!cleared_) {
+    fresh = width_;
+    cleared_ = true;
+  } else if (count < width_) {
+    lcd_.MoveRect(buffers_.drawing(), x_ + count, y_, x_, y_, width_ - count,
+                  height_);
+  }
+  if (fresh > 0) {
+    lcd_.SetTextColor(RATE_PLOT_BACKGROUND);
+    lcd_.FillRect(x_ + width_ - fresh, y_, fresh, height_);
+  }
+
+  // Move the columns from the queue to the ones on screen, keeping one
+  // more than the window shows
+  const size_t ring = RATE_PLOT_MAX_WIDTH + 1;
+  for (size_t i = 0; i < count; i++) {
+    if (shown_count_ == (size_t)width_ + 1) {
+      shown_first_ = (shown_first_ + 1) % ring;
+      shown_count_--;
+    }
+    shown_[(shown_first_ + shown_count_) % ring] = pending_[pending_first_];
+    shown_count_++;
+    pending_first_ = (pending_first_ + 1) % RATE_PLOT_PENDING;
+    pending_count_--;
+  }
+  size_t visible = min<size_t>(shown_count_, width_);
+  draw_history(visible - min<size_t>(fresh, visible));
+
+  buffers_.damage(x_, y_, width_, height_);
+  buffers_.present();
+
+  uint32_t us = (ProfilerNow() - start) / ProfilerTicksPerUs();
+  stats_.frames++;
+  stats_.columns += count;
+  stats_.last_us = us;
+  stats_.max_us = max(stats_.max_us, us);
+  stats_.frame_us += us;
+  if (us > RATE_PLOT_BUDGET_US) {
+    stats_.over_budget++;
+    max_columns_ = max<size_t>(max_columns_ / 2, 1);
+  } else if (us < RATE_PLOT_BUDGET_US / 2 &&
+             max_columns_ < RATE_PLOT_MAX_COLUMNS) {
+    max_columns_++;
+  }
+  return count;
+}
+
+void RatePlot::redraw() {
+  buffers_.begin();
+  lcd_.SetTextColor(RATE_PLOT_BACKGROUND);
+  lcd_.FillRect(x_, y_, width_, height_);
+  cleared_ = true;
+  draw_history(0);
+  buffers_.damage(x_, y_, width_, height_);
+  buffers_.present();
+}
+
+PlottingGyroSource::PlottingGyroSource(GyroSource &inner, RatePlot &plot)
+    : inner_(inner), plot_(plot), plotting_(false), samples_(0) {
+  memset(&calibration_, 0, sizeof(calibration_));
+}
+
+bool PlottingGyroSource::init(const Gyroscope_Init_Parameters &params) {
+  return inner_.init(params);
+}
+
+void PlottingGyroSource::begin(const Gyroscope_Calibration &calibration) {
+  calibration_ = calibration;
+  plot_.reset();
+  samples_ = 0;
+  plotting_ = true;
+}
+
+void PlottingGyroSource::end() {
+  plotting_ = false;
+  while (plot_.pending() > 0) plot_.render(true);
+}
+
+bool PlottingGyroSource::read(Gyroscope_RawData &sample) {
+  if (!inner_.read(sample)) return false;
+  if (!plotting_) return true;
+
+  Gyroscope_RawData calibrated = sample;
+  ApplyCalibration(calibration_, calibrated);
+  float sensitivity = inner_.sensitivity();
+  plot_.add(calibrated.x_raw * sensitivity, calibrated.y_raw * sensitivity,
+            calibrated.z_raw * sensitivity);
+  if (++samples_ >= RATE_PLOT_FRAME_SAMPLES) {
+    samples_ = 0;
+    plot_.render();
+  }
+  return true;
+}
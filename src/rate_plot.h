@@ -0,0 +1,168 @@
+/**
+ * @file rate_plot.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Scrolling plot of the x, y and z angular rate, drawn while a
+ * gesture is recorded.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * The plot is a window of the screen, one column per
+ * RATE_PLOT_SAMPLES_PER_COLUMN sensor samples (averaged), newest on the
+ * right. add() only works out the rows of a column and queues it; render()
+ * draws what is queued as one frame:
+ *
+ *   - the window is moved left by the number of new columns with one DMA2D
+ *     memory-to-memory move, so what is on screen is never redrawn;
+ *   - the columns freed on the right are cleared with a DMA2D fill;
+ *   - each new column gets the zero line and, per axis, a vertical segment
+ *     from the row of the column before to its own, a few CPU stores.
+ *
+ * A frame draws at most max_columns() columns. Its time is measured; a
+ * frame over RATE_PLOT_BUDGET_US halves the limit and one well under it
+ * raises it again, so a frame stays within the budget whatever the LCD
+ * costs. Columns left over wait for the next frame; when more than
+ * RATE_PLOT_PENDING are waiting the oldest are dropped.
+ *
+ * PlottingGyroSource feeds the plot from the samples a recording reads
+ * and renders a frame every RATE_PLOT_FRAME_SAMPLES samples (33 fps at
+ * 200 Hz), between two reads: the budget is well under the sample period,
+ * and a frame that would have to wait for the display (another thread's
+ * frame, a flip not done yet) is put off rather than waited for, so
+ * acquisition never misses a sample on account of the plot. Frames go
+ * through FrameBuffers, so the plot scrolls without tearing.
+ *
+ * add() and render() belong to one thread.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef RATE_PLOT_H
+#define RATE_PLOT_H
+
+#include "capture.h"
+#include "frame_buffers.h"
+#include "gyro_source.h"
+#include "system_config.h"
+
+// Rows of one column, per axis
+typedef struct {
+  uint16_t row[3];
+} Rate_Plot_Column;
+
+// Frames rendered and what they cost
+typedef struct {
+  uint32_t frames;       // frames drawn
+  uint32_t deferred;     // frames put off, the display was busy
+  uint32_t over_budget;  // frames over RATE_PLOT_BUDGET_US
+  uint32_t columns;      // columns drawn
+  uint32_t dropped;      // columns dropped, too many waiting
+  uint32_t last_us;      // time of the last frame
+  uint32_t max_us;       // and of the longest one
+  uint64_t frame_us;     // total time of the frames
+} Rate_Plot_Stats;
+
+class RatePlot {
+ public:
+  /**
+   * @param lcd: the display
+   * @param buffers: the display's frame buffers
+   * @param x, y: top left corner of the window
+   * @param width, height: size of the window; width at most
+   *        RATE_PLOT_MAX_WIDTH
+   * @param full_scale_dps: rate at the top and bottom edges
+   */
+  RatePlot(LCD_DISCO_F429ZI &lcd, FrameBuffers &buffers, uint16_t x,
+           uint16_t y, uint16_t width, uint16_t height,
+           float full_scale_dps = RATE_PLOT_FULL_SCALE_DPS);
+
+  /**
+   * @brief Empty the plot; the next render() clears the window
+   */
+  void reset();
+
+  /**
+   * @brief Add one sample, in dps
+   */
+  void add(float x, float y, float z);
+
+  /**
+   * @brief Draw the columns waiting, as many as the budget allows
+   * @param wait: wait for the display instead of putting the frame off
+   * @return the number of columns drawn
+   */
+  size_t render(bool wait = false);
+
+  /**
+   * @brief Draw the whole window again from the columns it shows
+   */
+  void redraw();
+
+  size_t pending() const { return pending_count_; }
+  size_t max_columns() const { return max_columns_; }
+  Rate_Plot_Stats stats() const { return stats_; }
+
+ private:
+  uint16_t row(float dps) const;
+  void draw_column(uint16_t column, const Rate_Plot_Column &previous,
+                   const Rate_Plot_Column &current);
+  void draw_history(uint16_t from);
+
+  LCD_DISCO_F429ZI &lcd_;
+  FrameBuffers &buffers_;
+  uint16_t x_, y_, width_, height_;
+  float full_scale_dps_;
+  bool cleared_;  // the window has been cleared since reset()
+
+  float sum_[3];  // samples of the column being averaged
+  size_t summed_;
+
+  Rate_Plot_Column pending_[RATE_PLOT_PENDING];  // ring of queued columns
+  size_t pending_first_;
+  size_t pending_count_;
+
+  // Ring of the columns on screen, oldest first, and the one before them
+  // (their segments start from it)
+  Rate_Plot_Column shown_[RATE_PLOT_MAX_WIDTH + 1];
+  size_t shown_first_;
+  size_t shown_count_;
+
+  size_t max_columns_;
+  Rate_Plot_Stats stats_;
+};
+
+/**
+ * @brief A GyroSource decorator that plots the samples it reads, calibrated
+ * and in dps, and renders the plot between reads.
+ */
+class PlottingGyroSource : public GyroSource {
+ public:
+  PlottingGyroSource(GyroSource &inner, RatePlot &plot);
+
+  /**
+   * @brief Start plotting; the plot is emptied
+   * @param calibration: applied to the samples plotted
+   */
+  void begin(const Gyroscope_Calibration &calibration);
+
+  /**
+   * @brief Stop plotting and draw the columns still waiting
+   */
+  void end();
+
+  bool init(const Gyroscope_Init_Parameters &params) override;
+  bool read(Gyroscope_RawData &sample) override;
+  float sensitivity() const override { return inner_.sensitivity(); }
+  void power_off() override { inner_.power_off(); }
+
+ private:
+  GyroSource &inner_;
+  RatePlot &plot_;
+  Gyroscope_Calibration calibration_;
+  bool plotting_;
+  uint32_t samples_;  // since the last frame
+};
+
+#endif  // RATE_PLOT_H
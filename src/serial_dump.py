@@ -14,12 +14,14 @@
 import serial
 
 # Connect to serial port
-ser = serial.Serial('COM4', 9600, timeout=1)
+# 115200 baud, see mbed_app.json. Binary capture frames share the port with
+# the text output; use host/tools/sentry_capture to record those.
+ser = serial.Serial('COM4', 115200, timeout=1)
 
 try:
     while True:
         if ser.in_waiting:
-            line = ser.readline().decode('utf-8').strip()
+            line = ser.readline().decode('utf-8', errors='replace').strip()
             print(line)
 except KeyboardInterrupt:
     print("\nStopping...")
@@ -0,0 +1,175 @@
+/**
+ * @file status_line.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Status line that redraws only the glyphs that changed.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "status_line.h"
+
+#include <cstring>
+
+#define STATUS_LINE_NO_FIT ((size_t)-1)
+
+const Status_Message STATUS_MESSAGES[STATUS_MESSAGE_COUNT] = {
+    {"NO KEY RECORDED", LCD_COLOR_GREEN},
+    {"LOCKED", LCD_COLOR_RED},
+    {"Erasing....", LCD_COLOR_YELLOW},
+    {"Key Erasing finish.", LCD_COLOR_YELLOW},
+    {"All Erasing finish.", LCD_COLOR_YELLOW},
+    {"Erase failed, retry", LCD_COLOR_RED},
+    {"Hold On", LCD_COLOR_ORANGE},
+    {"Calibrating...", LCD_COLOR_LIGHTGRAY},
+    {"Recording in 3...", LCD_COLOR_ORANGE},
+    {"Recording in 2...", LCD_COLOR_ORANGE},
+    {"Recording in 1...", LCD_COLOR_ORANGE},
+    {"Recording...", LCD_COLOR_GREEN},
+    {"Finished...", LCD_COLOR_GREEN},
+    {"Saving Key...", LCD_COLOR_LIGHTGREEN},
+    {"Key saved...", LCD_COLOR_LIGHTGREEN},
+    {"Removing old key...", LCD_COLOR_ORANGE},
+    {"New key is saved.", LCD_COLOR_LIGHTGREEN},
+    {"Unlocking...", LCD_COLOR_LIGHTGRAY},
+    {"NO KEY SAVED.", LCD_COLOR_RED},
+    {"UNLOCK: SUCCESS", LCD_COLOR_GREEN},
+    {"UNLOCK: FAILED", LCD_COLOR_RED},
+    {"Recording Initiated...", LCD_COLOR_BLUE},
+    {"Unlocking Initiated...", LCD_COLOR_BLUE}};
+
+StatusLine::StatusLine(LCD_DISCO_F429ZI &lcd, uint16_t x, uint16_t y,
+                       uint32_t background)
+    : lcd_(lcd),
+      x_(x),
+      y_(y),
+      background_(background),
+      valid_(false),
+      font_(nullptr),
+      count_(0) {
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+void StatusLine::invalidate() {
+  ScopedLock<Mutex> lock(mutex_);
+  valid_ = false;
+}
+
+Status_Line_Stats StatusLine::stats() const {
+  ScopedLock<Mutex> lock(mutex_);
+  return stats_;
+}
+
+/*******************************************************************************
+ *
+ * @brief Where DisplayStringAt(x, y, text, CENTER_MODE) puts each glyph
+ * @return the number of glyphs, or STATUS_LINE_NO_FIT if one would run
+ *         past the edge of the screen
+ *
+ * The arithmetic, wrap-arounds included, is the BSP's.
+ *
+ * ****************************************************************************/
+size_t StatusLine::layout(const char *text, uint32_t color, uint32_t back,
+                          Status_Glyph *glyphs) {
+  sFONT *font = lcd_.GetFont();
+  uint32_t width = lcd_.GetXSize();
+  uint32_t size = strlen(text);
+  uint32_t xsize = width / font->Width;
+  uint16_t column = x_ + ((xsize - size) * font->Width) / 2;
+
+  size_t count = 0;
+  for (uint32_t i = 0;
+       text[i] != 0 && ((width - i * font->Width) & 0xFFFF) >= font->Width;
+       i++) {
+    if (count == STATUS_LINE_GLYPHS ||
+        (uint32_t)column + font->Width > width) {
+      return STATUS_LINE_NO_FIT;
+    }
+    glyphs[count++] = {column, text[i], color, back};
+    column += font->Width;
+  }
+  return count;
+}
+
+void StatusLine::clear_columns(uint16_t from, uint16_t to, uint16_t height) {
+  if (from >= to) return;
+  lcd_.SetTextColor(background_);
+  lcd_.FillRect(from, y_, to - from, height);
+  stats_.fills++;
+}
+
+/*******************************************************************************
+ *
+ * @brief Show a text, drawing only what differs from the line on screen
+ *
+ * The glyphs of a line are contiguous, so the old text covers one span of
+ * columns and the new one another; what is left of the old span on either
+ * side of the new one is cleared. Both layouts are sorted by column, so
+ * the glyphs left alone are found in one pass.
+ *
+ * ****************************************************************************/
+void StatusLine::show(const char *text, uint32_t color) {
+  ScopedLock<Mutex> lock(mutex_);
+  stats_.updates++;
+
+  sFONT *font = lcd_.GetFont();
+  size_t count = layout(text, color, lcd_.GetBackColor(), next_);
+
+  if (!valid_ || font != font_ || count == STATUS_LINE_NO_FIT) {
+    lcd_.SetTextColor(background_);
+    lcd_.FillRect(0, y_, lcd_.GetXSize(), font->Height);
+    lcd_.SetTextColor(color);
+    lcd_.DisplayStringAt(x_, y_, (uint8_t *)text, CENTER_MODE);
+    stats_.full_redraws++;
+    stats_.fills++;
+    stats_.glyphs_drawn += count != STATUS_LINE_NO_FIT ? count : strlen(text);
+
+    valid_ = count != STATUS_LINE_NO_FIT;
+    font_ = font;
+    count_ = valid_ ? count : 0;
+    memcpy(glyphs_, next_, count_ * sizeof(Status_Glyph));
+    return;
+  }
+
+  uint32_t fills = stats_.fills;
+  uint32_t drawn = stats_.glyphs_drawn;
+  if (count_ > 0) {
+    uint16_t old_from = glyphs_[0].x;
+    uint16_t old_to = glyphs_[count_ - 1].x + font->Width;
+    if (count == 0) {
+      clear_columns(old_from, old_to, font->Height);
+    } else {
+      uint16_t new_from = next_[0].x;
+      uint16_t new_to = next_[count - 1].x + font->Width;
+      clear_columns(old_from, min(old_to, new_from), font->Height);
+      clear_columns(max(old_from, new_to), old_to, font->Height);
+    }
+  }
+
+  lcd_.SetTextColor(color);
+  size_t old = 0;
+  for (size_t i = 0; i < count; i++) {
+    const Status_Glyph &g = next_[i];
+    while (old < count_ && glyphs_[old].x < g.x) old++;
+    if (old < count_ && glyphs_[old].x == g.x &&
+        glyphs_[old].ascii == g.ascii &&
+        glyphs_[old].text_color == g.text_color &&
+        glyphs_[old].back_color == g.back_color) {
+      stats_.glyphs_kept++;
+      continue;
+    }
+    lcd_.DisplayChar(g.x, y_, g.ascii);
+    stats_.glyphs_drawn++;
+  }
+  if (fills == stats_.fills && drawn == stats_.glyphs_drawn) {
+    stats_.unchanged++;
+  }
+
+  count_ = count;
+  memcpy(glyphs_, next_, count * sizeof(Status_Glyph));
+}
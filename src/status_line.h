@@ -0,0 +1,140 @@
+/**
+ * @file status_line.h
+ * @author Xhovani Mali (xxm202)
+ * @brief A status line on the LCD that redraws only the glyphs that
+ * changed.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * display_status() used to clear the whole strip and draw every glyph
+ * again: a 240x16 fill and 176 pixel stores per character, even when
+ * "Recording in 3..." only turns into "Recording in 2...". StatusLine
+ * keeps the glyphs it drew (position, character, colors) and on show()
+ * lays the new text out exactly as DisplayStringAt(CENTER_MODE) would:
+ *
+ *   - a glyph already on screen at the same place in the same colors is
+ *     left alone;
+ *   - every other glyph is drawn, which rewrites its whole cell;
+ *   - columns the old text covered and the new one does not are cleared
+ *     with FillRect(), a DMA2D fill.
+ *
+ * The strip ends up with the same pixels as a full redraw. Glyphs are
+ * drawn with DisplayChar(), by the CPU one store per pixel or, with a
+ * glyph atlas attached (glyph_atlas.h), one DMA2D blend each; skipping
+ * them is where the time goes either way.
+ *
+ * The first show(), a font change, text too long for the line, or
+ * invalidate() (something else drew over the strip) redraw it all.
+ * show() may be called from any thread.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef STATUS_LINE_H
+#define STATUS_LINE_H
+
+#include "system_config.h"
+
+// The firmware's status messages, in STATUS_MESSAGES
+typedef enum {
+  STATUS_NO_KEY,
+  STATUS_LOCKED,
+  STATUS_ERASING,
+  STATUS_KEY_ERASED,
+  STATUS_ALL_ERASED,
+  STATUS_ERASE_FAILED,
+  STATUS_HOLD_ON,
+  STATUS_CALIBRATING,
+  STATUS_RECORDING_IN_3,  // the countdown, one message a second
+  STATUS_RECORDING_IN_2,
+  STATUS_RECORDING_IN_1,
+  STATUS_RECORDING,
+  STATUS_FINISHED,
+  STATUS_SAVING_KEY,
+  STATUS_KEY_SAVED,
+  STATUS_REMOVING_OLD_KEY,
+  STATUS_NEW_KEY_SAVED,
+  STATUS_UNLOCKING,
+  STATUS_NO_KEY_SAVED,
+  STATUS_UNLOCK_SUCCESS,
+  STATUS_UNLOCK_FAILED,
+  STATUS_RECORD_INITIATED,
+  STATUS_UNLOCK_INITIATED,
+  STATUS_MESSAGE_COUNT
+} Status_Message_Id;
+
+typedef struct {
+  const char *text;
+  uint32_t color;
+} Status_Message;
+
+// Text and color of each message; the host tests draw the same ones
+extern const Status_Message STATUS_MESSAGES[STATUS_MESSAGE_COUNT];
+
+// One glyph on the line
+typedef struct {
+  uint16_t x;
+  char ascii;
+  uint32_t text_color;
+  uint32_t back_color;
+} Status_Glyph;
+
+// Work done by show()
+typedef struct {
+  uint32_t updates;       // show() calls
+  uint32_t unchanged;     // of those, the ones that drew nothing
+  uint32_t full_redraws;  // of those, the ones that redrew the strip
+  uint32_t glyphs_drawn;
+  uint32_t glyphs_kept;   // glyphs left as they were
+  uint32_t fills;         // background spans cleared
+} Status_Line_Stats;
+
+class StatusLine {
+ public:
+  /**
+   * @param lcd: the display
+   * @param x: as for DisplayStringAt(x, y, text, CENTER_MODE)
+   * @param y: top of the line; it is one font height tall
+   * @param background: color of the strip around the text
+   */
+  StatusLine(LCD_DISCO_F429ZI &lcd, uint16_t x, uint16_t y,
+             uint32_t background = LCD_COLOR_BLACK);
+
+  /**
+   * @brief Show a text, centered, in the LCD's font and back color
+   * @param text: the text
+   * @param color: its color; the LCD's text color is left set to it
+   */
+  void show(const char *text, uint32_t color);
+
+  /**
+   * @brief The strip was drawn over; the next show() redraws it all
+   */
+  void invalidate();
+
+  Status_Line_Stats stats() const;
+
+  uint16_t y() const { return y_; }
+
+ private:
+  size_t layout(const char *text, uint32_t color, uint32_t back,
+                Status_Glyph *glyphs);
+  void clear_columns(uint16_t from, uint16_t to, uint16_t height);
+
+  mutable Mutex mutex_;
+  LCD_DISCO_F429ZI &lcd_;
+  uint16_t x_;
+  uint16_t y_;
+  uint32_t background_;
+  bool valid_;      // glyphs_ is what the strip shows
+  sFONT *font_;     // font of glyphs_
+  size_t count_;
+  Status_Glyph glyphs_[STATUS_LINE_GLYPHS];
+  Status_Glyph next_[STATUS_LINE_GLYPHS];  // show()'s layout, off the stack
+  Status_Line_Stats stats_;
+};
+
+#endif  // STATUS_LINE_H
@@ -23,8 +23,25 @@
 #include <limits>
 #include <vector>
 
+// The host build (CMakeLists.txt) compiles the processing code against a
+// thin mbed shim, with emulators for the display and the touch controller
+#ifndef SENTRY_HOST_BUILD
 #include "drivers/LCD_DISCO_F429ZI.h"
 #include "drivers/TS_DISCO_F429ZI.h"
+#else
+#include "lcd_emulator.h"
+#include "ts_emulator.h"
+#endif
+
+// Diagnostic output of the processing code; the host build sets this to 0 so
+// benchmarks measure the computation rather than the console
+#ifndef SENTRY_TRACE
+#define SENTRY_TRACE 1
+#endif
+#define trace_printf(...)                 \
+  do {                                    \
+    if (SENTRY_TRACE) printf(__VA_ARGS__); \
+  } while (0)
 
 #define CTRL_REG_1 0x20  // control register 1
 #define CTRL_REG_3 0x22  // control register 3
@@ -60,14 +77,134 @@
 #define UNLOCK_FLAG 2
 #define ERASE_FLAG 4
 #define DATA_READY_FLAG 8
+#define KEY_STORED_FLAG 16
 // on board discovery button
 #define USER_BUTTON PA_0
 
+// Touch input (see touch_input.h): the STMPE811 interrupt wakes the touch
+// thread, which samples only while a finger is down
+#define TOUCH_INT_PIN PA_15     // STMPE811 INT, open drain, active low
+#define TOUCH_POLL_MS 5         // sample period while in contact
+#define TOUCH_HELD_POLL_MS 20   // and once the press is reported
+#define TOUCH_PRESS_MS 10       // contact held this long is a press
+#define TOUCH_RELEASE_MS 30     // no contact this long is a release
+
+// Sampling and recording
+#define GYRO_SAMPLE_RATE_HZ 200   // sensor output data rate (ODR_200_CUTOFF_50)
+#define GYRO_READY_TIMEOUT 20ms   // read anyway if DRDY does not fire in time
+#define CALIBRATION_SAMPLES 128   // samples averaged for the zero-rate level
+#define RECORDING_DECIMATION 10   // sensor samples averaged per recorded sample
+#define RECORDING_SAMPLES 60      // recorded samples per gesture (3 s at 20 Hz)
+
+// Stream every recording as binary capture frames on the console
+// (see capture_format.h); 0 falls back to the text dump
+#define CAPTURE_STREAM 1
+
+// Stage profiler (see profiler.h); 0 compiles the probes out
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED 1
+#endif
+
+// Template store in internal flash (see template_store.h): the four 16 KB
+// sectors at the start of bank 2, away from the firmware in bank 1
+#define TEMPLATE_STORE_ADDRESS 0x08100000
+#define TEMPLATE_STORE_SECTORS 4
+#define TEMPLATE_STORE_RESERVE 1  // free sectors kept for compaction
+#define TEMPLATE_SLOTS 4
+#define TEMPLATE_KEY_SLOT 0       // slot of the unlock gesture key
+#define TEMPLATE_COMPRESS 1       // store keys with template_codec.h
+#define TEMPLATE_QUANTUM SENSITIVITY_500  // dps per step of stored keys
+#define BOOT_LOAD_BUDGET_MS 50    // mount and key load before the lock screen
+#define FLASH_WRITER_QUEUE 4      // pending flash jobs (writes and deletes)
+#define FLASH_WRITER_IDLE_MS 100  // maintain() period of the idle writer
+
+// Record store in the I2C EEPROM (see eeprom_store.h)
+#define EEPROM_STORE_ADDRESS 0x0000  // first byte used in the M24LR64
+#define EEPROM_RECORDS 8
+#define EEPROM_RECORD_PAYLOAD 12     // bytes per record (copies are 16 bytes)
+#define EEPROM_POLL_MS 1             // sleep before each standby poll
+#define EEPROM_POLL_LIMIT 20         // polls before a page write fails
+#define EEPROM_RECORD_ATTEMPTS 0     // unlock attempt counters
+
+// SDRAM arenas (see arena.h): the upper 4 MB, clear of the LCD frame
+// buffers in the first 3 MB
+#define SDRAM_ARENA_ADDRESS 0xD0400000
+#define ARENA_CAPTURE_SIZE (1024 * 1024)   // about 70 minutes of samples
+#define ARENA_DTW_SIZE (2 * 1024 * 1024)   // a 720 x 720 DTW matrix
+#define ARENA_TEMPLATE_SIZE (768 * 1024)
+#define ARENA_BLACKBOX_SIZE (256 * 1024)  // see BLACKBOX_ATTEMPTS
+
+// Black box of the last attempts (see blackbox.h), in ARENA_BLACKBOX
+#define BLACKBOX_ATTEMPTS 32   // attempts kept, about 5 KB each
+#define BLACKBOX_SAMPLES 640   // raw samples kept per attempt (3.2 s)
+
+// Thread stacks, painted for the memory report (see memory_report.h). The
+// host build gives its threads room for x86-64 frames and for the glibc
+// thread block kept at the top of a stack.
+#ifdef SENTRY_HOST_BUILD
+#define THREAD_STACK(bytes) ((bytes) * 2 + 16 * 1024)
+#else
+#define THREAD_STACK(bytes) (bytes)
+#endif
+#define GYROSCOPE_STACK_SIZE THREAD_STACK(4096)
+#define TOUCH_STACK_SIZE THREAD_STACK(4096)
+#define CONSOLE_STACK_SIZE THREAD_STACK(4096)
+#define FLASH_WRITER_STACK_SIZE THREAD_STACK(4096)
+#define UI_STACK_SIZE THREAD_STACK(4096)
+#define MEMORY_STACKS 6  // stacks the report can watch
+
 // LCD font size
 #define FONT_SIZE 16
+#define STATUS_LINE_GLYPHS 48  // glyphs a status line keeps (240 px of Font8)
+// Where main() shows its status messages (see status_line.h), centered as by
+// DisplayStringAt(STATUS_TEXT_X, STATUS_TEXT_Y, text, CENTER_MODE)
+#define STATUS_TEXT_X 5
+#define STATUS_TEXT_Y 270
+// Glyph atlas (see glyph_atlas.h): Font16's 95 glyphs and the opaque cell,
+// 11 x 16 bytes each
+#define GLYPH_ATLAS_BYTES ((LCD_ATLAS_GLYPHS + 1) * 11 * 16)
+
+// Double-buffered display (see frame_buffers.h): layer 0 flips between its
+// own buffer and the one LCD_DISCO_F429ZI gives layer 1, which stays hidden
+#define DISPLAY_FRONT_BUFFER (LCD_FRAME_BUFFER + 0x130000)
+#define DISPLAY_BACK_BUFFER LCD_FRAME_BUFFER
+#define DISPLAY_REFRESH_US 15205  // ILI9341: 6 MHz, 279 x 327 clocks a frame
+#define DISPLAY_FRAME_BUDGET_US DISPLAY_REFRESH_US
+// Pixel format of those buffers (see display_format.h): RGB565 halves the
+// SDRAM traffic of ARGB8888 and keeps the DMA2D; LCD_PIXEL_FORMAT_L8
+// quarters it, with a palette and the CPU drawing
+#define DISPLAY_PIXEL_FORMAT LCD_PIXEL_FORMAT_RGB565
+
+// Rate plot drawn while recording (see rate_plot.h), below the status line
+#define RATE_PLOT_Y 288
+#define RATE_PLOT_HEIGHT 32
+#define RATE_PLOT_MAX_WIDTH 240
+#define RATE_PLOT_FULL_SCALE_DPS 250.0f
+#define RATE_PLOT_SAMPLES_PER_COLUMN 2  // sensor samples per column (100/s)
+#define RATE_PLOT_FRAME_SAMPLES 6       // sensor samples per frame (33 fps)
+#define RATE_PLOT_BUDGET_US 1500        // per frame, under the sample period
+#define RATE_PLOT_MAX_COLUMNS 16        // columns a frame may draw
+#define RATE_PLOT_PENDING 64            // columns that may wait for a frame
+
+// UI thread (see ui_renderer.h): the only one drawing the status line and
+// progress bar and setting the LEDs, from commands the others queue
+#define UI_QUEUE_DEPTH 16   // commands waiting, a power of two
+#define UI_STATUS_TEXT 24   // bytes of a status text, NUL included
+#define UI_PROGRESS_X 20    // progress bar, between the buttons and the status
+#define UI_PROGRESS_Y 256
+#define UI_PROGRESS_WIDTH 200
+#define UI_PROGRESS_HEIGHT 6
 
 // the unlocking threshold, change this to a smaller value if you have trouble
 // unlocking (has to be positive)
 #define CORRELATION_THRESHOLD .70f
 
+// number of axes that have to beat CORRELATION_THRESHOLD to unlock
+#define UNLOCK_AXES_REQUIRED 1
+
+// Hampel spike rejection on the calibrated stream (see hampel_filter.h)
+#define HAMPEL_WINDOW_SIZE 7        // samples in the median window (odd)
+#define HAMPEL_N_SIGMAS 3.0f        // rejection threshold in sigmas
+#define HAMPEL_MIN_DEVIATION 50.0f  // never reject deviations below this (dps)
+
 #endif  // SYSTEM_CONFIG_H
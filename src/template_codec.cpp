@@ -0,0 +1,128 @@
+/**
+ * @file template_codec.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Compact encoding of gesture templates.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "template_codec.h"
+
+static inline uint32_t zigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static inline int16_t quantize(float value, float quantum) {
+  float q = roundf(value / quantum);
+  return (int16_t)std::max(-32768.0f, std::min(32767.0f, q));
+}
+
+/*******************************************************************************
+ *
+ * @brief Encode a template
+ * @param samples: the template, at most 65535 samples
+ * @param quantum: dps per quantization step
+ * @param out: receives the encoding (replaced)
+ * @return false if the template is too long or the quantum is not positive
+ *
+ * ****************************************************************************/
+bool TemplateEncode(const vector<array<float, 3>> &samples, float quantum,
+                    vector<uint8_t> &out) {
+  if (samples.size() > UINT16_MAX || !(quantum > 0.0f)) return false;
+
+  out.resize(TemplateEncodedBound(samples.size()));
+  uint8_t *p = out.data();
+  uint16_t count = (uint16_t)samples.size();
+  uint32_t quantum_bits;
+  memcpy(&quantum_bits, &quantum, sizeof(quantum_bits));
+  *p++ = count & 0xFF;
+  *p++ = count >> 8;
+  for (int i = 0; i < 4; i++) *p++ = (quantum_bits >> (8 * i)) & 0xFF;
+
+  int32_t previous[3] = {0, 0, 0};
+  for (const auto &sample : samples) {
+    for (int axis = 0; axis < 3; axis++) {
+      int32_t q = quantize(sample[axis], quantum);
+      uint32_t value = zigzag(q - previous[axis]);
+      previous[axis] = q;
+      while (value >= 0x80) {
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+      }
+      *p++ = (uint8_t)value;
+    }
+  }
+
+  out.resize(p - out.data());
+  return true;
+}
+
+bool TemplateDecode(const uint8_t *data, size_t size,
+                    vector<array<float, 3>> &samples) {
+  TemplateDecoder decoder(data, size);
+  if (!decoder.valid()) return false;
+  samples.resize(decoder.count());
+  for (auto &sample : samples) {
+    if (!decoder.next(sample)) return false;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * @brief Streaming decoder
+ *
+ * ****************************************************************************/
+TemplateDecoder::TemplateDecoder(const uint8_t *data, size_t size)
+    : data_(data), size_(size), count_(0), quantum_(0.0f), valid_(false) {
+  if (data != nullptr && size >= TEMPLATE_CODEC_HEADER_SIZE) {
+    uint32_t quantum_bits = data[2] | data[3] << 8 | data[4] << 16 |
+                            (uint32_t)data[5] << 24;
+    count_ = data[0] | data[1] << 8;
+    memcpy(&quantum_, &quantum_bits, sizeof(quantum_));
+    valid_ = quantum_ > 0.0f;
+  }
+  rewind();
+}
+
+void TemplateDecoder::rewind() {
+  pos_ = TEMPLATE_CODEC_HEADER_SIZE;
+  decoded_ = 0;
+  previous_[0] = previous_[1] = previous_[2] = 0;
+}
+
+bool TemplateDecoder::read_varint(uint32_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 21; shift += 7) {  // zigzag int17 fits 3 bytes
+    if (pos_ >= size_) return false;
+    uint8_t byte = data_[pos_++];
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+bool TemplateDecoder::next(array<float, 3> &sample) {
+  if (!valid_ || decoded_ >= count_) return false;
+  for (int axis = 0; axis < 3; axis++) {
+    uint32_t value;
+    if (!read_varint(value)) {
+      valid_ = false;
+      return false;
+    }
+    previous_[axis] += unzigzag(value);
+    sample[axis] = previous_[axis] * quantum_;
+  }
+  decoded_++;
+  return true;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file template_codec.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Compact encoding of gesture templates: int16 quantization, delta
+ * coding and zigzag varints.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Encoded layout (little-endian):
+ *
+ *   count (u16) | quantum (f32, dps per step) | varints
+ *
+ * Each sample is quantized per axis to q = round(value / quantum), clamped
+ * to int16, and stored as the zigzag varint of q minus the previous
+ * sample's q (x, y, z interleaved). With the sensor's own sensitivity as
+ * the quantum the round trip is exact for data that came from the sensor
+ * and within quantum / 2 for averaged data. A smooth gesture needs one or
+ * two bytes per axis instead of four.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef TEMPLATE_CODEC_H
+#define TEMPLATE_CODEC_H
+
+#include "system_config.h"
+
+#define TEMPLATE_CODEC_HEADER_SIZE 6  // count + quantum
+
+/**
+ * @brief Largest encoding of a template of `samples` samples
+ */
+static inline size_t TemplateEncodedBound(size_t samples) {
+  return TEMPLATE_CODEC_HEADER_SIZE + samples * 3 * 3;  // <= 3 bytes per axis
+}
+
+/**
+ * @brief Encode a template
+ * @param samples: the template, at most 65535 samples
+ * @param quantum: dps per quantization step
+ * @param out: receives the encoding (replaced)
+ * @return false if the template is too long or the quantum is not positive
+ */
+bool TemplateEncode(const vector<array<float, 3>> &samples, float quantum,
+                    vector<uint8_t> &out);
+
+/**
+ * @brief Decode a whole template
+ * @param data: the encoding
+ * @param size: its size in bytes
+ * @param samples: receives the template (replaced)
+ * @return false if the encoding is malformed
+ */
+bool TemplateDecode(const uint8_t *data, size_t size,
+                    vector<array<float, 3>> &samples);
+
+/**
+ * @brief Decodes an encoded template one sample at a time, in place
+ *
+ * Needs no buffer besides the encoding itself, which may be read straight
+ * from flash.
+ */
+class TemplateDecoder {
+ public:
+  TemplateDecoder(const uint8_t *data, size_t size);
+
+  /**
+   * @brief Whether the header was well formed
+   */
+  bool valid() const { return valid_; }
+
+  /**
+   * @brief Number of samples in the template
+   */
+  size_t count() const { return count_; }
+
+  /**
+   * @brief Decode the next sample
+   * @return false at the end of the template or on malformed data
+   */
+  bool next(array<float, 3> &sample);
+
+  /**
+   * @brief Go back to the first sample
+   */
+  void rewind();
+
+ private:
+  bool read_varint(uint32_t &value);
+
+  const uint8_t *data_;
+  size_t size_;
+  size_t pos_;
+  size_t count_;
+  size_t decoded_;
+  float quantum_;
+  int32_t previous_[3];
+  bool valid_;
+};
+
+#endif  // TEMPLATE_CODEC_H
@@ -0,0 +1,119 @@
+/**
+ * @file template_features.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Immutable per-key data for the matcher.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "template_features.h"
+
+#include <cstring>
+
+#include "template_codec.h"
+#include "utilities.h"
+
+TemplateFeatures::TemplateFeatures(Arena *arena)
+    : arena_(arena), samples_(nullptr), on_heap_(false), count_(0) {
+  clear();
+}
+
+TemplateFeatures::~TemplateFeatures() { clear(); }
+
+void TemplateFeatures::clear() {
+  if (on_heap_) free(samples_);
+  samples_ = nullptr;
+  on_heap_ = false;
+  count_ = 0;
+  for (int axis = 0; axis < 3; axis++) first_varying_[axis] = 0;
+  mean_.fill(0.0f);
+  sigma_.fill(0.0f);
+}
+
+/*******************************************************************************
+ *
+ * @brief Compute the features of a key
+ * @param key: the key in either encoding, in flash or in RAM
+ * @return false for a malformed key or no memory
+ *
+ * The running sums are computed exactly as CorrelationAccumulator::add()
+ * computes them for its a side.
+ *
+ * ****************************************************************************/
+bool TemplateFeatures::build(const Template_View &key) {
+  clear();
+  if (arena_ != nullptr) arena_->reset();
+
+  TemplateDecoder decoder(key.data, key.length);
+  size_t count;
+  switch (key.encoding) {
+    case TEMPLATE_ENCODING_FLOAT32:
+      count = key.length / sizeof(array<float, 3>);
+      break;
+    case TEMPLATE_ENCODING_DELTA:
+      if (!decoder.valid()) return false;
+      count = decoder.count();
+      break;
+    default:
+      return false;
+  }
+  if (count == 0) return false;
+
+  Template_Feature_Sample *samples =
+      arena_ != nullptr
+          ? arena_->allocate_array<Template_Feature_Sample>(count)
+          : nullptr;
+  if (samples == nullptr) {
+    samples = static_cast<Template_Feature_Sample *>(
+        malloc(count * sizeof(Template_Feature_Sample)));
+    if (samples == nullptr) return false;
+    on_heap_ = true;
+  }
+  samples_ = samples;
+
+  array<float, 3> sum = {0.0f, 0.0f, 0.0f};
+  array<float, 3> sq_sum = {0.0f, 0.0f, 0.0f};
+  double moments[3][2] = {{0, 0}, {0, 0}, {0, 0}};
+  for (int axis = 0; axis < 3; axis++) first_varying_[axis] = count;
+
+  for (size_t i = 0; i < count; i++) {
+    array<float, 3> k;
+    if (key.encoding == TEMPLATE_ENCODING_FLOAT32) {
+      memcpy(&k, key.data + i * sizeof(k), sizeof(k));
+    } else if (!decoder.next(k)) {
+      clear();
+      return false;
+    }
+    normalize_sample(k);
+
+    Template_Feature_Sample &s = samples_[i];
+    for (int axis = 0; axis < 3; axis++) {
+      float a = k[axis];
+      if (a != 0.0f && first_varying_[axis] == count) {
+        first_varying_[axis] = i;
+      }
+      s.delta[axis] = a - sum[axis];
+      sum[axis] += s.delta[axis];
+      sq_sum[axis] += a * a;
+      s.sum[axis] = sum[axis];
+      s.sq_sum[axis] = sq_sum[axis];
+      moments[axis][0] += a;
+      moments[axis][1] += (double)a * a;
+    }
+  }
+  count_ = count;
+
+  for (int axis = 0; axis < 3 && count > 0; axis++) {
+    double mean = moments[axis][0] / count;
+    double variance = moments[axis][1] / count - mean * mean;
+    mean_[axis] = (float)mean;
+    sigma_[axis] = variance > 0 ? (float)sqrt(variance) : 0.0f;
+  }
+  return true;
+}
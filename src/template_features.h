@@ -0,0 +1,101 @@
+/**
+ * @file template_features.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Immutable per-key data for the matcher, computed once when a key
+ * is enrolled or loaded.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * Matching an attempt against a key in flash decodes the key, normalizes
+ * every sample and accumulates its half of the correlation sums, all over
+ * again on every attempt, although none of it depends on the attempt.
+ * build() does that work once. For every sample of the normalized key it
+ * keeps, per axis:
+ *
+ *   delta   the step CorrelationAccumulator::add() takes for the key value
+ *   sum     the accumulator's running sum after the sample
+ *   sq_sum  the sum of squares up to and including the sample
+ *
+ * The sums are prefix sums, so an attempt of any length n reads the key's
+ * totals at sample n - 1, and MatchFeatures() only has to normalize and
+ * accumulate the attempt. The arithmetic is the accumulator's own, in the
+ * same order, so scores equal MatchTemplate() bit for bit.
+ *
+ * The per-axis mean and standard deviation of the normalized key are kept
+ * for diagnostics: an axis that barely moves cannot vote.
+ *
+ * The samples go in an arena (on the board SdramArena(ARENA_TEMPLATE),
+ * which the object owns and resets on each build()), or on the heap
+ * without one. After build() nothing changes them.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef TEMPLATE_FEATURES_H
+#define TEMPLATE_FEATURES_H
+
+#include "arena.h"
+#include "system_config.h"
+#include "template_store.h"
+
+// The key side of the correlation sums at one sample
+typedef struct {
+  array<float, 3> delta;
+  array<float, 3> sum;
+  array<float, 3> sq_sum;
+} Template_Feature_Sample;
+
+class TemplateFeatures {
+ public:
+  /**
+   * @param arena: optional arena the samples are kept in; it is reset by
+   *        every build()
+   */
+  explicit TemplateFeatures(Arena *arena = nullptr);
+  ~TemplateFeatures();
+
+  /**
+   * @brief Compute the features of a key
+   * @param key: the key in either encoding, in flash or in RAM
+   * @return false for a malformed key or no memory (the features are then
+   *         empty)
+   */
+  bool build(const Template_View &key);
+
+  /**
+   * @brief Drop the features (the key was erased)
+   */
+  void clear();
+
+  bool valid() const { return samples_ != nullptr; }
+  size_t count() const { return count_; }
+  const Template_Feature_Sample &operator[](size_t i) const {
+    return samples_[i];
+  }
+
+  /**
+   * @brief First sample whose normalized value on an axis is non-zero
+   * (count() if there is none)
+   */
+  size_t first_varying(int axis) const { return first_varying_[axis]; }
+
+  const array<float, 3> &mean() const { return mean_; }
+  const array<float, 3> &sigma() const { return sigma_; }
+
+ private:
+  TemplateFeatures(const TemplateFeatures &) = delete;
+  TemplateFeatures &operator=(const TemplateFeatures &) = delete;
+
+  Arena *arena_;
+  Template_Feature_Sample *samples_;
+  bool on_heap_;
+  size_t count_;
+  size_t first_varying_[3];
+  array<float, 3> mean_;
+  array<float, 3> sigma_;
+};
+
+#endif  // TEMPLATE_FEATURES_H
@@ -0,0 +1,583 @@
+/**
+ * @file template_store.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Log-structured, wear-leveled gesture template store in internal
+ * flash.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "template_store.h"
+#include "capture_format.h"
+#include "profiler.h"
+#include "template_codec.h"
+
+static const uint32_t SECTOR_HEADER_SIZE = sizeof(Template_Sector_Header);
+static const uint32_t RECORD_HEADER_SIZE = sizeof(Template_Record_Header);
+static const uint32_t CRC_COVERED = offsetof(Template_Record_Header, crc);
+// Sector sequences at or above this are damaged; the room left above it
+// keeps next_sector_sequence_ from ever reaching TEMPLATE_UNUSED
+static const uint32_t SEQUENCE_LIMIT = TEMPLATE_UNUSED - TEMPLATE_STORE_SECTORS;
+
+static_assert(sizeof(Template_Sector_Header) == 16, "sector header layout");
+static_assert(sizeof(Template_Record_Header) == 20, "record header layout");
+
+// Where the CPU sees a flash address
+static inline const uint8_t *flash_memory(uint32_t address) {
+#ifdef SENTRY_HOST_BUILD
+  return flash_emulator_memory(address);
+#else
+  return (const uint8_t *)address;
+#endif
+}
+
+// Records start on word boundaries
+static uint32_t record_size(uint32_t length) {
+  return (RECORD_HEADER_SIZE + length + 3) & ~3u;
+}
+
+TemplateStore::TemplateStore(uint32_t address)
+    : mounted_(false),
+      encoding_(TEMPLATE_COMPRESS ? TEMPLATE_ENCODING_DELTA
+                                  : TEMPLATE_ENCODING_FLOAT32),
+      views_(0),
+      address_(address),
+      head_(-1),
+      next_record_sequence_(1),
+      next_sector_sequence_(1),
+      compactions_(0),
+      corrupt_records_(0) {
+  memset(sectors_, 0, sizeof(sectors_));
+  memset(slots_, 0, sizeof(slots_));
+}
+
+/*******************************************************************************
+ *
+ * @brief Scan the sectors and rebuild the slot index
+ * @return false if the flash cannot be accessed
+ *
+ * ****************************************************************************/
+bool TemplateStore::mount() {
+  ScopedLock<Mutex> lock(mutex_);
+  if (flash_.init() != 0) return false;
+
+  memset(slots_, 0, sizeof(slots_));
+  head_ = -1;
+  next_record_sequence_ = 1;
+  next_sector_sequence_ = 1;
+  compactions_ = 0;
+  corrupt_records_ = 0;
+
+  // Sector geometry and headers
+  bool formatted[TEMPLATE_STORE_SECTORS];
+  uint32_t max_erase_count = 0;
+  uint32_t address = address_;
+  for (int s = 0; s < TEMPLATE_STORE_SECTORS; s++) {
+    Sector &sector = sectors_[s];
+    sector.address = address;
+    sector.size = flash_.get_sector_size(address);
+    if (sector.size <= SECTOR_HEADER_SIZE) return false;
+    address += sector.size;
+
+    Template_Sector_Header header;
+    if (flash_.read(&header, sector.address, sizeof(header)) != 0) return false;
+    formatted[s] = header.magic == TEMPLATE_SECTOR_MAGIC;
+    sector.erase_count = formatted[s] ? header.erase_count : 0;
+    sector.sequence = formatted[s] ? header.sequence : TEMPLATE_UNUSED;
+    sector.write_offset = SECTOR_HEADER_SIZE;
+    sector.garbage = 0;
+    if (formatted[s]) max_erase_count = std::max(max_erase_count, header.erase_count);
+  }
+
+  // A reset while open_sector() programs a sequence leaves a torn word.
+  // Programming only clears bits, so it reads at or above the sequence
+  // meant, and the sector holds no records yet. Sectors are opened in turn
+  // and reclaimed oldest first, so the ones in use have sequences within
+  // TEMPLATE_STORE_SECTORS of each other: a newest sector further ahead
+  // than that is torn, and is reclaimed before it can rank as the head.
+  int newest = -1, previous = -1;
+  for (int s = 0; s < TEMPLATE_STORE_SECTORS; s++) {
+    if (!formatted[s] || sectors_[s].sequence == TEMPLATE_UNUSED) continue;
+    if (newest < 0 || sectors_[s].sequence > sectors_[newest].sequence) {
+      previous = newest;
+      newest = s;
+    } else if (previous < 0 ||
+               sectors_[s].sequence > sectors_[previous].sequence) {
+      previous = s;
+    }
+  }
+  if (newest >= 0) {
+    uint32_t limit = SEQUENCE_LIMIT;
+    if (previous >= 0 &&
+        sectors_[previous].sequence < SEQUENCE_LIMIT - TEMPLATE_STORE_SECTORS) {
+      limit = sectors_[previous].sequence + TEMPLATE_STORE_SECTORS;
+    }
+    if (sectors_[newest].sequence >= limit && !erase_sector(newest)) {
+      return false;
+    }
+  }
+
+  for (int s = 0; s < TEMPLATE_STORE_SECTORS; s++) {
+    Sector &sector = sectors_[s];
+    if (!formatted[s]) {
+      // Blank or foreign: the true erase count is lost, assume the worst.
+      // A blank sector only needs its header, which saves a first boot the
+      // quarter second per sector of an erase.
+      sector.erase_count = max_erase_count;
+      bool blank;
+      if (!is_blank(s, blank)) return false;
+      if (!(blank ? write_sector_header(s) : erase_sector(s))) return false;
+      continue;
+    }
+    if (sector.sequence == TEMPLATE_UNUSED) continue;
+
+    if (!scan_sector(s)) return false;
+    next_sector_sequence_ = std::max(next_sector_sequence_, sector.sequence + 1);
+    if (head_ < 0 || sector.sequence > sectors_[head_].sequence) head_ = s;
+  }
+
+  mounted_ = true;
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * @brief Walk the records of a sector and merge them into the slot index
+ * @param s: the sector
+ *
+ * The walk stops at the first erased word. A header that cannot be a
+ * record (power lost while it was programmed) makes the rest of the sector
+ * unusable; a record with a bad CRC is skipped.
+ *
+ * ****************************************************************************/
+bool TemplateStore::scan_sector(int s) {
+  Sector &sector = sectors_[s];
+  uint32_t offset = SECTOR_HEADER_SIZE;
+
+  while (offset + RECORD_HEADER_SIZE <= sector.size) {
+    Template_Record_Header header;
+    uint32_t address = sector.address + offset;
+    if (flash_.read(&header, address, sizeof(header)) != 0) return false;
+    if (header.magic == TEMPLATE_UNUSED) break;
+
+    if (header.magic != TEMPLATE_RECORD_MAGIC ||
+        header.version != TEMPLATE_FORMAT_VERSION ||
+        header.slot >= TEMPLATE_SLOTS ||
+        record_size(header.length) > sector.size - offset) {
+      corrupt_records_++;
+      sector.garbage += sector.size - offset;
+      offset = sector.size;
+      break;
+    }
+
+    uint32_t size = record_size(header.length);
+    uint16_t crc = crc16_ccitt((const uint8_t *)&header, CRC_COVERED);
+    uint8_t chunk[64];
+    for (uint32_t done = 0; done < header.length; done += sizeof(chunk)) {
+      uint32_t n = std::min<uint32_t>(sizeof(chunk), header.length - done);
+      if (flash_.read(chunk, address + RECORD_HEADER_SIZE + done, n) != 0) {
+        return false;
+      }
+      crc = crc16_ccitt(chunk, n, crc);
+    }
+    offset += size;
+
+    if (crc != header.crc) {
+      corrupt_records_++;
+      sector.garbage += size;
+      continue;
+    }
+
+    next_record_sequence_ =
+        std::max(next_record_sequence_, header.sequence + 1);
+    Slot &slot = slots_[header.slot];
+    if (slot.address != 0 && slot.sequence > header.sequence) {
+      sector.garbage += size;  // already superseded
+      continue;
+    }
+    supersede(header.slot);
+    slot.address = address;
+    slot.sequence = header.sequence;
+    slot.size = size;
+    slot.type = header.type;
+  }
+
+  sector.write_offset = std::min(offset, sector.size);
+  return true;
+}
+
+bool TemplateStore::format() {
+  ScopedLock<Mutex> lock(mutex_);
+  if (!mounted_ || views_ > 0) return false;
+  for (int s = 0; s < TEMPLATE_STORE_SECTORS; s++) {
+    if (!erase_sector(s)) return false;
+  }
+  memset(slots_, 0, sizeof(slots_));
+  head_ = -1;
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * @brief Store a template in a slot, replacing what was there
+ * @param slot: the slot
+ * @param samples: the template
+ * @param sample_rate_hz: the rate of the samples
+ * @return false if the slot is invalid, the template does not fit or the
+ *         flash failed
+ *
+ * ****************************************************************************/
+bool TemplateStore::write(uint8_t slot, const vector<array<float, 3>> &samples,
+                          uint16_t sample_rate_hz) {
+  PROFILE_SCOPE(PROFILE_FLASH);
+  uint8_t encoding = encoding_;
+  const void *payload = samples.data();
+  size_t length = samples.size() * sizeof(array<float, 3>);
+  vector<uint8_t> encoded;
+  if (encoding == TEMPLATE_ENCODING_DELTA) {
+    if (!TemplateEncode(samples, TEMPLATE_QUANTUM, encoded)) return false;
+    payload = encoded.data();
+    length = encoded.size();
+  }
+
+  ScopedLock<Mutex> lock(mutex_);
+  if (!mounted_ || slot >= TEMPLATE_SLOTS || length > UINT16_MAX) return false;
+
+  uint32_t sequence = next_record_sequence_++;
+  for (int attempt = 0; attempt <= TEMPLATE_STORE_SECTORS; attempt++) {
+    if (append(TEMPLATE_RECORD_DATA, slot, encoding, sample_rate_hz, sequence,
+               payload, (uint16_t)length, false)) {
+      return true;
+    }
+    // Out of space: reclaim in the foreground, maintain() was too late
+    int oldest = oldest_sector();
+    if (oldest < 0 || !compact(oldest)) return false;
+  }
+  return false;
+}
+
+bool TemplateStore::remove(uint8_t slot) {
+  ScopedLock<Mutex> lock(mutex_);
+  if (!mounted_ || slot >= TEMPLATE_SLOTS) return false;
+  if (slots_[slot].address == 0 ||
+      slots_[slot].type == TEMPLATE_RECORD_TOMBSTONE) {
+    return true;  // nothing to delete
+  }
+
+  uint32_t sequence = next_record_sequence_++;
+  for (int attempt = 0; attempt <= TEMPLATE_STORE_SECTORS; attempt++) {
+    if (append(TEMPLATE_RECORD_TOMBSTONE, slot, TEMPLATE_ENCODING_FLOAT32, 0,
+               sequence, nullptr, 0, false)) {
+      return true;
+    }
+    int oldest = oldest_sector();
+    if (oldest < 0 || !compact(oldest)) return false;
+  }
+  return false;
+}
+
+/*******************************************************************************
+ *
+ * @brief Get the template of a slot in place, without copying it
+ * @param slot: the slot
+ * @param view: receives the template
+ * @return false if the slot is empty
+ *
+ * ****************************************************************************/
+bool TemplateStore::acquire(uint8_t slot, Template_View &view) {
+  ScopedLock<Mutex> lock(mutex_);
+  if (!contains(slot)) return false;
+
+  // The header was checked at mount; the payload follows it in flash
+  const Template_Record_Header *header =
+      (const Template_Record_Header *)flash_memory(slots_[slot].address);
+  view.data = (const uint8_t *)header + RECORD_HEADER_SIZE;
+  view.length = header->length;
+  view.encoding = header->encoding;
+  view.sample_rate_hz = header->sample_rate_hz;
+  views_++;
+  return true;
+}
+
+void TemplateStore::release() {
+  ScopedLock<Mutex> lock(mutex_);
+  if (views_ > 0) views_--;
+}
+
+bool TemplateStore::contains(uint8_t slot) const {
+  ScopedLock<Mutex> lock(mutex_);
+  return slot < TEMPLATE_SLOTS && slots_[slot].address != 0 &&
+         slots_[slot].type == TEMPLATE_RECORD_DATA;
+}
+
+/*******************************************************************************
+ *
+ * @brief Load the template of a slot
+ * @param slot: the slot
+ * @param samples: receives the template (replaced)
+ * @return false if the slot is empty
+ *
+ * ****************************************************************************/
+bool TemplateStore::read(uint8_t slot, vector<array<float, 3>> &samples) {
+  PROFILE_SCOPE(PROFILE_FLASH);
+  ScopedLock<Mutex> lock(mutex_);
+  if (slot >= TEMPLATE_SLOTS || slots_[slot].address == 0 ||
+      slots_[slot].type != TEMPLATE_RECORD_DATA) {
+    return false;
+  }
+
+  Template_Record_Header header;
+  uint32_t address = slots_[slot].address;
+  if (flash_.read(&header, address, sizeof(header)) != 0) return false;
+
+  switch (header.encoding) {
+    case TEMPLATE_ENCODING_FLOAT32:
+      samples.resize(header.length / sizeof(array<float, 3>));
+      return flash_.read(samples.data(), address + RECORD_HEADER_SIZE,
+                         header.length) == 0;
+    case TEMPLATE_ENCODING_DELTA: {
+      vector<uint8_t> encoded(header.length);
+      return flash_.read(encoded.data(), address + RECORD_HEADER_SIZE,
+                         header.length) == 0 &&
+             TemplateDecode(encoded.data(), encoded.size(), samples);
+    }
+    default:
+      return false;
+  }
+}
+
+/*******************************************************************************
+ *
+ * @brief Reclaim the oldest sector once only the reserve is left free
+ * @return true if a sector was reclaimed
+ *
+ * ****************************************************************************/
+bool TemplateStore::maintain() {
+  ScopedLock<Mutex> lock(mutex_);
+  if (!mounted_ || free_sector_count() > TEMPLATE_STORE_RESERVE) return false;
+  int oldest = oldest_sector();
+  return oldest >= 0 && compact(oldest);
+}
+
+Template_Store_Stats TemplateStore::stats() const {
+  ScopedLock<Mutex> lock(mutex_);
+  Template_Store_Stats stats;
+  memset(&stats, 0, sizeof(stats));
+  for (int s = 0; s < TEMPLATE_STORE_SECTORS; s++) {
+    stats.erase_count[s] = sectors_[s].erase_count;
+    stats.garbage_bytes += sectors_[s].garbage;
+  }
+  for (int i = 0; i < TEMPLATE_SLOTS; i++) stats.live_bytes += slots_[i].size;
+  stats.free_sectors = free_sector_count();
+  stats.compactions = compactions_;
+  stats.corrupt_records = corrupt_records_;
+  return stats;
+}
+
+/*******************************************************************************
+ *
+ * @brief Append one record at the head of the log
+ *
+ * A new sector is opened when the head is full. Outside compaction the
+ * last TEMPLATE_STORE_RESERVE free sectors are left alone, so there is
+ * always room to copy the live records of the oldest sector.
+ *
+ * ****************************************************************************/
+bool TemplateStore::append(uint8_t type, uint8_t slot, uint8_t encoding,
+                           uint16_t sample_rate_hz, uint32_t sequence,
+                           const void *payload, uint16_t length,
+                           bool compacting) {
+  uint32_t size = record_size(length);
+  if (head_ < 0 ||
+      sectors_[head_].write_offset + size > sectors_[head_].size) {
+    int next = free_sector();
+    if (next < 0) return false;
+    if (!compacting && free_sector_count() <= TEMPLATE_STORE_RESERVE) {
+      return false;
+    }
+    if (size > sectors_[next].size - SECTOR_HEADER_SIZE) return false;
+    if (!open_sector(next)) return false;
+  }
+
+  Sector &sector = sectors_[head_];
+  uint32_t address = sector.address + sector.write_offset;
+  sector.write_offset += size;  // consumed even if programming fails
+
+  Template_Record_Header header;
+  header.magic = TEMPLATE_RECORD_MAGIC;
+  header.version = TEMPLATE_FORMAT_VERSION;
+  header.type = type;
+  header.slot = slot;
+  header.encoding = encoding;
+  header.length = length;
+  header.sample_rate_hz = sample_rate_hz;
+  header.sequence = sequence;
+  header.reserved = 0xFFFF;
+  header.crc = crc16_ccitt((const uint8_t *)&header, CRC_COVERED);
+  header.crc = crc16_ccitt((const uint8_t *)payload, length, header.crc);
+
+  // Header first: a record cut short by a reset fails its CRC at mount
+  if (flash_.program(&header, address, sizeof(header)) != 0 ||
+      (length > 0 &&
+       flash_.program(payload, address + RECORD_HEADER_SIZE, length) != 0)) {
+    sector.garbage += size;
+    return false;
+  }
+
+  if (!compacting) supersede(slot);
+  Slot &entry = slots_[slot];
+  entry.address = address;
+  entry.sequence = sequence;
+  entry.size = size;
+  entry.type = type;
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * @brief Copy the live records of a sector to the head and erase it
+ * @param s: the sector, normally the oldest
+ *
+ * A tombstone that is still the newest record of its slot can be dropped
+ * here: anything older for that slot sits in this same sector.
+ *
+ * ****************************************************************************/
+bool TemplateStore::compact(int s) {
+  if (s == head_ || views_ > 0) return false;
+  Sector &sector = sectors_[s];
+
+  for (uint8_t i = 0; i < TEMPLATE_SLOTS; i++) {
+    Slot &slot = slots_[i];
+    if (slot.address < sector.address ||
+        slot.address >= sector.address + sector.size) {
+      continue;
+    }
+    if (slot.type == TEMPLATE_RECORD_TOMBSTONE) {
+      memset(&slot, 0, sizeof(slot));
+      continue;
+    }
+
+    Template_Record_Header header;
+    if (flash_.read(&header, slot.address, sizeof(header)) != 0) return false;
+    vector<uint8_t> payload(header.length);
+    if (flash_.read(payload.data(), slot.address + RECORD_HEADER_SIZE,
+                    header.length) != 0 ||
+        !append(header.type, header.slot, header.encoding,
+                header.sample_rate_hz, header.sequence, payload.data(),
+                header.length, true)) {
+      return false;
+    }
+  }
+
+  if (!erase_sector(s)) return false;
+  compactions_++;
+  return true;
+}
+
+// The current record of a slot is about to be replaced
+void TemplateStore::supersede(uint8_t slot) {
+  Slot &entry = slots_[slot];
+  if (entry.address == 0) return;
+  int s = sector_of(entry.address);
+  if (s >= 0) sectors_[s].garbage += entry.size;
+}
+
+bool TemplateStore::erase_sector(int s) {
+  Sector &sector = sectors_[s];
+  if (flash_.erase(sector.address, sector.size) != 0) return false;
+  sector.erase_count++;
+  return write_sector_header(s);
+}
+
+// Format an erased sector as free
+bool TemplateStore::write_sector_header(int s) {
+  Sector &sector = sectors_[s];
+  Template_Sector_Header header = {TEMPLATE_SECTOR_MAGIC, sector.erase_count,
+                                   TEMPLATE_UNUSED, TEMPLATE_UNUSED};
+  if (flash_.program(&header, sector.address, sizeof(header)) != 0) {
+    return false;
+  }
+  sector.sequence = TEMPLATE_UNUSED;
+  sector.write_offset = SECTOR_HEADER_SIZE;
+  sector.garbage = 0;
+  if (head_ == s) head_ = -1;
+  return true;
+}
+
+// Whether every byte of a sector is erased
+bool TemplateStore::is_blank(int s, bool &blank) {
+  const Sector &sector = sectors_[s];
+  uint32_t chunk[64];
+  blank = true;
+  for (uint32_t done = 0; done < sector.size && blank; done += sizeof(chunk)) {
+    uint32_t n = std::min<uint32_t>(sizeof(chunk), sector.size - done);
+    if (flash_.read(chunk, sector.address + done, n) != 0) return false;
+    for (uint32_t i = 0; i < n / sizeof(chunk[0]); i++) {
+      blank = blank && chunk[i] == TEMPLATE_UNUSED;
+    }
+  }
+  return true;
+}
+
+// Make a free sector the head of the log
+bool TemplateStore::open_sector(int s) {
+  Sector &sector = sectors_[s];
+  if (next_sector_sequence_ >= SEQUENCE_LIMIT) return false;
+  uint32_t sequence = next_sector_sequence_++;
+  if (flash_.program(&sequence,
+                     sector.address + offsetof(Template_Sector_Header, sequence),
+                     sizeof(sequence)) != 0) {
+    return false;
+  }
+  sector.sequence = sequence;
+  head_ = s;
+  return true;
+}
+
+// The least worn free sector, -1 if none
+int TemplateStore::free_sector() const {
+  int best = -1;
+  for (int s = 0; s < TEMPLATE_STORE_SECTORS; s++) {
+    if (sectors_[s].sequence != TEMPLATE_UNUSED) continue;
+    if (best < 0 || sectors_[s].erase_count < sectors_[best].erase_count) {
+      best = s;
+    }
+  }
+  return best;
+}
+
+// The used sector furthest back in the log other than the head, -1 if none
+int TemplateStore::oldest_sector() const {
+  int oldest = -1;
+  for (int s = 0; s < TEMPLATE_STORE_SECTORS; s++) {
+    if (s == head_ || sectors_[s].sequence == TEMPLATE_UNUSED) continue;
+    if (oldest < 0 || sectors_[s].sequence < sectors_[oldest].sequence) {
+      oldest = s;
+    }
+  }
+  return oldest;
+}
+
+int TemplateStore::sector_of(uint32_t address) const {
+  for (int s = 0; s < TEMPLATE_STORE_SECTORS; s++) {
+    if (address >= sectors_[s].address &&
+        address < sectors_[s].address + sectors_[s].size) {
+      return s;
+    }
+  }
+  return -1;
+}
+
+uint32_t TemplateStore::free_sector_count() const {
+  uint32_t count = 0;
+  for (int s = 0; s < TEMPLATE_STORE_SECTORS; s++) {
+    if (sectors_[s].sequence == TEMPLATE_UNUSED) count++;
+  }
+  return count;
+}
@@ -0,0 +1,229 @@
+/**
+ * @file template_store.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Log-structured, wear-leveled gesture template store in internal
+ * flash.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * The store owns TEMPLATE_STORE_SECTORS flash sectors starting at
+ * TEMPLATE_STORE_ADDRESS. Every sector starts with a sector header (erase
+ * count and log sequence) followed by records appended back to back:
+ *
+ *   Template_Record_Header | payload | padding to 4 bytes
+ *
+ * A record is never modified in place. Writing a slot appends a new record,
+ * deleting it appends a tombstone, and the record with the highest sequence
+ * number decides the state of a slot. maintain() reclaims space in the
+ * background: once only the reserve sector is free, the oldest sector's
+ * live records are copied to the head of the log and the sector is erased.
+ * The log thus rotates through all sectors, and new sectors are opened in
+ * order of lowest erase count, which levels the wear.
+ *
+ * Internal flash is memory mapped, so acquire() hands out a template in
+ * place: a Template_View points at the payload in flash, and matching
+ * reads it from there without a copy in RAM. Sectors are not reclaimed
+ * while a view is held.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef TEMPLATE_STORE_H
+#define TEMPLATE_STORE_H
+
+#include "system_config.h"
+
+#define TEMPLATE_SECTOR_MAGIC 0x53544B47  // "GKTS"
+#define TEMPLATE_RECORD_MAGIC 0x52544B47  // "GKTR"
+#define TEMPLATE_FORMAT_VERSION 1
+#define TEMPLATE_UNUSED 0xFFFFFFFFu       // erased word
+
+// Record types
+#define TEMPLATE_RECORD_DATA 0x01
+#define TEMPLATE_RECORD_TOMBSTONE 0x02
+
+// Payload encodings
+#define TEMPLATE_ENCODING_FLOAT32 0x00  // array<float, 3> per sample
+#define TEMPLATE_ENCODING_DELTA 0x01    // template_codec.h
+
+// First bytes of every sector
+typedef struct {
+  uint32_t magic;        // TEMPLATE_SECTOR_MAGIC
+  uint32_t erase_count;  // erases of this sector so far
+  uint32_t sequence;     // position in the log, TEMPLATE_UNUSED while free
+  uint32_t reserved;
+} Template_Sector_Header;
+
+// First bytes of every record
+typedef struct {
+  uint32_t magic;           // TEMPLATE_RECORD_MAGIC
+  uint8_t version;          // TEMPLATE_FORMAT_VERSION
+  uint8_t type;             // TEMPLATE_RECORD_DATA or _TOMBSTONE
+  uint8_t slot;             // template slot, < TEMPLATE_SLOTS
+  uint8_t encoding;         // payload encoding
+  uint16_t length;          // payload bytes
+  uint16_t sample_rate_hz;  // rate of the samples in the payload
+  uint32_t sequence;        // store-wide write counter
+  uint16_t crc;             // CRC-16/CCITT of the fields above and payload
+  uint16_t reserved;
+} Template_Record_Header;
+
+// A template in place in memory-mapped flash, see TemplateStore::acquire()
+typedef struct {
+  const uint8_t *data;      // the payload
+  uint16_t length;          // payload bytes
+  uint8_t encoding;         // TEMPLATE_ENCODING_*
+  uint16_t sample_rate_hz;
+} Template_View;
+
+// Space and wear, for diagnostics and the host benchmark
+typedef struct {
+  uint32_t erase_count[TEMPLATE_STORE_SECTORS];
+  uint32_t free_sectors;
+  uint32_t live_bytes;     // bytes of records that still matter
+  uint32_t garbage_bytes;  // bytes of superseded or damaged records
+  uint32_t compactions;    // sectors reclaimed since mount
+  uint32_t corrupt_records;  // records with a bad CRC seen at mount
+} Template_Store_Stats;
+
+class TemplateStore {
+ public:
+  /**
+   * @brief Construct a store over a sector range (nothing is read yet)
+   * @param address: first byte of the first sector
+   */
+  explicit TemplateStore(uint32_t address = TEMPLATE_STORE_ADDRESS);
+
+  /**
+   * @brief Scan the sectors and rebuild the slot index
+   *
+   * Sectors without a valid header are formatted (erased first unless
+   * blank). Every record's CRC is checked, so a record cut short by a
+   * reset is skipped and its slot keeps its previous template, and a
+   * sector whose sequence was torn by a reset while it was being opened is
+   * reclaimed. The scan reads each used sector once, which bounds the time
+   * to boot.
+   *
+   * @return false if the flash cannot be accessed
+   */
+  bool mount();
+
+  /**
+   * @brief Erase every sector, losing all templates
+   */
+  bool format();
+
+  /**
+   * @brief Store a template in a slot, replacing what was there
+   *
+   * The template is stored in the encoding chosen with set_encoding().
+   *
+   * @param slot: the slot, < TEMPLATE_SLOTS
+   * @param samples: the template
+   * @param sample_rate_hz: the rate of the samples
+   * @return false if the slot is invalid, the template does not fit or the
+   *         flash failed
+   */
+  bool write(uint8_t slot, const vector<array<float, 3>> &samples,
+             uint16_t sample_rate_hz);
+
+  /**
+   * @brief Load the template of a slot
+   * @param slot: the slot
+   * @param samples: receives the template (replaced)
+   * @return false if the slot is empty
+   */
+  bool read(uint8_t slot, vector<array<float, 3>> &samples);
+
+  /**
+   * @brief Get the template of a slot in place, without copying it
+   *
+   * The view stays valid until release(): compaction is held off in the
+   * meantime, and writes that need space fail. Views are counted, so
+   * several may be held at once.
+   *
+   * @param slot: the slot
+   * @param view: receives the template
+   * @return false if the slot is empty (nothing to release)
+   */
+  bool acquire(uint8_t slot, Template_View &view);
+
+  /**
+   * @brief Give back a view obtained from acquire()
+   */
+  void release();
+
+  /**
+   * @brief Delete the template of a slot (appends a tombstone)
+   */
+  bool remove(uint8_t slot);
+
+  bool contains(uint8_t slot) const;
+
+  /**
+   * @brief Choose the encoding of future writes; read() handles both
+   * @param encoding: TEMPLATE_ENCODING_DELTA (TemplateEncode() at
+   *        TEMPLATE_QUANTUM, the default with TEMPLATE_COMPRESS) or
+   *        TEMPLATE_ENCODING_FLOAT32
+   */
+  void set_encoding(uint8_t encoding) { encoding_ = encoding; }
+
+  /**
+   * @brief Background maintenance: reclaim one sector if the store is down
+   * to its reserve
+   * @return true if a sector was reclaimed
+   */
+  bool maintain();
+
+  Template_Store_Stats stats() const;
+
+ private:
+  struct Sector {
+    uint32_t address;
+    uint32_t size;
+    uint32_t erase_count;
+    uint32_t sequence;     // TEMPLATE_UNUSED while free
+    uint32_t write_offset; // first unwritten byte
+    uint32_t garbage;      // bytes of records that no longer matter
+  };
+  struct Slot {
+    uint32_t address;   // record header address, 0 if never written
+    uint32_t sequence;
+    uint32_t size;      // record size including padding
+    uint8_t type;
+  };
+
+  bool scan_sector(int s);
+  bool erase_sector(int s);
+  bool write_sector_header(int s);
+  bool is_blank(int s, bool &blank);
+  bool open_sector(int s);
+  int free_sector() const;
+  int oldest_sector() const;
+  int sector_of(uint32_t address) const;
+  uint32_t free_sector_count() const;
+  bool append(uint8_t type, uint8_t slot, uint8_t encoding,
+              uint16_t sample_rate_hz, uint32_t sequence, const void *payload,
+              uint16_t length, bool compacting);
+  bool compact(int s);
+  void supersede(uint8_t slot);
+
+  FlashIAP flash_;
+  mutable Mutex mutex_;
+  bool mounted_;
+  uint8_t encoding_;  // encoding of new records
+  uint32_t views_;    // views held, compaction waits for zero
+  uint32_t address_;
+  Sector sectors_[TEMPLATE_STORE_SECTORS];
+  Slot slots_[TEMPLATE_SLOTS];
+  int head_;  // sector receiving appends, -1 if none is open
+  uint32_t next_record_sequence_;
+  uint32_t next_sector_sequence_;
+  uint32_t compactions_;
+  uint32_t corrupt_records_;
+};
+
+#endif  // TEMPLATE_STORE_H
@@ -0,0 +1,178 @@
+/**
+ * @file touch_input.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Interrupt-driven, debounced touch screen input.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "touch_input.h"
+
+#define TOUCH_IRQ_FLAG 0x01   // INT fell
+#define TOUCH_STOP_FLAG 0x02  // stop() was called
+
+static uint32_t now_ms() {
+  return (uint32_t)Kernel::Clock::now().time_since_epoch().count();
+}
+
+TouchDebouncer::TouchDebouncer()
+    : state_(IDLE), since_ms_(0), x_(0), y_(0), rejected_(0) {}
+
+/*******************************************************************************
+ *
+ * @brief IDLE -> PRESSING on contact; PRESSING -> PRESSED (a press) once it
+ * has lasted TOUCH_PRESS_MS, or back to IDLE (rejected) if it ends first;
+ * PRESSED -> RELEASING when it ends; RELEASING -> IDLE (a release) once it
+ * has been gone TOUCH_RELEASE_MS, or back to PRESSED if it returns first
+ *
+ * ****************************************************************************/
+bool TouchDebouncer::update(bool touched, uint16_t x, uint16_t y,
+                            uint32_t now_ms, Touch_Event &event) {
+  if (touched) {
+    x_ = x;
+    y_ = y;
+  }
+  switch (state_) {
+    case IDLE:
+      if (touched) {
+        state_ = PRESSING;
+        since_ms_ = now_ms;
+      }
+      return false;
+    case PRESSING:
+      if (!touched) {
+        state_ = IDLE;
+        rejected_++;
+        return false;
+      }
+      if (now_ms - since_ms_ < TOUCH_PRESS_MS) return false;
+      state_ = PRESSED;
+      event.type = TOUCH_PRESS;
+      break;
+    case PRESSED:
+      if (!touched) {
+        state_ = RELEASING;
+        since_ms_ = now_ms;
+      }
+      return false;
+    case RELEASING:
+      if (touched) {
+        state_ = PRESSED;
+        return false;
+      }
+      if (now_ms - since_ms_ < TOUCH_RELEASE_MS) return false;
+      state_ = IDLE;
+      event.type = TOUCH_RELEASE;
+      break;
+  }
+  event.x = x_;
+  event.y = y_;
+  event.at_ms = now_ms;
+  return true;
+}
+
+TouchInput::TouchInput(TS_DISCO_F429ZI &ts, Mutex &i2c_bus)
+    : ts_(ts),
+      i2c_bus_(i2c_bus),
+      irq_(TOUCH_INT_PIN, PullUp),
+      sampled_ms_(0),
+      interrupts_(0) {
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+/*******************************************************************************
+ *
+ * @brief Initialize the controller and its interrupt
+ *
+ * The BSP's ITConfig() sets up the pin as well (EXTI on the falling edge);
+ * the handler is attached after it, so mbed owns the vector.
+ *
+ * ****************************************************************************/
+bool TouchInput::init(uint16_t width, uint16_t height) {
+  ScopedLock<Mutex> bus(i2c_bus_);
+  if (ts_.Init(width, height) != TS_OK || ts_.ITConfig() != TS_OK) {
+    return false;
+  }
+  ts_.ITClear();
+  irq_.fall(callback(this, &TouchInput::interrupt));
+  // Pending since before the handler, it would never fall again
+  if (irq_.read() == 0) flags_.set(TOUCH_IRQ_FLAG);
+  return true;
+}
+
+// Interrupt context: only note it
+void TouchInput::interrupt() {
+  interrupts_.fetch_add(1, std::memory_order_relaxed);
+  flags_.set(TOUCH_IRQ_FLAG);
+}
+
+void TouchInput::stop() { flags_.set(TOUCH_STOP_FLAG); }
+
+Touch_Input_Stats TouchInput::stats() const {
+  ScopedLock<Mutex> lock(mutex_);
+  Touch_Input_Stats stats = stats_;
+  stats.interrupts = interrupts_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+/*******************************************************************************
+ *
+ * @brief Read the position and clear the interrupt, then feed the debouncer
+ *
+ * The period runs from the start of a sample: reading one at 100 kHz takes
+ * 2 to 3 ms.
+ *
+ * ****************************************************************************/
+bool TouchInput::sample(Touch_Event &event) {
+  TS_StateTypeDef state;
+  sampled_ms_ = now_ms();
+  i2c_bus_.lock();
+  ts_.GetState(&state);
+  if (ts_.ITGetStatus() != 0) ts_.ITClear();
+  i2c_bus_.unlock();
+  // Raised again between the read and the clear: no edge will tell
+  if (irq_.read() == 0) flags_.set(TOUCH_IRQ_FLAG);
+
+  bool confirmed = debouncer_.update(state.TouchDetected != 0, state.X,
+                                     state.Y, sampled_ms_, event);
+  ScopedLock<Mutex> lock(mutex_);
+  stats_.samples++;
+  stats_.rejected = debouncer_.rejected();
+  if (confirmed) {
+    stats_.presses += event.type == TOUCH_PRESS ? 1 : 0;
+    stats_.releases += event.type == TOUCH_RELEASE ? 1 : 0;
+  }
+  return confirmed;
+}
+
+/*******************************************************************************
+ *
+ * @brief Sleep until the controller interrupts; while a finger is down,
+ * sample every TOUCH_POLL_MS instead, its interrupts being only new samples,
+ * and every TOUCH_HELD_POLL_MS once it has pressed, watching for the lift
+ *
+ * ****************************************************************************/
+bool TouchInput::wait(Touch_Event &event) {
+  while (true) {
+    uint32_t flags;
+    if (debouncer_.idle()) {
+      flags = flags_.wait_any(TOUCH_IRQ_FLAG | TOUCH_STOP_FLAG);
+    } else {
+      uint32_t period = debouncer_.held() ? TOUCH_HELD_POLL_MS : TOUCH_POLL_MS;
+      uint32_t elapsed = now_ms() - sampled_ms_;
+      uint32_t rest = elapsed < period ? period - elapsed : 0;
+      flags = flags_.wait_any_for(TOUCH_STOP_FLAG,
+                                  Kernel::Clock::duration_u32(rest));
+      if (flags & osFlagsError) flags = 0;  // the period is up
+      flags_.clear(TOUCH_IRQ_FLAG);
+    }
+    if (flags & TOUCH_STOP_FLAG) return false;
+    if (sample(event)) return true;
+  }
+}
@@ -0,0 +1,137 @@
+/**
+ * @file touch_input.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Interrupt-driven touch screen input: presses and releases,
+ * debounced, as soon as they are sure.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * The touch thread used to read the STMPE811 over I2C every 10 ms forever,
+ * and slept a second after a hit before raising the flag. Now the
+ * controller's interrupt (TS_DISCO_F429ZI::ITConfig(), INT on
+ * TOUCH_INT_PIN) wakes it: while no finger is down the thread sleeps and
+ * the bus is left to the EEPROM. Once one is, it samples every
+ * TOUCH_POLL_MS until the press is sure, then every TOUCH_HELD_POLL_MS
+ * until it is lifted; the controller keeps interrupting meanwhile (a FIFO
+ * interrupt a sample), which is cleared, not followed.
+ *
+ * Samples go through a TouchDebouncer: a contact becomes a press once held
+ * for TOUCH_PRESS_MS and a release once gone for TOUCH_RELEASE_MS, so a
+ * bouncing finger gives one press and one release, and a brush shorter
+ * than TOUCH_PRESS_MS none (it counts as rejected). A press is reported at
+ * once, with the position of the sample that confirmed it; what it does is
+ * the caller's.
+ *
+ * INT is a level: the BSP clears the status with ITClear() after reading
+ * it, and if the line is still low then (a new interrupt in between), the
+ * thread goes round again rather than waiting for an edge that will not
+ * come.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef TOUCH_INPUT_H
+#define TOUCH_INPUT_H
+
+#include <atomic>
+
+#include "system_config.h"
+
+typedef enum {
+  TOUCH_PRESS,
+  TOUCH_RELEASE,
+} Touch_Event_Type;
+
+typedef struct {
+  Touch_Event_Type type;
+  uint16_t x;         // where it was pressed, or last touched
+  uint16_t y;
+  uint32_t at_ms;     // Kernel::Clock time it was sure
+} Touch_Event;
+
+typedef struct {
+  uint32_t interrupts;  // falling edges of INT
+  uint32_t samples;     // positions read over I2C
+  uint32_t presses;
+  uint32_t releases;
+  uint32_t rejected;    // contacts too short to be a press
+} Touch_Input_Stats;
+
+// The press and release state machine, fed one sample at a time
+class TouchDebouncer {
+ public:
+  TouchDebouncer();
+
+  /**
+   * @brief Take a sample
+   * @param touched, x, y: the sample
+   * @param now_ms: when it was read
+   * @param event: set if the sample confirms a press or a release
+   * @return whether it did
+   */
+  bool update(bool touched, uint16_t x, uint16_t y, uint32_t now_ms,
+              Touch_Event &event);
+
+  // No finger down nor being debounced: nothing to sample for
+  bool idle() const { return state_ == IDLE; }
+  // Pressed and still down
+  bool held() const { return state_ == PRESSED; }
+  uint32_t rejected() const { return rejected_; }
+
+ private:
+  enum State { IDLE, PRESSING, PRESSED, RELEASING };
+
+  State state_;
+  uint32_t since_ms_;  // the contact, or its absence, started
+  uint16_t x_;
+  uint16_t y_;
+  uint32_t rejected_;
+};
+
+class TouchInput {
+ public:
+  /**
+   * @param ts: the touch screen
+   * @param i2c_bus: the lock of the bus it shares
+   */
+  TouchInput(TS_DISCO_F429ZI &ts, Mutex &i2c_bus);
+
+  /**
+   * @brief Initialize the controller and enable its interrupt
+   * @return false if it does not answer
+   */
+  bool init(uint16_t width, uint16_t height);
+
+  /**
+   * @brief Wait for the next press or release
+   * @return false once stop() is called
+   */
+  bool wait(Touch_Event &event);
+
+  /**
+   * @brief Make wait() return false, from another thread
+   */
+  void stop();
+
+  Touch_Input_Stats stats() const;
+
+ private:
+  void interrupt();
+  bool sample(Touch_Event &event);
+
+  TS_DISCO_F429ZI &ts_;
+  Mutex &i2c_bus_;
+  InterruptIn irq_;
+  EventFlags flags_;
+  TouchDebouncer debouncer_;
+  uint32_t sampled_ms_;  // the last sample started
+  std::atomic<uint32_t> interrupts_;  // counted by the interrupt
+
+  mutable Mutex mutex_;  // stats_
+  Touch_Input_Stats stats_;
+};
+
+#endif  // TOUCH_INPUT_H
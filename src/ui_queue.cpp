@@ -0,0 +1,79 @@
+/**
+ * @file ui_queue.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief Lock-free queue of render commands from any thread to the UI
+ * thread.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "ui_queue.h"
+
+static_assert((UI_QUEUE_DEPTH & (UI_QUEUE_DEPTH - 1)) == 0,
+              "UI_QUEUE_DEPTH has to be a power of two");
+
+UiQueue::UiQueue() : tail_(0), head_(0), pushed_(0), rejected_(0), popped_(0) {
+  for (uint32_t i = 0; i < UI_QUEUE_DEPTH; i++) {
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+/*******************************************************************************
+ *
+ * @brief Claim the tail position if its cell is free, copy, publish
+ *
+ * A cell is free for position p when its sequence is p; it is still
+ * waiting for the consumer from the lap before when the sequence is lower.
+ *
+ * ****************************************************************************/
+bool UiQueue::push(const Ui_Command &command) {
+  uint32_t position = tail_.load(std::memory_order_relaxed);
+  Cell *cell;
+  while (true) {
+    cell = &cells_[position & (UI_QUEUE_DEPTH - 1)];
+    uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+    int32_t lag = (int32_t)(sequence - position);
+    if (lag == 0) {
+      // On failure position is reloaded with the tail another producer set
+      if (tail_.compare_exchange_weak(position, position + 1,
+                                      std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (lag < 0) {
+      rejected_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      position = tail_.load(std::memory_order_relaxed);
+    }
+  }
+  cell->command = command;
+  cell->sequence.store(position + 1, std::memory_order_release);
+  pushed_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool UiQueue::pop(Ui_Command &command) {
+  Cell &cell = cells_[head_ & (UI_QUEUE_DEPTH - 1)];
+  if (cell.sequence.load(std::memory_order_acquire) != head_ + 1) {
+    return false;
+  }
+  command = cell.command;
+  cell.sequence.store(head_ + UI_QUEUE_DEPTH, std::memory_order_release);
+  head_++;
+  popped_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+Ui_Queue_Stats UiQueue::stats() const {
+  Ui_Queue_Stats stats;
+  stats.pushed = pushed_.load(std::memory_order_relaxed);
+  stats.rejected = rejected_.load(std::memory_order_relaxed);
+  stats.popped = popped_.load(std::memory_order_relaxed);
+  return stats;
+}
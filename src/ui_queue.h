@@ -0,0 +1,97 @@
+/**
+ * @file ui_queue.h
+ * @author Xhovani Mali (xxm202)
+ * @brief Lock-free queue of render commands from any thread to the UI
+ * thread.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * A bounded ring of UI_QUEUE_DEPTH commands, many producers and one
+ * consumer. Each cell carries a sequence number: a producer claims the
+ * next position with one compare-and-swap on the tail, copies its command
+ * into the cell and publishes it by advancing the cell's sequence; the
+ * consumer takes a cell once its sequence says it is published, and hands
+ * it back to the producers a lap later. Nothing is locked, so push() never
+ * waits, whatever the consumer or another producer is doing, and may be
+ * called from an interrupt. A full queue refuses the command instead
+ * (push() returns false).
+ *
+ * Commands come out in the order their producers claimed positions, so the
+ * commands of one producer stay in order. A producer preempted between the
+ * claim and the publish holds up the commands after its own until it
+ * resumes; pop() then reports the queue empty.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef UI_QUEUE_H
+#define UI_QUEUE_H
+
+#include <atomic>
+
+#include "system_config.h"
+
+// What a command changes
+typedef enum {
+  UI_COMMAND_STATUS,    // the status line: text and color
+  UI_COMMAND_LEDS,      // the green and red LEDs
+  UI_COMMAND_PROGRESS,  // the progress bar
+  UI_COMMAND_KINDS,     // the number of kinds above
+} Ui_Command_Type;
+
+#define UI_LED_GREEN 0x01
+#define UI_LED_RED 0x02
+#define UI_PROGRESS_HIDDEN 0xFFFF  // progress that hides the bar
+
+// One render command, 32 bytes
+typedef struct {
+  uint8_t type;       // Ui_Command_Type
+  uint8_t leds;       // UI_COMMAND_LEDS: UI_LED_ bits of the LEDs lit
+  uint16_t progress;  // UI_COMMAND_PROGRESS: per mille, or UI_PROGRESS_HIDDEN
+  uint32_t color;     // UI_COMMAND_STATUS: text color ARGB(8-8-8-8)
+  char text[UI_STATUS_TEXT];  // UI_COMMAND_STATUS: NUL-terminated
+} Ui_Command;
+
+// Queue activity, for diagnostics and the host benchmark
+typedef struct {
+  uint32_t pushed;    // commands accepted
+  uint32_t rejected;  // commands refused, the queue was full
+  uint32_t popped;    // commands taken by the consumer
+} Ui_Queue_Stats;
+
+class UiQueue {
+ public:
+  UiQueue();
+
+  /**
+   * @brief Add a command; any thread or interrupt, never blocks
+   * @return false if the queue is full
+   */
+  bool push(const Ui_Command &command);
+
+  /**
+   * @brief Take the oldest published command; the consumer only
+   * @return false if there is none
+   */
+  bool pop(Ui_Command &command);
+
+  Ui_Queue_Stats stats() const;
+
+ private:
+  struct Cell {
+    std::atomic<uint32_t> sequence;  // position + 1 once published
+    Ui_Command command;
+  };
+
+  Cell cells_[UI_QUEUE_DEPTH];
+  std::atomic<uint32_t> tail_;  // next position to claim
+  uint32_t head_;               // next position to take, the consumer's
+  std::atomic<uint32_t> pushed_;
+  std::atomic<uint32_t> rejected_;
+  std::atomic<uint32_t> popped_;
+};
+
+#endif  // UI_QUEUE_H
@@ -0,0 +1,306 @@
+/**
+ * @file ui_renderer.cpp
+ * @author Xhovani Mali (xxm202)
+ * @brief The UI thread, drawing the commands the other threads queue.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#include "ui_renderer.h"
+
+#include <cstring>
+
+#include "profiler.h"
+
+#define UI_WAKE_FLAG 0x01  // commands were queued
+#define UI_STOP_FLAG 0x02  // the destructor is waiting
+
+#define UI_PROGRESS_TRACK LCD_COLOR_DARKGRAY
+#define UI_PROGRESS_BAR LCD_COLOR_ORANGE
+#define UI_PROGRESS_BACKGROUND LCD_COLOR_BLACK
+
+UiRenderer::UiRenderer(LCD_DISCO_F429ZI &lcd, FrameBuffers &buffers,
+                       StatusLine &line, DigitalOut &green, DigitalOut &red)
+    : lcd_(lcd),
+      buffers_(buffers),
+      line_(line),
+      green_(green),
+      red_(red),
+      overflowed_(0),
+      thread_(osPriorityBelowNormal, sizeof(stack_), stack_, "ui"),
+      started_(false),
+      status_shown_(false),
+      leds_set_(false),
+      leds_(0),
+      progress_(UI_PROGRESS_HIDDEN) {
+  memset(&status_, 0, sizeof(status_));
+  memset(&stats_, 0, sizeof(stats_));
+  for (Latest &latest : latest_) {
+    latest.waiting.store(false, std::memory_order_relaxed);
+    latest.version.store(0, std::memory_order_relaxed);
+    for (auto &word : latest.words) word.store(0, std::memory_order_relaxed);
+  }
+}
+
+UiRenderer::~UiRenderer() {
+  if (started_) {
+    flags_.set(UI_STOP_FLAG);
+    thread_.join();
+  }
+}
+
+void UiRenderer::start() {
+  if (started_) return;
+  started_ = true;
+  thread_.start(callback(this, &UiRenderer::run));
+}
+
+/*******************************************************************************
+ *
+ * @brief Queue a command, or keep it in the slot of its kind
+ *
+ * While a slot holds a command not taken yet, the newer commands of its
+ * kind go to the slot as well: one queued now would be drawn before it.
+ *
+ * ****************************************************************************/
+bool UiRenderer::post(const Ui_Command &command) {
+  bool kind = command.type < UI_COMMAND_KINDS;
+  if (kind && latest_[command.type].waiting.load(std::memory_order_acquire)) {
+    hold(command);
+  } else if (!queue_.push(command)) {
+    if (!kind) return false;
+    hold(command);
+  }
+  flags_.set(UI_WAKE_FLAG);
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * @brief Write a command to the slot of its kind
+ *
+ * A producer that finds another one writing the slot leaves it: the two
+ * posts overlap, so the other's command may count as the later one.
+ *
+ * ****************************************************************************/
+void UiRenderer::hold(const Ui_Command &command) {
+  Latest &latest = latest_[command.type];
+  overflowed_.fetch_add(1, std::memory_order_relaxed);
+  uint32_t version = latest.version.load(std::memory_order_relaxed);
+  if ((version & 1) != 0 ||
+      !latest.version.compare_exchange_strong(version, version + 1,
+                                              std::memory_order_relaxed)) {
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+
+  uint32_t words[sizeof(Ui_Command) / 4];
+  memcpy(words, &command, sizeof(words));
+  for (size_t i = 0; i < sizeof(words) / 4; i++) {
+    latest.words[i].store(words[i], std::memory_order_relaxed);
+  }
+  latest.version.store(version + 2, std::memory_order_release);
+  latest.waiting.store(true, std::memory_order_release);
+}
+
+/*******************************************************************************
+ *
+ * @brief Take the command waiting in a slot; the UI thread only
+ * @return false if there is none, or a producer was writing it (and will
+ *         wake the UI thread again)
+ *
+ * ****************************************************************************/
+bool UiRenderer::take(uint8_t type, Ui_Command &command) {
+  Latest &latest = latest_[type];
+  if (!latest.waiting.exchange(false, std::memory_order_acquire)) return false;
+
+  uint32_t version = latest.version.load(std::memory_order_acquire);
+  uint32_t words[sizeof(Ui_Command) / 4];
+  for (size_t i = 0; i < sizeof(words) / 4; i++) {
+    words[i] = latest.words[i].load(std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if ((version & 1) != 0 ||
+      latest.version.load(std::memory_order_relaxed) != version) {
+    return false;
+  }
+  memcpy(&command, words, sizeof(command));
+  return true;
+}
+
+bool UiRenderer::status(const char *text, uint32_t color) {
+  Ui_Command command;
+  memset(&command, 0, sizeof(command));
+  command.type = UI_COMMAND_STATUS;
+  command.color = color;
+  strncpy(command.text, text, sizeof(command.text) - 1);
+  return post(command);
+}
+
+bool UiRenderer::leds(uint8_t leds) {
+  Ui_Command command;
+  memset(&command, 0, sizeof(command));
+  command.type = UI_COMMAND_LEDS;
+  command.leds = leds;
+  return post(command);
+}
+
+bool UiRenderer::progress(uint16_t per_mille) {
+  Ui_Command command;
+  memset(&command, 0, sizeof(command));
+  command.type = UI_COMMAND_PROGRESS;
+  command.progress = per_mille == UI_PROGRESS_HIDDEN
+                         ? per_mille
+                         : std::min<uint16_t>(per_mille, 1000);
+  return post(command);
+}
+
+Ui_Renderer_Stats UiRenderer::stats() const {
+  ScopedLock<Mutex> lock(mutex_);
+  Ui_Renderer_Stats stats = stats_;
+  stats.overflowed = overflowed_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+// The track and the filled part of the bar, or the background if hidden
+void UiRenderer::draw_progress(uint16_t per_mille) {
+  if (per_mille == UI_PROGRESS_HIDDEN) {
+    lcd_.SetTextColor(UI_PROGRESS_BACKGROUND);
+    lcd_.FillRect(UI_PROGRESS_X, UI_PROGRESS_Y, UI_PROGRESS_WIDTH,
+                  UI_PROGRESS_HEIGHT);
+    return;
+  }
+  uint16_t filled = (uint32_t)UI_PROGRESS_WIDTH * per_mille / 1000;
+  if (filled > 0) {
+    lcd_.SetTextColor(UI_PROGRESS_BAR);
+    lcd_.FillRect(UI_PROGRESS_X, UI_PROGRESS_Y, filled, UI_PROGRESS_HEIGHT);
+  }
+  if (filled < UI_PROGRESS_WIDTH) {
+    lcd_.SetTextColor(UI_PROGRESS_TRACK);
+    lcd_.FillRect(UI_PROGRESS_X + filled, UI_PROGRESS_Y,
+                  UI_PROGRESS_WIDTH - filled, UI_PROGRESS_HEIGHT);
+  }
+}
+
+/*******************************************************************************
+ *
+ * @brief Take every command queued, then the slots, keep the latest of
+ * each kind and draw what changed as one frame, then set the LEDs
+ *
+ * A slot is taken after the queue: what it holds is newer than every
+ * command of its kind queued before the slot was written.
+ *
+ * ****************************************************************************/
+size_t UiRenderer::render() {
+  Ui_Command command;
+  Ui_Command status;
+  bool new_status = false;
+  bool new_leds = false;
+  bool new_progress = false;
+  uint8_t leds = 0;
+  uint16_t progress = UI_PROGRESS_HIDDEN;
+  size_t taken = 0;
+  size_t coalesced = 0;
+  auto keep = [&](const Ui_Command &kept) {
+    taken++;
+    switch (kept.type) {
+      case UI_COMMAND_STATUS:
+        coalesced += new_status ? 1 : 0;
+        new_status = true;
+        status = kept;
+        break;
+      case UI_COMMAND_LEDS:
+        coalesced += new_leds ? 1 : 0;
+        new_leds = true;
+        leds = kept.leds;
+        break;
+      case UI_COMMAND_PROGRESS:
+        coalesced += new_progress ? 1 : 0;
+        new_progress = true;
+        progress = kept.progress;
+        break;
+      default:
+        coalesced++;
+        break;
+    }
+  };
+  while (queue_.pop(command)) keep(command);
+  for (uint8_t type = 0; type < UI_COMMAND_KINDS; type++) {
+    if (take(type, command)) keep(command);
+  }
+  if (taken == 0) return 0;
+
+  // What is on screen already is not drawn again
+  status.text[sizeof(status.text) - 1] = 0;
+  if (new_status && status_shown_ && status.color == status_.color &&
+      strcmp(status.text, status_.text) == 0) {
+    new_status = false;
+    coalesced++;
+  }
+  if (new_progress && progress == progress_) {
+    new_progress = false;
+    coalesced++;
+  }
+  if (new_leds && leds_set_ && leds == leds_) {
+    new_leds = false;
+    coalesced++;
+  }
+
+  uint32_t us = 0;
+  if (new_status || new_progress) {
+    PROFILE_SCOPE(PROFILE_LCD);
+    uint32_t start = ProfilerNow();
+    buffers_.begin();
+    if (new_status) {
+      line_.show(status.text, status.color);
+      buffers_.damage(0, line_.y(), lcd_.GetXSize(), lcd_.GetFont()->Height);
+      status_ = status;
+      status_shown_ = true;
+    }
+    if (new_progress) {
+      draw_progress(progress);
+      buffers_.damage(UI_PROGRESS_X, UI_PROGRESS_Y, UI_PROGRESS_WIDTH,
+                      UI_PROGRESS_HEIGHT);
+      progress_ = progress;
+    }
+    buffers_.present();
+    us = (ProfilerNow() - start) / ProfilerTicksPerUs();
+  }
+  if (new_leds) {
+    green_ = (leds & UI_LED_GREEN) ? 1 : 0;
+    red_ = (leds & UI_LED_RED) ? 1 : 0;
+    leds_ = leds;
+    leds_set_ = true;
+  }
+
+  ScopedLock<Mutex> lock(mutex_);
+  stats_.renders++;
+  stats_.commands += taken;
+  stats_.coalesced += coalesced;
+  if (new_status || new_progress) {
+    stats_.frames++;
+    stats_.last_us = us;
+    stats_.max_us = std::max(stats_.max_us, us);
+  }
+  return taken;
+}
+
+/*******************************************************************************
+ *
+ * @brief UI thread: render whenever commands are queued; on stop, render
+ * what is left and return
+ *
+ * ****************************************************************************/
+void UiRenderer::run() {
+  while (true) {
+    uint32_t flags = flags_.wait_any(UI_WAKE_FLAG | UI_STOP_FLAG);
+    render();
+    if (flags & UI_STOP_FLAG) return;
+  }
+}
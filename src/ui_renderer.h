@@ -0,0 +1,157 @@
+/**
+ * @file ui_renderer.h
+ * @author Xhovani Mali (xxm202)
+ * @brief The UI thread: the one owner of the status line, the progress bar
+ * and the LEDs, drawing what the other threads queue.
+ * @version 0.1
+ * @date 2024-12-15
+ *
+ * The gyroscope and touch screen threads used to draw the status line
+ * themselves: every update cost the acquisition path a frame (and a wait
+ * for the last flip), and the two threads raced on the LCD's text color.
+ * They now post commands instead (status(), leds(), progress()): a copy
+ * into a UiQueue and an event flag, which never blocks, from any thread or
+ * interrupt. Only the latest state of each kind matters, so a command that
+ * finds the queue full is not refused: it goes to a latest-value slot of
+ * its kind, overwriting what an earlier overflow left there, and the newer
+ * commands of that kind follow it until the UI thread has taken it.
+ *
+ * The UI thread, below the acquisition threads' priority, wakes on the
+ * flag and render()s: it takes every command queued, then the slots, and
+ * keeps only the latest of each kind, so a burst of updates is drawn once
+ * (the ones overtaken count as coalesced, as does a command that changes
+ * nothing on screen). The status line and progress bar are drawn as one
+ * frame through FrameBuffers; the LEDs are set after it, so they change
+ * with the screen.
+ *
+ * The rate plot stays with the acquisition loop (see rate_plot.h): its
+ * frames never wait for the display.
+ *
+ * @group Members:
+ * - Xhovani Mali
+ * - Shruti Pangare
+ * - Temira Koenig
+ */
+
+#ifndef UI_RENDERER_H
+#define UI_RENDERER_H
+
+#include <atomic>
+
+#include "frame_buffers.h"
+#include "status_line.h"
+#include "system_config.h"
+#include "ui_queue.h"
+
+// What the UI thread did
+typedef struct {
+  uint32_t renders;     // render() calls that found commands
+  uint32_t commands;    // commands taken from the queue and the slots
+  uint32_t coalesced;   // of those, overtaken or changing nothing
+  uint32_t overflowed;  // commands posted to a slot, the queue was full
+  uint32_t frames;      // frames drawn
+  uint32_t last_us;     // time of the last frame
+  uint32_t max_us;      // and of the longest one
+} Ui_Renderer_Stats;
+
+class UiRenderer {
+ public:
+  /**
+   * @param lcd: the display
+   * @param buffers: the display's frame buffers
+   * @param line: the status line
+   * @param green, red: the status LEDs
+   */
+  UiRenderer(LCD_DISCO_F429ZI &lcd, FrameBuffers &buffers, StatusLine &line,
+             DigitalOut &green, DigitalOut &red);
+
+  /**
+   * @brief Draws what is still queued, then stops the thread
+   */
+  ~UiRenderer();
+
+  /**
+   * @brief Start the UI thread
+   */
+  void start();
+
+  /**
+   * @brief Queue a status line text (truncated to UI_STATUS_TEXT - 1
+   * characters) in a color; never refused
+   */
+  bool status(const char *text, uint32_t color);
+
+  /**
+   * @brief Queue the LEDs to light, UI_LED_GREEN and UI_LED_RED bits;
+   * never refused
+   */
+  bool leds(uint8_t leds);
+
+  /**
+   * @brief Queue the progress bar, in per mille, UI_PROGRESS_HIDDEN hides
+   * it; never refused
+   */
+  bool progress(uint16_t per_mille);
+
+  /**
+   * @brief Queue a command, or keep it in the slot of its kind
+   * @return false if the command is of no kind and the queue is full
+   */
+  bool post(const Ui_Command &command);
+
+  /**
+   * @brief Take the commands queued and draw the latest state; the UI
+   * thread's loop, or the caller's without start()
+   * @return the commands taken
+   */
+  size_t render();
+
+  Ui_Renderer_Stats stats() const;
+  Ui_Queue_Stats queue_stats() const { return queue_.stats(); }
+
+  /**
+   * @brief The stack of the UI thread, to paint before start() (see
+   * memory_report.h)
+   */
+  unsigned char *stack() { return stack_; }
+  size_t stack_size() const { return sizeof(stack_); }
+
+ private:
+  // The latest command of a kind that found the queue full, written by
+  // the producers and read by the UI thread under a sequence count
+  struct Latest {
+    std::atomic<bool> waiting;      // holds a command not taken yet
+    std::atomic<uint32_t> version;  // odd while a producer writes
+    std::atomic<uint32_t> words[sizeof(Ui_Command) / 4];
+  };
+
+  void run();
+  void hold(const Ui_Command &command);
+  bool take(uint8_t type, Ui_Command &command);
+  void draw_progress(uint16_t per_mille);
+
+  LCD_DISCO_F429ZI &lcd_;
+  FrameBuffers &buffers_;
+  StatusLine &line_;
+  DigitalOut &green_;
+  DigitalOut &red_;
+  UiQueue queue_;
+  Latest latest_[UI_COMMAND_KINDS];
+  std::atomic<uint32_t> overflowed_;
+  EventFlags flags_;
+  MBED_ALIGN(8) unsigned char stack_[UI_STACK_SIZE];
+  Thread thread_;
+  bool started_;
+
+  // What the screen and LEDs show, the UI thread's
+  bool status_shown_;
+  Ui_Command status_;
+  bool leds_set_;
+  uint8_t leds_;
+  uint16_t progress_;
+
+  mutable Mutex mutex_;  // stats_
+  Ui_Renderer_Stats stats_;
+};
+
+#endif  // UI_RENDERER_H
@@ -20,18 +20,19 @@ array<float, 3> calculateCorrelationVectors(vector<array<float, 3>> &vec1,
   array<float, 3> result;
 
   // Debug: Print sizes before checking for equality
-  printf("Size of vec1: %zu, Size of vec2: %zu\n", vec1.size(), vec2.size());
+  trace_printf("Size of vec1: %zu, Size of vec2: %zu\n", vec1.size(),
+               vec2.size());
 
   // Ensure both vectors are of the same size
   if (vec1.size() != vec2.size()) {
-    printf("Error: Vectors have different sizes before resizing!\n");
+    trace_printf("Error: Vectors have different sizes before resizing!\n");
 
     // Optionally, trim both vectors to the minimum size
     size_t min_size = std::min(vec1.size(), vec2.size());
     vec1.resize(min_size);
     vec2.resize(min_size);
 
-    printf(
+    trace_printf(
         "Size of vec1 after resizing: %zu, Size of vec2 after resizing: %zu\n",
         vec1.size(), vec2.size());
   }
@@ -74,39 +75,31 @@ float correlation(const vector<float> &a, const vector<float> &b) {
                                                      // code
   }
 
+  CorrelationAccumulator accumulator;
+  for (size_t i = 0; i < a.size(); ++i) accumulator.add(a[i], b[i]);
+  return accumulator.result();
+}
+
+/*******************************************************************************
+ *
+ * @brief The correlation of the pairs added so far
+ * @return NaN if all values were zero or one side has no spread
+ *
+ * ****************************************************************************/
+float CorrelationAccumulator::result() const {
   // Check if vectors are too small or have too much zero data
-  bool has_variation = false;
-  for (size_t i = 0; i < a.size(); ++i) {
-    if (a[i] != 0.0f || b[i] != 0.0f) {
-      has_variation = true;
-      break;
-    }
-  }
-  if (!has_variation) {
-    printf("Insufficient variation in data.\n");
+  if (!has_variation_) {
+    trace_printf("Insufficient variation in data.\n");
     return std::numeric_limits<float>::quiet_NaN();  // Return NaN for
                                                      // insufficient data
   }
 
-  float sum_a = 0, sum_b = 0, sum_ab = 0, sq_sum_a = 0, sq_sum_b = 0;
-
-  // Use Kahan summation for more stable summation
-  for (size_t i = 0; i < a.size(); ++i) {
-    float delta_a = a[i] - sum_a;
-    float delta_b = b[i] - sum_b;
-    sum_a += delta_a;
-    sum_b += delta_b;
-    sum_ab += delta_a * delta_b;
-    sq_sum_a += a[i] * a[i];
-    sq_sum_b += b[i] * b[i];
-  }
-
-  size_t n = a.size();  // Number of elements
+  size_t n = n_;  // Number of elements
 
-  float numerator = sum_ab - (sum_a * sum_b / n);  // Covariance
+  float numerator = sum_ab_ - (sum_a_ * sum_b_ / n);  // Covariance
   float denominator =
-      sqrt((sq_sum_a - sum_a * sum_a / n) *
-           (sq_sum_b - sum_b * sum_b / n));  // Standard deviation
+      sqrt((sq_sum_a_ - sum_a_ * sum_a_ / n) *
+           (sq_sum_b_ - sum_b_ * sum_b_ / n));  // Standard deviation
 
   // Handle division by zero
   if (denominator == 0.0f) {
@@ -122,14 +115,15 @@ float correlation(const vector<float> &a, const vector<float> &b) {
  * @param data: the gyro data to trim
  *
  * ****************************************************************************/
-void trim_gyro_data(vector<array<float, 3>> &data) {
+template <typename Allocator>
+void trim_gyro_data(vector<array<float, 3>, Allocator> &data) {
   float threshold = 0.00001;
   auto ptr = data.begin();
 
   // find the first element where data from any one direction is larger than the
   // threshold
-  while (abs((*ptr)[0]) <= threshold && abs((*ptr)[1]) <= threshold &&
-         abs((*ptr)[2]) <= threshold) {
+  while (ptr != data.end() && abs((*ptr)[0]) <= threshold &&
+         abs((*ptr)[1]) <= threshold && abs((*ptr)[2]) <= threshold) {
     ptr++;
   }
   if (ptr == data.end()) return;  // all data less than threshold
@@ -155,33 +149,30 @@ void trim_gyro_data(vector<array<float, 3>> &data) {
   }
 
   // Debug: Print the sizes of both vectors after trimming
-  printf("Data after trimming, size: %zu\n", data.size());
+  trace_printf("Data after trimming, size: %zu\n", data.size());
 }
 
+template void trim_gyro_data(vector<array<float, 3>> &data);
+template void trim_gyro_data(ArenaSamples &data);
+
 /*******************************************************************************
  *
  * @brief Calculate the DTW distance between two vectors
  * @param s: the first vectorS
  * @param t: the second vector
+ * @param scratch: optional arena for the matrix
  * @return the DTW distance between the two vectors
  *
  * ****************************************************************************/
-float dtw(const vector<array<float, 3>> &s, const vector<array<float, 3>> &t) {
-  vector<vector<float>> dtw_matrix(
-      s.size() + 1,
-      vector<float>(t.size() + 1, numeric_limits<float>::infinity()));
-
-  dtw_matrix[0][0] = 0;
-
-  for (size_t i = 1; i <= s.size(); ++i) {
-    for (size_t j = 1; j <= t.size(); ++j) {
-      float cost = euclidean_distance(s[i - 1], t[j - 1]);
-      dtw_matrix[i][j] = cost + min({dtw_matrix[i - 1][j], dtw_matrix[i][j - 1],
-                                     dtw_matrix[i - 1][j - 1]});
-    }
-  }
-
-  return dtw_matrix[s.size()][t.size()];
+float dtw(const vector<array<float, 3>> &s, const vector<array<float, 3>> &t,
+          Arena *scratch) {
+  size_t i = 0;
+  return dtw_stream(
+      [&](array<float, 3> &sample) {
+        sample = s[i++];
+        return true;
+      },
+      s.size(), t.data(), t.size(), scratch);
 }
 
 /*******************************************************************************
@@ -202,53 +193,34 @@ float euclidean_distance(const array<float, 3> &a, const array<float, 3> &b) {
 
 /*******************************************************************************
  *
- * @brief store data to flash
- * @param gesture_key: the data to store
- * @param flash_address: the address of the flash to store
- * @return true if the data is stored successfully, false otherwise
+ * @brief Scale every sample to unit length
+ * @param data: the gyro data to normalize in place
  *
  * ****************************************************************************/
-bool storeGyroDataToFlash(vector<array<float, 3>> &gesture_key,
-                          uint32_t flash_address) {
-  FlashIAP flash;
-  flash.init();
-
-  // Calculate the total size of the data to be stored in bytes
-  uint32_t data_size = gesture_key.size() * sizeof(array<float, 3>);
-
-  // Erase the flash sector
-  flash.erase(flash_address, data_size);
-
-  // Write the data to flash
-  int write_result =
-      flash.program(gesture_key.data(), flash_address, data_size);
-
-  flash.deinit();
-
-  return write_result == 0;
+void normalize(vector<array<float, 3>> &data) {
+  for (auto &point : data) normalize_sample(point);
 }
 
 /*******************************************************************************
  *
- * @brief read data from flash
- * @param flash_address: the address of the flash to read
- * @param data_size: the size of the data to read in bytes
- * @return a vector of array<float, 3> containing the data
+ * @brief Moving average over the last WINDOW_SIZE values
+ * @param new_value: the value to add
+ * @param buffer: the window
+ * @param index: the next slot of the window to overwrite
+ * @param sum: running sum of the window
+ * @return the average of the window
  *
  * ****************************************************************************/
-vector<array<float, 3>> readGyroDataFromFlash(uint32_t flash_address,
-                                              size_t data_size) {
-  vector<array<float, 3>> gesture_key(data_size);
-
-  FlashIAP flash;
-  flash.init();
-
-  // Read the data from flash
-  flash.read(gesture_key.data(), flash_address,
-             data_size * sizeof(array<float, 3>));
-
-  flash.deinit();
-
-  return gesture_key;
+float movingAverageFilter(float new_value, array<float, WINDOW_SIZE> &buffer,
+                          size_t &index, float &sum) {
+  // Subtract the old value from the sum and add the new value
+  sum -= buffer[index];
+  buffer[index] = new_value;
+  sum += new_value;
+
+  // Move the index in the buffer
+  index = (index + 1) % WINDOW_SIZE;
+
+  // Return the average
+  return sum / WINDOW_SIZE;
 }
-
@@ -16,6 +16,9 @@
 #define UTILITIES_H
 
 // Include system configuration header
+#include <algorithm>
+
+#include "arena.h"
 #include "system_config.h"
 
 #define WINDOW_SIZE 5  // The size of the moving average window
@@ -39,19 +42,85 @@ array<float, 3> calculateCorrelationVectors(vector<array<float, 3>> &vec1,
  */
 float correlation(const vector<float> &a, const vector<float> &b);
 
+/**
+ * @brief The running sums behind correlation(), fed one pair at a time so
+ * a stream (e.g. a template decoded on the fly) can be correlated without
+ * first being copied into a vector
+ */
+class CorrelationAccumulator {
+ public:
+  CorrelationAccumulator()
+      : sum_a_(0), sum_b_(0), sum_ab_(0), sq_sum_a_(0), sq_sum_b_(0), n_(0),
+        has_variation_(false) {}
+
+  void add(float a, float b) {
+    if (a != 0.0f || b != 0.0f) has_variation_ = true;
+    // Use Kahan summation for more stable summation
+    float delta_a = a - sum_a_;
+    float delta_b = b - sum_b_;
+    sum_a_ += delta_a;
+    sum_b_ += delta_b;
+    sum_ab_ += delta_a * delta_b;
+    sq_sum_a_ += a * a;
+    sq_sum_b_ += b * b;
+    n_++;
+  }
+
+  /**
+   * @brief add() with the a side computed ahead of time (see
+   * TemplateFeatures): only b is accumulated here
+   * @param delta_a: the step add() would compute for a
+   * @param b: the b value
+   */
+  void add_b(float delta_a, float b) {
+    if (b != 0.0f) has_variation_ = true;
+    float delta_b = b - sum_b_;
+    sum_b_ += delta_b;
+    sum_ab_ += delta_a * delta_b;
+    sq_sum_b_ += b * b;
+    n_++;
+  }
+
+  /**
+   * @brief Supply the a side's sums after the pairs fed with add_b()
+   * @param sum_a: its running sum
+   * @param sq_sum_a: its sum of squares
+   * @param a_varies: whether any of its values was non-zero
+   */
+  void set_a(float sum_a, float sq_sum_a, bool a_varies) {
+    sum_a_ = sum_a;
+    sq_sum_a_ = sq_sum_a;
+    if (a_varies) has_variation_ = true;
+  }
+
+  /**
+   * @brief The correlation of the pairs added so far
+   * @return NaN if all values were zero or one side has no spread
+   */
+  float result() const;
+
+ private:
+  float sum_a_, sum_b_, sum_ab_, sq_sum_a_, sq_sum_b_;
+  size_t n_;
+  bool has_variation_;
+};
+
 /**
  * @brief Trim the gyro data based on a threshold
- * @param data: the gyro data to trim
+ * @param data: the gyro data to trim, a heap or an ArenaSamples vector
  */
-void trim_gyro_data(vector<array<float, 3>> &data);
+template <typename Allocator>
+void trim_gyro_data(vector<array<float, 3>, Allocator> &data);
 
 /**
  * @brief Calculate the Dynamic Time Warping (DTW) distance between two vectors
  * @param s: the first vector
  * @param t: the second vector
+ * @param scratch: optional arena for the matrix, rewound on return
  * @return the DTW distance between the two vectors
  */
-float dtw(const vector<array<float, 3>> &s, const vector<array<float, 3>> &t);
+float dtw(const vector<array<float, 3>> &s, const vector<array<float, 3>> &t,
+          Arena *scratch = nullptr);
 
 /**
  * @brief Calculate the Euclidean distance between two vectors
@@ -62,21 +131,81 @@ float dtw(const vector<array<float, 3>> &s, const vector<array<float, 3>> &t);
 float euclidean_distance(const array<float, 3> &a, const array<float, 3> &b);
 
 /**
- * @brief Read gyro data from flash memory
- * @param flash_address: the flash address to read from
- * @param data_size: the size of the data to read
- * @return a vector containing the gyro data read from flash
+ * @brief dtw() with the first sequence read one sample at a time, in order
+ *
+ * Each row of the DTW matrix needs one sample of s, so s can be a template
+ * decoded on the fly or read in place from flash.
+ *
+ * @param next_s: callable `bool(array<float, 3> &)` giving the next sample
+ *        of s, false if it has none
+ * @param s_size: the length of s
+ * @param t: the second sequence
+ * @param t_size: its length
+ * @param scratch: optional arena for the matrix, rewound on return; the
+ *        heap is used if it is null or full
+ * @return the DTW distance, NaN if s ended early
+ */
+template <typename NextSample>
+float dtw_stream(NextSample next_s, size_t s_size, const array<float, 3> *t,
+                 size_t t_size, Arena *scratch = nullptr) {
+  // One block for the whole matrix, row by row
+  size_t columns = t_size + 1;
+  size_t cells = (s_size + 1) * columns;
+  ArenaScope scope(scratch);
+  vector<float> heap;
+  float *dtw_matrix =
+      scratch != nullptr ? scratch->allocate_array<float>(cells) : nullptr;
+  if (dtw_matrix == nullptr) {
+    heap.resize(cells);
+    dtw_matrix = heap.data();
+  }
+  std::fill(dtw_matrix, dtw_matrix + cells, numeric_limits<float>::infinity());
+
+  dtw_matrix[0] = 0;
+
+  for (size_t i = 1; i <= s_size; ++i) {
+    array<float, 3> s_i;
+    if (!next_s(s_i)) return numeric_limits<float>::quiet_NaN();
+    float *row = dtw_matrix + i * columns;
+    const float *above = row - columns;
+    for (size_t j = 1; j <= t_size; ++j) {
+      float cost = euclidean_distance(s_i, t[j - 1]);
+      row[j] = cost + min({above[j], row[j - 1], above[j - 1]});
+    }
+  }
+
+  return dtw_matrix[s_size * columns + t_size];
+}
+
+/**
+ * @brief Scale every sample to unit length (samples at rest are left as is)
+ * @param data: the gyro data to normalize in place
+ */
+void normalize(vector<array<float, 3>> &data);
+
+/**
+ * @brief Scale one sample to unit length, as normalize() does
+ * @param point: the sample, normalized in place
  */
-vector<array<float, 3>> readGyroDataFromFlash(uint32_t flash_address,
-                                              size_t data_size);
+static inline void normalize_sample(array<float, 3> &point) {
+  float magnitude =
+      sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]);
+  if (magnitude > 0) {
+    point[0] /= magnitude;
+    point[1] /= magnitude;
+    point[2] /= magnitude;
+  }
+}
 
 /**
- * @brief Store gyro data to flash memory
- * @param gesture_key: the gyro data to store
- * @param flash_address: the address in flash to store the data
- * @return true if data is stored successfully, false otherwise
+ * @brief Moving average over the last WINDOW_SIZE values
+ * @param new_value: the value to add
+ * @param buffer: the window
+ * @param index: the next slot of the window to overwrite
+ * @param sum: running sum of the window
+ * @return the average of the window
  */
-bool storeGyroDataToFlash(vector<array<float, 3>> &gesture_key,
-                          uint32_t flash_address);
+float movingAverageFilter(float new_value, array<float, WINDOW_SIZE> &buffer,
+                          size_t &index, float &sum);
 
 #endif  // UTILITIES_H